@@ -134,6 +134,20 @@ function(parse_automake AM_FILE_NAME)
     list(APPEND AM_TARGETS ${AM_TARGET})
   endforeach()
 
+  foreach(AM_FILE ${check_PROGRAMS})
+    string(REPLACE "." "_" AM_NAME "${AM_FILE}")
+    am_add_target(bin ${AM_FOLDER} ${AM_FILE} "${${AM_NAME}_SOURCES}" "${${AM_NAME}_LDADD}")
+
+    am_target_name(${AM_FOLDER} ${AM_FILE} AM_TARGET)
+    set(${AM_TARGET}_LINK_TARGETS ${${AM_TARGET}_LINK_TARGETS} PARENT_SCOPE)
+    list(APPEND AM_TARGETS ${AM_TARGET})
+
+    list(FIND TESTS ${AM_FILE} AM_TEST_INDEX)
+    if(NOT AM_TEST_INDEX EQUAL -1)
+      add_test(NAME ${AM_TARGET} COMMAND ${AM_TARGET})
+    endif()
+  endforeach()
+
   set(AM_TARGETS ${AM_TARGETS} PARENT_SCOPE)
 endfunction()
 
@@ -36,6 +36,7 @@ Currently, the following tools are included:
 
 * gff2xml: Convert BioWare GFF to XML
 * tlk2xml: Convert BioWare TLK to XML
+* tlksearch: Search for strings in BioWare TLK files
 * ssf2xml: Convert BioWare SSF to XML
 * xml2tlk: Convert XML back to BioWare TLK
 * xml2ssf: Convert XML back to BioWare SSF
@@ -54,6 +55,12 @@ Currently, the following tools are included:
 * cbgt2tga: Convert CBGT images into TGA
 * cdpth2tga: Convert CDPTH depth images into TGA
 * ncsdis: Disassemble NWScript bytecode
+* ncsrun: Run NWScript bytecode with stubbed engine functions
+* ncsxref: Index and query cross-references of NWScript bytecode
+* ncsasm: Assemble NWScript bytecode
+* texpack2tga: Convert all textures in ERF, RIM or KEY/BIF archives into TGA
+* tga2tpc: Convert TGA images into TPC or DDS textures
+* texdedup: Find duplicate textures within BioWare archives
 
 %prep
 %setup -q
@@ -85,7 +92,14 @@ rm %{buildroot}%{_pkgdocdir}/*
 %{_bindir}/nbfs2tga
 %{_bindir}/ncgr2tga
 %{_bindir}/ncsdis
+%{_bindir}/ncsrun
+%{_bindir}/ncsxref
+%{_bindir}/ncsasm
+%{_bindir}/texpack2tga
+%{_bindir}/tga2tpc
+%{_bindir}/texdedup
 %{_bindir}/tlk2xml
+%{_bindir}/tlksearch
 %{_bindir}/ssf2xml
 %{_bindir}/unerf
 %{_bindir}/unherf
@@ -107,7 +121,14 @@ rm %{buildroot}%{_pkgdocdir}/*
 %{_mandir}/man1/nbfs2tga.1.*
 %{_mandir}/man1/ncgr2tga.1.*
 %{_mandir}/man1/ncsdis.1.*
+%{_mandir}/man1/ncsrun.1.*
+%{_mandir}/man1/ncsxref.1.*
+%{_mandir}/man1/ncsasm.1.*
+%{_mandir}/man1/texpack2tga.1.*
+%{_mandir}/man1/tga2tpc.1.*
+%{_mandir}/man1/texdedup.1.*
 %{_mandir}/man1/tlk2xml.1.*
+%{_mandir}/man1/tlksearch.1.*
 %{_mandir}/man1/ssf2xml.1.*
 %{_mandir}/man1/unerf.1.*
 %{_mandir}/man1/unherf.1.*
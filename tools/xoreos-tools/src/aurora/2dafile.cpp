@@ -27,9 +27,11 @@
  */
 
 #include <cassert>
+#include <cctype>
 
 #include "src/common/util.h"
 #include "src/common/error.h"
+#include "src/common/hash.h"
 #include "src/common/strutil.h"
 #include "src/common/encoding.h"
 #include "src/common/readstream.h"
@@ -63,7 +65,7 @@ const Common::UString &TwoDARow::getString(size_t column) const {
 	return cell;
 }
 
-const Common::UString &TwoDARow::getString(const Common::UString &column) const {
+const Common::UString &TwoDARow::getString(const Common::UStringView &column) const {
 	const Common::UString &cell = getCell(_parent->headerToColumn(column));
 	if (cell.empty() || (cell == "****"))
 		return _parent->_defaultString;
@@ -79,7 +81,7 @@ int32 TwoDARow::getInt(size_t column) const {
 	return _parent->parseInt(cell);
 }
 
-int32 TwoDARow::getInt(const Common::UString &column) const {
+int32 TwoDARow::getInt(const Common::UStringView &column) const {
 	const Common::UString &cell = getCell(_parent->headerToColumn(column));
 	if (cell.empty() || (cell == "****"))
 		return _parent->_defaultInt;
@@ -95,7 +97,7 @@ float TwoDARow::getFloat(size_t column) const {
 	return _parent->parseFloat(cell);
 }
 
-float TwoDARow::getFloat(const Common::UString &column) const {
+float TwoDARow::getFloat(const Common::UStringView &column) const {
 	const Common::UString &cell = getCell(_parent->headerToColumn(column));
 	if (cell.empty() || (cell == "****"))
 		return _parent->_defaultFloat;
@@ -111,7 +113,7 @@ bool TwoDARow::empty(size_t column) const {
 	return false;
 }
 
-bool TwoDARow::empty(const Common::UString &column) const {
+bool TwoDARow::empty(const Common::UStringView &column) const {
 	return empty(_parent->headerToColumn(column));
 }
 
@@ -347,7 +349,9 @@ void TwoDAFile::readRows2b(Common::SeekableReadStream &twoda) {
 				throw;
 			}
 
-			_rows[i]->_data[j] = tokenize.getToken(twoda);
+			Common::UString cell = tokenize.getToken(twoda);
+			_rows[i]->_data[j].swap(cell);
+
 			if (_rows[i]->_data[j].empty())
 				_rows[i]->_data[j] = "****";
 		}
@@ -358,7 +362,24 @@ void TwoDAFile::readRows2b(Common::SeekableReadStream &twoda) {
 
 void TwoDAFile::createHeaderMap() {
 	for (size_t i = 0; i < _headers.size(); i++)
-		_headerMap.insert(std::make_pair(_headers[i], i));
+		_headerMap.insert(std::make_pair(hashHeader(_headers[i]), i));
+}
+
+uint32 TwoDAFile::hashHeader(const Common::UStringView &header) {
+	/* Only ASCII characters have a case mapping, and bytes < 0x80 are
+	 * always ASCII characters in UTF-8. Lowercasing just those gives a
+	 * hash that agrees with UStringView::equalsIgnoreCase(). */
+	uint32 hash = 0x811C9DC5;
+
+	for (size_t i = 0; i < header.size(); i++) {
+		byte c = header.data()[i];
+		if (!(c & 0x80))
+			c = std::tolower(c);
+
+		hash = Common::hashFNV32(hash, c);
+	}
+
+	return hash;
 }
 
 void TwoDAFile::load(const GDAFile &gda) {
@@ -434,13 +455,18 @@ const std::vector<Common::UString> &TwoDAFile::getHeaders() const {
 	return _headers;
 }
 
-size_t TwoDAFile::headerToColumn(const Common::UString &header) const {
-	HeaderMap::const_iterator column = _headerMap.find(header);
-	if (column == _headerMap.end())
-		// No such header
-		return kFieldIDInvalid;
+size_t TwoDAFile::headerToColumn(const Common::UStringView &header) const {
+	std::pair<HeaderMap::const_iterator, HeaderMap::const_iterator> columns =
+		_headerMap.equal_range(hashHeader(header));
+
+	/* Columns with the same hash are kept in the order they were inserted,
+	 * so in case of duplicate headers, the first column wins. */
+	for (HeaderMap::const_iterator column = columns.first; column != columns.second; ++column)
+		if (header.equalsIgnoreCase(_headers[column->second]))
+			return column->second;
 
-	return column->second;
+	// No such header
+	return kFieldIDInvalid;
 }
 
 const TwoDARow &TwoDAFile::getRow(size_t row) const {
@@ -451,13 +477,13 @@ const TwoDARow &TwoDAFile::getRow(size_t row) const {
 	return *_rows[row];
 }
 
-const TwoDARow &TwoDAFile::getRow(const Common::UString &header, const Common::UString &value) const {
+const TwoDARow &TwoDAFile::getRow(const Common::UStringView &header, const Common::UStringView &value) const {
 	size_t columnIndex = headerToColumn(header);
 	if (columnIndex == kFieldIDInvalid)
 		return _emptyRow;
 
 	for (std::vector<TwoDARow *>::const_iterator row = _rows.begin(); row != _rows.end(); ++row) {
-		if ((*row)->getString(columnIndex).equalsIgnoreCase(value))
+		if (value.equalsIgnoreCase((*row)->getString(columnIndex)))
 			return **row;
 	}
 
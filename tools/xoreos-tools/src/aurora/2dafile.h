@@ -30,6 +30,7 @@
 
 #include "src/common/types.h"
 #include "src/common/ustring.h"
+#include "src/common/ustringview.h"
 
 #include "src/aurora/aurorafile.h"
 
@@ -60,22 +61,22 @@ public:
 	/** Return the contents of a cell as a string. */
 	const Common::UString &getString(size_t column) const;
 	/** Return the contents of a cell as a string. */
-	const Common::UString &getString(const Common::UString &column) const;
+	const Common::UString &getString(const Common::UStringView &column) const;
 
 	/** Return the contents of a cell as an int. */
 	int32 getInt(size_t column) const;
 	/** Return the contents of a cell as an int. */
-	int32 getInt(const Common::UString &column) const;
+	int32 getInt(const Common::UStringView &column) const;
 
 	/** Return the contents of a cell as a float. */
 	float getFloat(size_t column) const;
 	/** Return the contents of a cell as a float. */
-	float getFloat(const Common::UString &column) const;
+	float getFloat(const Common::UStringView &column) const;
 
 	/** Check if the cell is empty. */
 	bool empty(size_t column) const;
 	/** Check if the cell is empty. */
-	bool empty(const Common::UString &column) const;
+	bool empty(const Common::UStringView &column) const;
 
 private:
 	TwoDAFile *_parent; ///< The parent 2DA.
@@ -130,14 +131,17 @@ public:
 	/** Return the columns' headers. */
 	const std::vector<Common::UString> &getHeaders() const;
 
-	/** Translate a column header to a column index. */
-	size_t headerToColumn(const Common::UString &header) const;
+	/** Translate a column header to a column index.
+	 *
+	 *  Headers are matched case-insensitively. This does not allocate any memory.
+	 */
+	size_t headerToColumn(const Common::UStringView &header) const;
 
 	/** Get a row. */
 	const TwoDARow &getRow(size_t row) const;
 
 	/** Get a row whose value in the column named header is the given string value. */
-	const TwoDARow &getRow(const Common::UString &header, const Common::UString &value) const;
+	const TwoDARow &getRow(const Common::UStringView &header, const Common::UStringView &value) const;
 
 	// .--- 2DA file writers
 	/** Write the 2DA data into an V2.0 ASCII 2DA. */
@@ -157,7 +161,8 @@ public:
 	// '---
 
 private:
-	typedef std::map<Common::UString, size_t, Common::UString::iless> HeaderMap;
+	/** Column indices, indexed by the case-insensitive hash of their headers. */
+	typedef std::multimap<uint32, size_t> HeaderMap;
 
 	Common::UString _defaultString; ///< The default string to return should a cell not exist.
 	int32           _defaultInt;    ///< The default int to return should a cell not exist.
@@ -190,6 +195,8 @@ private:
 
 	void createHeaderMap();
 
+	static uint32 hashHeader(const Common::UStringView &header);
+
 	static int32 parseInt(const Common::UString &str);
 	static float parseFloat(const Common::UString &str);
 
@@ -53,9 +53,9 @@ uint32 Archive::findResource(uint64 hash) const {
 	return 0xFFFFFFFF;
 }
 
-uint32 Archive::findResource(const Common::UString &name, FileType type) const {
+uint32 Archive::findResource(const Common::UStringView &name, FileType type) const {
 	for (ResourceList::const_iterator r = getResources().begin(); r != getResources().end(); ++r)
-		if ((r->type == type) && (r->name == name))
+		if ((r->type == type) && name.equals(r->name))
 			return r->index;
 
 	return 0xFFFFFFFF;
@@ -29,6 +29,7 @@
 
 #include "src/common/types.h"
 #include "src/common/ustring.h"
+#include "src/common/ustringview.h"
 #include "src/common/hash.h"
 
 #include "src/aurora/types.h"
@@ -77,7 +78,7 @@ public:
 	/** Return the index of the resource matching the hash, or 0xFFFFFFFF if not found. */
 	uint32 findResource(uint64 hash) const;
 	/** Return the index of the resource matching the name and type, or 0xFFFFFFFF if not found. */
-	uint32 findResource(const Common::UString &name, FileType type) const;
+	uint32 findResource(const Common::UStringView &name, FileType type) const;
 };
 
 } // End of namespace Aurora
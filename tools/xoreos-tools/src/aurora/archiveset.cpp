@@ -0,0 +1,130 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+/** @file
+ *  A set of archive files, opened for tools working on many resources at once.
+ */
+
+#include "src/common/util.h"
+#include "src/common/error.h"
+#include "src/common/readfile.h"
+#include "src/common/filepath.h"
+
+#include "src/aurora/archiveset.h"
+#include "src/aurora/erffile.h"
+#include "src/aurora/rimfile.h"
+#include "src/aurora/keyfile.h"
+#include "src/aurora/biffile.h"
+
+namespace Aurora {
+
+ArchiveSet::ArchiveSet() {
+}
+
+ArchiveSet::~ArchiveSet() {
+	for (std::vector<Archive *>::iterator a = _archives.begin(); a != _archives.end(); ++a)
+		delete *a;
+}
+
+void ArchiveSet::open(const Common::UString &file) {
+	uint32 id;
+	{
+		Common::ReadFile archive(file);
+		id = archive.readUint32BE();
+	}
+
+	if (id == MKTAG('K', 'E', 'Y', ' ')) {
+		openKEY(file);
+		return;
+	}
+
+	if (id == MKTAG('B', 'I', 'F', 'F'))
+		throw Common::Exception("\"%s\" is a BIF; please specify the KEY indexing it instead", file.c_str());
+
+	if (id == MKTAG('R', 'I', 'M', ' '))
+		add(new RIMFile(new Common::ReadFile(file)), file);
+	else
+		add(new ERFFile(new Common::ReadFile(file)), file);
+}
+
+void ArchiveSet::openKEY(const Common::UString &file) {
+	Common::ReadFile keyFile(file);
+	KEYFile key(keyFile);
+
+	Common::UString directory = Common::FilePath::getDirectory(file);
+	if (!directory.empty())
+		directory += "/";
+
+	const KEYFile::BIFList &bifs = key.getBIFs();
+	for (uint32 i = 0; i < bifs.size(); i++) {
+		const Common::UString bifFile = directory + bifs[i];
+
+		BIFFile *bif = 0;
+		try {
+			bif = new BIFFile(new Common::ReadFile(bifFile));
+			bif->mergeKEY(key, i);
+		} catch (...) {
+			delete bif;
+
+			Common::exceptionDispatcherWarnAndIgnore("Skipping BIF \"" + bifFile + "\"");
+			continue;
+		}
+
+		add(bif, bifFile);
+	}
+}
+
+void ArchiveSet::add(Archive *archive, const Common::UString &file) {
+	try {
+		_archives.push_back(archive);
+	} catch (...) {
+		delete archive;
+		throw;
+	}
+
+	_files.push_back(file);
+}
+
+size_t ArchiveSet::size() const {
+	return _archives.size();
+}
+
+const Archive &ArchiveSet::getArchive(size_t n) const {
+	if (n >= _archives.size())
+		throw Common::Exception("ArchiveSet::getArchive(): Invalid archive %u", (uint)n);
+
+	return *_archives[n];
+}
+
+const Common::UString &ArchiveSet::getFile(size_t n) const {
+	if (n >= _files.size())
+		throw Common::Exception("ArchiveSet::getFile(): Invalid archive %u", (uint)n);
+
+	return _files[n];
+}
+
+Common::SeekableReadStream *ArchiveSet::getResource(size_t n, uint32 index) const {
+	const Archive &archive = getArchive(n);
+
+	Common::StackLock lock(_mutex);
+
+	return archive.getResource(index);
+}
+
+} // End of namespace Aurora
@@ -0,0 +1,84 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+/** @file
+ *  A set of archive files, opened for tools working on many resources at once.
+ */
+
+#ifndef AURORA_ARCHIVESET_H
+#define AURORA_ARCHIVESET_H
+
+#include <vector>
+
+#include "src/common/types.h"
+#include "src/common/ustring.h"
+#include "src/common/noncopyable.h"
+#include "src/common/mutex.h"
+
+namespace Common {
+	class SeekableReadStream;
+}
+
+namespace Aurora {
+
+class Archive;
+
+/** A set of archive files, as given on the command line of a batch tool.
+ *
+ *  ERF files (including MOD, HAK, SAV and NWM files) and RIM files are opened
+ *  directly. For a KEY file, all the BIF files it indexes are opened, looked
+ *  for relative to the directory the KEY file is in. BIF files that can't be
+ *  opened are skipped with a warning.
+ *
+ *  Since every archive reads from a single file, reading resources out of
+ *  the archives is serialized. getResource() can be called from several
+ *  threads at once.
+ */
+class ArchiveSet : Common::NonCopyable {
+public:
+	ArchiveSet();
+	~ArchiveSet();
+
+	/** Open an ERF, RIM or KEY file and add its archives to the set. */
+	void open(const Common::UString &file);
+
+	/** Return the number of archives in the set. */
+	size_t size() const;
+
+	/** Return this archive. */
+	const Archive &getArchive(size_t n) const;
+	/** Return the file this archive was opened from. */
+	const Common::UString &getFile(size_t n) const;
+
+	/** Return a stream of the contents of this resource in this archive. */
+	Common::SeekableReadStream *getResource(size_t n, uint32 index) const;
+
+private:
+	std::vector<Archive *> _archives;
+	std::vector<Common::UString> _files;
+
+	mutable Common::Mutex _mutex;
+
+	void add(Archive *archive, const Common::UString &file);
+	void openKEY(const Common::UString &file);
+};
+
+} // End of namespace Aurora
+
+#endif // AURORA_ARCHIVESET_H
@@ -96,6 +96,7 @@ void GFF3File::load(uint32 id) {
 	try {
 
 		loadHeader(id);
+		loadLabels();
 		loadStructs();
 		loadLists();
 
@@ -180,9 +181,35 @@ void GFF3File::loadHeader(uint32 id) {
 		throw Common::Exception("GFF3 header broken: section offset points outside stream");
 }
 
+void GFF3File::loadLabels() {
+	/* Intern all labels found in the GFF3 once, so that the structs only need to
+	 * remember their label IDs. A label is a string of up to 16 ASCII characters,
+	 * filled up with \0 bytes when shorter. */
+
+	static const uint32 kLabelSize = 16;
+
+	_stream->seek(_header.labelOffset);
+
+	_labels.resize(_header.labelCount);
+	for (uint32 i = 0; i < _header.labelCount; i++) {
+		char label[kLabelSize];
+
+		const size_t size = _stream->read(label, kLabelSize);
+
+		size_t length = 0;
+		while ((length < size) && (label[length] != '\0'))
+			length++;
+
+		_labels[i] = GFFLabels.intern(label, length);
+	}
+}
+
 void GFF3File::loadStructs() {
 	static const uint32 kStructSize = 12;
 
+	// Every field is referenced by exactly one struct in well-formed GFF3s
+	_fieldLabels.reserve(_header.fieldCount);
+
 	_structs.reserve(_header.structCount);
 	for (uint32 i = 0; i < _header.structCount; i++)
 		_structs.push_back(new GFF3Struct(*this, _header.structOffset + i * kStructSize));
@@ -257,6 +284,13 @@ const GFF3Struct &GFF3File::getStruct(uint32 i) const {
 	return *_structs[i];
 }
 
+GFFLabelID GFF3File::getLabel(uint32 i) const {
+	if (i >= _labels.size())
+		throw Common::Exception("GFF3: Label index out of range (%u >= %u)", i, (uint) _labels.size());
+
+	return _labels[i];
+}
+
 const GFF3List &GFF3File::getList(uint32 i) const {
 	if (i >= _listOffsetToIndex.size())
 		throw Common::Exception("GFF3: List offset index out of range (%u >= %u)",
@@ -301,8 +335,8 @@ GFF3Struct::Field::Field(FieldType t, uint32 d) : type(t), data(d) {
 }
 
 
-GFF3Struct::GFF3Struct(const GFF3File &parent, uint32 offset) : _parent(&parent) {
-	load(offset);
+GFF3Struct::GFF3Struct(GFF3File &parent, uint32 offset) : _parent(&parent) {
+	load(parent, offset);
 }
 
 GFF3Struct::~GFF3Struct() {
@@ -314,21 +348,24 @@ uint32 GFF3Struct::getID() const {
 
 // --- Loader ---
 
-void GFF3Struct::load(uint32 offset) {
-	Common::SeekableReadStream &data = _parent->getStream(offset);
+void GFF3Struct::load(GFF3File &parent, uint32 offset) {
+	Common::SeekableReadStream &data = parent.getStream(offset);
 
 	_id         = data.readUint32LE();
 	_fieldIndex = data.readUint32LE();
 	_fieldCount = data.readUint32LE();
 
+	// Our label IDs will be appended to the parent's list of field labels
+	_labelIndex = parent._fieldLabels.size();
+
 	// Read the field(s)
 	if      (_fieldCount == 1)
-		readField (data, _fieldIndex);
+		readField (parent, data, _fieldIndex);
 	else if (_fieldCount > 1)
-		readFields(data, _fieldIndex, _fieldCount);
+		readFields(parent, data, _fieldIndex, _fieldCount);
 }
 
-void GFF3Struct::readField(Common::SeekableReadStream &data, uint32 index) {
+void GFF3Struct::readField(GFF3File &parent, Common::SeekableReadStream &data, uint32 index) {
 	// Sanity check
 	if (index > _parent->_header.fieldCount)
 		throw Common::Exception("GFF3: Field index out of range (%d/%d)",
@@ -342,16 +379,13 @@ void GFF3Struct::readField(Common::SeekableReadStream &data, uint32 index) {
 	const uint32 fieldLabel = data.readUint32LE();
 	const uint32 fieldData  = data.readUint32LE();
 
-	// Read the name
-	Common::UString fieldName = readLabel(data, fieldLabel);
-
-	// And add the field to the map and name list
-	_fields[fieldName] = Field((FieldType) fieldType, fieldData);
+	// And add the field and its label ID
+	parent._fieldLabels.push_back(parent.getLabel(fieldLabel));
 
-	_fieldNames.push_back(fieldName);
+	_fields.push_back(Field((FieldType) fieldType, fieldData));
 }
 
-void GFF3Struct::readFields(Common::SeekableReadStream &data, uint32 index, uint32 count) {
+void GFF3Struct::readFields(GFF3File &parent, Common::SeekableReadStream &data, uint32 index, uint32 count) {
 	// Sanity check
 	if (index > _parent->_header.fieldIndicesCount)
 		throw Common::Exception("GFF3: Field indices index out of range (%d/%d)",
@@ -365,8 +399,9 @@ void GFF3Struct::readFields(Common::SeekableReadStream &data, uint32 index, uint
 	readIndices(data, indices, count);
 
 	// Read the fields
+	_fields.reserve(count);
 	for (std::vector<uint32>::const_iterator i = indices.begin(); i != indices.end(); ++i)
-		readField(data, *i);
+		readField(parent, data, *i);
 }
 
 void GFF3Struct::readIndices(Common::SeekableReadStream &data,
@@ -376,12 +411,6 @@ void GFF3Struct::readIndices(Common::SeekableReadStream &data,
 		indices.push_back(data.readUint32LE());
 }
 
-Common::UString GFF3Struct::readLabel(Common::SeekableReadStream &data, uint32 index) const {
-	data.seek(_parent->_header.labelOffset + index * 16);
-
-	return Common::readStringFixed(data, Common::kEncodingASCII, 16);
-}
-
 Common::SeekableReadStream &GFF3Struct::getData(const Field &field) const {
 	assert(field.extended);
 
@@ -397,15 +426,30 @@ size_t GFF3Struct::getFieldCount() const {
 	return _fields.size();
 }
 
-bool GFF3Struct::hasField(const Common::UString &field) const {
+bool GFF3Struct::hasField(const Common::UStringView &field) const {
+	return getField(field) != 0;
+}
+
+bool GFF3Struct::hasField(GFFLabelID field) const {
 	return getField(field) != 0;
 }
 
-const std::vector<Common::UString> &GFF3Struct::getFieldNames() const {
-	return _fieldNames;
+GFFLabelSpan GFF3Struct::getFieldLabels() const {
+	if (_fields.empty())
+		return GFFLabelSpan();
+
+	return GFFLabelSpan(&_parent->_fieldLabels[_labelIndex], _fields.size());
+}
+
+GFF3Struct::FieldType GFF3Struct::getFieldType(const Common::UStringView &field) const {
+	const Field *f = getField(field);
+	if (!f)
+		return kFieldTypeNone;
+
+	return f->type;
 }
 
-GFF3Struct::FieldType GFF3Struct::getFieldType(const Common::UString &field) const {
+GFF3Struct::FieldType GFF3Struct::getFieldType(GFFLabelID field) const {
 	const Field *f = getField(field);
 	if (!f)
 		return kFieldTypeNone;
@@ -415,15 +459,28 @@ GFF3Struct::FieldType GFF3Struct::getFieldType(const Common::UString &field) con
 
 // --- Field value reader helpers ---
 
-const GFF3Struct::Field *GFF3Struct::getField(const Common::UString &name) const {
-	FieldMap::const_iterator field = _fields.find(name);
-	if (field == _fields.end())
+const GFF3Struct::Field *GFF3Struct::getField(const Common::UStringView &name) const {
+	// A label that was never interned can't be the label of any of our fields
+	const GFFLabelID label = GFFLabels.find(name);
+	if (label == kGFFLabelNone)
 		return 0;
 
-	return &field->second;
+	return getField(label);
+}
+
+const GFF3Struct::Field *GFF3Struct::getField(GFFLabelID label) const {
+	const GFFLabelSpan labels = getFieldLabels();
+
+	/* Search backwards, so that, in case of a broken GFF3 with a duplicate
+	 * label within a struct, the last field with that label wins. */
+	for (size_t i = labels.size(); i-- > 0; )
+		if (labels[i] == label)
+			return &_fields[i];
+
+	return 0;
 }
 
-char GFF3Struct::getChar(const Common::UString &field, char def) const {
+char GFF3Struct::getChar(const Common::UStringView &field, char def) const {
 	const Field *f = getField(field);
 	if (!f)
 		return def;
@@ -433,7 +490,7 @@ char GFF3Struct::getChar(const Common::UString &field, char def) const {
 	return (char) f->data;
 }
 
-uint64 GFF3Struct::getUint(const Common::UString &field, uint64 def) const {
+uint64 GFF3Struct::getUint(const Common::UStringView &field, uint64 def) const {
 	const Field *f = getField(field);
 	if (!f)
 		return def;
@@ -470,7 +527,7 @@ uint64 GFF3Struct::getUint(const Common::UString &field, uint64 def) const {
 	throw Common::Exception("GFF3: Field is not an int type");
 }
 
-int64 GFF3Struct::getSint(const Common::UString &field, int64 def) const {
+int64 GFF3Struct::getSint(const Common::UStringView &field, int64 def) const {
 	const Field *f = getField(field);
 	if (!f)
 		return def;
@@ -507,11 +564,11 @@ int64 GFF3Struct::getSint(const Common::UString &field, int64 def) const {
 	throw Common::Exception("GFF3: Field is not an int type");
 }
 
-bool GFF3Struct::getBool(const Common::UString &field, bool def) const {
+bool GFF3Struct::getBool(const Common::UStringView &field, bool def) const {
 	return getUint(field, def) != 0;
 }
 
-double GFF3Struct::getDouble(const Common::UString &field, double def) const {
+double GFF3Struct::getDouble(const Common::UStringView &field, double def) const {
 	const Field *f = getField(field);
 	if (!f)
 		return def;
@@ -524,7 +581,7 @@ double GFF3Struct::getDouble(const Common::UString &field, double def) const {
 	throw Common::Exception("GFF3: Field is not a double type");
 }
 
-Common::UString GFF3Struct::getString(const Common::UString &field,
+Common::UString GFF3Struct::getString(const Common::UStringView &field,
                                       const Common::UString &def) const {
 
 	const Field *f = getField(field);
@@ -611,7 +668,7 @@ Common::UString GFF3Struct::getString(const Common::UString &field,
 	throw Common::Exception("GFF3: Field is not a string(able) type");
 }
 
-bool GFF3Struct::getLocString(const Common::UString &field, LocString &str) const {
+bool GFF3Struct::getLocString(const Common::UStringView &field, LocString &str) const {
 	const Field *f = getField(field);
 	if (!f || (f->type != kFieldTypeLocString))
 		return false;
@@ -635,7 +692,7 @@ bool GFF3Struct::getLocString(const Common::UString &field, LocString &str) cons
 	return true;
 }
 
-Common::SeekableReadStream *GFF3Struct::getData(const Common::UString &field) const {
+Common::SeekableReadStream *GFF3Struct::getData(const Common::UStringView &field) const {
 	const Field *f = getField(field);
 	if (!f)
 		return 0;
@@ -653,7 +710,7 @@ Common::SeekableReadStream *GFF3Struct::getData(const Common::UString &field) co
 	return data.readStream(size);
 }
 
-void GFF3Struct::getVector(const Common::UString &field,
+void GFF3Struct::getVector(const Common::UStringView &field,
                            float &x, float &y, float &z) const {
 
 	const Field *f = getField(field);
@@ -669,7 +726,7 @@ void GFF3Struct::getVector(const Common::UString &field,
 	z = data.readIEEEFloatLE();
 }
 
-void GFF3Struct::getOrientation(const Common::UString &field,
+void GFF3Struct::getOrientation(const Common::UStringView &field,
                                 float &a, float &b, float &c, float &d) const {
 
 	const Field *f = getField(field);
@@ -686,7 +743,7 @@ void GFF3Struct::getOrientation(const Common::UString &field,
 	d = data.readIEEEFloatLE();
 }
 
-void GFF3Struct::getVector(const Common::UString &field,
+void GFF3Struct::getVector(const Common::UStringView &field,
                            double &x, double &y, double &z) const {
 
 	const Field *f = getField(field);
@@ -702,7 +759,7 @@ void GFF3Struct::getVector(const Common::UString &field,
 	z = data.readIEEEFloatLE();
 }
 
-void GFF3Struct::getOrientation(const Common::UString &field,
+void GFF3Struct::getOrientation(const Common::UStringView &field,
                                 double &a, double &b, double &c, double &d) const {
 
 	const Field *f = getField(field);
@@ -721,7 +778,7 @@ void GFF3Struct::getOrientation(const Common::UString &field,
 
 // --- Struct reader ---
 
-const GFF3Struct &GFF3Struct::getStruct(const Common::UString &field) const {
+const GFF3Struct &GFF3Struct::getStruct(const Common::UStringView &field) const {
 	const Field *f = getField(field);
 	if (!f)
 		throw Common::Exception("GFF3: No such field");
@@ -734,7 +791,7 @@ const GFF3Struct &GFF3Struct::getStruct(const Common::UString &field) const {
 
 // --- Struct list reader ---
 
-const GFF3List &GFF3Struct::getList(const Common::UString &field) const {
+const GFF3List &GFF3Struct::getList(const Common::UStringView &field) const {
 	const Field *f = getField(field);
 	if (!f)
 		throw Common::Exception("GFF3: No such field");
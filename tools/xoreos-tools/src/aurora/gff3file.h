@@ -26,13 +26,14 @@
 #define AURORA_GFF3FILE_H
 
 #include <vector>
-#include <map>
 
 #include "src/common/types.h"
 #include "src/common/ustring.h"
+#include "src/common/ustringview.h"
 
 #include "src/aurora/types.h"
 #include "src/aurora/aurorafile.h"
+#include "src/aurora/gfflabels.h"
 
 namespace Common {
 	class SeekableReadStream;
@@ -125,10 +126,16 @@ private:
 	/** To convert list offsets found in GFF3 to real indices. */
 	std::vector<uint32> _listOffsetToIndex;
 
+	/** The interned IDs of all labels found in the GFF3's label section. */
+	std::vector<GFFLabelID> _labels;
+	/** The label IDs of all fields of all structs, one contiguous range for each struct. */
+	std::vector<GFFLabelID> _fieldLabels;
+
 
 	// .--- Loading helpers
 	void load(uint32 id);
 	void loadHeader(uint32 id);
+	void loadLabels();
 	void loadStructs();
 	void loadLists();
 
@@ -145,6 +152,9 @@ private:
 	const GFF3Struct &getStruct(uint32 i) const;
 	/** Return a list within the GFF3. */
 	const GFF3List   &getList  (uint32 i) const;
+
+	/** Return the interned ID of a label within the GFF3's label section. */
+	GFFLabelID getLabel(uint32 i) const;
 	// '---
 
 	friend class GFF3Struct;
@@ -191,44 +201,51 @@ public:
 	/** Return the number of fields in this struct. */
 	size_t getFieldCount() const;
 	/** Does this specific field exist? */
-	bool hasField(const Common::UString &field) const;
+	bool hasField(const Common::UStringView &field) const;
+	/** Does this specific field, given by its interned label ID, exist? */
+	bool hasField(GFFLabelID field) const;
 
-	/** Return a list of all field names in this struct. */
-	const std::vector<Common::UString> &getFieldNames() const;
+	/** Return the interned label IDs of all fields in this struct.
+	 *
+	 *  The label strings can be looked up with GFFLabelManager::getLabel().
+	 */
+	GFFLabelSpan getFieldLabels() const;
 
 	/** Return the type of this field, or kFieldTypeNone if such a field doesn't exist. */
-	FieldType getFieldType(const Common::UString &field) const;
+	FieldType getFieldType(const Common::UStringView &field) const;
+	/** Return the type of this field, given by its interned label ID, or kFieldTypeNone. */
+	FieldType getFieldType(GFFLabelID field) const;
 
 
 	// .--- Read field values
-	char   getChar(const Common::UString &field, char   def = '\0' ) const;
-	uint64 getUint(const Common::UString &field, uint64 def = 0    ) const;
-	 int64 getSint(const Common::UString &field,  int64 def = 0    ) const;
-	bool   getBool(const Common::UString &field, bool   def = false) const;
+	char   getChar(const Common::UStringView &field, char   def = '\0' ) const;
+	uint64 getUint(const Common::UStringView &field, uint64 def = 0    ) const;
+	 int64 getSint(const Common::UStringView &field,  int64 def = 0    ) const;
+	bool   getBool(const Common::UStringView &field, bool   def = false) const;
 
-	double getDouble(const Common::UString &field, double def = 0.0) const;
+	double getDouble(const Common::UStringView &field, double def = 0.0) const;
 
-	Common::UString getString(const Common::UString &field,
+	Common::UString getString(const Common::UStringView &field,
 	                          const Common::UString &def = "") const;
 
-	bool getLocString(const Common::UString &field, LocString &str) const;
+	bool getLocString(const Common::UStringView &field, LocString &str) const;
 
-	void getVector     (const Common::UString &field,
+	void getVector     (const Common::UStringView &field,
 	                    float &x, float &y, float &z          ) const;
-	void getOrientation(const Common::UString &field,
+	void getOrientation(const Common::UStringView &field,
 	                    float &a, float &b, float &c, float &d) const;
 
-	void getVector     (const Common::UString &field,
+	void getVector     (const Common::UStringView &field,
 	                    double &x, double &y, double &z           ) const;
-	void getOrientation(const Common::UString &field,
+	void getOrientation(const Common::UStringView &field,
 	                    double &a, double &b, double &c, double &d) const;
 
-	Common::SeekableReadStream *getData(const Common::UString &field) const;
+	Common::SeekableReadStream *getData(const Common::UStringView &field) const;
 	// '---
 
 	// .--- Structs and lists of structs
-	const GFF3Struct &getStruct(const Common::UString &field) const;
-	const GFF3List   &getList  (const Common::UString &field) const;
+	const GFF3Struct &getStruct(const Common::UStringView &field) const;
+	const GFF3List   &getList  (const Common::UStringView &field) const;
 	// '---
 
 private:
@@ -242,38 +259,36 @@ private:
 		Field(FieldType t, uint32 d);
 	};
 
-	typedef std::map<Common::UString, Field> FieldMap;
-
-
 	const GFF3File *_parent; ///< The parent GFF3.
 
 	uint32 _id;         ///< The struct's ID.
 	uint32 _fieldIndex; ///< Field / Field indices index.
 	uint32 _fieldCount; ///< Field count.
 
-	FieldMap _fields; ///< The fields, indexed by their label.
+	/** Index of this struct's range of label IDs within the parent's field labels. */
+	size_t _labelIndex;
 
-	/** The names of all fields in this struct. */
-	std::vector<Common::UString> _fieldNames;
+	/** The fields, in the same order as their label IDs. */
+	std::vector<Field> _fields;
 
 
 	// .--- Loader
-	GFF3Struct(const GFF3File &parent, uint32 offset);
+	GFF3Struct(GFF3File &parent, uint32 offset);
 	~GFF3Struct();
 
-	void load(uint32 offset);
+	void load(GFF3File &parent, uint32 offset);
 
-	void readField  (Common::SeekableReadStream &data, uint32 index);
-	void readFields (Common::SeekableReadStream &data, uint32 index, uint32 count);
+	void readField  (GFF3File &parent, Common::SeekableReadStream &data, uint32 index);
+	void readFields (GFF3File &parent, Common::SeekableReadStream &data, uint32 index, uint32 count);
 	void readIndices(Common::SeekableReadStream &data,
 	                 std::vector<uint32> &indices, uint32 count) const;
-
-	Common::UString readLabel(Common::SeekableReadStream &data, uint32 index) const;
 	// '---
 
 	// .--- Field and field data accessors
 	/** Returns the field with this tag. */
-	const Field *getField(const Common::UString &name) const;
+	const Field *getField(const Common::UStringView &name) const;
+	/** Returns the field with this interned label ID. */
+	const Field *getField(GFFLabelID label) const;
 	/** Returns the extended field data for this field. */
 	Common::SeekableReadStream &getData(const Field &field) const;
 	// '---
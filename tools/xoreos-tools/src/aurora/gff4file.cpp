@@ -172,6 +172,7 @@ void GFF4File::loadStructs() {
 		// Read the field declarations
 
 		strct.fields.resize(fieldCount);
+		strct.fieldLabels.resize(fieldCount);
 		for (uint32 j = 0; j < fieldCount; j++) {
 			StructTemplate::Field &field = strct.fields[j];
 
@@ -179,6 +180,8 @@ void GFF4File::loadStructs() {
 			field.type   = _stream->readUint16LE();
 			field.flags  = _stream->readUint16LE();
 			field.offset = _stream->readUint32LE();
+
+			strct.fieldLabels[j] = field.label;
 		}
 	}
 
@@ -328,11 +331,13 @@ uint32 GFF4Struct::getLabel() const {
 // --- Loader ---
 
 void GFF4Struct::load(GFF4File &parent, uint32 offset, const GFF4File::StructTemplate &tmplt) {
+	// All structs of the same template have the same fields
+	if (!tmplt.fieldLabels.empty())
+		_fieldLabels = GFFLabelSpan(&tmplt.fieldLabels[0], tmplt.fieldLabels.size());
+
 	for (size_t i = 0; i < tmplt.fields.size(); i++) {
 		const GFF4File::StructTemplate::Field &field = tmplt.fields[i];
 
-		_fieldLabels.push_back(field.label);
-
 		// Calculate the offset for the field data, but guard against NULL pointers
 		uint32 fieldOffset = offset + field.offset;
 		if ((offset == 0xFFFFFFFF) || (field.offset == 0xFFFFFFFF))
@@ -410,7 +415,7 @@ void GFF4Struct::load(GFF4File &parent, const Field &genericParent) {
 		if (fieldOffset == 0xFFFFFFFF)
 			continue;
 
-		_fieldLabels.push_back(i);
+		_genericLabels.push_back(i);
 
 		// Load the field and its struct(s), if any
 		Field &f = _fields[i] = Field(i, fieldType, fieldFlags, fieldOffset, true);
@@ -418,6 +423,9 @@ void GFF4Struct::load(GFF4File &parent, const Field &genericParent) {
 			loadStructs(parent, f);
 	}
 
+	if (!_genericLabels.empty())
+		_fieldLabels = GFFLabelSpan(&_genericLabels[0], _genericLabels.size());
+
 	_fieldCount = genericCount;
 }
 
@@ -435,7 +443,7 @@ bool GFF4Struct::hasField(uint32 field) const {
 	return getField(field) != 0;
 }
 
-const std::vector<uint32> &GFF4Struct::getFieldLabels() const {
+GFFLabelSpan GFF4Struct::getFieldLabels() const {
 	return _fieldLabels;
 }
 
@@ -34,6 +34,7 @@
 
 #include "src/aurora/types.h"
 #include "src/aurora/aurorafile.h"
+#include "src/aurora/gfflabels.h"
 #include "src/aurora/gff4fields.h"
 
 namespace Common {
@@ -119,6 +120,9 @@ private:
 		uint32 size;
 
 		std::vector<Field> fields;
+
+		/** The labels of all fields, shared by all structs using this template. */
+		std::vector<GFFLabelID> fieldLabels;
 	};
 
 	typedef std::vector<StructTemplate> StructTemplates;
@@ -222,7 +226,7 @@ public:
 	bool hasField(uint32 field) const;
 
 	/** Return a list of all field labels in this struct. */
-	const std::vector<uint32> &getFieldLabels() const;
+	GFFLabelSpan getFieldLabels() const;
 
 	/** Return the type of this field, or kFieldTypeNone if it doesn't exist. */
 	FieldType getFieldType(uint32 field) const;
@@ -345,7 +349,10 @@ private:
 	FieldMap _fields;
 
 	/** The labels of all fields in this struct. */
-	std::vector<uint32> _fieldLabels;
+	GFFLabelSpan _fieldLabels;
+
+	/** The labels of all fields in this struct, if it's a generic without a template. */
+	std::vector<GFFLabelID> _genericLabels;
 
 
 	// .--- Loader
@@ -0,0 +1,117 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Process-wide interning of GFF field labels.
+ */
+
+#include "src/common/error.h"
+#include "src/common/hash.h"
+
+#include "src/aurora/gfflabels.h"
+
+DECLARE_SINGLETON(Aurora::GFFLabelManager)
+
+namespace Aurora {
+
+GFFLabelManager::GFFLabelManager() : _labelCount(0) {
+	for (size_t i = 0; i < kChunkCount; i++)
+		_labels[i] = 0;
+}
+
+GFFLabelManager::~GFFLabelManager() {
+	for (size_t i = 0; i < kChunkCount; i++)
+		delete[] _labels[i];
+}
+
+GFFLabelID GFFLabelManager::intern(const Common::UString &label) {
+	return internRaw(label);
+}
+
+GFFLabelID GFFLabelManager::intern(const char *label, size_t n) {
+	return internRaw(Common::UStringView(label, n));
+}
+
+GFFLabelID GFFLabelManager::internRaw(const Common::UStringView &label) {
+	Common::StackLock lock(_mutex);
+
+	const uint32 hash = hashLabel(label);
+
+	const GFFLabelID id = findRaw(label, hash);
+	if (id != kGFFLabelNone)
+		return id;
+
+	const size_t chunk = _labelCount / kChunkSize;
+	if (chunk >= kChunkCount)
+		throw Common::Exception("GFF label table full (%u labels)", (uint) _labelCount);
+
+	// Construct the string before touching the table, since it might throw on invalid UTF-8
+	Common::UString labelString = label.toString();
+
+	if (!_labels[chunk])
+		_labels[chunk] = new Common::UString[kChunkSize];
+
+	_labels[chunk][_labelCount % kChunkSize].swap(labelString);
+
+	_ids.insert(std::make_pair(hash, _labelCount));
+
+	return _labelCount++;
+}
+
+GFFLabelID GFFLabelManager::find(const Common::UStringView &label) const {
+	Common::StackLock lock(_mutex);
+
+	return findRaw(label, hashLabel(label));
+}
+
+GFFLabelID GFFLabelManager::findRaw(const Common::UStringView &label, uint32 hash) const {
+	std::pair<LabelMap::const_iterator, LabelMap::const_iterator> ids = _ids.equal_range(hash);
+
+	for (LabelMap::const_iterator id = ids.first; id != ids.second; ++id)
+		if (label.equals(getLabel(id->second)))
+			return id->second;
+
+	return kGFFLabelNone;
+}
+
+const Common::UString &GFFLabelManager::getLabel(GFFLabelID id) const {
+	const size_t chunk = id / kChunkSize;
+	if ((chunk >= kChunkCount) || !_labels[chunk])
+		throw Common::Exception("Invalid GFF label ID %u", id);
+
+	return _labels[chunk][id % kChunkSize];
+}
+
+size_t GFFLabelManager::getLabelCount() const {
+	Common::StackLock lock(_mutex);
+
+	return _labelCount;
+}
+
+uint32 GFFLabelManager::hashLabel(const Common::UStringView &label) {
+	uint32 hash = 0x811C9DC5;
+
+	for (size_t i = 0; i < label.size(); i++)
+		hash = Common::hashFNV32(hash, (byte) label.data()[i]);
+
+	return hash;
+}
+
+} // End of namespace Aurora
@@ -0,0 +1,152 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Process-wide interning of GFF field labels.
+ */
+
+#ifndef AURORA_GFFLABELS_H
+#define AURORA_GFFLABELS_H
+
+#include <map>
+
+#include "src/common/types.h"
+#include "src/common/singleton.h"
+#include "src/common/mutex.h"
+#include "src/common/ustring.h"
+#include "src/common/ustringview.h"
+
+namespace Aurora {
+
+/** The numerical ID of a GFF field label.
+ *
+ *  For GFF V3.2/V3.3, this is the ID of a string label interned in the
+ *  GFFLabelManager. GFF V4.0/V4.1 fields are natively labeled by numerical
+ *  values, which are used directly.
+ */
+typedef uint32 GFFLabelID;
+
+static const GFFLabelID kGFFLabelNone = 0xFFFFFFFF;
+
+/** A non-owning, contiguous range of GFF field label IDs. */
+class GFFLabelSpan {
+public:
+	typedef const GFFLabelID *const_iterator;
+
+	GFFLabelSpan() : _data(0), _size(0) {
+	}
+
+	GFFLabelSpan(const GFFLabelID *data, size_t size) : _data(data), _size(size) {
+	}
+
+	const_iterator begin() const {
+		return _data;
+	}
+
+	const_iterator end() const {
+		return _data + _size;
+	}
+
+	size_t size() const {
+		return _size;
+	}
+
+	bool empty() const {
+		return _size == 0;
+	}
+
+	GFFLabelID operator[](size_t i) const {
+		return _data[i];
+	}
+
+private:
+	const GFFLabelID *_data;
+	size_t _size;
+};
+
+/** A process-wide table of interned GFF field labels.
+ *
+ *  The same few hundred field labels ("Tag", "TemplateResRef", "LocName", ...)
+ *  are found over and over again in every GFF of a game. Instead of keeping
+ *  a copy of each label string for every field in every struct, the GFF
+ *  loaders intern the labels here, and only keep their IDs around. This
+ *  also lets two labels be compared by their IDs.
+ *
+ *  Interning and finding labels is thread-safe. Since an interned label
+ *  is never removed or moved, getLabel() can be called without locking.
+ *
+ *  Note: as with all our singletons, the instance itself needs to be
+ *  created before multiple threads start to use it.
+ */
+class GFFLabelManager : public Common::Singleton<GFFLabelManager> {
+public:
+	GFFLabelManager();
+	~GFFLabelManager();
+
+	/** Intern this label, returning its ID. */
+	GFFLabelID intern(const Common::UString &label);
+	/** Intern the label made up of the first n bytes of this UTF-8 string. */
+	GFFLabelID intern(const char *label, size_t n);
+
+	/** Return the ID of this label, or kGFFLabelNone if it has never been interned.
+	 *
+	 *  This does not allocate any memory.
+	 */
+	GFFLabelID find(const Common::UStringView &label) const;
+
+	/** Return the label string of this ID. */
+	const Common::UString &getLabel(GFFLabelID id) const;
+
+	/** Return the number of interned labels. */
+	size_t getLabelCount() const;
+
+private:
+	/** Number of labels in each chunk of label storage. */
+	static const size_t kChunkSize  = 1024;
+	/** Maximum number of chunks of label storage. */
+	static const size_t kChunkCount = 4096;
+
+	/** Label IDs, indexed by the hash of their label strings. */
+	typedef std::multimap<uint32, GFFLabelID> LabelMap;
+
+	mutable Common::Mutex _mutex;
+
+	/** The IDs of all interned labels. */
+	LabelMap _ids;
+
+	/** The label strings, allocated in chunks that are never moved or freed. */
+	Common::UString *_labels[kChunkCount];
+
+	/** The number of interned labels. */
+	GFFLabelID _labelCount;
+
+
+	GFFLabelID internRaw(const Common::UStringView &label);
+	GFFLabelID findRaw(const Common::UStringView &label, uint32 hash) const;
+
+	static uint32 hashLabel(const Common::UStringView &label);
+};
+
+} // End of namespace Aurora
+
+/** Shortcut for accessing the GFF label manager. */
+#define GFFLabels ::Aurora::GFFLabelManager::instance()
+
+#endif // AURORA_GFFLABELS_H
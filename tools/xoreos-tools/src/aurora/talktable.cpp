@@ -42,6 +42,10 @@ TalkTable::TalkTable(Common::Encoding encoding) : _encoding(encoding) {
 TalkTable::~TalkTable() {
 }
 
+Common::Encoding TalkTable::getEncoding() const {
+	return _encoding;
+}
+
 uint32 TalkTable::getLanguageID() const {
 	return kLanguageInvalid;
 }
@@ -25,7 +25,7 @@
 #ifndef AURORA_TALKTABLE_H
 #define AURORA_TALKTABLE_H
 
-#include <list>
+#include <vector>
 
 #include "src/common/types.h"
 #include "src/common/encoding.h"
@@ -53,10 +53,13 @@ class TalkTable {
 public:
 	virtual ~TalkTable();
 
+	/** Return the encoding the strings in this talk table are read with. */
+	Common::Encoding getEncoding() const;
+
 	virtual uint32 getLanguageID() const;
 	virtual void setLanguageID(uint32 id);
 
-	virtual const std::list<uint32> &getStrRefs() const = 0;
+	virtual const std::vector<uint32> &getStrRefs() const = 0;
 	virtual bool getString(uint32 strRef, Common::UString &string, Common::UString &soundResRef) const = 0;
 
 	virtual bool getEntry(uint32 strRef, Common::UString &string, Common::UString &soundResRef,
@@ -27,6 +27,7 @@
  */
 
 #include <cassert>
+#include <algorithm>
 
 #include "src/common/util.h"
 #include "src/common/error.h"
@@ -61,7 +62,7 @@ void TalkTable_GFF::clean() {
 	delete _gff;
 }
 
-const std::list<uint32> &TalkTable_GFF::getStrRefs() const {
+const std::vector<uint32> &TalkTable_GFF::getStrRefs() const {
 	return _strRefs;
 }
 
@@ -127,7 +128,7 @@ void TalkTable_GFF::load(Common::SeekableReadStream *tlk) {
 		else
 			throw Common::Exception("Unsupported GFF TLK file version %08X", _gff->getTypeVersion());
 
-		_strRefs.sort();
+		std::sort(_strRefs.begin(), _strRefs.end());
 
 	} catch (Common::Exception &e) {
 		clean();
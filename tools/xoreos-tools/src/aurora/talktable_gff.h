@@ -26,6 +26,7 @@
 #define AURORA_TALKTABLE_GFF_H
 
 #include <map>
+#include <vector>
 
 #include "src/common/types.h"
 #include "src/common/ustring.h"
@@ -51,7 +52,7 @@ public:
 	TalkTable_GFF(Common::SeekableReadStream *tlk, Common::Encoding encoding);
 	~TalkTable_GFF();
 
-	const std::list<uint32> &getStrRefs() const;
+	const std::vector<uint32> &getStrRefs() const;
 	bool getString(uint32 strRef, Common::UString &string, Common::UString &soundResRef) const;
 
 	bool getEntry(uint32 strRef, Common::UString &string, Common::UString &soundResRef,
@@ -77,7 +78,7 @@ private:
 
 	GFF4File *_gff;
 
-	std::list<uint32> _strRefs;
+	std::vector<uint32> _strRefs;
 
 	Entries _entries;
 
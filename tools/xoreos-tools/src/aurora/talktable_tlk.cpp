@@ -27,6 +27,8 @@
  */
 
 #include <cassert>
+#include <cstring>
+#include <algorithm>
 
 #include "src/common/util.h"
 #include "src/common/strutil.h"
@@ -42,6 +44,11 @@ static const uint32 kTLKID    = MKTAG('T', 'L', 'K', ' ');
 static const uint32 kVersion3 = MKTAG('V', '3', '.', '0');
 static const uint32 kVersion4 = MKTAG('V', '4', '.', '0');
 
+static const size_t kEntrySizeV3 = 40;
+static const size_t kEntrySizeV4 = 10;
+
+static const size_t kDefaultCacheSize = 1024 * 1024;
+
 namespace Aurora {
 
 TalkTable_TLK::Entry::Entry() : offset(0xFFFFFFFF), length(0xFFFFFFFF),
@@ -52,12 +59,13 @@ TalkTable_TLK::Entry::Entry() : offset(0xFFFFFFFF), length(0xFFFFFFFF),
 
 
 TalkTable_TLK::TalkTable_TLK(Common::Encoding encoding, uint32 languageID) :
-	TalkTable(encoding), _tlk(0), _stringsOffset(0), _languageID(languageID) {
+	TalkTable(encoding), _tlk(0), _stringsOffset(0), _languageID(languageID),
+	_tableEntrySize(0), _cacheBudget(kDefaultCacheSize), _cacheSize(0) {
 
 }
 
 TalkTable_TLK::TalkTable_TLK(Common::SeekableReadStream *tlk, Common::Encoding encoding) :
-	TalkTable(encoding), _tlk(tlk) {
+	TalkTable(encoding), _tlk(tlk), _tableEntrySize(0), _cacheBudget(kDefaultCacheSize), _cacheSize(0) {
 
 	load();
 }
@@ -86,7 +94,6 @@ void TalkTable_TLK::load() {
 			_encoding = Common::kEncodingCP1252;
 
 		uint32 stringCount = _tlk->readUint32LE();
-		_entries.resize(stringCount);
 
 		// V4 added this field; it's right after the header in V3
 		uint32 tableOffset = 20;
@@ -98,11 +105,8 @@ void TalkTable_TLK::load() {
 		// Go to the table
 		_tlk->seek(tableOffset);
 
-		// Read in all the table data
-		if (_version == kVersion3)
-			readEntryTableV3();
-		else
-			readEntryTableV4();
+		// Read in the raw table data
+		readEntryTable(stringCount);
 
 	} catch (Common::Exception &e) {
 		delete _tlk;
@@ -112,41 +116,111 @@ void TalkTable_TLK::load() {
 	}
 }
 
-void TalkTable_TLK::readEntryTableV3() {
-	for (size_t i = 0; i < _entries.size(); i++) {
-		Entry &entry = _entries[i];
+void TalkTable_TLK::readEntryTable(uint32 count) {
+	_tableEntrySize = (_version == kVersion3) ? kEntrySizeV3 : kEntrySizeV4;
 
-		entry.flags          = _tlk->readUint32LE();
-		entry.soundResRef    = Common::readStringFixed(*_tlk, Common::kEncodingASCII, 16);
-		entry.volumeVariance = _tlk->readUint32LE();
-		entry.pitchVariance  = _tlk->readUint32LE();
-		entry.offset         = _tlk->readUint32LE() + _stringsOffset;
-		entry.length         = _tlk->readUint32LE();
-		entry.soundLength    = _tlk->readIEEEFloatLE();
+	if (count > ((_tlk->size() - _tlk->pos()) / _tableEntrySize))
+		throw Common::Exception(Common::kReadError);
 
-		if (!(entry.flags & kFlagSoundLengthPresent))
-			entry.soundLength = -1.0f;
+	_table.resize(count * _tableEntrySize);
+	if (_table.empty())
+		return;
+
+	if (_tlk->read(&_table[0], _table.size()) != _table.size())
+		throw Common::Exception(Common::kReadError);
+
+	// The entries themselves are only parsed when needed, but we need to know which have strings
+	_strRefs.reserve(count);
+
+	for (uint32 i = 0; i < count; i++) {
+		const byte *data = &_table[i * _tableEntrySize];
+
+		uint32 flags  = kFlagTextPresent;
+		uint32 length = 0;
+
+		if (_version == kVersion3) {
+			flags  = READ_LE_UINT32(data);
+			length = READ_LE_UINT32(data + 32);
+		} else
+			length = READ_LE_UINT16(data + 8);
 
-		if ((entry.length > 0) && (entry.flags & kFlagTextPresent))
+		if ((length > 0) && (flags & kFlagTextPresent))
 			_strRefs.push_back(i);
 	}
 }
 
-void TalkTable_TLK::readEntryTableV4() {
-	for (size_t i = 0; i < _entries.size(); i++) {
-		Entry &entry = _entries[i];
+size_t TalkTable_TLK::getEntryCount() const {
+	if (!_table.empty())
+		return _table.size() / _tableEntrySize;
 
-		entry.soundID = _tlk->readUint32LE();
-		entry.offset  = _tlk->readUint32LE();
-		entry.length  = _tlk->readUint16LE();
-		entry.flags   = kFlagTextPresent;
+	return _entries.size();
+}
 
-		if ((entry.length > 0) && (entry.flags & kFlagTextPresent))
-			_strRefs.push_back(i);
+const TalkTable_TLK::Entry &TalkTable_TLK::findEntry(uint32 strRef, Entry &buffer) const {
+	assert(strRef < getEntryCount());
+
+	if (_table.empty())
+		return _entries[strRef];
+
+	readEntry(strRef, buffer);
+	return buffer;
+}
+
+void TalkTable_TLK::readEntry(uint32 strRef, Entry &entry) const {
+	const byte *data = &_table[strRef * _tableEntrySize];
+
+	entry = Entry();
+
+	if (_version == kVersion3) {
+		const byte *resRef    = data + 4;
+		const byte *resRefEnd = std::find(resRef, resRef + 16, 0);
+
+		entry.flags          = READ_LE_UINT32(data);
+		entry.soundResRef    = Common::UString(reinterpret_cast<const char *>(resRef), resRefEnd - resRef);
+		entry.volumeVariance = READ_LE_UINT32(data + 20);
+		entry.pitchVariance  = READ_LE_UINT32(data + 24);
+		entry.offset         = READ_LE_UINT32(data + 28) + _stringsOffset;
+		entry.length         = READ_LE_UINT32(data + 32);
+		entry.soundLength    = convertIEEEFloat(READ_LE_UINT32(data + 36));
+
+		if (!(entry.flags & kFlagSoundLengthPresent))
+			entry.soundLength = -1.0f;
+
+	} else {
+		entry.soundID = READ_LE_UINT32(data);
+		entry.offset  = READ_LE_UINT32(data + 4);
+		entry.length  = READ_LE_UINT16(data + 8);
+		entry.flags   = kFlagTextPresent;
 	}
 }
 
-Common::UString TalkTable_TLK::readString(const Entry &entry) const {
+void TalkTable_TLK::parseEntries() {
+	if (_table.empty())
+		return;
+
+	_entries.resize(getEntryCount());
+	for (size_t i = 0; i < _entries.size(); i++)
+		readEntry(i, _entries[i]);
+
+	std::vector<byte>().swap(_table);
+}
+
+/** Do 7-bit ASCII characters stand for themselves in this encoding? */
+static bool isASCIICompatible(Common::Encoding encoding) {
+	return (encoding != Common::kEncodingInvalid) &&
+	       (encoding != Common::kEncodingUTF16LE) && (encoding != Common::kEncodingUTF16BE);
+}
+
+/** Is this plain 7-bit ASCII text, with nothing that could start a color code? */
+static bool isPlainASCII(const byte *data, const byte *end) {
+	for (; data != end; ++data)
+		if ((*data & 0x80) || (*data == '<'))
+			return false;
+
+	return true;
+}
+
+Common::UString TalkTable_TLK::readString(uint32 strRef, const Entry &entry) const {
 	if (!_tlk || !entry.text.empty())
 		return entry.text;
 
@@ -156,23 +230,95 @@ Common::UString TalkTable_TLK::readString(const Entry &entry) const {
 	if (_encoding == Common::kEncodingInvalid)
 		return "";
 
+	const Common::UString *cached = findCachedString(strRef);
+	if (cached)
+		return *cached;
+
+	const Common::UString str = decodeString(entry);
+
+	addCachedString(strRef, str);
+
+	return str;
+}
+
+Common::UString TalkTable_TLK::decodeString(const Entry &entry) const {
 	_tlk->seek(entry.offset);
 
-	size_t length = MIN<size_t>(entry.length, _tlk->size() - _tlk->pos());
+	const size_t length = MIN<size_t>(entry.length, _tlk->size() - _tlk->pos());
 	if (length == 0)
 		return "";
 
-	Common::MemoryReadStream *data   = _tlk->readStream(length);
-	Common::MemoryReadStream *parsed = LangMan.preParseColorCodes(*data);
+	_stringBuffer.resize(length);
+	if (_tlk->read(&_stringBuffer[0], length) != length)
+		throw Common::Exception(Common::kReadError);
+
+	// Plain ASCII strings need neither color code parsing nor an encoding conversion
+	if (isASCIICompatible(_encoding)) {
+		const byte *data = &_stringBuffer[0];
+		const byte *end  = std::find(data, data + length, 0);
+
+		if (isPlainASCII(data, end))
+			return Common::UString(reinterpret_cast<const char *>(data), end - data);
+	}
+
+	Common::MemoryReadStream  data(&_stringBuffer[0], length);
+	Common::MemoryReadStream *parsed = LangMan.preParseColorCodes(data);
 
 	Common::UString str = Common::readString(*parsed, _encoding);
 
 	delete parsed;
-	delete data;
 
 	return str;
 }
 
+const Common::UString *TalkTable_TLK::findCachedString(uint32 strRef) const {
+	StringCacheMap::iterator c = _cacheMap.find(strRef);
+	if (c == _cacheMap.end())
+		return 0;
+
+	// Move the string to the front, it's now the most recently used one
+	_cache.splice(_cache.begin(), _cache, c->second);
+
+	return &c->second->string;
+}
+
+void TalkTable_TLK::addCachedString(uint32 strRef, const Common::UString &string) const {
+	const size_t size = std::strlen(string.c_str()) + 1;
+	if (size > _cacheBudget)
+		return;
+
+	_cache.push_front(CachedString());
+
+	CachedString &cached = _cache.front();
+
+	cached.strRef = strRef;
+	cached.string = string;
+	cached.size   = size;
+
+	_cacheMap[strRef] = _cache.begin();
+	_cacheSize += size;
+
+	trimCache();
+}
+
+void TalkTable_TLK::trimCache() const {
+	// Throw out the least recently used strings until we're within our budget again
+	while ((_cacheSize > _cacheBudget) && !_cache.empty()) {
+		const CachedString &cached = _cache.back();
+
+		_cacheSize -= cached.size;
+		_cacheMap.erase(cached.strRef);
+
+		_cache.pop_back();
+	}
+}
+
+void TalkTable_TLK::setCacheSize(size_t size) {
+	_cacheBudget = size;
+
+	trimCache();
+}
+
 uint32 TalkTable_TLK::getLanguageID() const {
 	return _languageID;
 }
@@ -181,16 +327,19 @@ void TalkTable_TLK::setLanguageID(uint32 id) {
 	_languageID = id;
 }
 
-const std::list<uint32> &TalkTable_TLK::getStrRefs() const {
+const std::vector<uint32> &TalkTable_TLK::getStrRefs() const {
 	return _strRefs;
 }
 
 bool TalkTable_TLK::getString(uint32 strRef, Common::UString &string, Common::UString &soundResRef) const {
-	if (strRef >= _entries.size())
+	if (strRef >= getEntryCount())
 		return false;
 
-	string      = readString(_entries[strRef]);
-	soundResRef = _entries[strRef].soundResRef;
+	Entry buffer;
+	const Entry &entry = findEntry(strRef, buffer);
+
+	string      = readString(strRef, entry);
+	soundResRef = entry.soundResRef;
 
 	return true;
 }
@@ -199,12 +348,13 @@ bool TalkTable_TLK::getEntry(uint32 strRef, Common::UString &string, Common::USt
                              uint32 &volumeVariance, uint32 &pitchVariance, float &soundLength,
                              uint32 &soundID) const {
 
-	if (strRef >= _entries.size())
+	if (strRef >= getEntryCount())
 		return false;
 
-	const Entry &entry = _entries[strRef];
+	Entry buffer;
+	const Entry &entry = findEntry(strRef, buffer);
 
-	string      = readString(entry);
+	string      = readString(strRef, entry);
 	soundResRef = entry.soundResRef;
 
 	volumeVariance = entry.volumeVariance;
@@ -220,13 +370,13 @@ void TalkTable_TLK::setEntry(uint32 strRef, const Common::UString &string, const
                              uint32 volumeVariance, uint32 pitchVariance, float soundLength,
                              uint32 soundID) {
 
+	parseEntries();
+
 	if (strRef >= _entries.size()) {
+		// All existing string references are smaller, so the list stays sorted and unique
 		for (size_t i = _entries.size(); i < strRef; i++)
 			_strRefs.push_back(i);
 
-		_strRefs.sort();
-		_strRefs.unique();
-
 		_entries.resize(strRef + 1);
 	}
 
@@ -254,28 +404,31 @@ void TalkTable_TLK::setEntry(uint32 strRef, const Common::UString &string, const
 }
 
 Common::SeekableReadStream *TalkTable_TLK::collectEntries(Entries &entries) const {
-	entries.resize(_entries.size());
+	entries.resize(getEntryCount());
 
 	Common::MemoryWriteStreamDynamic data;
 
 	try {
-		for (size_t i = 0; i < _entries.size(); i++) {
+		for (size_t i = 0; i < entries.size(); i++) {
+			Entry buffer;
+			const Entry &entry = findEntry(i, buffer);
+
 			entries[i].length = 0;
 			entries[i].offset = 0;
 
-			const Common::UString text = readString(_entries[i]);
+			const Common::UString text = readString(i, entry);
 			if (!text.empty()) {
 				entries[i].offset = data.size();
 				entries[i].length = Common::writeString(data, text, _encoding, false);
 			}
 
-			entries[i].soundResRef = _entries[i].soundResRef;
+			entries[i].soundResRef = entry.soundResRef;
 
-			entries[i].volumeVariance = _entries[i].volumeVariance;
-			entries[i].pitchVariance  = _entries[i].pitchVariance;
-			entries[i].soundLength    = _entries[i].soundLength;
+			entries[i].volumeVariance = entry.volumeVariance;
+			entries[i].pitchVariance  = entry.pitchVariance;
+			entries[i].soundLength    = entry.soundLength;
 
-			entries[i].soundID = _entries[i].soundID;
+			entries[i].soundID = entry.soundID;
 
 			entries[i].flags = 0;
 			if (entries[i].length > 0)
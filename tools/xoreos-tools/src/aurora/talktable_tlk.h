@@ -26,6 +26,8 @@
 #define AURORA_TALKTABLE_TLK_H
 
 #include <vector>
+#include <list>
+#include <map>
 
 #include "src/common/types.h"
 #include "src/common/ustring.h"
@@ -61,7 +63,7 @@ public:
 	/** Set the language ID (ungendered) of the talk table. */
 	void setLanguageID(uint32 id);
 
-	const std::list<uint32> &getStrRefs() const;
+	const std::vector<uint32> &getStrRefs() const;
 	bool getString(uint32 strRef, Common::UString &string, Common::UString &soundResRef) const;
 
 	/** Return all values associated to a string references in a TLK talk table. */
@@ -74,6 +76,14 @@ public:
 	              uint32 volumeVariance, uint32 pitchVariance, float soundLength,
 	              uint32 soundID);
 
+	/** Set the maximum number of bytes of decoded strings to keep cached.
+	 *
+	 *  Strings read from the TLK file are decoded on demand, and the most
+	 *  recently used ones are kept around, up to this budget. A budget of 0
+	 *  disables the cache.
+	 */
+	void setCacheSize(size_t size);
+
 	/** Write this TLK as a version V3.0 TLK into that stream. */
 	void write30(Common::WriteStream &out) const;
 	/** Write this TLK as a version V4.0 TLK into that stream. */
@@ -112,22 +122,62 @@ private:
 
 	typedef std::vector<Entry> Entries;
 
+	/** A decoded string in the cache. */
+	struct CachedString {
+		uint32 strRef;
+		Common::UString string;
+		size_t size;
+	};
+
+	/** The cached strings, the most recently used first. */
+	typedef std::list<CachedString> StringCache;
+	typedef std::map<uint32, StringCache::iterator> StringCacheMap;
+
 
 	Common::SeekableReadStream *_tlk;
 
 	uint32 _stringsOffset;
 	uint32 _languageID;
 
-	std::list<uint32> _strRefs;
+	std::vector<uint32> _strRefs;
+
+	/** The raw entry table of the TLK file, parsed on demand. */
+	std::vector<byte> _table;
+	/** The size of one entry in the raw entry table. */
+	size_t _tableEntrySize;
 
+	/** The parsed entries, once the talk table has been modified. */
 	Entries _entries;
 
+	size_t _cacheBudget;
+
+	mutable StringCache    _cache;
+	mutable StringCacheMap _cacheMap;
+	mutable size_t         _cacheSize;
+
+	/** Buffer for the raw string data read from the TLK file. */
+	mutable std::vector<byte> _stringBuffer;
+
 	void load();
 
-	void readEntryTableV3();
-	void readEntryTableV4();
+	void readEntryTable(uint32 count);
+
+	/** Return the number of entries in the talk table. */
+	size_t getEntryCount() const;
+
+	/** Return the entry, parsing it out of the raw entry table into buffer if necessary. */
+	const Entry &findEntry(uint32 strRef, Entry &buffer) const;
+	void readEntry(uint32 strRef, Entry &entry) const;
+
+	/** Parse the whole raw entry table, so that entries can be modified. */
+	void parseEntries();
+
+	Common::UString readString(uint32 strRef, const Entry &entry) const;
+	Common::UString decodeString(const Entry &entry) const;
 
-	Common::UString readString(const Entry &entry) const;
+	const Common::UString *findCachedString(uint32 strRef) const;
+	void addCachedString(uint32 strRef, const Common::UString &string) const;
+	void trimCache() const;
 
 	Common::SeekableReadStream *collectEntries(Entries &entries) const;
 };
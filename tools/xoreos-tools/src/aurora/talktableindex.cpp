@@ -0,0 +1,302 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A trigram index for searching the strings of a talk table.
+ */
+
+#include <algorithm>
+#include <map>
+#include <iterator>
+
+#include "src/common/util.h"
+#include "src/common/strutil.h"
+#include "src/common/error.h"
+#include "src/common/hash.h"
+#include "src/common/readstream.h"
+#include "src/common/writestream.h"
+
+#include "src/aurora/talktableindex.h"
+#include "src/aurora/talktable.h"
+
+static const uint32 kTLKIID    = MKTAG('T', 'L', 'K', 'I');
+static const uint32 kVersion10 = MKTAG('V', '1', '.', '0');
+
+namespace Aurora {
+
+TalkTableIndex::TalkTableIndex(const TalkTable &talkTable, uint32 checksum) :
+	_checksum(checksum), _encoding(Common::kEncodingInvalid) {
+
+	create(talkTable);
+}
+
+TalkTableIndex::TalkTableIndex(Common::SeekableReadStream &index) :
+	_checksum(0), _encoding(Common::kEncodingInvalid) {
+
+	load(index);
+}
+
+TalkTableIndex::~TalkTableIndex() {
+}
+
+uint32 TalkTableIndex::getChecksum() const {
+	return _checksum;
+}
+
+Common::Encoding TalkTableIndex::getEncoding() const {
+	return _encoding;
+}
+
+bool TalkTableIndex::matches(uint32 checksum, Common::Encoding encoding) const {
+	return (_checksum == checksum) && (_encoding == encoding);
+}
+
+void TalkTableIndex::getTrigrams(const Common::UString &string, Trigrams &trigrams) {
+	trigrams.clear();
+
+	uint64 c[3] = { 0, 0, 0 };
+
+	size_t n = 0;
+	for (Common::UString::iterator s = string.begin(); s != string.end(); ++s, n++) {
+		c[0] = c[1];
+		c[1] = c[2];
+		c[2] = Common::UString::toLower(*s) & 0x1FFFFF;
+
+		if (n >= 2)
+			trigrams.push_back((c[0] << 42) | (c[1] << 21) | c[2]);
+	}
+
+	std::sort(trigrams.begin(), trigrams.end());
+	trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+}
+
+void TalkTableIndex::create(const TalkTable &talkTable) {
+	_encoding = talkTable.getEncoding();
+
+	_strRefs = talkTable.getStrRefs();
+
+	std::sort(_strRefs.begin(), _strRefs.end());
+	_strRefs.erase(std::unique(_strRefs.begin(), _strRefs.end()), _strRefs.end());
+
+	// Since we go through the strings in order, each list ends up sorted
+	std::map<uint64, std::vector<uint32> > postings;
+
+	Trigrams trigrams;
+	for (std::vector<uint32>::const_iterator s = _strRefs.begin(); s != _strRefs.end(); ++s) {
+		Common::UString string, soundResRef;
+		if (!talkTable.getString(*s, string, soundResRef))
+			continue;
+
+		getTrigrams(string, trigrams);
+
+		for (Trigrams::const_iterator t = trigrams.begin(); t != trigrams.end(); ++t)
+			postings[*t].push_back(*s);
+	}
+
+	// Flatten the lists into one contiguous array
+	_trigrams.reserve(postings.size());
+	_offsets.reserve(postings.size() + 1);
+
+	for (std::map<uint64, std::vector<uint32> >::const_iterator p = postings.begin(); p != postings.end(); ++p) {
+		_trigrams.push_back(p->first);
+		_offsets.push_back(_postings.size());
+
+		_postings.insert(_postings.end(), p->second.begin(), p->second.end());
+	}
+
+	_offsets.push_back(_postings.size());
+}
+
+void TalkTableIndex::load(Common::SeekableReadStream &index) {
+	try {
+		const uint32 id      = index.readUint32BE();
+		const uint32 version = index.readUint32BE();
+
+		if (id != kTLKIID)
+			throw Common::Exception("Not a talk table index (%s)", Common::debugTag(id).c_str());
+		if (version != kVersion10)
+			throw Common::Exception("Unsupported talk table index version %s", Common::debugTag(version).c_str());
+
+		_checksum = index.readUint32LE();
+		_encoding = (Common::Encoding) index.readSint32LE();
+
+		const uint32 strRefCount   = index.readUint32LE();
+		const uint32 trigramCount  = index.readUint32LE();
+		const uint32 postingsCount = index.readUint32LE();
+
+		const size_t size = index.size() - index.pos();
+		if (((uint64) strRefCount * 4 + (uint64) trigramCount * 12 + 4 + (uint64) postingsCount * 4) > size)
+			throw Common::Exception("Talk table index too short");
+
+		_strRefs.resize(strRefCount);
+		for (std::vector<uint32>::iterator s = _strRefs.begin(); s != _strRefs.end(); ++s)
+			*s = index.readUint32LE();
+
+		// findPostings() binary searches the trigrams, so they need to be sorted
+		_trigrams.resize(trigramCount);
+		for (Trigrams::iterator t = _trigrams.begin(); t != _trigrams.end(); ++t) {
+			*t = index.readUint64LE();
+
+			if ((t != _trigrams.begin()) && (*t <= *(t - 1)))
+				throw Common::Exception("Talk table index trigrams not sorted");
+		}
+
+		// Each list ends where the next one starts, so the offsets can't decrease
+		_offsets.resize(trigramCount + 1);
+		for (std::vector<uint32>::iterator o = _offsets.begin(); o != _offsets.end(); ++o) {
+			*o = index.readUint32LE();
+
+			if ((*o > postingsCount) || ((o != _offsets.begin()) && (*o < *(o - 1))))
+				throw Common::Exception("Invalid talk table index offset");
+		}
+
+		_postings.resize(postingsCount);
+		for (std::vector<uint32>::iterator p = _postings.begin(); p != _postings.end(); ++p)
+			*p = index.readUint32LE();
+
+	} catch (Common::Exception &e) {
+		e.add("Failed reading talk table index");
+		throw;
+	}
+}
+
+void TalkTableIndex::write(Common::WriteStream &out) const {
+	out.writeUint32BE(kTLKIID);
+	out.writeUint32BE(kVersion10);
+
+	out.writeUint32LE(_checksum);
+	out.writeSint32LE(_encoding);
+
+	out.writeUint32LE(_strRefs.size());
+	out.writeUint32LE(_trigrams.size());
+	out.writeUint32LE(_postings.size());
+
+	for (std::vector<uint32>::const_iterator s = _strRefs.begin(); s != _strRefs.end(); ++s)
+		out.writeUint32LE(*s);
+
+	for (Trigrams::const_iterator t = _trigrams.begin(); t != _trigrams.end(); ++t)
+		out.writeUint64LE(*t);
+
+	for (std::vector<uint32>::const_iterator o = _offsets.begin(); o != _offsets.end(); ++o)
+		out.writeUint32LE(*o);
+
+	for (std::vector<uint32>::const_iterator p = _postings.begin(); p != _postings.end(); ++p)
+		out.writeUint32LE(*p);
+}
+
+bool TalkTableIndex::findPostings(uint64 trigram, const uint32 *&postings, size_t &count) const {
+	Trigrams::const_iterator t = std::lower_bound(_trigrams.begin(), _trigrams.end(), trigram);
+	if ((t == _trigrams.end()) || (*t != trigram))
+		return false;
+
+	const size_t n = t - _trigrams.begin();
+
+	count    = _offsets[n + 1] - _offsets[n];
+	postings = (count > 0) ? (&_postings[0] + _offsets[n]) : 0;
+
+	return true;
+}
+
+bool TalkTableIndex::matchString(const Common::UString &string, const Common::UString &query, bool ignoreCase) {
+	// When ignoring case, the query has already been lowercased
+	if (ignoreCase)
+		return string.toLower().contains(query);
+
+	return string.contains(query);
+}
+
+void TalkTableIndex::search(const TalkTable &talkTable, const Common::UString &query, bool ignoreCase,
+                            std::vector<uint32> &strRefs) const {
+
+	strRefs.clear();
+
+	const Common::UString needle = ignoreCase ? query.toLower() : query;
+
+	Trigrams trigrams;
+	getTrigrams(needle, trigrams);
+
+	std::vector<uint32> candidates;
+
+	if (trigrams.empty()) {
+		// Query too short for the index, we need to look at every string
+		candidates = _strRefs;
+
+	} else {
+		// Gather the lists of all trigrams in the query, shortest first
+		std::vector< std::pair<size_t, const uint32 *> > lists;
+		lists.reserve(trigrams.size());
+
+		for (Trigrams::const_iterator t = trigrams.begin(); t != trigrams.end(); ++t) {
+			const uint32 *postings;
+			size_t count;
+
+			// No string contains this trigram, so none can contain the query
+			if (!findPostings(*t, postings, count))
+				return;
+
+			lists.push_back(std::make_pair(count, postings));
+		}
+
+		std::sort(lists.begin(), lists.end());
+
+		// Intersect them, leaving the strings that contain all trigrams
+		candidates.assign(lists[0].second, lists[0].second + lists[0].first);
+
+		std::vector<uint32> intersection;
+		for (size_t i = 1; (i < lists.size()) && !candidates.empty(); i++) {
+			intersection.clear();
+
+			std::set_intersection(candidates.begin(), candidates.end(),
+			                      lists[i].second, lists[i].second + lists[i].first,
+			                      std::back_inserter(intersection));
+
+			candidates.swap(intersection);
+		}
+	}
+
+	// Having all trigrams doesn't mean they're in the right order, so look at the actual strings
+	for (std::vector<uint32>::const_iterator c = candidates.begin(); c != candidates.end(); ++c) {
+		Common::UString string, soundResRef;
+		if (!talkTable.getString(*c, string, soundResRef))
+			continue;
+
+		if (matchString(string, needle, ignoreCase))
+			strRefs.push_back(*c);
+	}
+}
+
+uint32 TalkTableIndex::getChecksum(Common::SeekableReadStream &tlk) {
+	tlk.seek(0);
+
+	uint32 hash = 0xFFFFFFFF;
+
+	byte buffer[4096];
+
+	size_t n;
+	while ((n = tlk.read(buffer, sizeof(buffer))) != 0)
+		for (size_t i = 0; i < n; i++)
+			hash = Common::hashCRC32(hash, buffer[i]);
+
+	tlk.seek(0);
+
+	return hash ^ 0xFFFFFFFF;
+}
+
+} // End of namespace Aurora
@@ -0,0 +1,126 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A trigram index for searching the strings of a talk table.
+ */
+
+#ifndef AURORA_TALKTABLEINDEX_H
+#define AURORA_TALKTABLEINDEX_H
+
+#include <vector>
+
+#include "src/common/types.h"
+#include "src/common/ustring.h"
+#include "src/common/encoding.h"
+
+namespace Common {
+	class SeekableReadStream;
+	class WriteStream;
+}
+
+namespace Aurora {
+
+class TalkTable;
+
+/** A full-text search index over all strings of a talk table.
+ *
+ *  For every (ASCII-lowercased) sequence of 3 characters found in the
+ *  talk table's strings, the index holds a sorted list of the string
+ *  references of all strings that contain it. A substring search then
+ *  only has to look at the strings found in the lists of all the
+ *  trigrams of the query.
+ *
+ *  The index can be written into a stream and read back, so that it
+ *  doesn't have to be recreated every time. It remembers the checksum
+ *  of the talk table file and the encoding it was created for, so that
+ *  a stale index can be detected.
+ */
+class TalkTableIndex {
+public:
+	/** Create an index over all strings of this talk table.
+	 *
+	 *  @param talkTable The talk table to index.
+	 *  @param checksum The checksum of the talk table file, see getChecksum().
+	 */
+	TalkTableIndex(const TalkTable &talkTable, uint32 checksum);
+	/** Read a previously written index out of a stream. */
+	TalkTableIndex(Common::SeekableReadStream &index);
+	~TalkTableIndex();
+
+	/** Return the checksum of the talk table file this index was created for. */
+	uint32 getChecksum() const;
+	/** Return the encoding the talk table strings were read with. */
+	Common::Encoding getEncoding() const;
+
+	/** Was this index created for this talk table file and encoding? */
+	bool matches(uint32 checksum, Common::Encoding encoding) const;
+
+	/** Find all strings in the talk table that contain the query.
+	 *
+	 *  The talk table has to be the one this index was created for.
+	 *
+	 *  @param talkTable The talk table this index was created for.
+	 *  @param query The string to search for.
+	 *  @param ignoreCase Should the search ignore the case of ASCII characters?
+	 *  @param strRefs The string references of all matching strings, in ascending order.
+	 */
+	void search(const TalkTable &talkTable, const Common::UString &query, bool ignoreCase,
+	            std::vector<uint32> &strRefs) const;
+
+	/** Write the index into a stream. */
+	void write(Common::WriteStream &out) const;
+
+	/** Calculate the checksum of a talk table file, for matching it against an index. */
+	static uint32 getChecksum(Common::SeekableReadStream &tlk);
+
+
+private:
+	typedef std::vector<uint64> Trigrams;
+
+	uint32 _checksum;
+	Common::Encoding _encoding;
+
+	/** The string references of all strings that are in the index. */
+	std::vector<uint32> _strRefs;
+
+	/** All trigrams found in the strings, in ascending order. */
+	Trigrams _trigrams;
+	/** For each trigram, the offset into _postings where its list starts. */
+	std::vector<uint32> _offsets;
+	/** The concatenated lists of string references for all trigrams. */
+	std::vector<uint32> _postings;
+
+	void create(const TalkTable &talkTable);
+	void load(Common::SeekableReadStream &index);
+
+	/** Find the list of string references containing this trigram. */
+	bool findPostings(uint64 trigram, const uint32 *&postings, size_t &count) const;
+
+	/** Does this string contain the query? */
+	static bool matchString(const Common::UString &string, const Common::UString &query, bool ignoreCase);
+
+	/** Collect all unique trigrams of the lowercased string. */
+	static void getTrigrams(const Common::UString &string, Trigrams &trigrams);
+};
+
+} // End of namespace Aurora
+
+#endif // AURORA_TALKTABLEINDEX_H
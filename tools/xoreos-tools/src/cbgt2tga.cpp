@@ -41,10 +41,10 @@
 void printUsage(FILE *stream, const Common::UString &name);
 bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
                       Common::UString &cbgtFile , Common::UString &palFile,
-                      Common::UString &twoDAFile, Common::UString &outFile);
+                      Common::UString &twoDAFile, Common::UString &outFile, bool &png);
 
 void convert(const Common::UString &cbgtFile , const Common::UString &palFile,
-             const Common::UString &twoDAFile, const Common::UString &outFile);
+             const Common::UString &twoDAFile, const Common::UString &outFile, bool png);
 
 int main(int argc, char **argv) {
 	try {
@@ -53,11 +53,12 @@ int main(int argc, char **argv) {
 
 		int returnValue = 1;
 		Common::UString cbgtFile, palFile, twoDAFile, outFile;
+		bool png = false;
 
-		if (!parseCommandLine(args, returnValue, cbgtFile, palFile, twoDAFile, outFile))
+		if (!parseCommandLine(args, returnValue, cbgtFile, palFile, twoDAFile, outFile, png))
 			return returnValue;
 
-		convert(cbgtFile, palFile, twoDAFile, outFile);
+		convert(cbgtFile, palFile, twoDAFile, outFile, png);
 	} catch (...) {
 		Common::exceptionDispatcherError();
 	}
@@ -67,7 +68,7 @@ int main(int argc, char **argv) {
 
 bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
                       Common::UString &cbgtFile , Common::UString &palFile,
-                      Common::UString &twoDAFile, Common::UString &outFile) {
+                      Common::UString &twoDAFile, Common::UString &outFile, bool &png) {
 
 	std::vector<Common::UString> args;
 
@@ -96,6 +97,12 @@ bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue
 				return false;
 			}
 
+			if (argv[i] == "--png") {
+				png = true;
+
+				continue;
+			}
+
 			if (argv[i].beginsWith("-") || argv[i].beginsWith("--")) {
 			  // An options, but we already checked for all known ones
 
@@ -129,15 +136,19 @@ void printUsage(FILE *stream, const Common::UString &name) {
 	std::fprintf(stream, "Usage: %s [<options>] <cbgt> <pal> <2da> <tga>\n", name.c_str());
 	std::fprintf(stream, "  -h      --help              This help text\n");
 	std::fprintf(stream, "          --version           Display version information\n");
+	std::fprintf(stream, "          --png               Write a PNG instead of a TGA\n");
 }
 
 void convert(const Common::UString &cbgtFile , const Common::UString &palFile,
-             const Common::UString &twoDAFile, const Common::UString &outFile) {
+             const Common::UString &twoDAFile, const Common::UString &outFile, bool png) {
 
 	Common::ReadFile cbgt(cbgtFile), pal(palFile), twoDA(twoDAFile);
 	Images::CBGT image(cbgt, pal, twoDA);
 
 	image.flipVertically();
 
-	image.dumpTGA(outFile);
+	if (png)
+		image.dumpPNG(outFile);
+	else
+		image.dumpTGA(outFile);
 }
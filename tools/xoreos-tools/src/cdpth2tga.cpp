@@ -42,10 +42,10 @@
 void printUsage(FILE *stream, const Common::UString &name);
 bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
                       Common::UString &cdpthFile, Common::UString &twoDAFile,
-                      Common::UString &outFile);
+                      Common::UString &outFile, bool &png);
 
 void convert(const Common::UString &cdpthFile, const Common::UString &twoDAFile,
-             const Common::UString &outFile);
+             const Common::UString &outFile, bool png);
 
 int main(int argc, char **argv) {
 	try {
@@ -54,11 +54,12 @@ int main(int argc, char **argv) {
 
 		int returnValue = 1;
 		Common::UString cdpthFile, twoDAFile, outFile;
+		bool png = false;
 
-		if (!parseCommandLine(args, returnValue, cdpthFile, twoDAFile, outFile))
+		if (!parseCommandLine(args, returnValue, cdpthFile, twoDAFile, outFile, png))
 			return returnValue;
 
-		convert(cdpthFile, twoDAFile, outFile);
+		convert(cdpthFile, twoDAFile, outFile, png);
 	} catch (...) {
 		Common::exceptionDispatcherError();
 	}
@@ -68,7 +69,7 @@ int main(int argc, char **argv) {
 
 bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
                       Common::UString &cdpthFile, Common::UString &twoDAFile,
-                      Common::UString &outFile) {
+                      Common::UString &outFile, bool &png) {
 
 	std::vector<Common::UString> args;
 
@@ -97,6 +98,12 @@ bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue
 				return false;
 			}
 
+			if (argv[i] == "--png") {
+				png = true;
+
+				continue;
+			}
+
 			if (argv[i].beginsWith("-") || argv[i].beginsWith("--")) {
 			  // An options, but we already checked for all known ones
 
@@ -129,6 +136,7 @@ void printUsage(FILE *stream, const Common::UString &name) {
 	std::fprintf(stream, "Usage: %s [<options>] <cdpth> <2da> <tga>\n", name.c_str());
 	std::fprintf(stream, "  -h      --help              This help text\n");
 	std::fprintf(stream, "          --version           Display version information\n");
+	std::fprintf(stream, "          --png               Write a PNG instead of a TGA\n");
 }
 
 static void getDimensions(const Common::UString &twoDAFile, uint32 &width, uint32 &height) {
@@ -141,7 +149,7 @@ static void getDimensions(const Common::UString &twoDAFile, uint32 &width, uint3
 }
 
 void convert(const Common::UString &cdpthFile, const Common::UString &twoDAFile,
-             const Common::UString &outFile) {
+             const Common::UString &outFile, bool png) {
 
 	uint32 width, height;
 	getDimensions(twoDAFile, width, height);
@@ -151,5 +159,8 @@ void convert(const Common::UString &cdpthFile, const Common::UString &twoDAFile,
 
 	image.flipVertically();
 
-	image.dumpTGA(outFile);
+	if (png)
+		image.dumpPNG(outFile);
+	else
+		image.dumpTGA(outFile);
 }
@@ -22,14 +22,16 @@
  *  Base64 encoding and decoding.
  */
 
-#include <cassert>
+#include <cstring>
+#include <string>
 
 #include "src/common/base64.h"
 #include "src/common/ustring.h"
+#include "src/common/util.h"
 #include "src/common/error.h"
 #include "src/common/readstream.h"
+#include "src/common/writestream.h"
 #include "src/common/memreadstream.h"
-#include "src/common/memwritestream.h"
 
 namespace Common {
 
@@ -46,200 +48,252 @@ static const uint8 kBase64Values[128] = {
 	0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
 };
 
-/** Write a character into our base64 string, and update the remaining
- *  string length.
- *
- *  Returns false if we ran out of remaining characters in this string.
- */
-static bool writeCharacter(UString &base64, uint32 c, size_t &maxLength) {
-	assert(maxLength > 0);
+/** Number of input bytes we encode in one go. Needs to be divisible by 3. */
+static const size_t kEncodeChunkSize = 3 * 1024;
 
-	base64 += c;
+/** Find the raw value of a base64-encoded character. */
+static uint8 findCharacterValue(byte c) {
+	if ((c >= 128) || (kBase64Values[c] > 0x3F))
+		throw Exception("Invalid base64 character");
 
-	return --maxLength > 0;
+	return kBase64Values[c];
 }
 
-/** Write multiple characters into our base64 string, and update the remaining
- *  string length.
+/** Decode a group of 4 base64 characters that contains padding.
  *
- *  Returns false if we ran out of remaining characters in this string.
+ *  The padding characters count as 0 bits, and only the remaining
+ *  characters contribute to the number of bytes produced.
  */
-static bool writeCharacters(UString &base64, UString &str, size_t &lineLength) {
-	while (!str.empty()) {
-		writeCharacter(base64, *str.begin(), lineLength);
-		str.erase(str.begin());
+static size_t decodePaddedQuad(const char *base64, byte *data) {
+	uint32 code = 0;
+
+	uint8 n = 0;
+	for (size_t i = 0; i < 4; i++) {
+		code <<= 6;
 
-		if (lineLength == 0)
-			return false;
+		if (base64[i] != '=') {
+			code += findCharacterValue((byte) base64[i]);
+			n    += 6;
+		}
 	}
 
-	return lineLength > 0;
+	for (size_t i = 0; i < (n / 8); i++, code <<= 8)
+		data[i] = (byte) ((code & 0x00FF0000) >> 16);
+
+	return n / 8;
 }
 
-/** Find the raw value of a base64-encoded character. */
-static uint8 findCharacterValue(uint32 c) {
-	if ((c >= 128) || (kBase64Values[c] > 0x3F))
-		throw Exception("Invalid base64 character");
+/** Read as much data as possible into the buffer, until it's full or the stream ended. */
+static size_t readChunk(ReadStream &data, byte *buffer, size_t size) {
+	size_t n = 0;
+	while (n < size) {
+		const size_t r = data.read(buffer + n, size - n);
+		if (r == 0)
+			break;
 
-	return kBase64Values[c];
+		n += r;
+	}
+
+	return n;
 }
 
-/** Encode data into base64 and write the result into the string, but only up
- *  to maxLength characters.
- *
- *  The string overhang is and input/output string of both the overhang from
- *  the previous run of this function (which will get written into the base64
- *  string first) and the newly produced overhang.
- *
- *  Returns false if we have written all data there is to write, both from the
- *  overhang and the input data stream.
- */
-static bool encodeBase64(ReadStream &data, UString &base64, size_t maxLength, UString &overhang) {
-	if (maxLength == 0)
-		throw Exception("Invalid base64 max line length");
+/** Encode the whole stream in chunks, handing each encoded chunk to the sink. */
+template<typename Sink>
+static void encodeChunks(ReadStream &data, Sink &sink) {
+	byte input[kEncodeChunkSize];
+	char output[(kEncodeChunkSize / 3) * 4];
 
-	// First write the overhang, and return if we already maxed out the length there
-	if (!writeCharacters(base64, overhang, maxLength))
-		return true;
+	size_t n;
+	while ((n = readChunk(data, input, kEncodeChunkSize)) != 0)
+		sink(output, encodeBase64(input, n, output));
+}
 
-	overhang.clear();
+/** Sink appending the encoded characters to a string. */
+struct StringSink {
+	UString *base64;
 
-	uint8 n;
-	byte input[3];
+	StringSink(UString &b) : base64(&b) { }
 
-	// Read up to 3 characters at a time
-	while ((n = data.read(input, 3)) != 0) {
-		uint32 code = 0;
+	void operator()(const char *str, size_t n) {
+		*base64 += UString(str, n);
+	}
+};
 
-		// Concat the input characters
-		for (uint8 i = 0; i < n; i++)
-			code |= input[i] << (24 - i * 8);
+/** Sink breaking the encoded characters into a list of strings. */
+struct ListSink {
+	std::list<UString> *base64;
+	size_t lineLength;
 
-		// Create up to 4 6-bit base64-characters out of them
-		for (uint8 i = 0; i < (n + 1); i++) {
-			overhang += kBase64Char[(code >> 26) & 0x0000003F];
-			code <<= 6;
-		}
+	std::string line;
+
+	ListSink(std::list<UString> &b, size_t l) : base64(&b), lineLength(l) { }
 
-		// Add padding
-		for (int i = 0; i < (3 - n); i++)
-			overhang += '=';
+	void operator()(const char *str, size_t n) {
+		while (n > 0) {
+			const size_t count = MIN(n, lineLength - line.size());
 
-		// Write the base64 characters into the string, and return if we maxed out the length
-		if (!writeCharacters(base64, overhang, maxLength))
-			return true;
+			line.append(str, count);
+			str += count;
+			n   -= count;
 
-		overhang.clear();
+			if (line.size() == lineLength) {
+				base64->push_back(line);
+				line.clear();
+			}
+		}
 	}
 
-	// We reached the end of input the data
-	return false;
-}
+	void finish() {
+		if (!line.empty())
+			base64->push_back(line);
+	}
+};
 
-static void decodeBase64(WriteStream &data, const UString &base64, UString &overhang) {
-	assert(overhang.size() < 4);
+/** Sink writing the encoded characters into a stream, broken into lines. */
+struct StreamSink {
+	WriteStream *base64;
+	size_t lineLength;
+	const UString *linePrefix;
 
-	for (UString::iterator c = base64.begin(); c != base64.end(); ++c) {
-		overhang += *c;
+	size_t linePos;
 
-		if (overhang.size() == 4) {
-			uint32 code = 0;
+	StreamSink(WriteStream &b, size_t l, const UString &p) :
+		base64(&b), lineLength(l), linePrefix(&p), linePos(0) { }
 
-			uint8 n = 0;
-			for (UString::iterator o = overhang.begin(); o != overhang.end(); ++o) {
-				code <<= 6;
+	void operator()(const char *str, size_t n) {
+		while (n > 0) {
+			if (linePos == 0)
+				base64->writeString(*linePrefix);
 
-				if (*o != '=') {
-					code += findCharacterValue(*o);
-					n    += 6;
-				}
-			}
+			const size_t count = MIN(n, lineLength - linePos);
 
-			for (size_t i = 0; i < (n / 8); i++, code <<= 8)
-				data.writeByte((byte) ((code & 0x00FF0000) >> 16));
+			base64->write(str, count);
+			str += count;
+			n   -= count;
 
-			overhang.clear();
+			linePos += count;
+			if (linePos == lineLength)
+				linePos = 0;
 		}
 	}
+};
+
+
+size_t getBase64Length(size_t dataSize) {
+	return ((dataSize + 2) / 3) * 4;
 }
 
-static size_t countLength(const UString &str) {
-	const size_t dataLength = str.size();
+size_t encodeBase64(const byte *data, size_t dataSize, char *base64) {
+	char *out = base64;
 
-	if ((dataLength % 4) != 0)
-		throw Exception("Invalid length for a base64-encoded string");
+	// Full groups of 3 input bytes each map onto 4 base64 characters
+	for (; dataSize >= 3; dataSize -= 3, data += 3, out += 4) {
+		const uint32 code = (data[0] << 16) | (data[1] << 8) | data[2];
 
-	return dataLength;
-}
+		out[0] = kBase64Char[(code >> 18) & 0x3F];
+		out[1] = kBase64Char[(code >> 12) & 0x3F];
+		out[2] = kBase64Char[(code >>  6) & 0x3F];
+		out[3] = kBase64Char[ code        & 0x3F];
+	}
 
-static size_t countLength(const std::list<UString> &str) {
-	size_t dataLength = 0;
-	for (std::list<UString>::const_iterator s = str.begin(); s != str.end(); ++s)
-		dataLength += s->size();
+	// Encode the remaining 1 or 2 bytes, and add padding
+	if (dataSize > 0) {
+		const uint32 code = (data[0] << 16) | ((dataSize > 1) ? (data[1] << 8) : 0);
 
-	if ((dataLength % 4) != 0)
-		throw Exception("Invalid length for a base64-encoded string");
+		out[0] = kBase64Char[(code >> 18) & 0x3F];
+		out[1] = kBase64Char[(code >> 12) & 0x3F];
+		out[2] = (dataSize > 1) ? kBase64Char[(code >> 6) & 0x3F] : '=';
+		out[3] = '=';
+
+		out += 4;
+	}
 
-	return dataLength;
+	return out - base64;
 }
 
+size_t decodeBase64(const char *base64, size_t base64Size, byte *data) {
+	if ((base64Size % 4) != 0)
+		throw Exception("Invalid length for a base64-encoded string");
+
+	byte *out = data;
+
+	for (; base64Size > 0; base64Size -= 4, base64 += 4) {
+		const byte c0 = base64[0], c1 = base64[1], c2 = base64[2], c3 = base64[3];
+
+		// Any invalid or padding character (or non-ASCII) has the high bit set in one of these
+		const uint8 v0 = (c0 < 128) ? kBase64Values[c0] : 0xFF;
+		const uint8 v1 = (c1 < 128) ? kBase64Values[c1] : 0xFF;
+		const uint8 v2 = (c2 < 128) ? kBase64Values[c2] : 0xFF;
+		const uint8 v3 = (c3 < 128) ? kBase64Values[c3] : 0xFF;
+
+		if ((v0 | v1 | v2 | v3) & 0x80) {
+			out += decodePaddedQuad(base64, out);
+			continue;
+		}
+
+		const uint32 code = (v0 << 18) | (v1 << 12) | (v2 << 6) | v3;
+
+		out[0] = (byte) (code >> 16);
+		out[1] = (byte) (code >>  8);
+		out[2] = (byte)  code;
+
+		out += 3;
+	}
+
+	return out - data;
+}
 
 void encodeBase64(ReadStream &data, UString &base64) {
-	UString overhang;
+	StringSink sink(base64);
 
-	encodeBase64(data, base64, SIZE_MAX, overhang);
+	encodeChunks(data, sink);
 }
 
 void encodeBase64(ReadStream &data, std::list<UString> &base64, size_t lineLength) {
-	UString overhang;
+	if (lineLength == 0)
+		throw Exception("Invalid base64 max line length");
 
-	// Base64-encode the data, creating a new string after every lineLength characters
-	do {
-		base64.push_back(UString());
-	} while (encodeBase64(data, base64.back(), lineLength, overhang));
+	ListSink sink(base64, lineLength);
 
-	// Trim empty strings from the back
-	while (!base64.empty() && base64.back().empty())
-		base64.pop_back();
+	encodeChunks(data, sink);
+	sink.finish();
 }
 
-SeekableReadStream *decodeBase64(const UString &base64) {
-	const size_t dataLength = (countLength(base64) / 4) * 3;
-	byte *data = new byte[dataLength];
+void encodeBase64(ReadStream &data, WriteStream &base64, size_t lineLength, const UString &linePrefix) {
+	if (lineLength == 0)
+		throw Exception("Invalid base64 max line length");
 
-	MemoryWriteStream output(data, dataLength);
+	StreamSink sink(base64, lineLength, linePrefix);
+
+	encodeChunks(data, sink);
+}
+
+/** Decode the Base64 characters into a newly allocated stream. */
+static SeekableReadStream *decodeBase64Stream(const char *base64, size_t base64Size) {
+	byte *data = new byte[(base64Size / 4) * 3];
 
 	try {
-		UString overhang;
+		const size_t dataSize = decodeBase64(base64, base64Size, data);
 
-		decodeBase64(output, base64, overhang);
+		return new MemoryReadStream(data, dataSize, true);
 
 	} catch (...) {
 		delete[] data;
 		throw;
 	}
+}
 
-	return new MemoryReadStream(data, output.pos(), true);
+SeekableReadStream *decodeBase64(const UString &base64) {
+	return decodeBase64Stream(base64.c_str(), std::strlen(base64.c_str()));
 }
 
 SeekableReadStream *decodeBase64(const std::list<UString> &base64) {
-	const size_t dataLength = (countLength(base64) / 4) * 3;
-	byte *data = new byte[dataLength];
-
-	MemoryWriteStream output(data, dataLength);
-
-	try {
-		UString overhang;
-
-		for (std::list<UString>::const_iterator b = base64.begin(); b != base64.end(); ++b)
-			decodeBase64(output, *b, overhang);
-
-	} catch (...) {
-		delete[] data;
-		throw;
-	}
+	// Concatenate the strings, since a group of 4 characters might straddle two of them
+	std::string str;
+	for (std::list<UString>::const_iterator b = base64.begin(); b != base64.end(); ++b)
+		str += b->c_str();
 
-	return new MemoryReadStream(data, output.pos(), true);
+	return decodeBase64Stream(str.c_str(), str.size());
 }
 
 } // End of namespace Common
@@ -38,18 +38,48 @@
 #include <list>
 
 #include "src/common/types.h"
+#include "src/common/ustring.h"
 
 namespace Common {
 
-class UString;
 class ReadStream;
 class SeekableReadStream;
+class WriteStream;
+
+/** Return the number of Base64 characters needed to encode dataSize bytes. */
+size_t getBase64Length(size_t dataSize);
+
+/** Encode a buffer of binary data into Base64.
+ *
+ *  The output buffer needs to hold at least getBase64Length(dataSize)
+ *  characters. No terminating \0 is written.
+ *
+ *  Returns the number of characters written.
+ */
+size_t encodeBase64(const byte *data, size_t dataSize, char *base64);
+
+/** Decode a buffer of Base64 characters into binary data.
+ *
+ *  The number of Base64 characters has to be divisible by 4, and the output
+ *  buffer needs to hold at least (base64Size / 4) * 3 bytes.
+ *
+ *  Returns the number of bytes written.
+ */
+size_t decodeBase64(const char *base64, size_t base64Size, byte *data);
 
 /** Encode the binary stream data into a Base64 string. */
 void encodeBase64(ReadStream &data, UString &base64);
 /** Encode the binary stream data into a list of Base64 strings of at max lineLength characters. */
 void encodeBase64(ReadStream &data, std::list<UString> &base64, size_t lineLength);
 
+/** Encode the binary stream data into Base64, writing it directly into a stream.
+ *
+ *  The output is broken into lines of at max lineLength characters, and each
+ *  line is preceded by linePrefix.
+ */
+void encodeBase64(ReadStream &data, WriteStream &base64, size_t lineLength,
+                  const UString &linePrefix = "");
+
 /** Decode the Base64 string into binary data, returning a newly allocated stream. */
 SeekableReadStream *decodeBase64(const UString &base64);
 /** Decode the list of Base64 strings into binary data, returning a newly allocated stream. */
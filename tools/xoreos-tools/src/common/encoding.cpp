@@ -28,10 +28,16 @@
 #include <iconv.h>
 
 #include <vector>
+#include <string>
+#include <iterator>
+
+#include "utf8cpp/utf8.h"
 
 #include "src/common/encoding.h"
+#include "src/common/encoding_tables.h"
 #include "src/common/error.h"
 #include "src/common/singleton.h"
+#include "src/common/mutex.h"
 #include "src/common/ustring.h"
 #include "src/common/memreadstream.h"
 #include "src/common/writestream.h"
@@ -55,30 +61,164 @@ static const size_t kTerminatorLength  [kEncodingMAX] = {
 	1, 1, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1
 };
 
+// .--- Single-byte codepages ---.
+
+/** Return the decoding table of a single-byte codepage, or 0 if there is none. */
+static const uint16 *getCodepageTable(Encoding encoding) {
+	switch (encoding) {
+		case kEncodingLatin9:
+			return kCodepageLatin9;
+		case kEncodingCP1250:
+			return kCodepageCP1250;
+		case kEncodingCP1251:
+			return kCodepageCP1251;
+		case kEncodingCP1252:
+			return kCodepageCP1252;
+
+		default:
+			break;
+	}
+
+	return 0;
+}
+
+/** Return the length of the run of 7-bit ASCII bytes at the start of the data. */
+static size_t findNonASCII(const byte *data, size_t n) {
+	size_t i = 0;
+
+	// Check 16 bytes at a time
+	for (; (i + 16) <= n; i += 16) {
+		uint64 a, b;
+		std::memcpy(&a, data + i    , 8);
+		std::memcpy(&b, data + i + 8, 8);
+
+		if ((a | b) & 0x8080808080808080ULL)
+			break;
+	}
+
+	for (; i < n; i++)
+		if (data[i] & 0x80)
+			break;
+
+	return i;
+}
+
+/** Decode a string in a single-byte codepage into UTF-8.
+ *
+ *  Like with iconv, the string ends at the first 0x00 byte. Returns false
+ *  if there's no table for this encoding or the string contains undefined
+ *  bytes, leaving those to iconv.
+ */
+static bool decodeCodepage(Encoding encoding, const byte *data, size_t n, UString &str) {
+	const uint16 *table = getCodepageTable(encoding);
+	if (!table)
+		return false;
+
+	const byte *end = reinterpret_cast<const byte *>(std::memchr(data, 0, n));
+	if (end)
+		n = end - data;
+
+	std::string utf8;
+	utf8.reserve(n);
+
+	while (n > 0) {
+		const size_t ascii = findNonASCII(data, n);
+
+		utf8.append(reinterpret_cast<const char *>(data), ascii);
+		data += ascii;
+		n    -= ascii;
+
+		if (n == 0)
+			break;
+
+		const uint16 c = table[*data - 0x80];
+		if (c == 0)
+			return false;
+
+		utf8::append(c, std::back_inserter(utf8));
+		data++;
+		n--;
+	}
+
+	str = utf8;
+	return true;
+}
+
+/** Find the byte representing this codepoint in a single-byte codepage. */
+static bool findCodepageByte(const uint16 *table, uint32 c, byte &b) {
+	for (size_t i = 0; i < 128; i++) {
+		if (table[i] == c) {
+			b = 0x80 + i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/** Encode a UTF-8 string into a single-byte codepage.
+ *
+ *  Returns 0 if there's no table for this encoding or the string contains
+ *  characters not representable in it, leaving those to iconv.
+ */
+static MemoryReadStream *encodeCodepage(Encoding encoding, const UString &str, bool terminate) {
+	const uint16 *table = getCodepageTable(encoding);
+	if (!table)
+		return 0;
+
+	const byte *data = reinterpret_cast<const byte *>(str.c_str());
+	size_t n = std::strlen(str.c_str());
+
+	// We never produce more bytes than there are in the UTF-8 input
+	byte *output = new byte[n + 1];
+	byte *out    = output;
+
+	while (n > 0) {
+		const size_t ascii = findNonASCII(data, n);
+
+		std::memcpy(out, data, ascii);
+		out  += ascii;
+		data += ascii;
+		n    -= ascii;
+
+		if (n == 0)
+			break;
+
+		const byte *next = data;
+		const uint32 c   = utf8::unchecked::next(next);
+
+		if (!findCodepageByte(table, c, *out)) {
+			delete[] output;
+			return 0;
+		}
+
+		out++;
+		n   -= next - data;
+		data = next;
+	}
+
+	if (terminate)
+		*out++ = '\0';
+
+	return new MemoryReadStream(output, out - output, true);
+}
+
+// '--- Single-byte codepages ---'
+
 /** A manager handling string encoding conversions. */
 class ConversionManager : public Singleton<ConversionManager> {
 public:
 	ConversionManager() {
 		for (size_t i = 0; i < kEncodingMAX; i++) {
-			_contextFrom[i] = (iconv_t) -1;
-			_contextTo  [i] = (iconv_t) -1;
+			initPool(_poolFrom[i], "UTF-8", kEncodingName[i]);
+			initPool(_poolTo  [i], kEncodingName[i], "UTF-8");
 		}
-
-		for (size_t i = 0; i < kEncodingMAX; i++)
-			if ((_contextFrom[i] = iconv_open("UTF-8", kEncodingName[i])) == ((iconv_t) -1))
-				warning("Failed to initialize %s -> UTF-8 conversion: %s", kEncodingName[i], strerror(errno));
-
-		for (size_t i = 0; i < kEncodingMAX; i++)
-			if ((_contextTo  [i] = iconv_open(kEncodingName[i], "UTF-8")) == ((iconv_t) -1))
-				warning("Failed to initialize UTF-8 -> %s conversion: %s", kEncodingName[i], strerror(errno));
 	}
 
 	~ConversionManager() {
 		for (size_t i = 0; i < kEncodingMAX; i++) {
-			if (_contextFrom[i] != ((iconv_t) -1))
-				iconv_close(_contextFrom[i]);
-			if (_contextTo  [i] != ((iconv_t) -1))
-				iconv_close(_contextTo  [i]);
+			clearPool(_poolFrom[i]);
+			clearPool(_poolTo  [i]);
 		}
 	}
 
@@ -86,20 +226,97 @@ public:
 		if (((size_t) encoding) >= kEncodingMAX)
 			throw Exception("Invalid encoding %d", encoding);
 
-		return convert(_contextFrom[encoding], data, n, kEncodingGrowthFrom[encoding], 1);
+		// Single-byte codepages are decoded directly, without going through iconv
+		UString str;
+		if (decodeCodepage(encoding, data, n, str))
+			return str;
+
+		return convert(_poolFrom[encoding], data, n, kEncodingGrowthFrom[encoding], 1);
 	}
 
 	MemoryReadStream *convert(Encoding encoding, const UString &str, bool terminate = true) {
 		if (((size_t) encoding) >= kEncodingMAX)
 			throw Exception("Invalid encoding %d", encoding);
 
-		return convert(_contextTo[encoding], str, kEncodingGrowthTo[encoding],
+		MemoryReadStream *data = encodeCodepage(encoding, str, terminate);
+		if (data)
+			return data;
+
+		return convert(_poolTo[encoding], str, kEncodingGrowthTo[encoding],
 		               terminate ? kTerminatorLength[encoding] : 0);
 	}
 
 private:
-	iconv_t _contextFrom[kEncodingMAX];
-	iconv_t _contextTo  [kEncodingMAX];
+	/** The iconv contexts for one conversion direction of one encoding.
+	 *
+	 *  An iconv context carries conversion state, so it must never be used
+	 *  by two threads at the same time. Each conversion takes a context out
+	 *  of the pool and puts it back when it's done, and a new context is
+	 *  opened whenever all existing ones are currently in use.
+	 */
+	struct ContextPool {
+		const char *to;
+		const char *from;
+
+		bool failed; ///< Is this conversion unavailable?
+
+		std::vector<iconv_t> contexts; ///< The currently unused contexts.
+	};
+
+	ContextPool _poolFrom[kEncodingMAX];
+	ContextPool _poolTo  [kEncodingMAX];
+
+	/** Guards the contexts lists. Only held while taking out or putting back a context. */
+	Mutex _mutex;
+
+	void initPool(ContextPool &pool, const char *to, const char *from) {
+		pool.to     = to;
+		pool.from   = from;
+		pool.failed = false;
+
+		// Open the first context right away, to see if this conversion is available at all
+		iconv_t ctx = iconv_open(to, from);
+		if (ctx == ((iconv_t) -1)) {
+			warning("Failed to initialize %s -> %s conversion: %s", from, to, strerror(errno));
+
+			pool.failed = true;
+			return;
+		}
+
+		pool.contexts.push_back(ctx);
+	}
+
+	void clearPool(ContextPool &pool) {
+		for (std::vector<iconv_t>::iterator c = pool.contexts.begin(); c != pool.contexts.end(); ++c)
+			iconv_close(*c);
+
+		pool.contexts.clear();
+	}
+
+	iconv_t acquireContext(ContextPool &pool) {
+		{
+			StackLock lock(_mutex);
+
+			if (pool.failed)
+				return (iconv_t) -1;
+
+			if (!pool.contexts.empty()) {
+				iconv_t ctx = pool.contexts.back();
+				pool.contexts.pop_back();
+
+				return ctx;
+			}
+		}
+
+		// All contexts are in use by other threads, so open another one
+		return iconv_open(pool.to, pool.from);
+	}
+
+	void releaseContext(ContextPool &pool, iconv_t ctx) {
+		StackLock lock(_mutex);
+
+		pool.contexts.push_back(ctx);
+	}
 
 	byte *doConvert(iconv_t &ctx, byte *data, size_t nIn, size_t nOut, size_t &size) {
 		size_t inBytes  = nIn;
@@ -126,12 +343,23 @@ private:
 		return convData;
 	}
 
-	UString convert(iconv_t &ctx, byte *data, size_t n, size_t growth, size_t termSize) {
+	UString convert(ContextPool &pool, byte *data, size_t n, size_t growth, size_t termSize) {
+		iconv_t ctx = acquireContext(pool);
 		if (ctx == ((iconv_t) -1))
 			return "[!!!]";
 
 		size_t size;
-		byte *dataOut = doConvert(ctx, data, n, n * growth + termSize, size);
+		byte *dataOut = 0;
+
+		try {
+			dataOut = doConvert(ctx, data, n, n * growth + termSize, size);
+		} catch (...) {
+			releaseContext(pool, ctx);
+			throw;
+		}
+
+		releaseContext(pool, ctx);
+
 		if (!dataOut)
 			return "[!?!]";
 
@@ -144,7 +372,8 @@ private:
 		return str;
 	}
 
-	MemoryReadStream *convert(iconv_t &ctx, const UString &str, size_t growth, size_t termSize) {
+	MemoryReadStream *convert(ContextPool &pool, const UString &str, size_t growth, size_t termSize) {
+		iconv_t ctx = acquireContext(pool);
 		if (ctx == ((iconv_t) -1))
 			return 0;
 
@@ -153,7 +382,17 @@ private:
 		size_t nOut   = nIn * growth + termSize;
 
 		size_t size;
-		byte *dataOut = doConvert(ctx, dataIn, nIn, nOut, size);
+		byte *dataOut = 0;
+
+		try {
+			dataOut = doConvert(ctx, dataIn, nIn, nOut, size);
+		} catch (...) {
+			releaseContext(pool, ctx);
+			throw;
+		}
+
+		releaseContext(pool, ctx);
+
 		if (!dataOut)
 			return 0;
 
@@ -180,6 +419,7 @@ static uint32 readFakeChar(SeekableReadStream &stream, Encoding encoding) {
 		case kEncodingLatin9:
 		case kEncodingUTF8:
 		case kEncodingCP1250:
+		case kEncodingCP1251:
 		case kEncodingCP1252:
 		case kEncodingCP932:
 		case kEncodingCP936:
@@ -217,6 +457,7 @@ static void writeFakeChar(std::vector<byte> &output, uint32 c, Encoding encoding
 		case kEncodingLatin9:
 		case kEncodingUTF8:
 		case kEncodingCP1250:
+		case kEncodingCP1251:
 		case kEncodingCP1252:
 		case kEncodingCP932:
 		case kEncodingCP936:
@@ -308,6 +549,8 @@ size_t writeString(WriteStream &stream, const Common::UString &str, Encoding enc
 	MemoryReadStream *data = 0;
 	try {
 		data = convertString(str, encoding, terminate);
+		if (!data)
+			throw Exception("Failed converting string to encoding %d", (int)encoding);
 
 		n = stream.writeStream(*data);
 	} catch (...) {
@@ -324,6 +567,8 @@ void writeStringFixed(WriteStream &stream, const Common::UString &str, Encoding
 	MemoryReadStream *data = 0;
 	try {
 		data = convertString(str, encoding, false);
+		if (!data)
+			throw Exception("Failed converting string to encoding %d", (int)encoding);
 
 		size_t n = stream.writeStream(*data, length);
 		while (n++ < length)
@@ -350,6 +595,7 @@ size_t getBytesPerCodepoint(Encoding encoding) {
 		case kEncodingASCII:
 		case kEncodingLatin9:
 		case kEncodingCP1250:
+		case kEncodingCP1251:
 		case kEncodingCP1252:
 			return 1;
 
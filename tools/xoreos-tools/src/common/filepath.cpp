@@ -54,4 +54,23 @@ UString FilePath::getFile(const UString &p) {
 	return file;
 }
 
+UString FilePath::getDirectory(const UString &p) {
+	UString::iterator slash = p.findLast('/');
+	UString::iterator backslash = p.findLast('\\');
+
+	if (slash == p.end())
+		slash = backslash;
+	else if ((backslash != p.end()) && (p.getPosition(backslash) > p.getPosition(slash)))
+		slash = backslash;
+
+	if (slash == p.end())
+		return "";
+
+	// Keep the root directory's slash
+	if (slash == p.begin())
+		return UString(*slash);
+
+	return UString(p.begin(), slash);
+}
+
 } // End of namespace Common
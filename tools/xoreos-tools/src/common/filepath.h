@@ -69,6 +69,15 @@ public:
 	 *  @return The path's file.
 	 */
 	static UString getFile(const UString &p);
+
+	/** Return the directory part of a path.
+	 *
+	 *  Example: "/path/to/file.ext" -> "/path/to"
+	 *
+	 *  @param  p The path to manipulate.
+	 *  @return The path's directory, or "" if the path has no directory part.
+	 */
+	static UString getDirectory(const UString &p);
 };
 
 } // End of namespace Common
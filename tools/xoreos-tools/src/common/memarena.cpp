@@ -0,0 +1,97 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A simple memory arena, for many small allocations freed all at once.
+ */
+
+#include "src/common/memarena.h"
+#include "src/common/util.h"
+
+namespace Common {
+
+/** The alignment of all allocations, large enough for any basic type. */
+static const size_t kArenaAlignment = 16;
+
+MemoryArena::MemoryArena(size_t chunkSize) : _chunkSize(MAX<size_t>(chunkSize, kArenaAlignment)),
+	_free(0), _freeSize(0), _allocatedSize(0), _reservedSize(0) {
+
+}
+
+MemoryArena::~MemoryArena() {
+	clear();
+}
+
+void *MemoryArena::allocate(size_t size) {
+	size = (MAX<size_t>(size, 1) + kArenaAlignment - 1) & ~(kArenaAlignment - 1);
+
+	_allocatedSize += size;
+
+	// Allocations larger than a quarter chunk get a chunk of their own, to not waste space
+	if (size > (_chunkSize / 4))
+		return allocateChunk(size);
+
+	if (size > _freeSize) {
+		_free     = allocateChunk(_chunkSize);
+		_freeSize = _chunkSize;
+	}
+
+	byte *data = _free;
+
+	_free     += size;
+	_freeSize -= size;
+
+	return data;
+}
+
+byte *MemoryArena::allocateChunk(size_t size) {
+	Chunk chunk;
+
+	chunk.data = new byte[size];
+	chunk.size = size;
+
+	_chunks.push_back(chunk);
+	_reservedSize += size;
+
+	return chunk.data;
+}
+
+void MemoryArena::clear() {
+	for (std::vector<Chunk>::iterator c = _chunks.begin(); c != _chunks.end(); ++c)
+		delete[] c->data;
+
+	_chunks.clear();
+
+	_free     = 0;
+	_freeSize = 0;
+
+	_allocatedSize = 0;
+	_reservedSize  = 0;
+}
+
+size_t MemoryArena::getAllocatedSize() const {
+	return _allocatedSize;
+}
+
+size_t MemoryArena::getReservedSize() const {
+	return _reservedSize;
+}
+
+} // End of namespace Common
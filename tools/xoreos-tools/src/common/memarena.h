@@ -0,0 +1,90 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A simple memory arena, for many small allocations freed all at once.
+ */
+
+#ifndef COMMON_MEMARENA_H
+#define COMMON_MEMARENA_H
+
+#include <vector>
+
+#include "src/common/types.h"
+#include "src/common/noncopyable.h"
+
+namespace Common {
+
+/** A memory arena.
+ *
+ *  Memory is handed out from large chunks, by simply moving a pointer
+ *  forward. Individual allocations can't be freed; instead, all the memory
+ *  is released together, when the arena is cleared or destroyed.
+ *
+ *  This makes allocating lots of small, long-lived objects very cheap,
+ *  both in time and in memory overhead. Note that no constructors or
+ *  destructors are called, so only plain data should be stored here.
+ */
+class MemoryArena : NonCopyable {
+public:
+	/** Create an arena that allocates memory in chunks of this many bytes. */
+	MemoryArena(size_t chunkSize = 65536);
+	~MemoryArena();
+
+	/** Allocate size bytes, aligned to fit any type. */
+	void *allocate(size_t size);
+
+	/** Allocate memory for count elements of type T. */
+	template<typename T>
+	T *allocate(size_t count) {
+		return static_cast<T *>(allocate(count * sizeof(T)));
+	}
+
+	/** Free all memory allocated from this arena. */
+	void clear();
+
+	/** Return the number of bytes handed out by this arena. */
+	size_t getAllocatedSize() const;
+	/** Return the number of bytes this arena reserved from the system. */
+	size_t getReservedSize() const;
+
+private:
+	struct Chunk {
+		byte  *data;
+		size_t size;
+	};
+
+	size_t _chunkSize;
+
+	std::vector<Chunk> _chunks;
+
+	/** The free memory at the end of the current chunk. */
+	byte  *_free;
+	size_t _freeSize;
+
+	size_t _allocatedSize;
+	size_t _reservedSize;
+
+	byte *allocateChunk(size_t size);
+};
+
+} // End of namespace Common
+
+#endif // COMMON_MEMARENA_H
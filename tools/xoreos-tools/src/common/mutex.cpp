@@ -0,0 +1,83 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Thread mutex classes.
+ */
+
+#include "src/common/mutex.h"
+
+namespace Common {
+
+#if defined(WIN32)
+
+Mutex::Mutex() {
+	InitializeCriticalSection(&_mutex);
+}
+
+Mutex::~Mutex() {
+	DeleteCriticalSection(&_mutex);
+}
+
+void Mutex::lock() {
+	EnterCriticalSection(&_mutex);
+}
+
+void Mutex::unlock() {
+	LeaveCriticalSection(&_mutex);
+}
+
+#else
+
+Mutex::Mutex() {
+	pthread_mutexattr_t attr;
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+
+	pthread_mutex_init(&_mutex, &attr);
+
+	pthread_mutexattr_destroy(&attr);
+}
+
+Mutex::~Mutex() {
+	pthread_mutex_destroy(&_mutex);
+}
+
+void Mutex::lock() {
+	pthread_mutex_lock(&_mutex);
+}
+
+void Mutex::unlock() {
+	pthread_mutex_unlock(&_mutex);
+}
+
+#endif
+
+
+StackLock::StackLock(Mutex &mutex) : _mutex(&mutex) {
+	_mutex->lock();
+}
+
+StackLock::~StackLock() {
+	_mutex->unlock();
+}
+
+} // End of namespace Common
@@ -0,0 +1,74 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Thread mutex classes.
+ */
+
+#ifndef COMMON_MUTEX_H
+#define COMMON_MUTEX_H
+
+#include "src/common/system.h"
+
+#if defined(WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <pthread.h>
+#endif
+
+#include "src/common/noncopyable.h"
+
+namespace Common {
+
+/** A mutex, guarding data shared between threads.
+ *
+ *  The mutex is recursive: a thread that already holds it can lock it
+ *  again, as long as it unlocks it the same number of times.
+ */
+class Mutex : NonCopyable {
+public:
+	Mutex();
+	~Mutex();
+
+	void lock();
+	void unlock();
+
+private:
+#if defined(WIN32)
+	CRITICAL_SECTION _mutex;
+#else
+	pthread_mutex_t _mutex;
+#endif
+};
+
+/** Convenience class that locks a mutex on creation and unlocks it on destruction. */
+class StackLock : NonCopyable {
+public:
+	StackLock(Mutex &mutex);
+	~StackLock();
+
+private:
+	Mutex *_mutex;
+};
+
+} // End of namespace Common
+
+#endif // COMMON_MUTEX_H
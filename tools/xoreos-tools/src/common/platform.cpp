@@ -29,6 +29,8 @@
 	#include <windows.h>
 	#include <shellapi.h>
 	#include <wchar.h>
+#else
+	#include <time.h>
 #endif
 
 #include <cassert>
@@ -100,4 +102,23 @@ std::FILE *Platform::openFile(const UString &fileName, FileMode mode) {
 }
 // '--- openFile() ---'
 
+// .--- getMicroseconds() ---.
+uint64 Platform::getMicroseconds() {
+#if defined(WIN32)
+	LARGE_INTEGER frequency, counter;
+
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+
+	return (uint64) ((counter.QuadPart / frequency.QuadPart) * 1000000 +
+	                 ((counter.QuadPart % frequency.QuadPart) * 1000000) / frequency.QuadPart);
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return ((uint64) now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+#endif
+}
+// '--- getMicroseconds() ---'
+
 } // End of namespace Common
@@ -29,6 +29,7 @@
 
 #include <vector>
 
+#include "src/common/types.h"
 #include "src/common/ustring.h"
 
 namespace Common {
@@ -47,6 +48,9 @@ public:
 
 	/** Open a file with an UTF-8 encoded name. */
 	static std::FILE *openFile(const UString &fileName, FileMode mode);
+
+	/** Return a monotonic timestamp in microseconds, for measuring time spans. */
+	static uint64 getMicroseconds();
 };
 
 } // End of namespace Common
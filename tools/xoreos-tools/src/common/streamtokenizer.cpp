@@ -157,7 +157,9 @@ size_t StreamTokenizer::getTokens(SeekableReadStream &stream, std::vector<UStrin
 		UString token = getToken(stream);
 
 		if (!token.empty() || (_conSepRule != kRuleIgnoreAll)) {
-			list.push_back(token);
+			// Swap the token into place instead of copying it
+			list.push_back(UString());
+			list.back().swap(token);
 			realTokenCount++;
 		}
 	}
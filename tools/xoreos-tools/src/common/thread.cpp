@@ -0,0 +1,204 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Threading helpers.
+ */
+
+#if !defined(WIN32)
+	#include <unistd.h>
+#endif
+
+#include "src/common/thread.h"
+#include "src/common/util.h"
+#include "src/common/error.h"
+
+namespace Common {
+
+Thread::Thread() : _running(false) {
+}
+
+Thread::~Thread() {
+	joinThread();
+}
+
+#if defined(WIN32)
+
+void Thread::createThread() {
+	if (_running)
+		return;
+
+	_thread = CreateThread(0, 0, &threadHelper, this, 0, 0);
+	if (!_thread)
+		throw Exception("Failed to create thread");
+
+	_running = true;
+}
+
+void Thread::joinThread() {
+	if (!_running)
+		return;
+
+	WaitForSingleObject(_thread, INFINITE);
+	CloseHandle(_thread);
+
+	_running = false;
+}
+
+size_t Thread::getProcessorCount() {
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+
+	return MAX<size_t>(info.dwNumberOfProcessors, 1);
+}
+
+DWORD WINAPI Thread::threadHelper(LPVOID obj) {
+	try {
+		static_cast<Thread *>(obj)->threadMethod();
+	} catch (...) {
+		exceptionDispatcherWarnAndIgnore("Uncaught exception in thread");
+	}
+
+	return 0;
+}
+
+#else
+
+void Thread::createThread() {
+	if (_running)
+		return;
+
+	if (pthread_create(&_thread, 0, &threadHelper, this) != 0)
+		throw Exception("Failed to create thread");
+
+	_running = true;
+}
+
+void Thread::joinThread() {
+	if (!_running)
+		return;
+
+	pthread_join(_thread, 0);
+
+	_running = false;
+}
+
+size_t Thread::getProcessorCount() {
+	const long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return (count > 0) ? (size_t) count : 1;
+}
+
+void *Thread::threadHelper(void *obj) {
+	try {
+		static_cast<Thread *>(obj)->threadMethod();
+	} catch (...) {
+		exceptionDispatcherWarnAndIgnore("Uncaught exception in thread");
+	}
+
+	return 0;
+}
+
+#endif
+
+
+/** A thread of a ThreadPool, running jobs until none are left. */
+class ThreadPool::Worker : public Thread {
+public:
+	Worker(ThreadPool &pool) : _pool(&pool) {
+	}
+
+	~Worker() {
+		joinThread();
+	}
+
+protected:
+	void threadMethod() {
+		_pool->work();
+	}
+
+private:
+	ThreadPool *_pool;
+};
+
+ThreadPool::ThreadPool() : _jobCount(0), _nextJob(0) {
+}
+
+ThreadPool::~ThreadPool() {
+	joinWorkers();
+}
+
+void ThreadPool::runJobs(size_t jobCount, size_t threadCount) {
+	joinWorkers();
+
+	_jobCount = jobCount;
+	_nextJob  = 0;
+
+	threadCount = MIN(threadCount, jobCount);
+
+	try {
+		_workers.reserve(threadCount);
+
+		// The calling thread works on the jobs too
+		for (size_t i = 1; i < threadCount; i++) {
+			_workers.push_back(new Worker(*this));
+			_workers.back()->createThread();
+		}
+
+	} catch (...) {
+		// Wait for the threads already started, which work through all jobs between them
+		joinWorkers();
+		throw;
+	}
+
+	work();
+
+	joinWorkers();
+}
+
+bool ThreadPool::getNextJob(size_t &n) {
+	StackLock lock(_jobMutex);
+
+	if (_nextJob >= _jobCount)
+		return false;
+
+	n = _nextJob++;
+	return true;
+}
+
+void ThreadPool::work() {
+	size_t n;
+	while (getNextJob(n)) {
+		try {
+			runJob(n);
+		} catch (...) {
+			exceptionDispatcherWarnAndIgnore("Uncaught exception in thread pool job");
+		}
+	}
+}
+
+void ThreadPool::joinWorkers() {
+	for (std::vector<Worker *>::iterator w = _workers.begin(); w != _workers.end(); ++w)
+		delete *w;
+
+	_workers.clear();
+}
+
+} // End of namespace Common
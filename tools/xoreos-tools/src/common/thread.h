@@ -0,0 +1,128 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Threading helpers.
+ */
+
+#ifndef COMMON_THREAD_H
+#define COMMON_THREAD_H
+
+#include "src/common/system.h"
+
+#if defined(WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <pthread.h>
+#endif
+
+#include <vector>
+
+#include "src/common/types.h"
+#include "src/common/noncopyable.h"
+#include "src/common/mutex.h"
+
+namespace Common {
+
+/** A class that runs a method in its own thread.
+ *
+ *  Derive from this class and implement threadMethod(). createThread()
+ *  then starts a new thread running that method, and joinThread() waits
+ *  for it to finish. The destructor joins a still running thread.
+ *
+ *  An exception escaping threadMethod() is printed as a warning and
+ *  otherwise ignored.
+ */
+class Thread : NonCopyable {
+public:
+	Thread();
+	virtual ~Thread();
+
+	/** Start running threadMethod() in a new thread. */
+	void createThread();
+	/** Wait for the thread to finish. */
+	void joinThread();
+
+	/** Return the number of processors available to this process. */
+	static size_t getProcessorCount();
+
+protected:
+	/** The method that is run in the thread. */
+	virtual void threadMethod() = 0;
+
+private:
+	bool _running;
+
+#if defined(WIN32)
+	HANDLE _thread;
+
+	static DWORD WINAPI threadHelper(LPVOID obj);
+#else
+	pthread_t _thread;
+
+	static void *threadHelper(void *obj);
+#endif
+};
+
+/** A pool of threads working through a list of jobs together.
+ *
+ *  Derive from this class and implement runJob(). runJobs() then calls
+ *  runJob() once for every job, spread over several threads, the calling
+ *  thread being one of them. The jobs are handed out in order, each to the
+ *  next thread that becomes free.
+ *
+ *  All threads are joined before runJobs() returns, even when it throws,
+ *  and again in the destructor. So the threads never outlive the pool, nor
+ *  any state the pool holds.
+ *
+ *  Like with Thread, an exception escaping runJob() is printed as a
+ *  warning and otherwise ignored.
+ */
+class ThreadPool : NonCopyable {
+public:
+	ThreadPool();
+	virtual ~ThreadPool();
+
+	/** Run the jobs 0 to jobCount - 1 on threadCount threads, and wait for all of them. */
+	void runJobs(size_t jobCount, size_t threadCount);
+
+protected:
+	/** Run this job. Called from several threads at once. */
+	virtual void runJob(size_t n) = 0;
+
+private:
+	class Worker;
+
+	std::vector<Worker *> _workers;
+
+	size_t _jobCount;
+	size_t _nextJob;
+
+	Mutex _jobMutex; ///< Guards _nextJob.
+
+	bool getNextJob(size_t &n);
+	void work();
+	void joinWorkers();
+};
+
+} // End of namespace Common
+
+#endif // COMMON_THREAD_H
@@ -86,11 +86,11 @@ UString &UString::operator=(const char *str) {
 }
 
 bool UString::operator==(const UString &str) const {
-	return strcmp(str) == 0;
+	return equals(str);
 }
 
 bool UString::operator!=(const UString &str) const {
-	return strcmp(str) != 0;
+	return !equals(str);
 }
 
 bool UString::operator<(const UString &str) const {
@@ -153,6 +153,13 @@ UString &UString::operator+=(const char *str) {
 }
 
 UString &UString::operator+=(uint32 c) {
+	if (isASCII(c)) {
+		_string.push_back((char) c);
+		_size++;
+
+		return *this;
+	}
+
 	try {
 		utf8::append(c, std::back_inserter(_string));
 	} catch (const std::exception &se) {
@@ -166,28 +173,34 @@ UString &UString::operator+=(uint32 c) {
 }
 
 int UString::strcmp(const UString &str) const {
-	UString::iterator it1 = begin();
-	UString::iterator it2 = str.begin();
-	for (; (it1 != end()) && (it2 != str.end()); ++it1, ++it2) {
-		uint32 c1 = *it1;
-		uint32 c2 = *it2;
+	/* UTF-8 preserves the ordering of codepoints, so a bytewise
+	 * (unsigned) comparison gives the same result as comparing the
+	 * decoded characters one by one. */
+	const int result = _string.compare(str._string);
 
-		if (c1 < c2)
-			return -1;
-		if (c1 > c2)
-			return  1;
-	}
+	return (result < 0) ? -1 : ((result > 0) ? 1 : 0);
+}
 
-	if ((it1 == end()) && (it2 == str.end()))
-		return 0;
+int UString::stricmp(const UString &str) const {
+	if (isASCII() && str.isASCII()) {
+		const size_t size = MIN(_size, str._size);
 
-	if (it1 == end())
-		return -1;
+		for (size_t i = 0; i < size; i++) {
+			const int c1 = std::tolower((byte) _string[i]);
+			const int c2 = std::tolower((byte) str._string[i]);
 
-	return 1;
-}
+			if (c1 < c2)
+				return -1;
+			if (c1 > c2)
+				return  1;
+		}
+
+		if (_size == str._size)
+			return 0;
+
+		return (_size < str._size) ? -1 : 1;
+	}
 
-int UString::stricmp(const UString &str) const {
 	UString::iterator it1 = begin();
 	UString::iterator it2 = str.begin();
 	for (; (it1 != end()) && (it2 != str.end()); ++it1, ++it2) {
@@ -210,10 +223,13 @@ int UString::stricmp(const UString &str) const {
 }
 
 bool UString::equals(const UString &str) const {
-	return strcmp(str) == 0;
+	return (_size == str._size) && (_string == str._string);
 }
 
 bool UString::equalsIgnoreCase(const UString &str) const {
+	if (_size != str._size)
+		return false;
+
 	return stricmp(str) == 0;
 }
 
@@ -240,6 +256,10 @@ size_t UString::size() const {
 	return _size;
 }
 
+bool UString::isASCII() const {
+	return _size == _string.size();
+}
+
 bool UString::empty() const {
 	return _string.empty() || (_string[0] == '\0');
 }
@@ -351,6 +371,12 @@ void UString::truncate(size_t n) {
 	if (n >= _size)
 		return;
 
+	if (isASCII()) {
+		_string.resize(n);
+		_size = n;
+		return;
+	}
+
 	UString temp;
 
 	for (iterator it = begin(); n > 0; ++it, n--)
@@ -473,32 +499,45 @@ void UString::makeUpper() {
 }
 
 UString UString::toLower() const {
-	UString str;
+	/* Only ASCII characters have a case mapping, and bytes < 0x80 in UTF-8
+	 * are always ASCII characters. We can therefore work on the bytes and
+	 * leave everything else, including the size, untouched. */
+	UString str(*this);
 
-	str._string.reserve(_string.size());
-	for (iterator it = begin(); it != end(); ++it)
-		str += toLower(*it);
+	for (std::string::iterator it = str._string.begin(); it != str._string.end(); ++it)
+		if (!(*it & 0x80))
+			*it = std::tolower(*it);
 
 	return str;
 }
 
 UString UString::toUpper() const {
-	UString str;
+	UString str(*this);
 
-	str._string.reserve(_string.size());
-	for (iterator it = begin(); it != end(); ++it)
-		str += toUpper(*it);
+	for (std::string::iterator it = str._string.begin(); it != str._string.end(); ++it)
+		if (!(*it & 0x80))
+			*it = std::toupper(*it);
 
 	return str;
 }
 
 UString::iterator UString::getPosition(size_t n) const {
+	if (isASCII()) {
+		std::string::const_iterator it = _string.begin();
+		std::advance(it, MIN(n, _size));
+
+		return iterator(it, _string.begin(), _string.end());
+	}
+
 	iterator it = begin();
 	for (size_t i = 0; (i < n) && (it != end()); i++, ++it);
 	return it;
 }
 
 size_t UString::getPosition(iterator it) const {
+	if (isASCII())
+		return std::distance(_string.begin(), it.base());
+
 	size_t n = 0;
 	for (iterator i = begin(); i != it; ++i, n++);
 	return n;
@@ -748,9 +787,17 @@ size_t UString::split(const UString &text, uint32 delim, std::vector<UString> &t
 }
 
 void UString::recalculateSize() {
+	// Skip over the leading ASCII characters, which are one byte each
+	_size = 0;
+	while ((_size < _string.size()) && !(_string[_size] & 0x80))
+		_size++;
+
+	if (_size == _string.size())
+		return;
+
 	try {
-		// Calculate the "distance" in characters from the beginning and end
-		_size = utf8::distance(_string.begin(), _string.end());
+		// Calculate the "distance" in characters for the rest
+		_size += utf8::distance(_string.begin() + _size, _string.end());
 	} catch (const std::exception &se) {
 		Exception e(se);
 		throw e;
@@ -114,6 +114,14 @@ public:
 	/** Return the size of the string, in characters. */
 	size_t size() const;
 
+	/** Does the string consist of ASCII characters only?
+	 *
+	 *  Every non-ASCII codepoint takes up more than one byte in UTF-8, so
+	 *  this is the case exactly when the number of characters is equal to
+	 *  the number of bytes. No scanning is necessary.
+	 */
+	bool isASCII() const;
+
 	/** Is the string empty? */
 	bool empty() const;
 
@@ -0,0 +1,140 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A non-owning view into UTF-8 string data.
+ */
+
+#include <cstring>
+#include <cctype>
+
+#include "src/common/ustringview.h"
+#include "src/common/ustring.h"
+#include "src/common/util.h"
+
+namespace Common {
+
+UStringView::UStringView() : _data(""), _size(0), _ascii(true) {
+}
+
+UStringView::UStringView(const char *str) : _data(str), _size(std::strlen(str)) {
+	_ascii = isASCII(_data, _size);
+}
+
+UStringView::UStringView(const char *str, size_t n) : _data(str), _size(n) {
+	_ascii = isASCII(_data, _size);
+}
+
+UStringView::UStringView(const std::string &str) : _data(str.c_str()), _size(str.size()) {
+	_ascii = isASCII(_data, _size);
+}
+
+UStringView::UStringView(const UString &str) : _data(str.c_str()), _ascii(str.isASCII()) {
+	// In an ASCII string, the number of characters is the number of bytes
+	_size = _ascii ? str.size() : std::strlen(_data);
+}
+
+const char *UStringView::data() const {
+	return _data;
+}
+
+size_t UStringView::size() const {
+	return _size;
+}
+
+bool UStringView::empty() const {
+	return _size == 0;
+}
+
+bool UStringView::isASCII() const {
+	return _ascii;
+}
+
+bool UStringView::operator==(const UStringView &str) const {
+	return equals(str);
+}
+
+bool UStringView::operator!=(const UStringView &str) const {
+	return !equals(str);
+}
+
+int UStringView::strcmp(const UStringView &str) const {
+	/* UTF-8 preserves the ordering of codepoints, so a bytewise
+	 * (unsigned) comparison is the same as the one UString does. */
+	const int result = std::memcmp(_data, str._data, MIN(_size, str._size));
+	if (result != 0)
+		return (result < 0) ? -1 : 1;
+
+	if (_size == str._size)
+		return 0;
+
+	return (_size < str._size) ? -1 : 1;
+}
+
+int UStringView::stricmp(const UStringView &str) const {
+	/* Only ASCII characters have a case mapping, and bytes < 0x80 are
+	 * always ASCII characters in UTF-8. Lowercasing those bytes and then
+	 * comparing bytewise is therefore the same as comparing lowercased
+	 * characters, like UString does. */
+	const size_t size = MIN(_size, str._size);
+
+	for (size_t i = 0; i < size; i++) {
+		byte c1 = _data[i];
+		byte c2 = str._data[i];
+
+		if (!(c1 & 0x80))
+			c1 = std::tolower(c1);
+		if (!(c2 & 0x80))
+			c2 = std::tolower(c2);
+
+		if (c1 < c2)
+			return -1;
+		if (c1 > c2)
+			return  1;
+	}
+
+	if (_size == str._size)
+		return 0;
+
+	return (_size < str._size) ? -1 : 1;
+}
+
+bool UStringView::equals(const UStringView &str) const {
+	return (_size == str._size) && (std::memcmp(_data, str._data, _size) == 0);
+}
+
+bool UStringView::equalsIgnoreCase(const UStringView &str) const {
+	// Case mapping never changes the number of bytes
+	return (_size == str._size) && (stricmp(str) == 0);
+}
+
+UString UStringView::toString() const {
+	return UString(_data, _size);
+}
+
+bool UStringView::isASCII(const char *str, size_t n) {
+	for (size_t i = 0; i < n; i++)
+		if (str[i] & 0x80)
+			return false;
+
+	return true;
+}
+
+} // End of namespace Common
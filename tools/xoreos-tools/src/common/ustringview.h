@@ -0,0 +1,94 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A non-owning view into UTF-8 string data.
+ */
+
+#ifndef COMMON_USTRINGVIEW_H
+#define COMMON_USTRINGVIEW_H
+
+#include <string>
+
+#include "src/common/types.h"
+
+namespace Common {
+
+class UString;
+
+/** A non-owning view into UTF-8 string data.
+ *
+ *  A UStringView is only a pointer and a length in bytes. Unlike UString,
+ *  creating one never allocates memory and never validates the UTF-8 data,
+ *  which makes it the right type for lookups by name: a string literal, a
+ *  fixed-length name in a file buffer or an existing UString can all be
+ *  compared against without first creating a temporary UString.
+ *
+ *  The view does not own the data it points to, so the data has to
+ *  outlive the view. The data is not necessarily NUL-terminated.
+ */
+class UStringView {
+public:
+	/** Construct an empty view. */
+	UStringView();
+	/** Construct a view of this NUL-terminated UTF-8 string. */
+	UStringView(const char *str);
+	/** Construct a view of the first n bytes of an UTF-8 string. */
+	UStringView(const char *str, size_t n);
+	/** Construct a view of this UTF-8 string. */
+	UStringView(const std::string &str);
+	/** Construct a view of this string. */
+	UStringView(const UString &str);
+
+	/** Return the (UTF-8 encoded) string data, not necessarily NUL-terminated. */
+	const char *data() const;
+	/** Return the size of the string, in bytes. */
+	size_t size() const;
+
+	/** Is the view empty? */
+	bool empty() const;
+
+	/** Does the string consist of ASCII characters only? */
+	bool isASCII() const;
+
+	bool operator==(const UStringView &str) const;
+	bool operator!=(const UStringView &str) const;
+
+	int strcmp(const UStringView &str) const;
+	int stricmp(const UStringView &str) const;
+
+	bool equals(const UStringView &str) const;
+	bool equalsIgnoreCase(const UStringView &str) const;
+
+	/** Create an UString holding a copy of the viewed string. */
+	UString toString() const;
+
+private:
+	const char *_data;
+	size_t _size;
+
+	bool _ascii;
+
+	static bool isASCII(const char *str, size_t n);
+};
+
+} // End of namespace Common
+
+#endif // COMMON_USTRINGVIEW_H
@@ -0,0 +1,124 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A pool of pixel buffers, for reusing the memory of freed mip maps.
+ */
+
+#include <map>
+
+#include "src/common/mutex.h"
+
+#include "src/images/bufferpool.h"
+
+namespace Images {
+
+/** The buffers in the pool, sorted by size. */
+class BufferPool {
+public:
+	BufferPool() : _maxSize(0), _size(0) {
+	}
+
+	~BufferPool() {
+		shrink(0);
+	}
+
+	void setMaxSize(size_t size) {
+		Common::StackLock lock(_mutex);
+
+		_maxSize = size;
+		shrink(_maxSize);
+	}
+
+	byte *allocate(size_t size) {
+		{
+			Common::StackLock lock(_mutex);
+
+			Buffers::iterator buffer = _buffers.find(size);
+			if (buffer != _buffers.end()) {
+				byte *data = buffer->second;
+
+				_size -= size;
+				_buffers.erase(buffer);
+
+				return data;
+			}
+		}
+
+		return new byte[size];
+	}
+
+	void release(byte *data, size_t size) {
+		if (!data)
+			return;
+
+		{
+			Common::StackLock lock(_mutex);
+
+			if ((size > 0) && (size <= _maxSize - _size)) {
+				_buffers.insert(std::make_pair(size, data));
+				_size += size;
+
+				return;
+			}
+		}
+
+		delete[] data;
+	}
+
+private:
+	typedef std::multimap<size_t, byte *> Buffers;
+
+	Common::Mutex _mutex;
+
+	size_t _maxSize; ///< The maximum number of bytes kept in the pool.
+	size_t _size;    ///< The number of bytes currently in the pool.
+
+	Buffers _buffers;
+
+	/** Free the biggest buffers until the pool fits into size bytes. */
+	void shrink(size_t size) {
+		while ((_size > size) && !_buffers.empty()) {
+			Buffers::iterator buffer = --_buffers.end();
+
+			_size -= buffer->first;
+			delete[] buffer->second;
+
+			_buffers.erase(buffer);
+		}
+	}
+};
+
+static BufferPool bufferPool;
+
+
+void setBufferPoolSize(size_t size) {
+	bufferPool.setMaxSize(size);
+}
+
+byte *allocateBuffer(size_t size) {
+	return bufferPool.allocate(size);
+}
+
+void freeBuffer(byte *data, size_t size) {
+	bufferPool.release(data, size);
+}
+
+} // End of namespace Images
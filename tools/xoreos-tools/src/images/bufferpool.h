@@ -0,0 +1,56 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A pool of pixel buffers, for reusing the memory of freed mip maps.
+ */
+
+#ifndef IMAGES_BUFFERPOOL_H
+#define IMAGES_BUFFERPOOL_H
+
+#include "src/common/types.h"
+
+namespace Images {
+
+/** Keep freed pixel buffers of up to this many bytes in total around for reuse.
+ *
+ *  Converting many textures in a row allocates and frees buffers of the same
+ *  few sizes over and over again. Big buffers come directly from the system,
+ *  so each of these allocations costs page faults; keeping the buffers around
+ *  avoids that.
+ *
+ *  The pool is shared by all threads. It is disabled, with a size of 0, by
+ *  default. Shrinking the pool frees the buffers that don't fit anymore.
+ */
+void setBufferPoolSize(size_t size);
+
+/** Allocate an uninitialized buffer of size bytes, from the pool if possible. */
+byte *allocateBuffer(size_t size);
+
+/** Give a buffer of size bytes back to the pool, or free it if it doesn't fit.
+ *
+ *  Any buffer allocated with new[] can be given to the pool, not just the
+ *  ones allocated with allocateBuffer().
+ */
+void freeBuffer(byte *data, size_t size);
+
+} // End of namespace Images
+
+#endif // IMAGES_BUFFERPOOL_H
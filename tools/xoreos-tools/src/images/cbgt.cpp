@@ -226,7 +226,7 @@ void CBGT::createImage(uint32 width, uint32 height) {
 	_mipMaps.back()->height = height;
 	_mipMaps.back()->size   = width * height * 4;
 
-	_mipMaps.back()->data = new byte[_mipMaps.back()->size];
+	_mipMaps.back()->allocate(_mipMaps.back()->size);
 	byte *data = _mipMaps.back()->data;
 	std::memset(data, 0, _mipMaps.back()->size);
 }
@@ -0,0 +1,69 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Check that deSwizzle() matches deSwizzleOffset() for every power-of-two texture size.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "src/common/types.h"
+
+#include "src/images/util.h"
+
+/** De-swizzle a texture whose pixels hold their own index, and compare each pixel with deSwizzleOffset(). */
+static bool checkDeSwizzle(uint32 width, uint32 height) {
+	const uint32 pixels = width * height;
+
+	std::vector<byte> src(pixels * 4), dst(pixels * 4);
+	for (uint32 i = 0; i < pixels; i++)
+		std::memcpy(&src[i * 4], &i, 4);
+
+	Images::deSwizzle(&dst[0], &src[0], width, height);
+
+	for (uint32 y = 0; y < height; y++) {
+		for (uint32 x = 0; x < width; x++) {
+			uint32 offset;
+			std::memcpy(&offset, &dst[(y * width + x) * 4], 4);
+
+			const uint32 expected = Images::deSwizzleOffset(x, y, width, height);
+			if (offset != expected) {
+				std::fprintf(stderr, "%ux%u: Pixel %u,%u was read from %u instead of %u\n",
+				             width, height, x, y, offset, expected);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+int main() {
+	bool success = true;
+
+	for (uint32 width = 1; width <= 4096; width *= 2)
+		for (uint32 height = 1; height <= 4096; height *= 2)
+			if (!checkDeSwizzle(width, height))
+				success = false;
+
+	return success ? 0 : 1;
+}
@@ -43,7 +43,7 @@ static const uint32 kPixelFlagsIsRGB     = 0x00000040;
 
 namespace Images {
 
-DDS::DDS(Common::SeekableReadStream &dds) {
+DDS::DDS(Common::SeekableReadStream &dds, const DecodeOptions &options) : Decoder(options) {
 	load(dds);
 }
 
@@ -72,6 +72,8 @@ void DDS::load(Common::SeekableReadStream &dds) {
 		readHeader(dds, dataType);
 		readData  (dds, dataType);
 
+		removeSkippedMipMaps(_options.hasArea());
+
 	} catch (Common::Exception &e) {
 		e.add("Failed reading DDS file");
 		throw;
@@ -227,7 +229,20 @@ void DDS::setSize(MipMap &mipMap) {
 
 void DDS::readData(Common::SeekableReadStream &dds, DataType dataType) {
 	for (std::vector<MipMap *>::iterator mipMap = _mipMaps.begin(); mipMap != _mipMaps.end(); ++mipMap) {
-		(*mipMap)->data = new byte[(*mipMap)->size];
+		const size_t level = mipMap - _mipMaps.begin();
+
+		// DDS files only have a single layer
+		if (!isMipMapWanted(level) || !isLayerWanted(0)) {
+			dds.skip((dataType == kDataType4444) ? ((*mipMap)->width * (*mipMap)->height * 2) : (*mipMap)->size);
+			continue;
+		}
+
+		if (dataType == kDataTypeDirect) {
+			readMipMap(dds, **mipMap, level - _options.firstMipMap);
+			continue;
+		}
+
+		(*mipMap)->allocate((*mipMap)->size);
 
 		if (dataType == kDataType4444) {
 
@@ -241,9 +256,9 @@ void DDS::readData(Common::SeekableReadStream &dds, DataType dataType) {
 				data[3] = ((pixel & 0x0000F000) >> 12) << 4;
 			}
 
-		} else if (dataType == kDataTypeDirect)
-			if (dds.read((*mipMap)->data, (*mipMap)->size) != (*mipMap)->size)
-				throw Common::Exception(Common::kReadError);
+			if (_options.hasArea())
+				cropMipMap(**mipMap, level - _options.firstMipMap);
+		}
 
 	}
 }
@@ -39,7 +39,7 @@ namespace Images {
  */
 class DDS : public Decoder {
 public:
-	DDS(Common::SeekableReadStream &dds);
+	DDS(Common::SeekableReadStream &dds, const DecodeOptions &options = DecodeOptions());
 	~DDS();
 
 	/** Return true if the data within this stream is a DDS image. */
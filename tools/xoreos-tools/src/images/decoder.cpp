@@ -23,43 +23,45 @@
  */
 
 #include <cassert>
+#include <cmath>
 
 #include "src/common/util.h"
 #include "src/common/error.h"
-#include "src/common/memreadstream.h"
+#include "src/common/readstream.h"
+#include "src/common/mutex.h"
+#include "src/common/thread.h"
 
 #include "src/images/decoder.h"
 #include "src/images/util.h"
+#include "src/images/bufferpool.h"
 #include "src/images/s3tc.h"
 #include "src/images/dumptga.h"
 
 namespace Images {
 
-Decoder::MipMap::MipMap() : width(0), height(0), size(0), data(0) {
+DecodeOptions::DecodeOptions() : firstMipMap(0), mipMapCount(SIZE_MAX), firstLayer(0), layerCount(SIZE_MAX),
+	areaX(0), areaY(0), areaWidth(0), areaHeight(0), threads(0) {
 }
 
-Decoder::MipMap::MipMap(const MipMap &mipMap) : width(0), height(0), size(0), data(0) {
-	*this = mipMap;
+bool DecodeOptions::hasArea() const {
+	return (areaWidth > 0) && (areaHeight > 0);
 }
 
-Decoder::MipMap::~MipMap() {
-	delete[] data;
-}
 
-Decoder::MipMap &Decoder::MipMap::operator=(const MipMap &mipMap) {
-	if (&mipMap == this)
-		return *this;
+Decoder::MipMap::MipMap() : width(0), height(0), size(0), data(0) {
+}
 
-	width  = mipMap.width;
-	height = mipMap.height;
-	size   = mipMap.size;
+Decoder::MipMap::~MipMap() {
+	freeBuffer(data, size);
+}
 
-	delete[] data;
-	data = new byte[size];
+void Decoder::MipMap::allocate(uint32 dataSize) {
+	byte *newData = allocateBuffer(dataSize);
 
-	std::memcpy(data, mipMap.data, size);
+	freeBuffer(data, size);
 
-	return *this;
+	size = dataSize;
+	data = newData;
 }
 
 void Decoder::MipMap::swap(MipMap &right) {
@@ -70,11 +72,8 @@ void Decoder::MipMap::swap(MipMap &right) {
 }
 
 
-Decoder::Decoder() : _format(kPixelFormatR8G8B8A8), _layerCount(1), _isCubeMap(false) {
-}
-
-Decoder::Decoder(const Decoder &decoder) {
-	*this = decoder;
+Decoder::Decoder(const DecodeOptions &options) : _format(kPixelFormatR8G8B8A8), _layerCount(1),
+	_isCubeMap(false), _bytesCopied(0), _options(options) {
 }
 
 Decoder::~Decoder() {
@@ -82,25 +81,14 @@ Decoder::~Decoder() {
 		delete *m;
 }
 
-Decoder &Decoder::operator=(const Decoder &decoder) {
-	_format = decoder._format;
-
-	_layerCount = decoder._layerCount;
-	_isCubeMap  = decoder._isCubeMap;
-
-	_mipMaps.clear();
-	_mipMaps.reserve(decoder._mipMaps.size());
-
-	for (std::vector<MipMap *>::const_iterator m = decoder._mipMaps.begin(); m != decoder._mipMaps.end(); ++m)
-		_mipMaps.push_back(new MipMap(**m));
-
-	return *this;
-}
-
 Common::SeekableReadStream *Decoder::getTXI() const {
 	return 0;
 }
 
+size_t Decoder::getBytesCopied() const {
+	return _bytesCopied;
+}
+
 bool Decoder::isCompressed() const {
 	return (_format == kPixelFormatDXT1) ||
 	       (_format == kPixelFormatDXT3) ||
@@ -138,7 +126,8 @@ const Decoder::MipMap &Decoder::getMipMap(size_t mipMap, size_t layer) const {
 	return *_mipMaps[index];
 }
 
-void Decoder::decompress(MipMap &out, const MipMap &in, PixelFormat format) {
+/** Check that this mip map can be decompressed, and allocate the decompressed mip map. */
+static void createDecompressed(Decoder::MipMap &out, const Decoder::MipMap &in, PixelFormat format) {
 	if ((format != kPixelFormatDXT1) &&
 	    (format != kPixelFormatDXT3) &&
 	    (format != kPixelFormatDXT5))
@@ -149,51 +138,595 @@ void Decoder::decompress(MipMap &out, const MipMap &in, PixelFormat format) {
 	if (!hasValidDimensions(format, in.width, in.height))
 		throw Common::Exception("Invalid dimensions (%dx%d) for format %d", in.width, in.height, format);
 
+	/* Check the size of the compressed data here, so that decompressing
+	 * the rows, potentially in another thread, can't fail. */
+	const uint32 blockSize = (format == kPixelFormatDXT1) ? 8 : 16;
+	const uint32 blocks    = ((in.width + 3) / 4) * ((in.height + 3) / 4);
+	if ((in.size / blockSize) < blocks)
+		throw Common::Exception("Not enough data for a %dx%d image in format %d (%u bytes)",
+		                        in.width, in.height, format, in.size);
+
 	out.width  = in.width;
 	out.height = in.height;
-	out.size   = MAX(out.width * out.height * 4, 64);
-	out.data   = new byte[out.size];
+	out.allocate(MAX(out.width * out.height * 4, 64));
+}
 
-	Common::MemoryReadStream *stream = new Common::MemoryReadStream(in.data, in.size);
+/** Decompress the rows from top up to, but not including, bottom of a mip map. */
+static void decompressRows(Decoder::MipMap &out, const Decoder::MipMap &in, PixelFormat format,
+                           uint32 top, uint32 bottom) {
 
 	if      (format == kPixelFormatDXT1)
-		decompressDXT1(out.data, *stream, out.width, out.height, out.width * 4);
+		decompressDXT1(out.data, in.data, in.size, out.width, out.height, out.width * 4, top, bottom);
 	else if (format == kPixelFormatDXT3)
-		decompressDXT3(out.data, *stream, out.width, out.height, out.width * 4);
+		decompressDXT3(out.data, in.data, in.size, out.width, out.height, out.width * 4, top, bottom);
+	else if (format == kPixelFormatDXT5)
+		decompressDXT5(out.data, in.data, in.size, out.width, out.height, out.width * 4, top, bottom);
+}
+
+void Decoder::decompress(MipMap &out, const MipMap &in, PixelFormat format) {
+	createDecompressed(out, in, format);
+	decompressRows(out, in, format, 0, out.height);
+}
+
+/** Check that this R8G8B8A8 mip map can be compressed, and allocate the compressed mip map. */
+static void createCompressed(Decoder::MipMap &out, const Decoder::MipMap &in, PixelFormat format) {
+	if ((format != kPixelFormatDXT1) && (format != kPixelFormatDXT5))
+		throw Common::Exception("Unsupported compressed format %d", format);
+
+	out.width  = in.width;
+	out.height = in.height;
+	out.allocate(getDataSize(format, out.width, out.height));
+}
+
+/** Compress the rows from top up to, but not including, bottom of an R8G8B8A8 mip map. */
+static void compressRows(Decoder::MipMap &out, const Decoder::MipMap &in, PixelFormat format,
+                         S3TCQuality quality, uint32 top, uint32 bottom) {
+
+	if      (format == kPixelFormatDXT1)
+		compressDXT1(out.data, in.data, in.width, in.height, in.width * 4, quality, top, bottom);
 	else if (format == kPixelFormatDXT5)
-		decompressDXT5(out.data, *stream, out.width, out.height, out.width * 4);
+		compressDXT5(out.data, in.data, in.width, in.height, in.width * 4, quality, top, bottom);
+}
+
+
+/** Converting between sRGB and linear light, for filtering mip maps. */
+struct GammaTable {
+	float toLinear[256];   ///< The linear value of each sRGB value.
+	float thresholds[255]; ///< The linear values halfway between two neighbouring sRGB values.
+
+	GammaTable() {
+		for (int i = 0; i < 256; i++) {
+			const double value = i / 255.0;
+
+			toLinear[i] = (value <= 0.04045) ? (value / 12.92) : std::pow((value + 0.055) / 1.055, 2.4);
+		}
+
+		for (int i = 0; i < 255; i++)
+			thresholds[i] = (toLinear[i] + toLinear[i + 1]) / 2.0f;
+	}
+
+	/** Return the sRGB value closest to this linear value. */
+	byte toSRGB(float value) const {
+		int low = 0, high = 255;
+		while (low < high) {
+			const int middle = (low + high) / 2;
+
+			if (value < thresholds[middle])
+				high = middle;
+			else
+				low  = middle + 1;
+		}
+
+		return low;
+	}
+};
+
+/** Built at start-up, so that all threads can read it without locking. */
+static const GammaTable kGammaTable;
+
+/** Create the rows from top up to, but not including, bottom of a mip map half
+ *  the size of an R8G8B8A8 mip map.
+ *
+ *  Each pixel is the average of a 2x2 box of source pixels. The colors are
+ *  averaged in linear light, so that the mip maps don't get darker than the
+ *  full image. Alpha is averaged as is.
+ */
+static void downsampleRows(Decoder::MipMap &out, const Decoder::MipMap &in, uint32 top, uint32 bottom) {
+	const uint32 inWidth  = in.width;
+	const uint32 inHeight = in.height;
+
+	for (uint32 y = top; y < bottom; y++) {
+		const byte *row0 = in.data + MIN(2 * y    , inHeight - 1) * inWidth * 4;
+		const byte *row1 = in.data + MIN(2 * y + 1, inHeight - 1) * inWidth * 4;
+
+		byte *dest = out.data + y * out.width * 4;
+
+		for (uint32 x = 0; x < (uint32) out.width; x++, dest += 4) {
+			const uint32 x0 = MIN(2 * x    , inWidth - 1) * 4;
+			const uint32 x1 = MIN(2 * x + 1, inWidth - 1) * 4;
+
+			for (int c = 0; c < 3; c++) {
+				const float sum = kGammaTable.toLinear[row0[x0 + c]] + kGammaTable.toLinear[row0[x1 + c]] +
+				                  kGammaTable.toLinear[row1[x0 + c]] + kGammaTable.toLinear[row1[x1 + c]];
+
+				dest[c] = kGammaTable.toSRGB(sum / 4.0f);
+			}
+
+			dest[3] = (row0[x0 + 3] + row0[x1 + 3] + row1[x0 + 3] + row1[x1 + 3] + 2) / 4;
+		}
+	}
+}
+
+
+/** Roughly how many pixels to process in one task. */
+static const uint32 kRowTaskPixels = 256 * 256;
+
+/** Roughly how many pixels it takes to make starting another thread worthwhile. */
+static const uint32 kDecompressThreadPixels = 512 * 512;
+static const uint32 kDownsampleThreadPixels = 256 * 256;
+static const uint32 kCompressThreadPixels   =  64 *  64;
+
+/** What to do with a band of rows of a mip map. */
+enum RowOperation {
+	kRowOperationDecompress,
+	kRowOperationCompress,
+	kRowOperationDownsample
+};
+
+/** A band of rows of one mip map to process. */
+struct RowTask {
+	const Decoder::MipMap *in;
+	Decoder::MipMap *out;
+
+	uint32 top;
+	uint32 bottom;
+
+
+	RowTask(const Decoder::MipMap &i, Decoder::MipMap &o, uint32 t, uint32 b) :
+		in(&i), out(&o), top(t), bottom(b) {
+	}
+};
+
+/** The state shared between all threads processing bands of rows. */
+struct RowContext : public Common::ThreadPool {
+	RowOperation operation;
+	PixelFormat format;
+	S3TCQuality quality;
+
+	std::vector<RowTask> tasks;
+
+	bool failed;
+	Common::Exception error;
+
+	Common::Mutex errorMutex; ///< Guards failed and error.
+
+
+	RowContext(RowOperation o, PixelFormat f, S3TCQuality q = kS3TCQualityFast) :
+		operation(o), format(f), quality(q), failed(false) {
+	}
+
+protected:
+	void runJob(size_t n) {
+		try {
+			runTask(tasks[n]);
+		} catch (Common::Exception &e) {
+			setError(e);
+		} catch (std::exception &e) {
+			setError(Common::Exception(e));
+		} catch (...) {
+			setError(Common::Exception("Unknown error while processing image rows"));
+		}
+	}
+
+private:
+	void runTask(RowTask &task) {
+		switch (operation) {
+			case kRowOperationDecompress:
+				decompressRows(*task.out, *task.in, format, task.top, task.bottom);
+				break;
+
+			case kRowOperationCompress:
+				compressRows(*task.out, *task.in, format, quality, task.top, task.bottom);
+				break;
+
+			case kRowOperationDownsample:
+				downsampleRows(*task.out, *task.in, task.top, task.bottom);
+				break;
+		}
+	}
+
+	/** Remember the first error of any thread. */
+	void setError(const Common::Exception &e) {
+		Common::StackLock lock(errorMutex);
+
+		if (!failed)
+			error = e;
+
+		failed = true;
+	}
+};
+
+/** Split a mip map into bands of whole blocks, each one a task. */
+static void addRowTasks(RowContext &context, const Decoder::MipMap &in, Decoder::MipMap &out) {
+	const uint32 width  = MAX(out.width , 1);
+	const uint32 height = out.height;
 
-	delete stream;
+	// Bands need to start at a block boundary
+	const uint32 bandHeight = MAX<uint32>(((kRowTaskPixels / width) / 4) * 4, 4);
+
+	for (uint32 top = 0; top < height; top += bandHeight)
+		context.tasks.push_back(RowTask(in, out, top, MIN(top + bandHeight, height)));
+}
+
+/** Run all tasks of the context, in parallel if the amount of pixels is worth it.
+ *
+ *  Each band is written to its own part of the output, so the result doesn't
+ *  depend on the thread timing.
+ */
+static void runRowTasks(RowContext &context, size_t pixels, uint32 threadPixels, size_t threads) {
+	if (threads == 0)
+		threads = Common::Thread::getProcessorCount();
+
+	const size_t threadCount = MIN(MIN(threads, context.tasks.size()), 1 + pixels / threadPixels);
+
+	context.runJobs(context.tasks.size(), threadCount);
+
+	if (context.failed)
+		throw context.error;
 }
 
 void Decoder::decompress() {
 	if (!isCompressed())
 		return;
 
-	for (std::vector<MipMap *>::iterator m = _mipMaps.begin(); m != _mipMaps.end(); ++m) {
-		MipMap decompressed;
+	// Every mip map of every layer is split into bands of rows, and these are decompressed in parallel
+
+	RowContext context(kRowOperationDecompress, _format);
+
+	std::vector<MipMap *> decompressed;
+
+	try {
+		decompressed.reserve(_mipMaps.size());
+
+		size_t pixels = 0;
+		for (std::vector<MipMap *>::iterator m = _mipMaps.begin(); m != _mipMaps.end(); ++m) {
+			decompressed.push_back(new MipMap);
+
+			createDecompressed(*decompressed.back(), **m, _format);
+			addRowTasks(context, **m, *decompressed.back());
 
-		decompress(decompressed, **m, _format);
+			pixels += (*m)->width * (*m)->height;
+		}
 
-		decompressed.swap(**m);
+		runRowTasks(context, pixels, kDecompressThreadPixels, _options.threads);
+
+	} catch (...) {
+		for (std::vector<MipMap *>::iterator m = decompressed.begin(); m != decompressed.end(); ++m)
+			delete *m;
+
+		throw;
+	}
+
+	for (size_t i = 0; i < _mipMaps.size(); i++) {
+		decompressed[i]->swap(*_mipMaps[i]);
+		delete decompressed[i];
 	}
 
 	_format = kPixelFormatR8G8B8A8;
 }
 
-void Decoder::dumpTGA(const Common::UString &fileName) const {
-	if (_mipMaps.size() < 1)
+void Decoder::convertToR8G8B8A8() {
+	decompress();
+
+	if (_format == kPixelFormatR8G8B8A8)
+		return;
+
+	if ((_format != kPixelFormatR8G8B8) && (_format != kPixelFormatB8G8R8) &&
+	    (_format != kPixelFormatB8G8R8A8))
+		throw Common::Exception("Unsupported pixel format %d", _format);
+
+	const bool isBGR     = (_format == kPixelFormatB8G8R8) || (_format == kPixelFormatB8G8R8A8);
+	const bool hasAlpha  = (_format == kPixelFormatB8G8R8A8);
+	const int  inBPP     = getBPP(_format);
+
+	for (std::vector<MipMap *>::iterator m = _mipMaps.begin(); m != _mipMaps.end(); ++m) {
+		const uint32 pixels = (*m)->width * (*m)->height;
+
+		MipMap converted;
+		converted.width  = (*m)->width;
+		converted.height = (*m)->height;
+		converted.allocate(pixels * 4);
+
+		const byte *src  = (*m)->data;
+		byte       *dest = converted.data;
+		for (uint32 i = 0; i < pixels; i++, src += inBPP, dest += 4) {
+			dest[0] = src[isBGR ? 2 : 0];
+			dest[1] = src[1];
+			dest[2] = src[isBGR ? 0 : 2];
+			dest[3] = hasAlpha ? src[3] : 0xFF;
+		}
+
+		converted.swap(**m);
+	}
+
+	_format = kPixelFormatR8G8B8A8;
+}
+
+void Decoder::createMipMaps() {
+	if (_mipMaps.empty())
 		throw Common::Exception("Image contains no mip maps");
 
-	if (!isCompressed()) {
-		Images::dumpTGA(fileName, *this);
+	convertToR8G8B8A8();
+
+	const size_t oldMipMapCount = getMipMapCount();
+
+	std::vector<MipMap *> mipMaps, bases;
+
+	try {
+		bases.reserve(_layerCount);
+
+		for (size_t i = 0; i < _layerCount; i++) {
+			// The first mip map is taken over as it is, without copying its data
+			MipMap *base = new MipMap;
+			mipMaps.push_back(base);
+
+			base->swap(*_mipMaps[i * oldMipMapCount]);
+			bases.push_back(base);
+
+			// Each level is made from the one before, so only the rows within a level run in parallel
+			while ((mipMaps.back()->width > 1) || (mipMaps.back()->height > 1)) {
+				const MipMap &in = *mipMaps.back();
+
+				MipMap *out = new MipMap;
+				mipMaps.push_back(out);
+
+				out->width  = MAX(in.width  >> 1, 1);
+				out->height = MAX(in.height >> 1, 1);
+				out->allocate(out->width * out->height * 4);
+
+				RowContext context(kRowOperationDownsample, _format);
+				addRowTasks(context, in, *out);
+
+				runRowTasks(context, out->width * out->height, kDownsampleThreadPixels, _options.threads);
+			}
+		}
+
+	} catch (...) {
+		// Give the first mip maps back, so that the image stays intact
+		for (size_t i = 0; i < bases.size(); i++)
+			bases[i]->swap(*_mipMaps[i * oldMipMapCount]);
+
+		for (std::vector<MipMap *>::iterator m = mipMaps.begin(); m != mipMaps.end(); ++m)
+			delete *m;
+
+		throw;
+	}
+
+	for (std::vector<MipMap *>::iterator m = _mipMaps.begin(); m != _mipMaps.end(); ++m)
+		delete *m;
+
+	_mipMaps.swap(mipMaps);
+}
+
+void Decoder::compress(PixelFormat format, S3TCQuality quality) {
+	if (_format == format)
+		return;
+
+	convertToR8G8B8A8();
+
+	// Like for decompressing, all bands of all mip maps are compressed in parallel
+
+	RowContext context(kRowOperationCompress, format, quality);
+
+	std::vector<MipMap *> compressed;
+
+	try {
+		compressed.reserve(_mipMaps.size());
+
+		size_t pixels = 0;
+		for (std::vector<MipMap *>::iterator m = _mipMaps.begin(); m != _mipMaps.end(); ++m) {
+			compressed.push_back(new MipMap);
+
+			createCompressed(*compressed.back(), **m, format);
+			addRowTasks(context, **m, *compressed.back());
+
+			pixels += (*m)->width * (*m)->height;
+		}
+
+		runRowTasks(context, pixels, kCompressThreadPixels, _options.threads);
+
+	} catch (...) {
+		for (std::vector<MipMap *>::iterator m = compressed.begin(); m != compressed.end(); ++m)
+			delete *m;
+
+		throw;
+	}
+
+	for (size_t i = 0; i < _mipMaps.size(); i++) {
+		compressed[i]->swap(*_mipMaps[i]);
+		delete compressed[i];
+	}
+
+	_format = format;
+}
+
+bool Decoder::isLayerWanted(size_t layer) const {
+	return (layer >= _options.firstLayer) && ((layer - _options.firstLayer) < _options.layerCount);
+}
+
+bool Decoder::isMipMapWanted(size_t mipMap) const {
+	return (mipMap >= _options.firstMipMap) && ((mipMap - _options.firstMipMap) < _options.mipMapCount);
+}
+
+/** Scale the decode area down to the index-th decoded mip map, and clip it to the mip map. */
+static void getArea(const DecodeOptions &options, size_t index, int32 width, int32 height,
+                    int32 &x, int32 &y, int32 &w, int32 &h) {
+
+	const size_t shift = MIN<size_t>(index, 15);
+
+	x = options.areaX >> shift;
+	y = options.areaY >> shift;
+
+	if ((x < 0) || (y < 0) || (x >= width) || (y >= height)) {
+		// Rounding down the mip map sizes can push the area out of the smaller mip maps
+		if ((index == 0) || (x < 0) || (y < 0))
+			throw Common::Exception("Decode area (%d, %d) outside of a %dx%d mip map", x, y, width, height);
+
+		x = MIN(x, width  - 1);
+		y = MIN(y, height - 1);
+	}
+
+	w = MIN(MAX(options.areaWidth  >> shift, 1), width  - x);
+	h = MIN(MAX(options.areaHeight >> shift, 1), height - y);
+}
+
+/** Copy an area out of a mip map, decompressing it first if necessary. */
+static void cropArea(Decoder::MipMap &out, const Decoder::MipMap &in, PixelFormat format,
+                     int32 x, int32 y, int32 w, int32 h) {
+
+	Decoder::MipMap decompressed;
+
+	const Decoder::MipMap *src = &in;
+	if ((format == kPixelFormatDXT1) || (format == kPixelFormatDXT3) || (format == kPixelFormatDXT5)) {
+		createDecompressed(decompressed, in, format);
+		decompressRows(decompressed, in, format, 0, decompressed.height);
+
+		src    = &decompressed;
+		format = kPixelFormatR8G8B8A8;
+	}
+
+	const int bpp = getBPP(format);
+
+	out.width  = w;
+	out.height = h;
+	out.allocate(w * h * bpp);
+
+	for (int32 i = 0; i < h; i++)
+		std::memcpy(out.data + i * w * bpp, src->data + ((y + i) * src->width + x) * bpp, w * bpp);
+}
+
+void Decoder::readMipMap(Common::SeekableReadStream &stream, MipMap &mipMap, size_t index) {
+	if (!_options.hasArea()) {
+		mipMap.allocate(mipMap.size);
+
+		if (stream.read(mipMap.data, mipMap.size) != mipMap.size)
+			throw Common::Exception(Common::kReadError);
+
 		return;
 	}
 
-	Decoder decoder(*this);
-	decoder.decompress();
+	int32 x, y, w, h;
+	getArea(_options, index, mipMap.width, mipMap.height, x, y, w, h);
+
+	// Only read the rows containing the area. For compressed data, these are whole rows of blocks
+
+	uint32 top = y, bottom = y + h, rowHeight = 1, rowSize = mipMap.width * getBPP(_format);
+	if (isCompressed()) {
+		rowHeight = 4;
+		rowSize   = ((mipMap.width + 3) / 4) * ((_format == kPixelFormatDXT1) ? 8 : 16);
+
+		top    = top & ~3;
+		bottom = MIN<uint32>((bottom + 3) & ~3, mipMap.height);
+
+		// Images smaller than a block are decompressed differently, so they need to be read whole
+		if ((mipMap.width < 4) || (mipMap.height < 4)) {
+			top    = 0;
+			bottom = mipMap.height;
+		}
+	}
+
+	const uint32 offset   = MIN((top / rowHeight) * rowSize, mipMap.size);
+	const uint32 dataSize = MIN(((bottom - top + rowHeight - 1) / rowHeight) * rowSize, mipMap.size - offset);
+
+	MipMap rows;
+	rows.width  = mipMap.width;
+	rows.height = bottom - top;
+	rows.allocate(dataSize);
+
+	stream.skip(offset);
+
+	if (stream.read(rows.data, rows.size) != rows.size)
+		throw Common::Exception(Common::kReadError);
+
+	stream.skip(mipMap.size - offset - dataSize);
+
+	cropArea(mipMap, rows, _format, x, y - top, w, h);
+}
+
+void Decoder::cropMipMap(MipMap &mipMap, size_t index) {
+	int32 x, y, w, h;
+	getArea(_options, index, mipMap.width, mipMap.height, x, y, w, h);
+
+	MipMap cropped;
+	cropArea(cropped, mipMap, _format, x, y, w, h);
+
+	cropped.swap(mipMap);
+}
+
+void Decoder::removeSkippedMipMaps(bool cropped) {
+	const size_t mipMapCount = getMipMapCount();
+
+	// Check that all layers still fit together, before changing anything
+
+	size_t layerCount = 0, layerMipMapCount = 0, keptCount = 0;
+	for (size_t i = 0; i < _layerCount; i++) {
+		size_t count = 0;
+		for (size_t j = 0; j < mipMapCount; j++)
+			if (_mipMaps[i * mipMapCount + j]->data)
+				count++;
+
+		if (count == 0)
+			continue;
+
+		if ((layerCount > 0) && (count != layerMipMapCount))
+			throw Common::Exception("Layers with different numbers of mip maps (%u, %u)",
+			                        (uint) layerMipMapCount, (uint) count);
+
+		layerMipMapCount = count;
+		layerCount++;
+		keptCount += count;
+	}
+
+	if (keptCount == 0)
+		throw Common::Exception("None of the requested mip maps exist");
+
+	std::vector<MipMap *> mipMaps;
+	mipMaps.reserve(keptCount);
+
+	for (std::vector<MipMap *>::iterator m = _mipMaps.begin(); m != _mipMaps.end(); ++m) {
+		if ((*m)->data)
+			mipMaps.push_back(*m);
+		else
+			delete *m;
+	}
+
+	_mipMaps.swap(mipMaps);
+
+	_layerCount = layerCount;
+
+	if (_layerCount != 6)
+		_isCubeMap = false;
+
+	if (cropped) {
+		_isCubeMap = false;
+
+		if (isCompressed())
+			_format = kPixelFormatR8G8B8A8;
+	}
+}
+
+void Decoder::dumpTGA(const Common::UString &fileName, bool rle) const {
+	if (_mipMaps.size() < 1)
+		throw Common::Exception("Image contains no mip maps");
+
+	Images::dumpTGA(fileName, *this, rle);
+}
+
+void Decoder::dumpPNG(const Common::UString &fileName, const PNGOptions &options) const {
+	if (_mipMaps.size() < 1)
+		throw Common::Exception("Image contains no mip maps");
 
-	Images::dumpTGA(fileName, decoder);
+	Images::dumpPNG(fileName, *this, options);
 }
 
 void Decoder::flipHorizontally() {
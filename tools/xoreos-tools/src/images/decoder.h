@@ -28,8 +28,10 @@
 #include <vector>
 
 #include "src/common/types.h"
+#include "src/common/noncopyable.h"
 
 #include "src/images/types.h"
+#include "src/images/dumppng.h"
 
 namespace Common {
 	class SeekableReadStream;
@@ -38,31 +40,64 @@ namespace Common {
 
 namespace Images {
 
-/** A generic interface for image decoders. */
-class Decoder {
+/** Which parts of an image to decode.
+ *
+ *  By default, all mip maps of all layers are decoded in full. Decoders
+ *  that take these options skip over the data they don't need, instead of
+ *  reading it.
+ */
+struct DecodeOptions {
+	size_t firstMipMap; ///< The first mip map to decode, 0 being the largest.
+	size_t mipMapCount; ///< The number of mip maps to decode. SIZE_MAX means all of them.
+
+	size_t firstLayer;  ///< The first layer to decode.
+	size_t layerCount;  ///< The number of layers to decode. SIZE_MAX means all of them.
+
+	/** Only decode this area, in pixels of the first decoded mip map.
+	 *
+	 *  If the width or height is 0, the whole mip maps are decoded. Further
+	 *  mip maps are cropped to the same area, scaled down accordingly.
+	 */
+	int32 areaX, areaY, areaWidth, areaHeight;
+
+	/** The number of threads to decompress, compress and create mip maps with. 0 means one per processor.
+	 *
+	 *  Callers that already work on several images in parallel should set this to 1.
+	 */
+	size_t threads;
+
+	DecodeOptions();
+
+	/** Does this decode only an area of the mip maps? */
+	bool hasArea() const;
+};
+
+/** A generic interface for image decoders.
+ *
+ *  Images can't be copied. Their pixel data is only ever handed over from
+ *  one mip map to another, with MipMap::swap().
+ */
+class Decoder : Common::NonCopyable {
 public:
 	/** A mip map. */
-	struct MipMap {
+	struct MipMap : Common::NonCopyable {
 		int    width;  ///< The mip map's width.
 		int    height; ///< The mip map's height.
 		uint32 size;   ///< The mip map's size in bytes.
 		byte  *data;   ///< The mip map's data.
 
 		MipMap();
-		MipMap(const MipMap &mipMap);
 		~MipMap();
 
-		MipMap &operator=(const MipMap &mipMap);
+		/** Replace the data with an uninitialized buffer of dataSize bytes, taken from the buffer pool. */
+		void allocate(uint32 dataSize);
 
 		void swap(MipMap &right);
 	};
 
-	Decoder();
-	Decoder(const Decoder &decoder);
+	Decoder(const DecodeOptions &options = DecodeOptions());
 	virtual ~Decoder();
 
-	Decoder &operator=(const Decoder &decoder);
-
 	/** Return the image's general format. */
 	PixelFormat getFormat() const;
 
@@ -80,8 +115,29 @@ public:
 	/** Return TXI data, if embedded in the image. */
 	virtual Common::SeekableReadStream *getTXI() const;
 
-	/** Dump the image into a TGA. */
-	void dumpTGA(const Common::UString &fileName) const;
+	/** Return the number of bytes of pixel data copied from one buffer into another,
+	 *  without being converted, while reading and processing this image.
+	 */
+	size_t getBytesCopied() const;
+
+	/** Dump the image into a TGA, optionally run-length encoded.
+	 *
+	 *  Compressed images are decompressed a few rows at a time while writing.
+	 */
+	void dumpTGA(const Common::UString &fileName, bool rle = false) const;
+
+	/** Dump the image into a PNG. See Images::dumpPNG(). */
+	void dumpPNG(const Common::UString &fileName, const PNGOptions &options = PNGOptions()) const;
+
+	/** Replace the mip maps of every layer with a full chain down to 1x1 pixels.
+	 *
+	 *  The chain is created from the first mip map of each layer, with a
+	 *  gamma-correct box filter. The image is converted to R8G8B8A8.
+	 */
+	void createMipMaps();
+
+	/** Compress all mip maps of the image into DXT1 or DXT5. */
+	void compress(PixelFormat format, S3TCQuality quality = kS3TCQualityFast);
 
 	/** Flip the whole image horizontally. */
 	void flipHorizontally();
@@ -98,13 +154,55 @@ protected:
 
 	std::vector<MipMap *> _mipMaps;
 
+	/** The number of bytes of pixel data copied so far. See getBytesCopied(). */
+	size_t _bytesCopied;
+
+	/** Which parts of the image to decode. */
+	DecodeOptions _options;
+
 	/** Is the image data compressed? */
 	bool isCompressed() const;
 
 	/** Manually decompress the texture image data. */
 	void decompress();
 
+	/** Convert uncompressed image data of any 8 bits per channel format into R8G8B8A8. */
+	void convertToR8G8B8A8();
+
 	static void decompress(MipMap &out, const MipMap &in, PixelFormat format);
+
+	// Decode options helpers
+	/** Do the decode options ask for this layer? */
+	bool isLayerWanted(size_t layer) const;
+	/** Do the decode options ask for this mip map level? */
+	bool isMipMapWanted(size_t mipMap) const;
+
+	/** Read the data of a mip map in the image's format, skipping over the parts not needed.
+	 *
+	 *  The mip map's width, height and size need to be set up already. If the
+	 *  decode options ask for an area, only the rows containing it are read,
+	 *  and the mip map is cropped to the area.
+	 *
+	 *  @param stream The stream to read from. The data of the mip map is skipped over completely.
+	 *  @param mipMap The mip map to read.
+	 *  @param index  The index of the mip map among the ones decoded, for scaling the area.
+	 */
+	void readMipMap(Common::SeekableReadStream &stream, MipMap &mipMap, size_t index);
+
+	/** Crop a fully read mip map to the decode area.
+	 *
+	 *  Compressed data is decompressed first, so once the first mip map is
+	 *  cropped, all of them need to be.
+	 */
+	void cropMipMap(MipMap &mipMap, size_t index);
+
+	/** Remove all mip maps without data, which have been skipped while reading.
+	 *
+	 *  Layers without any mip maps left are removed. The others need to have
+	 *  the same number of mip maps. If the mip maps have been cropped, a
+	 *  compressed format changes to R8G8B8A8.
+	 */
+	void removeSkippedMipMaps(bool cropped);
 };
 
 } // End of namespace Images
@@ -0,0 +1,164 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A simple DDS texture dumper.
+ */
+
+#include "src/common/util.h"
+#include "src/common/error.h"
+#include "src/common/ustring.h"
+#include "src/common/writefile.h"
+
+#include "src/images/dumpdds.h"
+#include "src/images/decoder.h"
+#include "src/images/util.h"
+
+static const uint32 kDDSID  = MKTAG('D', 'D', 'S', ' ');
+static const uint32 kDXT1ID = MKTAG('D', 'X', 'T', '1');
+static const uint32 kDXT3ID = MKTAG('D', 'X', 'T', '3');
+static const uint32 kDXT5ID = MKTAG('D', 'X', 'T', '5');
+
+static const uint32 kHeaderFlagsCaps        = 0x00000001;
+static const uint32 kHeaderFlagsHeight      = 0x00000002;
+static const uint32 kHeaderFlagsWidth       = 0x00000004;
+static const uint32 kHeaderFlagsPitch       = 0x00000008;
+static const uint32 kHeaderFlagsPixelFormat = 0x00001000;
+static const uint32 kHeaderFlagsHasMipMaps  = 0x00020000;
+static const uint32 kHeaderFlagsLinearSize  = 0x00080000;
+
+static const uint32 kPixelFlagsHasAlpha  = 0x00000001;
+static const uint32 kPixelFlagsHasFourCC = 0x00000004;
+static const uint32 kPixelFlagsIsRGB     = 0x00000040;
+
+static const uint32 kCapsComplex = 0x00000008;
+static const uint32 kCapsTexture = 0x00001000;
+static const uint32 kCapsMipMap  = 0x00400000;
+
+namespace Images {
+
+static void writeZeros(Common::WriteStream &stream, size_t count) {
+	while (count-- > 0)
+		stream.writeByte(0);
+}
+
+static uint32 getFourCC(PixelFormat format) {
+	switch (format) {
+		case kPixelFormatDXT1:
+			return kDXT1ID;
+		case kPixelFormatDXT3:
+			return kDXT3ID;
+		case kPixelFormatDXT5:
+			return kDXT5ID;
+
+		default:
+			break;
+	}
+
+	return 0;
+}
+
+static void writeMipMap(Common::WriteStream &stream, const Decoder::MipMap &mipMap, PixelFormat format) {
+	const uint32 size = getDataSize(format, mipMap.width, mipMap.height);
+	if (mipMap.size < size)
+		throw Common::Exception("dumpDDS(): Not enough data for a %dx%d mip map", mipMap.width, mipMap.height);
+
+	if (format != kPixelFormatR8G8B8A8) {
+		stream.write(mipMap.data, size);
+		return;
+	}
+
+	const byte *data = mipMap.data;
+	for (uint32 i = 0; i < size; i += 4, data += 4) {
+		stream.writeByte(data[2]);
+		stream.writeByte(data[1]);
+		stream.writeByte(data[0]);
+		stream.writeByte(data[3]);
+	}
+}
+
+void dumpDDS(const Common::UString &fileName, const Decoder &image) {
+	if ((image.getLayerCount() != 1) || (image.getMipMapCount() < 1))
+		throw Common::Exception("dumpDDS(): Unsupported image with %u layers and %u mip maps",
+		                        (uint) image.getLayerCount(), (uint) image.getMipMapCount());
+
+	const PixelFormat format = image.getFormat();
+	const uint32      fourCC = getFourCC(format);
+
+	if ((fourCC == 0) && (format != kPixelFormatR8G8B8A8) && (format != kPixelFormatB8G8R8A8))
+		throw Common::Exception("dumpDDS(): Unsupported pixel format %d", (int) format);
+
+	const Decoder::MipMap &base = image.getMipMap(0);
+	const uint32 mipMapCount = image.getMipMapCount();
+
+	uint32 flags = kHeaderFlagsCaps | kHeaderFlagsHeight | kHeaderFlagsWidth | kHeaderFlagsPixelFormat;
+	uint32 pitchOrLinearSize;
+
+	if (fourCC != 0) {
+		flags |= kHeaderFlagsLinearSize;
+		pitchOrLinearSize = getDataSize(format, base.width, base.height);
+	} else {
+		flags |= kHeaderFlagsPitch;
+		pitchOrLinearSize = base.width * 4;
+	}
+
+	if (mipMapCount > 1)
+		flags |= kHeaderFlagsHasMipMaps;
+
+	Common::WriteFile file(fileName);
+
+	file.writeUint32BE(kDDSID);
+	file.writeUint32LE(124); // Header size
+
+	file.writeUint32LE(flags);
+	file.writeUint32LE(base.height);
+	file.writeUint32LE(base.width);
+	file.writeUint32LE(pitchOrLinearSize);
+	file.writeUint32LE(0); // Depth
+	file.writeUint32LE(mipMapCount);
+
+	writeZeros(file, 44); // Reserved
+
+	// Pixel format
+	file.writeUint32LE(32);
+	if (fourCC != 0) {
+		file.writeUint32LE(kPixelFlagsHasFourCC);
+		file.writeUint32BE(fourCC);
+		writeZeros(file, 5 * 4);
+	} else {
+		file.writeUint32LE(kPixelFlagsIsRGB | kPixelFlagsHasAlpha);
+		file.writeUint32BE(0);
+		file.writeUint32LE(32);
+		file.writeUint32LE(0x00FF0000);
+		file.writeUint32LE(0x0000FF00);
+		file.writeUint32LE(0x000000FF);
+		file.writeUint32LE(0xFF000000);
+	}
+
+	file.writeUint32LE(kCapsTexture | ((mipMapCount > 1) ? (kCapsComplex | kCapsMipMap) : 0));
+	writeZeros(file, 4 + 4 + 4 + 4); // DDCAPS2 + Reserved
+
+	for (uint32 i = 0; i < mipMapCount; i++)
+		writeMipMap(file, image.getMipMap(i), format);
+
+	file.flush();
+}
+
+} // End of namespace Images
@@ -0,0 +1,512 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A PNG image dumper.
+ */
+
+#include <cstring>
+
+#include <vector>
+
+#include <zlib.h>
+
+#include "src/common/util.h"
+#include "src/common/error.h"
+#include "src/common/ustring.h"
+#include "src/common/writefile.h"
+#include "src/common/mutex.h"
+#include "src/common/thread.h"
+
+#include "src/images/dumppng.h"
+#include "src/images/decoder.h"
+#include "src/images/util.h"
+#include "src/images/pixelrows.h"
+
+namespace Images {
+
+static const byte kPNGSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+static const byte kColorTypeRGB  = 2;
+static const byte kColorTypeRGBA = 6;
+
+/** Roughly how many bytes of filtered rows to compress into one independent deflate stream. */
+static const size_t kBandSize = 256 * 1024;
+
+/** The size of the deflate window. Each band is primed with that much data from before it. */
+static const size_t kWindowSize = 32 * 1024;
+
+PNGOptions::PNGOptions() : compression(6), filter(kPNGFilterAdaptive), threads(0) {
+}
+
+/** Does a PNG of an image in this format need an alpha channel? */
+static bool hasAlpha(PixelFormat format) {
+	return (format != kPixelFormatR8G8B8) && (format != kPixelFormatB8G8R8) && (format != kPixelFormatR5G6B5);
+}
+
+/** Reads the rows of an image as R8G8B8(A8), in the order they go into the PNG.
+ *
+ *  A TGA written by dumpTGA() starts with the bottom row, so the PNG, which
+ *  starts with the top row, gets the rows of all layers in reverse.
+ */
+class PNGRowReader {
+public:
+	PNGRowReader(const Decoder &image, bool alpha) : _image(&image), _alpha(alpha),
+		_width(image.getMipMap(0, 0).width), _height(0), _cachedLayer(SIZE_MAX), _cachedTop(0) {
+
+		uint32 cacheRows = 8;
+		for (size_t i = 0; i < image.getLayerCount(); i++) {
+			_height += image.getMipMap(0, i).height;
+
+			// Images narrower than a block are decompressed whole
+			if (_width < 4)
+				cacheRows = MAX<uint32>(cacheRows, image.getMipMap(0, i).height);
+		}
+
+		_row.resize(_width * 4);
+
+		if (isCompressed(image.getFormat()))
+			_cache.resize(MAX<size_t>(_width * cacheRows * 4, 64));
+	}
+
+	/** Read the row, counted from the top of the PNG. */
+	void readRow(byte *dest, uint32 row) {
+		uint32 y = _height - 1 - row;
+
+		size_t layer = 0;
+		while ((uint32) _image->getMipMap(0, layer).height <= y)
+			y -= _image->getMipMap(0, layer++).height;
+
+		const Decoder::MipMap &mipMap = _image->getMipMap(0, layer);
+
+		if (isCompressed(_image->getFormat()))
+			convertRow(&_row[0], getDecompressedRow(mipMap, layer, y), _width, kPixelFormatR8G8B8A8);
+		else
+			convertRow(&_row[0], mipMap.data + y * _width * getBPP(_image->getFormat()), _width, _image->getFormat());
+
+		// From B8G8R8A8 into the channel order of the PNG
+
+		const byte *src = &_row[0];
+		if (_alpha) {
+			for (uint32 x = 0; x < _width; x++, src += 4, dest += 4) {
+				dest[0] = src[2];
+				dest[1] = src[1];
+				dest[2] = src[0];
+				dest[3] = src[3];
+			}
+		} else {
+			for (uint32 x = 0; x < _width; x++, src += 4, dest += 3) {
+				dest[0] = src[2];
+				dest[1] = src[1];
+				dest[2] = src[0];
+			}
+		}
+	}
+
+private:
+	const Decoder *_image;
+	bool _alpha;
+
+	uint32 _width;
+	uint32 _height;
+
+	std::vector<byte> _row;
+
+	/** The rows of blocks that were decompressed last. */
+	std::vector<byte> _cache;
+	size_t _cachedLayer;
+	uint32 _cachedTop;
+
+	const byte *getDecompressedRow(const Decoder::MipMap &mipMap, size_t layer, uint32 y) {
+		const uint32 height = mipMap.height;
+
+		/* Small images are decompressed whole, everything else one row of blocks at a time.
+		 * Like in dumpTGA(), a partial row of blocks at the bottom goes with the one above it. */
+		uint32 top = 0, bottom = height;
+		if ((_width >= 4) && (height >= 4)) {
+			top    = y & ~3;
+			bottom = MIN(top + 4, height);
+
+			if ((bottom - top) < 4)
+				top -= 4;
+		}
+
+		if ((layer != _cachedLayer) || (top != _cachedTop)) {
+			decompressRows(&_cache[0], mipMap, _image->getFormat(), top, bottom);
+
+			_cachedLayer = layer;
+			_cachedTop   = top;
+		}
+
+		return &_cache[(y - top) * _width * 4];
+	}
+};
+
+static byte paethPredictor(byte a, byte b, byte c) {
+	const int p  = a + b - c;
+	const int pa = ABS(p - a);
+	const int pb = ABS(p - b);
+	const int pc = ABS(p - c);
+
+	if ((pa <= pb) && (pa <= pc))
+		return a;
+	if (pb <= pc)
+		return b;
+
+	return c;
+}
+
+/** Filter a row with one specific filter. prior is the unfiltered row above. */
+static void applyFilter(byte *dest, const byte *row, const byte *prior, size_t size, uint32 bpp, PNGFilter filter) {
+	switch (filter) {
+		case kPNGFilterSub:
+			for (size_t i = 0; i < bpp; i++)
+				dest[i] = row[i];
+			for (size_t i = bpp; i < size; i++)
+				dest[i] = row[i] - row[i - bpp];
+			break;
+
+		case kPNGFilterUp:
+			for (size_t i = 0; i < size; i++)
+				dest[i] = row[i] - prior[i];
+			break;
+
+		case kPNGFilterAverage:
+			for (size_t i = 0; i < bpp; i++)
+				dest[i] = row[i] - (prior[i] >> 1);
+			for (size_t i = bpp; i < size; i++)
+				dest[i] = row[i] - ((row[i - bpp] + prior[i]) >> 1);
+			break;
+
+		case kPNGFilterPaeth:
+			for (size_t i = 0; i < bpp; i++)
+				dest[i] = row[i] - prior[i];
+			for (size_t i = bpp; i < size; i++)
+				dest[i] = row[i] - paethPredictor(row[i - bpp], prior[i], prior[i - bpp]);
+			break;
+
+		default:
+			std::memcpy(dest, row, size);
+			break;
+	}
+}
+
+/** The sum of the filtered bytes, read as signed values. Smaller sums tend to compress better. */
+static uint32 getFilterCost(const byte *data, size_t size) {
+	uint32 cost = 0;
+	for (size_t i = 0; i < size; i++)
+		cost += (data[i] < 128) ? data[i] : (256 - data[i]);
+
+	return cost;
+}
+
+/** Filter a row into dest, which starts with the byte naming the filter used. */
+static void filterRow(byte *dest, const byte *row, const byte *prior, size_t size, uint32 bpp,
+                      PNGFilter filter, std::vector<byte> &scratch) {
+
+	if (filter != kPNGFilterAdaptive) {
+		dest[0] = (byte) filter;
+		applyFilter(dest + 1, row, prior, size, bpp, filter);
+		return;
+	}
+
+	scratch.resize(size);
+
+	uint32 bestCost = 0xFFFFFFFF;
+	for (int f = kPNGFilterNone; f < kPNGFilterAdaptive; f++) {
+		applyFilter(&scratch[0], row, prior, size, bpp, (PNGFilter) f);
+
+		const uint32 cost = getFilterCost(&scratch[0], size);
+		if (cost < bestCost) {
+			bestCost = cost;
+
+			dest[0] = (byte) f;
+			std::memcpy(dest + 1, &scratch[0], size);
+		}
+	}
+}
+
+/** A band of rows, compressed into a deflate stream of its own. */
+struct PNGBand {
+	uint32 top;    ///< The first row of the band.
+	uint32 bottom; ///< The row after the last row of the band.
+
+	std::vector<byte> data; ///< The compressed band.
+
+	uLong adler; ///< The Adler-32 checksum of the filtered rows.
+	size_t size; ///< The size of the filtered rows.
+
+
+	PNGBand(uint32 t, uint32 b) : top(t), bottom(b), adler(0), size(0) {
+	}
+};
+
+/** The state shared between all threads compressing bands. */
+struct PNGContext : public Common::ThreadPool {
+	const Decoder *image;
+	const PNGOptions *options;
+
+	bool alpha;
+	uint32 width;
+	uint32 height;
+
+	std::vector<PNGBand> bands;
+
+	bool failed;
+	Common::Exception error;
+
+	Common::Mutex errorMutex; ///< Guards failed and error.
+
+
+	PNGContext(const Decoder &i, const PNGOptions &o) : image(&i), options(&o),
+		alpha(hasAlpha(i.getFormat())), width(i.getMipMap(0, 0).width), height(0), failed(false) {
+	}
+
+protected:
+	void runJob(size_t n) {
+		// Once a band has failed, the remaining ones aren't needed anymore
+		if (hasFailed())
+			return;
+
+		try {
+			compressBand(bands[n]);
+		} catch (Common::Exception &e) {
+			setError(e);
+		} catch (std::exception &e) {
+			setError(Common::Exception(e));
+		} catch (...) {
+			setError(Common::Exception("Unknown error while compressing PNG data"));
+		}
+	}
+
+private:
+	void compressBand(PNGBand &band) {
+		PNGRowReader reader(*image, alpha);
+
+		const uint32 bpp      = alpha ? 4 : 3;
+		const size_t rowSize  = width * bpp;
+		const size_t lineSize = rowSize + 1;
+
+		/* To compress about as well as a single stream, the band is primed with
+		 * the filtered rows before it, as far back as the deflate window reaches. */
+		const uint32 dictRows = MIN<uint32>(band.top, (kWindowSize + lineSize - 1) / lineSize);
+		const uint32 first    = band.top - dictRows;
+
+		std::vector<byte> filtered((band.bottom - first) * lineSize);
+		std::vector<byte> prior(rowSize, 0), row(rowSize), scratch;
+
+		if (first > 0)
+			reader.readRow(&prior[0], first - 1);
+
+		for (uint32 y = first; y < band.bottom; y++) {
+			reader.readRow(&row[0], y);
+			filterRow(&filtered[(y - first) * lineSize], &row[0], &prior[0], rowSize, bpp, options->filter, scratch);
+
+			row.swap(prior);
+		}
+
+		const size_t dictSize = MIN(dictRows * lineSize, kWindowSize);
+
+		byte *input = &filtered[dictRows * lineSize];
+		band.size   = (band.bottom - band.top) * lineSize;
+		band.adler  = adler32(adler32(0, Z_NULL, 0), input, band.size);
+
+		z_stream strm;
+		std::memset(&strm, 0, sizeof(strm));
+
+		// Negative window bits mean a raw deflate stream, without zlib header and checksum
+		const int strategy = (options->filter == kPNGFilterNone) ? Z_DEFAULT_STRATEGY : Z_FILTERED;
+		if (deflateInit2(&strm, options->compression, Z_DEFLATED, -15, 8, strategy) != Z_OK)
+			throw Common::Exception("Could not initialize zlib deflate");
+
+		if (dictSize > 0)
+			deflateSetDictionary(&strm, input - dictSize, dictSize);
+
+		// The first band starts with the zlib header
+		const size_t headerSize = (band.top == 0) ? 2 : 0;
+
+		band.data.resize(headerSize + deflateBound(&strm, band.size) + 16);
+
+		strm.next_in   = input;
+		strm.avail_in  = band.size;
+		strm.next_out  = &band.data[headerSize];
+		strm.avail_out = band.data.size() - headerSize;
+
+		/* All but the last band end with an empty stored block, which aligns them
+		 * to a byte boundary without ending the stream. */
+		const bool last   = band.bottom == height;
+		const int  result = deflate(&strm, last ? Z_FINISH : Z_SYNC_FLUSH);
+
+		const bool complete = (strm.avail_in == 0) && (strm.avail_out > 0) && (result == (last ? Z_STREAM_END : Z_OK));
+
+		band.data.resize(band.data.size() - strm.avail_out);
+
+		deflateEnd(&strm);
+
+		if (!complete)
+			throw Common::Exception("Failed to compress PNG data (%d)", result);
+	}
+
+	bool hasFailed() {
+		Common::StackLock lock(errorMutex);
+
+		return failed;
+	}
+
+	/** Remember the first error of any thread. */
+	void setError(const Common::Exception &e) {
+		Common::StackLock lock(errorMutex);
+
+		if (!failed)
+			error = e;
+
+		failed = true;
+	}
+};
+
+static void compressBands(PNGContext &context) {
+	size_t threadCount = context.options->threads;
+	if (threadCount == 0)
+		threadCount = Common::Thread::getProcessorCount();
+
+	context.runJobs(context.bands.size(), threadCount);
+
+	if (context.failed)
+		throw context.error;
+
+	// A band missing its data would corrupt the stream joined from them
+	for (std::vector<PNGBand>::const_iterator b = context.bands.begin(); b != context.bands.end(); ++b)
+		if (b->data.empty())
+			throw Common::Exception("Failed to compress PNG data");
+}
+
+/** Check that the mip maps written into the PNG hold enough data. */
+static void checkMipMap(const Decoder::MipMap &mipMap, PixelFormat format) {
+	if (isCompressed(format)) {
+		if (!hasValidDimensions(format, mipMap.width, mipMap.height))
+			throw Common::Exception("Invalid dimensions (%dx%d) for format %d", mipMap.width, mipMap.height, format);
+	}
+
+	if (mipMap.size < getDataSize(format, mipMap.width, mipMap.height))
+		throw Common::Exception("Not enough data for a %dx%d image in format %d (%u bytes)",
+		                        mipMap.width, mipMap.height, format, mipMap.size);
+}
+
+static void writeChunk(Common::WriteStream &file, uint32 type, const byte *data, size_t size) {
+	byte header[8];
+	WRITE_BE_UINT32(header    , size);
+	WRITE_BE_UINT32(header + 4, type);
+
+	// The CRC covers the chunk type and data, but not the length
+	uLong crc = crc32(0, Z_NULL, 0);
+	crc = crc32(crc, header + 4, 4);
+	if (size > 0)
+		crc = crc32(crc, data, size);
+
+	byte footer[4];
+	WRITE_BE_UINT32(footer, crc);
+
+	file.write(header, sizeof(header));
+	file.write(data, size);
+	file.write(footer, sizeof(footer));
+}
+
+/** The zlib header, announcing a deflate stream with a 32KB window. */
+static void writeZlibHeader(byte *header, int compression) {
+	const byte level = (compression < 2) ? 0 : ((compression < 6) ? 1 : ((compression == 6) ? 2 : 3));
+
+	header[0] = 0x78;
+	header[1] = level << 6;
+
+	// The header, as a 16-bit big endian value, needs to be a multiple of 31
+	header[1] += 31 - (((header[0] << 8) | header[1]) % 31);
+}
+
+void dumpPNG(const Common::UString &fileName, const Decoder &image, const PNGOptions &options) {
+	if ((image.getLayerCount() < 1) || (image.getMipMapCount() < 1))
+		throw Common::Exception("No image");
+
+	if ((getBPP(image.getFormat()) == 0) && !isCompressed(image.getFormat()))
+		throw Common::Exception("Unsupported pixel format: %d", (int) image.getFormat());
+
+	if ((options.compression < 0) || (options.compression > 9))
+		throw Common::Exception("Invalid PNG compression level %d", options.compression);
+
+	PNGContext context(image, options);
+
+	for (size_t i = 0; i < image.getLayerCount(); i++) {
+		const Decoder::MipMap &mipMap = image.getMipMap(0, i);
+
+		if ((uint32) mipMap.width != context.width)
+			throw Common::Exception("dumpPNG(): Unsupported image with variable layer width");
+
+		checkMipMap(mipMap, image.getFormat());
+
+		context.height += mipMap.height;
+	}
+
+	if ((context.width == 0) || (context.height == 0))
+		throw Common::Exception("Invalid PNG dimensions (%ux%u)", context.width, context.height);
+
+	const size_t lineSize = context.width * (context.alpha ? 4 : 3) + 1;
+	const uint32 bandRows = MAX<uint32>(kBandSize / lineSize, 1);
+
+	for (uint32 top = 0; top < context.height; top += bandRows)
+		context.bands.push_back(PNGBand(top, MIN(top + bandRows, context.height)));
+
+	compressBands(context);
+
+	// Join the bands into one zlib stream: header, the deflate data and the Adler-32 of everything
+
+	writeZlibHeader(&context.bands.front().data[0], options.compression);
+
+	uLong adler = adler32(0, Z_NULL, 0);
+	for (std::vector<PNGBand>::const_iterator b = context.bands.begin(); b != context.bands.end(); ++b)
+		adler = adler32_combine(adler, b->adler, b->size);
+
+	std::vector<byte> &lastData = context.bands.back().data;
+	lastData.resize(lastData.size() + 4);
+	WRITE_BE_UINT32(&lastData[lastData.size() - 4], adler);
+
+	byte header[13];
+	WRITE_BE_UINT32(header    , context.width);
+	WRITE_BE_UINT32(header + 4, context.height);
+
+	header[ 8] = 8; // Bits per channel
+	header[ 9] = context.alpha ? kColorTypeRGBA : kColorTypeRGB;
+	header[10] = 0; // Deflate compression
+	header[11] = 0; // Adaptive filtering
+	header[12] = 0; // No interlacing
+
+	Common::WriteFile file(fileName);
+
+	file.write(kPNGSignature, sizeof(kPNGSignature));
+
+	writeChunk(file, MKTAG('I', 'H', 'D', 'R'), header, sizeof(header));
+
+	for (std::vector<PNGBand>::const_iterator b = context.bands.begin(); b != context.bands.end(); ++b)
+		writeChunk(file, MKTAG('I', 'D', 'A', 'T'), &b->data[0], b->data.size());
+
+	writeChunk(file, MKTAG('I', 'E', 'N', 'D'), 0, 0);
+
+	file.flush();
+}
+
+} // End of namespace Images
@@ -0,0 +1,63 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A PNG image dumper.
+ */
+
+#ifndef IMAGES_DUMPPNG_H
+#define IMAGES_DUMPPNG_H
+
+#include "src/common/types.h"
+
+#include "src/images/types.h"
+
+namespace Common {
+	class UString;
+}
+
+namespace Images {
+
+class Decoder;
+
+/** How to write a PNG. */
+struct PNGOptions {
+	int compression;  ///< The zlib compression level, 0 to 9.
+	PNGFilter filter; ///< How to filter the rows before compressing them.
+	size_t threads;   ///< The number of threads to compress with. 0 means one per processor.
+
+	PNGOptions();
+};
+
+/** Dump image into a PNG file.
+ *
+ *  The PNG shows the image the same way as the TGA written by dumpTGA().
+ *  It has 8 bits per channel, and an alpha channel unless the image's
+ *  format has none.
+ *
+ *  The image data is split into bands of rows, each one compressed into a
+ *  deflate stream of its own. These are then joined into a single zlib
+ *  stream. The output doesn't depend on the number of threads.
+ */
+void dumpPNG(const Common::UString &fileName, const Decoder &image, const PNGOptions &options = PNGOptions());
+
+} // End of namespace Images
+
+#endif // IMAGES_DUMPPNG_H
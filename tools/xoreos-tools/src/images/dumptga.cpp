@@ -23,100 +23,149 @@
  */
 
 #include <cstdio>
+#include <cstring>
+
+#include <vector>
 
 #include "src/common/error.h"
 #include "src/common/ustring.h"
 #include "src/common/writefile.h"
 
 #include "src/images/decoder.h"
+#include "src/images/util.h"
+#include "src/images/pixelrows.h"
 
 namespace Images {
 
-static void writePixel(Common::WriteStream &file, const byte *&data, PixelFormat format) {
-	if (format == kPixelFormatR8G8B8) {
-		file.writeByte(data[2]);
-		file.writeByte(data[1]);
-		file.writeByte(data[0]);
-		file.writeByte(0xFF);
-		data += 3;
-	} else if (format == kPixelFormatB8G8R8) {
-		file.writeByte(data[0]);
-		file.writeByte(data[1]);
-		file.writeByte(data[2]);
-		file.writeByte(0xFF);
-		data += 3;
-	} else if (format == kPixelFormatR8G8B8A8) {
-		file.writeByte(data[2]);
-		file.writeByte(data[1]);
-		file.writeByte(data[0]);
-		file.writeByte(data[3]);
-		data += 4;
-	} else if (format == kPixelFormatB8G8R8A8) {
-		file.writeByte(data[0]);
-		file.writeByte(data[1]);
-		file.writeByte(data[2]);
-		file.writeByte(data[3]);
-		data += 4;
-	} else if (format == kPixelFormatR5G6B5) {
-		uint16 color = READ_LE_UINT16(data);
-		file.writeByte( color & 0x001F);
-		file.writeByte((color & 0x07E0) >>  5);
-		file.writeByte((color & 0xF800) >> 11);
-		file.writeByte(0xFF);
-		data += 2;
-	} else if (format == kPixelFormatA1R5G5B5) {
-		uint16 color = READ_LE_UINT16(data);
-		file.writeByte( color & 0x001F);
-		file.writeByte((color & 0x03E0) >>  5);
-		file.writeByte((color & 0x7C00) >> 10);
-		file.writeByte((color & 0x8000) ? 0xFF : 0x00);
-		data += 2;
-	} else if (format == kPixelFormatDepth16) {
-		uint16 color = READ_LE_UINT16(data);
-		file.writeByte(color / 128);
-		file.writeByte(color / 128);
-		file.writeByte(color / 128);
-		file.writeByte((color >= 0x7FFF) ? 0x00 : 0xFF);
-
-		data += 2;
-	} else
-		throw Common::Exception("Unsupported pixel format: %d", (int) format);
+/** Roughly how many bytes to collect before writing them out in one go. */
+static const size_t kBufferSize = 256 * 1024;
 
-}
+/** Append a row of B8G8R8A8 pixels as RLE packets. Packets never cross rows. */
+static void compressRowRLE(std::vector<byte> &out, const byte *row, uint32 width) {
+	uint32 x = 0;
+	while (x < width) {
+		const byte *pixel = row + x * 4;
+
+		// Count how often this pixel repeats
+		uint32 run = 1;
+		while ((x + run < width) && (run < 128) && !std::memcmp(pixel, pixel + run * 4, 4))
+			run++;
+
+		if (run > 1) {
+			out.push_back(0x80 | (run - 1));
+			out.insert(out.end(), pixel, pixel + 4);
+
+			x += run;
+			continue;
+		}
+
+		// Collect pixels until the next repeating one
+		uint32 count = 1;
+		while ((x + count < width) && (count < 128)) {
+			const byte *next = pixel + count * 4;
+			if ((x + count + 1 < width) && !std::memcmp(next, next + 4, 4))
+				break;
+
+			count++;
+		}
 
-static Common::WriteStream *openTGA(const Common::UString &fileName, int width, int height) {
-	Common::WriteFile *file = new Common::WriteFile(fileName);
+		out.push_back(count - 1);
+		out.insert(out.end(), pixel, pixel + count * 4);
 
-	file->writeByte(0);     // ID Length
-	file->writeByte(0);     // Palette size
-	file->writeByte(2);     // Unmapped RGB
-	file->writeUint32LE(0); // Color map
-	file->writeByte(0);     // Color map
-	file->writeUint16LE(0); // X
-	file->writeUint16LE(0); // Y
+		x += count;
+	}
+}
 
-	file->writeUint16LE(width);
-	file->writeUint16LE(height);
+static void writeHeader(Common::WriteStream &file, int width, int height, bool rle) {
+	byte header[18];
+	std::memset(header, 0, sizeof(header));
 
-	file->writeByte(32); // Pixel depths
+	header[ 2] = rle ? 10 : 2; // (RLE) Unmapped RGB
+	header[16] = 32;           // Pixel depth
 
-	file->writeByte(0);
+	WRITE_LE_UINT16(header + 12, width);
+	WRITE_LE_UINT16(header + 14, height);
 
-	return file;
+	file.write(header, sizeof(header));
 }
 
-static void writeMipMap(Common::WriteStream &stream, const Decoder::MipMap &mipMap, PixelFormat format) {
-	const byte *data = mipMap.data;
+/** Convert a mip map in chunks of rows, writing each chunk in one go.
+ *
+ *  Data already in B8G8R8A8 is written directly, without going through a buffer.
+ *  Compressed data is decompressed chunk by chunk.
+ */
+static void writeMipMap(Common::WriteStream &file, const Decoder::MipMap &mipMap, PixelFormat format, bool rle) {
+	const uint32 width  = mipMap.width;
+	const uint32 height = mipMap.height;
+	if ((width == 0) || (height == 0))
+		return;
+
+	if ((format == kPixelFormatB8G8R8A8) && !rle) {
+		file.write(mipMap.data, width * height * 4);
+		return;
+	}
+
+	const bool compressed = isCompressed(format);
+	if (compressed && !hasValidDimensions(format, width, height))
+		throw Common::Exception("Invalid dimensions (%dx%d) for format %d", width, height, format);
+
+	const uint32 srcPitch  = width * (compressed ? 4 : getBPP(format));
+	const uint32 destPitch = width * 4;
 
-	uint32 count = mipMap.width * mipMap.height;
-	while (count-- > 0)
-		writePixel(stream, data, format);
+	uint32 chunkRows = MAX<uint32>(kBufferSize / destPitch, 1);
+
+	// Decompress in whole blocks. A lone block row at the bottom goes with the chunk above it
+	if (compressed)
+		chunkRows = ((width < 4) || (height < 4)) ? height : MAX<uint32>(chunkRows & ~3, 4);
+
+	const uint32 bufferRows = compressed ? (chunkRows + 3) : chunkRows;
+
+	std::vector<byte> buffer(bufferRows * destPitch);
+	std::vector<byte> decompressed(compressed ? MAX<uint32>(bufferRows * srcPitch, 64) : 0);
+	std::vector<byte> packets;
+
+	for (uint32 y = 0; y < height; ) {
+		uint32 rows = MIN(chunkRows, height - y);
+		if (compressed && ((height - y - rows) < 4))
+			rows = height - y;
+
+		const byte *src = mipMap.data + y * srcPitch;
+		if (compressed) {
+			decompressRows(&decompressed[0], mipMap, format, y, y + rows);
+			src = &decompressed[0];
+		}
+
+		const byte *converted = src;
+		if (format != kPixelFormatB8G8R8A8) {
+			for (uint32 i = 0; i < rows; i++)
+				convertRow(&buffer[i * destPitch], src + i * srcPitch, width,
+				           compressed ? kPixelFormatR8G8B8A8 : format);
+
+			converted = &buffer[0];
+		}
+
+		y += rows;
+
+		if (!rle) {
+			file.write(converted, rows * destPitch);
+			continue;
+		}
+
+		packets.clear();
+		for (uint32 i = 0; i < rows; i++)
+			compressRowRLE(packets, converted + i * destPitch, width);
+
+		file.write(&packets[0], packets.size());
+	}
 }
 
-void dumpTGA(const Common::UString &fileName, const Decoder &image) {
+void dumpTGA(const Common::UString &fileName, const Decoder &image, bool rle) {
 	if ((image.getLayerCount() < 1) || (image.getMipMapCount() < 1))
 		throw Common::Exception("No image");
 
+	if ((getBPP(image.getFormat()) == 0) && !isCompressed(image.getFormat()))
+		throw Common::Exception("Unsupported pixel format: %d", (int) image.getFormat());
+
 	int32 width  = image.getMipMap(0, 0).width;
 	int32 height = 0;
 
@@ -129,13 +178,14 @@ void dumpTGA(const Common::UString &fileName, const Decoder &image) {
 		height += mipMap.height;
 	}
 
-	Common::WriteStream *file = openTGA(fileName, width, height);
+	Common::WriteFile file(fileName);
+
+	writeHeader(file, width, height, rle);
 
 	for (size_t i = 0; i < image.getLayerCount(); i++)
-		writeMipMap(*file, image.getMipMap(0, i), image.getFormat());
+		writeMipMap(file, image.getMipMap(0, i), image.getFormat(), rle);
 
-	file->flush();
-	delete file;
+	file.flush();
 }
 
 } // End of namespace Images
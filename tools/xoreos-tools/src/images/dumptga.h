@@ -37,8 +37,12 @@ namespace Images {
 
 class Decoder;
 
-/** Dump image into a TGA file. */
-void dumpTGA(const Common::UString &fileName, const Decoder &image);
+/** Dump image into a TGA file.
+ *
+ *  The TGA is always written with 32 bits per pixel. If rle is true, the
+ *  pixel data is run-length encoded.
+ */
+void dumpTGA(const Common::UString &fileName, const Decoder &image, bool rle = false);
 
 } // End of namespace Images
 
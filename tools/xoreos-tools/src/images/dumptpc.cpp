@@ -0,0 +1,116 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A simple TPC texture dumper.
+ */
+
+#include "src/common/util.h"
+#include "src/common/error.h"
+#include "src/common/ustring.h"
+#include "src/common/readstream.h"
+#include "src/common/writefile.h"
+
+#include "src/images/dumptpc.h"
+#include "src/images/decoder.h"
+#include "src/images/util.h"
+
+static const byte kEncodingRGB  = 0x02;
+static const byte kEncodingRGBA = 0x04;
+
+namespace Images {
+
+static void writeZeros(Common::WriteStream &stream, size_t count) {
+	while (count-- > 0)
+		stream.writeByte(0);
+}
+
+void dumpTPC(const Common::UString &fileName, const Decoder &image, Common::SeekableReadStream *txi) {
+	if ((image.getLayerCount() != 1) || (image.getMipMapCount() < 1))
+		throw Common::Exception("dumpTPC(): Unsupported image with %u layers and %u mip maps",
+		                        (uint) image.getLayerCount(), (uint) image.getMipMapCount());
+
+	// DXT1 is marked as RGB, DXT5 as RGBA
+	byte   encoding    = 0;
+	uint32 minDataSize = 0;
+	if        (image.getFormat() == kPixelFormatDXT1) {
+		encoding    = kEncodingRGB;
+		minDataSize = 8;
+	} else if (image.getFormat() == kPixelFormatDXT5) {
+		encoding    = kEncodingRGBA;
+		minDataSize = 16;
+	} else
+		throw Common::Exception("dumpTPC(): Unsupported pixel format %d", (int) image.getFormat());
+
+	const Decoder::MipMap &base = image.getMipMap(0);
+	if (((base.width % 4) != 0) || ((base.height % 4) != 0) || (base.width >= 0x8000) || (base.height >= 0x8000))
+		throw Common::Exception("dumpTPC(): Unsupported image dimensions (%dx%d)", base.width, base.height);
+
+	const uint32 dataSize = base.width * base.height / ((image.getFormat() == kPixelFormatDXT1) ? 2 : 1);
+
+	/* The reader assumes that each mip map takes a quarter of the size of the
+	 * one before. With non-square textures, that's eventually too small for
+	 * the blocks of a mip map, and the reader stops there. So do we. */
+	size_t mipMapCount = 0;
+	for (uint32 layerSize = dataSize; mipMapCount < MIN<size_t>(image.getMipMapCount(), 255); mipMapCount++) {
+		const Decoder::MipMap &mipMap = image.getMipMap(mipMapCount);
+
+		if (MAX(layerSize, minDataSize) < getDataSize(image.getFormat(), mipMap.width, mipMap.height))
+			break;
+
+		layerSize >>= 2;
+	}
+
+	Common::WriteFile file(fileName);
+
+	file.writeUint32LE(dataSize);
+	file.writeIEEEFloatLE(1.0f); // Unknown
+
+	file.writeUint16LE(base.width);
+	file.writeUint16LE(base.height);
+
+	file.writeByte(encoding);
+	file.writeByte(mipMapCount);
+
+	writeZeros(file, 114); // Reserved
+
+	uint32 layerSize = dataSize;
+	for (size_t i = 0; i < mipMapCount; i++, layerSize >>= 2) {
+		const Decoder::MipMap &mipMap = image.getMipMap(i);
+
+		const uint32 size = MAX(layerSize, minDataSize);
+		const uint32 used = getDataSize(image.getFormat(), mipMap.width, mipMap.height);
+
+		if (mipMap.size < used)
+			throw Common::Exception("dumpTPC(): Not enough data in mip map %u", (uint) i);
+
+		file.write(mipMap.data, used);
+		writeZeros(file, size - used);
+	}
+
+	if (txi) {
+		txi->seek(0);
+		file.writeStream(*txi);
+	}
+
+	file.flush();
+}
+
+} // End of namespace Images
@@ -0,0 +1,52 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A simple TPC texture dumper.
+ */
+
+#ifndef IMAGES_DUMPTPC_H
+#define IMAGES_DUMPTPC_H
+
+#include "src/common/types.h"
+
+#include "src/images/types.h"
+
+namespace Common {
+	class UString;
+	class SeekableReadStream;
+}
+
+namespace Images {
+
+class Decoder;
+
+/** Dump an image into a TPC file.
+ *
+ *  The image needs to be compressed into DXT1 or DXT5 already, and its
+ *  dimensions need to be multiples of 4. Mip maps are written as far as
+ *  TPC::readHeader() would read them back. If given, the contents of the
+ *  txi stream are appended as the embedded TXI data.
+ */
+void dumpTPC(const Common::UString &fileName, const Decoder &image, Common::SeekableReadStream *txi = 0);
+
+} // End of namespace Images
+
+#endif // IMAGES_DUMPTPC_H
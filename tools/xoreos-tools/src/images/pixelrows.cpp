@@ -0,0 +1,143 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Reading the pixel rows of mip maps in a common format.
+ */
+
+#include <cassert>
+#include <cstring>
+
+#include "src/common/util.h"
+#include "src/common/error.h"
+
+#include "src/images/pixelrows.h"
+#include "src/images/util.h"
+#include "src/images/s3tc.h"
+
+namespace Images {
+
+bool isCompressed(PixelFormat format) {
+	return (format == kPixelFormatDXT1) || (format == kPixelFormatDXT3) || (format == kPixelFormatDXT5);
+}
+
+void convertRow(byte *dest, const byte *src, uint32 width, PixelFormat format) {
+	switch (format) {
+		case kPixelFormatR8G8B8:
+			for (uint32 x = 0; x < width; x++, dest += 4, src += 3) {
+				dest[0] = src[2];
+				dest[1] = src[1];
+				dest[2] = src[0];
+				dest[3] = 0xFF;
+			}
+			break;
+
+		case kPixelFormatB8G8R8:
+			for (uint32 x = 0; x < width; x++, dest += 4, src += 3) {
+				dest[0] = src[0];
+				dest[1] = src[1];
+				dest[2] = src[2];
+				dest[3] = 0xFF;
+			}
+			break;
+
+		case kPixelFormatR8G8B8A8:
+			for (uint32 x = 0; x < width; x++, dest += 4, src += 4) {
+				dest[0] = src[2];
+				dest[1] = src[1];
+				dest[2] = src[0];
+				dest[3] = src[3];
+			}
+			break;
+
+		case kPixelFormatB8G8R8A8:
+			std::memcpy(dest, src, width * 4);
+			break;
+
+		case kPixelFormatR5G6B5:
+			for (uint32 x = 0; x < width; x++, dest += 4, src += 2) {
+				const uint16 color = READ_LE_UINT16(src);
+
+				dest[0] =  color & 0x001F;
+				dest[1] = (color & 0x07E0) >>  5;
+				dest[2] = (color & 0xF800) >> 11;
+				dest[3] = 0xFF;
+			}
+			break;
+
+		case kPixelFormatA1R5G5B5:
+			for (uint32 x = 0; x < width; x++, dest += 4, src += 2) {
+				const uint16 color = READ_LE_UINT16(src);
+
+				dest[0] =  color & 0x001F;
+				dest[1] = (color & 0x03E0) >>  5;
+				dest[2] = (color & 0x7C00) >> 10;
+				dest[3] = (color & 0x8000) ? 0xFF : 0x00;
+			}
+			break;
+
+		case kPixelFormatDepth16:
+			for (uint32 x = 0; x < width; x++, dest += 4, src += 2) {
+				const uint16 color = READ_LE_UINT16(src);
+
+				dest[0] = dest[1] = dest[2] = color / 128;
+				dest[3] = (color >= 0x7FFF) ? 0x00 : 0xFF;
+			}
+			break;
+
+		default:
+			throw Common::Exception("Unsupported pixel format: %d", (int) format);
+	}
+}
+
+void decompressRows(byte *dest, const Decoder::MipMap &mipMap, PixelFormat format,
+                    uint32 top, uint32 bottom) {
+
+	const uint32 width = mipMap.width;
+
+	// Small images are always decompressed in one go
+	if ((width < 4) || (mipMap.height < 4)) {
+		assert((top == 0) && (bottom == (uint32) mipMap.height));
+
+		top    = 0;
+		bottom = mipMap.height;
+	}
+
+	/* Decompress the rows as an image of their own, made from the blocks
+	 * they consist of. That way, the rows can go into a small buffer. */
+
+	const uint32 blockSize = (format == kPixelFormatDXT1) ? 8 : 16;
+	const size_t offset    = (size_t) (top / 4) * ((width + 3) / 4) * blockSize;
+	if (offset > mipMap.size)
+		throw Common::Exception("Not enough data for a %dx%d image in format %d (%u bytes)",
+		                        mipMap.width, mipMap.height, format, mipMap.size);
+
+	const byte  *src  = mipMap.data + offset;
+	const size_t size = mipMap.size - offset;
+
+	if      (format == kPixelFormatDXT1)
+		decompressDXT1(dest, src, size, width, bottom - top, width * 4);
+	else if (format == kPixelFormatDXT3)
+		decompressDXT3(dest, src, size, width, bottom - top, width * 4);
+	else if (format == kPixelFormatDXT5)
+		decompressDXT5(dest, src, size, width, bottom - top, width * 4);
+}
+
+} // End of namespace Images
@@ -0,0 +1,52 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Reading the pixel rows of mip maps in a common format.
+ */
+
+#ifndef IMAGES_PIXELROWS_H
+#define IMAGES_PIXELROWS_H
+
+#include "src/common/types.h"
+
+#include "src/images/types.h"
+#include "src/images/decoder.h"
+
+namespace Images {
+
+/** Is this a compressed (DXT) pixel format? */
+bool isCompressed(PixelFormat format);
+
+/** Convert a row of uncompressed pixels into B8G8R8A8. */
+void convertRow(byte *dest, const byte *src, uint32 width, PixelFormat format);
+
+/** Decompress the rows from top up to, but not including, bottom of a DXT mip map into R8G8B8A8 pixels.
+ *
+ *  The rows are written to the start of dest. Unless they reach the bottom of
+ *  the image, they need to be a multiple of 4, the height of a block. Images
+ *  smaller than a block are always decompressed whole.
+ */
+void decompressRows(byte *dest, const Decoder::MipMap &mipMap, PixelFormat format,
+                    uint32 top, uint32 bottom);
+
+} // End of namespace Images
+
+#endif // IMAGES_PIXELROWS_H
@@ -19,201 +19,748 @@
  */
 
 /** @file
- *  Manual S3TC DXTn decompression methods.
+ *  Manual S3TC DXTn decompression and compression methods.
  */
 
+#include <cstring>
+#include <cfloat>
+
 #include "src/common/util.h"
-#include "src/common/readstream.h"
+#include "src/common/error.h"
 
 #include "src/images/s3tc.h"
 
 namespace Images {
 
-static uint32 convert565To8888(uint16 color) {
-	return ((color & 0x1F) << 11) | ((color & 0x7E0) << 13) | ((color & 0xF800) << 16) | 0xFF;
-}
-
-static uint32 interpolate32(double weight, uint32 color_0, uint32 color_1) {
-	byte r[3], g[3], b[3], a[3];
-	r[0] = color_0 >> 24;
-	r[1] = color_1 >> 24;
-	r[2] = (byte)((1.0f - weight) * (double)r[0] + weight * (double)r[1]);
-	g[0] = (color_0 >> 16) & 0xFF;
-	g[1] = (color_1 >> 16) & 0xFF;
-	g[2] = (byte)((1.0f - weight) * (double)g[0] + weight * (double)g[1]);
-	b[0] = (color_0 >> 8) & 0xFF;
-	b[1] = (color_1 >> 8) & 0xFF;
-	b[2] = (byte)((1.0f - weight) * (double)b[0] + weight * (double)b[1]);
-	a[0] = color_0 & 0xFF;
-	a[1] = color_1 & 0xFF;
-	a[2] = (byte)((1.0f - weight) * (double)a[0] + weight * (double)a[1]);
-	return r[2] << 24 | g[2] << 16 | b[2] << 8 | a[2];
-}
-
-struct DXT1Texel {
-	uint16 color_0;
-	uint16 color_1;
-	uint32 pixels;
+enum DXTFormat {
+	kDXT1,
+	kDXT3,
+	kDXT5
 };
 
-#define READ_DXT1_TEXEL(x) \
-	x.color_0 = src.readUint16LE(); \
-	x.color_1 = src.readUint16LE(); \
-	x.pixels = src.readUint32BE()
-
-void decompressDXT1(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch) {
-	for (int32 ty = height; ty > 0; ty -= 4) {
-		for (uint32 tx = 0; tx < width; tx += 4) {
-			DXT1Texel tex;
-			READ_DXT1_TEXEL(tex);
-			uint32 blended[4];
-
-			blended[0] = convert565To8888(tex.color_0);
-			blended[1] = convert565To8888(tex.color_1);
-
-			if (tex.color_0 > tex.color_1) {
-				blended[2] = interpolate32(0.333333f, blended[0], blended[1]);
-				blended[3] = interpolate32(0.666666f, blended[0], blended[1]);
-			} else {
-				blended[2] = interpolate32(0.5f, blended[0], blended[1]);
-				blended[3] = 0;
-			}
+typedef void (*DecodeBlockFunc)(byte *dest, uint32 pitch, const byte *block);
+
+static void convert565To8888(byte *color, uint16 c, byte alpha) {
+	color[0] = (c >> 8) & 0xF8;
+	color[1] = (c >> 3) & 0xFC;
+	color[2] = (c << 3) & 0xF8;
+	color[3] = alpha;
+}
+
+/** Read the two colors of a block and interpolate the other two.
+ *
+ *  The colors are R8G8B8A8, with the alpha of the two read colors set to
+ *  the given value. If the block can have transparency (DXT1) and the
+ *  first color is not greater than the second, the third color is the
+ *  average and the fourth color is transparent black.
+ */
+static void readColors(byte (&colors)[4][4], const byte *block, bool transparency, byte alpha) {
+	const uint16 color0 = READ_LE_UINT16(block    );
+	const uint16 color1 = READ_LE_UINT16(block + 2);
+
+	convert565To8888(colors[0], color0, alpha);
+	convert565To8888(colors[1], color1, alpha);
+
+	if (!transparency || (color0 > color1)) {
+		/* Interpolate at 1/3 and 2/3, rounding down. These colors have always
+		 * been calculated with the floating point weights 0.333333 and 0.666666,
+		 * which are slightly biased towards the first color. Subtracting 1 when
+		 * the first channel value is smaller reproduces that bias exactly. */
+
+		for (size_t i = 0; i < 4; i++) {
+			const int c0 = colors[0][i];
+			const int c1 = colors[1][i];
+
+			const int bias = (c0 < c1) ? 1 : 0;
+
+			colors[2][i] = (2 * c0 + c1 - bias) / 3;
+			colors[3][i] = (c0 + 2 * c1 - bias) / 3;
+		}
+
+	} else {
+		for (size_t i = 0; i < 4; i++) {
+			colors[2][i] = (colors[0][i] + colors[1][i]) >> 1;
+			colors[3][i] = 0;
+		}
+	}
+}
+
+/** Read the two alpha values of a DXT5 block and interpolate the other six. */
+static void readAlphas(byte (&alphas)[8], const byte *block) {
+	const int alpha0 = alphas[0] = block[0];
+	const int alpha1 = alphas[1] = block[1];
+
+	if (alpha0 > alpha1) {
+		for (int i = 1; i <= 6; i++)
+			alphas[1 + i] = ((7 - i) * alpha0 + i * alpha1 + 3) / 7;
+	} else {
+		for (int i = 1; i <= 4; i++)
+			alphas[1 + i] = ((5 - i) * alpha0 + i * alpha1 + 2) / 5;
+
+		alphas[6] =   0;
+		alphas[7] = 255;
+	}
+}
+
+/** Return the 3-bit alpha indices of a DXT5 block, for all 16 pixels. */
+static uint64 readAlphaIndices(const byte *block) {
+	return READ_LE_UINT32(block + 2) | ((uint64) READ_LE_UINT16(block + 6) << 32);
+}
+
+static void decodeBlockDXT1(byte *dest, uint32 pitch, const byte *block) {
+	byte colors[4][4];
+	readColors(colors, block, true, 0xFF);
+
+	for (int y = 0; y < 4; y++, dest += pitch) {
+		const byte indices = block[4 + y];
+
+		std::memcpy(dest +  0, colors[(indices     ) & 3], 4);
+		std::memcpy(dest +  4, colors[(indices >> 2) & 3], 4);
+		std::memcpy(dest +  8, colors[(indices >> 4) & 3], 4);
+		std::memcpy(dest + 12, colors[(indices >> 6)    ], 4);
+	}
+}
+
+static void decodeBlockDXT3(byte *dest, uint32 pitch, const byte *block) {
+	byte colors[4][4];
+	readColors(colors, block + 8, false, 0x00);
+
+	for (int y = 0; y < 4; y++, dest += pitch) {
+		const byte indices = block[12 + y];
+
+		/* The rows of explicit alpha values are applied bottom to top. That's
+		 * not what the S3TC specification says, but it's how these textures
+		 * have always been decoded here, and the output is kept stable. */
+		uint16 alpha = READ_LE_UINT16(block + 2 * (3 - y));
+
+		for (int x = 0; x < 4; x++, alpha >>= 4) {
+			std::memcpy(dest + x * 4, colors[(indices >> (x * 2)) & 3], 4);
+
+			dest[x * 4 + 3] = (alpha & 0xF) << 4;
+		}
+	}
+}
+
+static void decodeBlockDXT5(byte *dest, uint32 pitch, const byte *block) {
+	byte alphas[8];
+	readAlphas(alphas, block);
+
+	byte colors[4][4];
+	readColors(colors, block + 8, false, 0x00);
+
+	uint64 alphaIndices = readAlphaIndices(block);
+
+	for (int y = 0; y < 4; y++, dest += pitch) {
+		const byte indices = block[12 + y];
+
+		for (int x = 0; x < 4; x++, alphaIndices >>= 3) {
+			std::memcpy(dest + x * 4, colors[(indices >> (x * 2)) & 3], 4);
 
-			uint32 cpx = tex.pixels;
-			uint32 blockWidth = MIN<uint32>(width, 4);
-			uint32 blockHeight = MIN<uint32>(height, 4);
+			dest[x * 4 + 3] = alphas[alphaIndices & 7];
+		}
+	}
+}
+
+/** Decompress an image that's narrower or lower than a single block.
+ *
+ *  Such images have always been decoded by reading the pixels of each block
+ *  in storage order into a block the size of the image, filled bottom to top.
+ *  This is kept as it is, so that the output stays stable.
+ */
+static void decompressSmall(byte *dest, const byte *src, uint32 width, uint32 height, uint32 pitch,
+                            uint32 top, uint32 bottom, DXTFormat format) {
+
+	const uint32 blockWidth  = MIN<uint32>(width , 4);
+	const uint32 blockHeight = MIN<uint32>(height, 4);
 
-			for (byte y = 0; y < blockHeight; ++y) {
-				for (byte x = 0; x < blockWidth; ++x) {
-					const uint32 destX = tx + x;
-					const uint32 destY = height - 1 - (ty - blockHeight + y);
+	const uint32 blockSize = (format == kDXT1) ? 8 : 16;
+	const byte  *colorData = (format == kDXT1) ? src : (src + 8);
 
-					const uint32 pixel =  blended[cpx & 3];
+	for (uint32 blockY = top; blockY < bottom; blockY += 4) {
+		for (uint32 blockX = 0; blockX < width; blockX += 4, src += blockSize, colorData += blockSize) {
+			byte colors[4][4];
+			readColors(colors, colorData, format == kDXT1, (format == kDXT1) ? 0xFF : 0x00);
 
-					cpx >>= 2;
+			byte alphas[8];
+			if (format == kDXT5)
+				readAlphas(alphas, src);
 
-					if ((destX < width) && (destY < height))
-						WRITE_BE_UINT32(dest + destY * pitch + destX * 4, pixel);
+			const uint64 alphaIndices = (format == kDXT5) ? readAlphaIndices(src) : 0;
+
+			uint32 indices = READ_BE_UINT32(colorData + 4);
+
+			for (uint32 y = 0; y < blockHeight; y++) {
+				for (uint32 x = 0; x < blockWidth; x++, indices >>= 2) {
+					const uint32 destX = blockX + x;
+					const uint32 destY = blockY + blockHeight - 1 - y;
+
+					if ((destX >= width) || (destY >= bottom))
+						continue;
+
+					byte *pixel = dest + destY * pitch + destX * 4;
+
+					std::memcpy(pixel, colors[indices & 3], 4);
+
+					if      (format == kDXT3)
+						pixel[3] = ((READ_LE_UINT16(src + 2 * y) >> (x * 4)) & 0xF) << 4;
+					else if (format == kDXT5)
+						pixel[3] = alphas[(alphaIndices >> (3 * (4 * (3 - y) + x))) & 7];
 				}
 			}
 		}
 	}
 }
 
-struct DXT23Texel : public DXT1Texel {
-	uint16 alpha[4];
-};
+static void decompress(byte *dest, const byte *src, size_t size, uint32 width, uint32 height, uint32 pitch,
+                       uint32 top, uint32 bottom, DXTFormat format) {
 
-#define READ_DXT3_TEXEL(x) \
-	x.alpha[0] = src.readUint16LE(); \
-	x.alpha[1] = src.readUint16LE(); \
-	x.alpha[2] = src.readUint16LE(); \
-	x.alpha[3] = src.readUint16LE(); \
-	READ_DXT1_TEXEL(x)
-
-void decompressDXT3(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch) {
-	for (int32 ty = height; ty > 0; ty -= 4) {
-		for (uint32 tx = 0; tx < width; tx += 4) {
-			DXT23Texel tex;
-			uint32 blended[4];
-			READ_DXT3_TEXEL(tex);
-
-			blended[0] = convert565To8888(tex.color_0) & 0xFFFFFF00;
-			blended[1] = convert565To8888(tex.color_1) & 0xFFFFFF00;
-			blended[2] = interpolate32(0.333333f, blended[0], blended[1]);
-			blended[3] = interpolate32(0.666666f, blended[0], blended[1]);
-
-			uint32 cpx = tex.pixels;
-			uint32 blockWidth = MIN<uint32>(width, 4);
-			uint32 blockHeight = MIN<uint32>(height, 4);
-
-			for (byte y = 0; y < blockHeight; ++y) {
-				for (byte x = 0; x < blockWidth; ++x) {
-					const uint32 destX = tx + x;
-					const uint32 destY = height - 1 - (ty - blockHeight + y);
-
-					const uint32 alpha = (tex.alpha[y] >> (x * 4)) & 0xF;
-					const uint32 pixel = blended[cpx & 3] | alpha << 4;
-
-					cpx >>= 2;
-
-					if ((destX < width) && (destY < height))
-						WRITE_BE_UINT32(dest + destY * pitch + destX * 4, pixel);
-				}
+	const uint32 blockSize = (format == kDXT1) ? 8 : 16;
+
+	const uint32 blocksX = (width  + 3) / 4;
+	const uint32 blocksY = (height + 3) / 4;
+
+	if ((size / blockSize) < ((uint64) blocksX * blocksY))
+		throw Common::Exception("Not enough data for a %ux%u DXT image (%u bytes)",
+		                        width, height, (uint) size);
+
+	if (((top % 4) != 0) || (bottom > height))
+		throw Common::Exception("Invalid row range %u-%u for a %ux%u DXT image", top, bottom, width, height);
+
+	// Skip the blocks above the first row
+	src += (size_t) (top / 4) * blocksX * blockSize;
+
+	if ((width < 4) || (height < 4)) {
+		decompressSmall(dest, src, width, height, pitch, top, bottom, format);
+		return;
+	}
+
+	DecodeBlockFunc decodeBlock = 0;
+	if      (format == kDXT1)
+		decodeBlock = &decodeBlockDXT1;
+	else if (format == kDXT3)
+		decodeBlock = &decodeBlockDXT3;
+	else
+		decodeBlock = &decodeBlockDXT5;
+
+	for (uint32 y = top; y < bottom; y += 4) {
+		const uint32 rows = MIN<uint32>(bottom - y, 4);
+
+		byte *destRow = dest + y * pitch;
+
+		for (uint32 x = 0; x < width; x += 4, src += blockSize) {
+			const uint32 columns = MIN<uint32>(width - x, 4);
+
+			if ((rows == 4) && (columns == 4)) {
+				(*decodeBlock)(destRow + x * 4, pitch, src);
+				continue;
 			}
+
+			// A block on the right or bottom edge, only partially within the image
+			byte block[4 * 4 * 4];
+			(*decodeBlock)(block, 4 * 4, src);
+
+			for (uint32 i = 0; i < rows; i++)
+				std::memcpy(destRow + i * pitch + x * 4, block + i * 4 * 4, columns * 4);
 		}
 	}
 }
 
-struct DXT45Texel : public DXT1Texel {
-	byte alpha_0;
-	byte alpha_1;
-	uint64 alphabl;
-};
+void decompressDXT1(byte *dest, const byte *src, size_t size, uint32 width, uint32 height, uint32 pitch) {
+	decompress(dest, src, size, width, height, pitch, 0, height, kDXT1);
+}
+
+void decompressDXT3(byte *dest, const byte *src, size_t size, uint32 width, uint32 height, uint32 pitch) {
+	decompress(dest, src, size, width, height, pitch, 0, height, kDXT3);
+}
+
+void decompressDXT5(byte *dest, const byte *src, size_t size, uint32 width, uint32 height, uint32 pitch) {
+	decompress(dest, src, size, width, height, pitch, 0, height, kDXT5);
+}
+
+void decompressDXT1(byte *dest, const byte *src, size_t size, uint32 width, uint32 height, uint32 pitch,
+                    uint32 top, uint32 bottom) {
+
+	decompress(dest, src, size, width, height, pitch, top, bottom, kDXT1);
+}
+
+void decompressDXT3(byte *dest, const byte *src, size_t size, uint32 width, uint32 height, uint32 pitch,
+                    uint32 top, uint32 bottom) {
+
+	decompress(dest, src, size, width, height, pitch, top, bottom, kDXT3);
+}
+
+void decompressDXT5(byte *dest, const byte *src, size_t size, uint32 width, uint32 height, uint32 pitch,
+                    uint32 top, uint32 bottom) {
+
+	decompress(dest, src, size, width, height, pitch, top, bottom, kDXT5);
+}
+
+
+/** Read a block of 4x4 pixels to compress.
+ *
+ *  Where the block extends past the right or bottom edge of the image, the
+ *  edge pixels are repeated, so that they don't pull the fit elsewhere.
+ */
+static void readBlock(byte (&block)[16][4], const byte *src, uint32 width, uint32 height, uint32 pitch,
+                      uint32 blockX, uint32 blockY) {
+
+	for (uint32 y = 0; y < 4; y++) {
+		const byte *row = src + MIN(blockY + y, height - 1) * pitch;
+
+		for (uint32 x = 0; x < 4; x++)
+			std::memcpy(block[y * 4 + x], row + MIN(blockX + x, width - 1) * 4, 4);
+	}
+}
+
+/** Find the mean color of a block and the axis along which its colors vary the most. */
+static void findPrincipalAxis(const byte (&block)[16][4], float (&mean)[3], float (&axis)[3]) {
+	for (int c = 0; c < 3; c++) {
+		mean[c] = 0.0f;
+		for (int i = 0; i < 16; i++)
+			mean[c] += block[i][c];
+
+		mean[c] /= 16.0f;
+	}
+
+	float covariance[3][3] = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
+	for (int i = 0; i < 16; i++) {
+		const float d[3] = { block[i][0] - mean[0], block[i][1] - mean[1], block[i][2] - mean[2] };
+
+		for (int r = 0; r < 3; r++)
+			for (int c = 0; c < 3; c++)
+				covariance[r][c] += d[r] * d[c];
+	}
+
+	/* Power iteration, starting with the row of the channel that varies the
+	 * most. That row can't be orthogonal to the principal axis. */
+	int start = 0;
+	for (int c = 1; c < 3; c++)
+		if (covariance[c][c] > covariance[start][start])
+			start = c;
+
+	for (int c = 0; c < 3; c++)
+		axis[c] = covariance[start][c];
+
+	for (int i = 0; i < 8; i++) {
+		float next[3];
+		for (int r = 0; r < 3; r++)
+			next[r] = covariance[r][0] * axis[0] + covariance[r][1] * axis[1] + covariance[r][2] * axis[2];
+
+		const float scale = MAX(MAX(ABS(next[0]), ABS(next[1])), ABS(next[2]));
+		if (scale <= FLT_EPSILON) {
+			// All pixels have the same color
+			axis[0] = axis[1] = axis[2] = 0.0f;
+			return;
+		}
+
+		for (int c = 0; c < 3; c++)
+			axis[c] = next[c] / scale;
+	}
+
+	const float length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+	for (int c = 0; c < 3; c++)
+		axis[c] /= length;
+}
+
+/** Quantize an 8-bit channel value into the bits an endpoint stores.
+ *
+ *  The decoder expands the 5 or 6 stored bits by shifting them up, without
+ *  replicating the high bits into the low ones, so round to that grid.
+ */
+static int quantizeChannel(float value, int shift, int max) {
+	return CLIP<int>((int) (value / (1 << shift) + 0.5f), 0, max);
+}
+
+static uint16 convertToColor565(const float (&color)[3]) {
+	return (quantizeChannel(color[0], 3, 31) << 11) |
+	       (quantizeChannel(color[1], 2, 63) <<  5) |
+	        quantizeChannel(color[2], 3, 31);
+}
 
-static uint64 readUint48LE(Common::SeekableReadStream &src) {
-	uint64 output = src.readUint32LE();
-	return output | ((uint64)src.readUint16LE() << 32);
-}
-
-#define READ_DXT5_TEXEL(x) \
-	x.alpha_0 = src.readByte(); \
-	x.alpha_1 = src.readByte(); \
-	x.alphabl = readUint48LE(src); \
-	READ_DXT1_TEXEL(x)
-
-void decompressDXT5(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch) {
-	for (int32 ty = height; ty > 0; ty -= 4) {
-		for (uint32 tx = 0; tx < width; tx += 4) {
-			uint32 blended[4];
-			byte alphab[8];
-			DXT45Texel tex;
-			READ_DXT5_TEXEL(tex);
-
-			alphab[0] = tex.alpha_0;
-			alphab[1] = tex.alpha_1;
-
-			if (tex.alpha_0 > tex.alpha_1) {
-				alphab[2] = (byte)((6.0f * (double)alphab[0] + 1.0f * (double)alphab[1] + 3.0f) / 7.0f);
-				alphab[3] = (byte)((5.0f * (double)alphab[0] + 2.0f * (double)alphab[1] + 3.0f) / 7.0f);
-				alphab[4] = (byte)((4.0f * (double)alphab[0] + 3.0f * (double)alphab[1] + 3.0f) / 7.0f);
-				alphab[5] = (byte)((3.0f * (double)alphab[0] + 4.0f * (double)alphab[1] + 3.0f) / 7.0f);
-				alphab[6] = (byte)((2.0f * (double)alphab[0] + 5.0f * (double)alphab[1] + 3.0f) / 7.0f);
-				alphab[7] = (byte)((1.0f * (double)alphab[0] + 6.0f * (double)alphab[1] + 3.0f) / 7.0f);
-			} else {
-				alphab[2] = (byte)((4.0f * (double)alphab[0] + 1.0f * (double)alphab[1] + 2.0f) / 5.0f);
-				alphab[3] = (byte)((3.0f * (double)alphab[0] + 2.0f * (double)alphab[1] + 2.0f) / 5.0f);
-				alphab[4] = (byte)((2.0f * (double)alphab[0] + 3.0f * (double)alphab[1] + 2.0f) / 5.0f);
-				alphab[5] = (byte)((1.0f * (double)alphab[0] + 4.0f * (double)alphab[1] + 2.0f) / 5.0f);
-				alphab[6] = 0;
-				alphab[7] = 255;
+static uint32 getColorError(const byte *a, const byte *b) {
+	const int dR = a[0] - b[0];
+	const int dG = a[1] - b[1];
+	const int dB = a[2] - b[2];
+
+	return dR * dR + dG * dG + dB * dB;
+}
+
+/** Find the best color indices for a block with these two endpoints.
+ *
+ *  The endpoints are ordered so that the block is decoded in four color
+ *  mode, and the colors are interpolated exactly the way readColors() does.
+ *  The indices are stored with 2 bits per pixel in row-major order.
+ *
+ *  @return The sum of the squared errors of all pixels.
+ */
+static uint32 fitColorIndices(const byte (&block)[16][4], uint16 &color0, uint16 &color1, uint32 &indices) {
+	if (color0 < color1)
+		SWAP(color0, color1);
+
+	byte endpoints[4];
+	WRITE_LE_UINT16(endpoints    , color0);
+	WRITE_LE_UINT16(endpoints + 2, color1);
+
+	byte colors[4][4];
+	readColors(colors, endpoints, true, 0xFF);
+
+	// With equal endpoints, only the first color is safe to use in DXT1
+	const int colorCount = (color0 == color1) ? 1 : 4;
+
+	uint32 error = 0;
+
+	indices = 0;
+	for (int i = 0; i < 16; i++) {
+		uint32 bestError = getColorError(block[i], colors[0]);
+		int    bestIndex = 0;
+
+		for (int j = 1; j < colorCount; j++) {
+			const uint32 colorError = getColorError(block[i], colors[j]);
+			if (colorError < bestError) {
+				bestError = colorError;
+				bestIndex = j;
 			}
+		}
+
+		indices |= bestIndex << (2 * i);
+		error   += bestError;
+	}
+
+	return error;
+}
+
+/** Range fit: take the colors at the ends of the block's principal axis as the endpoints. */
+static uint32 fitColorsRange(const byte (&block)[16][4], uint16 &color0, uint16 &color1, uint32 &indices) {
+	float mean[3], axis[3];
+	findPrincipalAxis(block, mean, axis);
+
+	float minProjection = 0.0f, maxProjection = 0.0f;
+	for (int i = 0; i < 16; i++) {
+		const float projection = (block[i][0] - mean[0]) * axis[0] +
+		                         (block[i][1] - mean[1]) * axis[1] +
+		                         (block[i][2] - mean[2]) * axis[2];
+
+		minProjection = MIN(minProjection, projection);
+		maxProjection = MAX(maxProjection, projection);
+	}
 
-			blended[0] = convert565To8888(tex.color_0) & 0xFFFFFF00;
-			blended[1] = convert565To8888(tex.color_1) & 0xFFFFFF00;
-			blended[2] = interpolate32(0.333333f, blended[0], blended[1]);
-			blended[3] = interpolate32(0.666666f, blended[0], blended[1]);
+	float start[3], end[3];
+	for (int c = 0; c < 3; c++) {
+		start[c] = mean[c] + axis[c] * minProjection;
+		end  [c] = mean[c] + axis[c] * maxProjection;
+	}
+
+	color0 = convertToColor565(end);
+	color1 = convertToColor565(start);
+
+	return fitColorIndices(block, color0, color1, indices);
+}
 
-			uint32 cpx = tex.pixels;
-			uint32 blockWidth = MIN<uint32>(width, 4);
-			uint32 blockHeight = MIN<uint32>(height, 4);
+/** Round an endpoint channel onto the grid of values the decoder can produce. */
+static float snapChannel(float value, int shift, int max) {
+	return (float) (quantizeChannel(value, shift, max) << shift);
+}
+
+/** Cluster fit: sort the pixels along the principal axis, and try every way
+ *  to split them into the four clusters of the palette. For each split, the
+ *  endpoints are solved for by least squares, and the split with the least
+ *  error wins. The range fit result is kept if it's better still.
+ */
+static uint32 fitColorsCluster(const byte (&block)[16][4], uint16 &color0, uint16 &color1, uint32 &indices) {
+	uint32 error = fitColorsRange(block, color0, color1, indices);
+	if (error == 0)
+		return 0;
+
+	float mean[3], axis[3];
+	findPrincipalAxis(block, mean, axis);
+
+	// Sort the pixels by their projection onto the axis
+	int   order[16];
+	float projections[16];
+	for (int i = 0; i < 16; i++) {
+		const float projection = block[i][0] * axis[0] + block[i][1] * axis[1] + block[i][2] * axis[2];
+
+		int j = i;
+		for (; (j > 0) && (projections[j - 1] > projection); j--) {
+			projections[j] = projections[j - 1];
+			order      [j] = order      [j - 1];
+		}
 
-			for (byte y = 0; y < blockHeight; ++y) {
-				for (byte x = 0; x < blockWidth; ++x) {
-					const uint32 destX = tx + x;
-					const uint32 destY = height - 1 - (ty - blockHeight + y);
+		projections[j] = projection;
+		order      [j] = i;
+	}
 
-					const uint32 alpha = alphab[(tex.alphabl >> (3 * (4 * (3 - y) + x))) & 7];
-					const uint32 pixel = blended[cpx & 3] | alpha;
+	float sums[17][3];
+	sums[0][0] = sums[0][1] = sums[0][2] = 0.0f;
+	for (int i = 0; i < 16; i++)
+		for (int c = 0; c < 3; c++)
+			sums[i + 1][c] = sums[i][c] + block[order[i]][c];
+
+	static const int kShift[3] = {  3,  2,  3 };
+	static const int kMax  [3] = { 31, 63, 31 };
+
+	float bestError = FLT_MAX;
+	float best0[3] = { 0.0f, 0.0f, 0.0f };
+	float best1[3] = { 0.0f, 0.0f, 0.0f };
+
+	/* The first i pixels are weighted fully towards endpoint 0, the pixels up
+	 * to j by 2/3, those up to k by 1/3, and the rest are on endpoint 1. */
+	for (int i = 0; i <= 16; i++) {
+		for (int j = i; j <= 16; j++) {
+			for (int k = j; k <= 16; k++) {
+				const float n0 = (float) (i);
+				const float n1 = (float) (j - i);
+				const float n2 = (float) (k - j);
+				const float n3 = (float) (16 - k);
+
+				const float alpha2      = n0 + (4.0f * n1 + n2) / 9.0f;
+				const float beta2       = n3 + (n1 + 4.0f * n2) / 9.0f;
+				const float alphaBeta   = 2.0f * (n1 + n2) / 9.0f;
+				const float determinant = alpha2 * beta2 - alphaBeta * alphaBeta;
+
+				if (determinant <= FLT_EPSILON)
+					continue;
+
+				const float factor = 1.0f / determinant;
+
+				float clusterError = 0.0f;
+				float end0[3], end1[3];
+
+				for (int c = 0; c < 3; c++) {
+					const float s0 = sums[i][c];
+					const float s1 = sums[j][c] - sums[i][c];
+					const float s2 = sums[k][c] - sums[j][c];
+					const float s3 = sums[16][c] - sums[k][c];
+
+					const float alphaX = s0 + (2.0f * s1 + s2) / 3.0f;
+					const float betaX  = s3 + (s1 + 2.0f * s2) / 3.0f;
+
+					end0[c] = snapChannel((alphaX * beta2 - betaX * alphaBeta) * factor, kShift[c], kMax[c]);
+					end1[c] = snapChannel((betaX * alpha2 - alphaX * alphaBeta) * factor, kShift[c], kMax[c]);
+
+					// The squared error, minus the constant sum of the squared pixel values
+					clusterError += alpha2 * end0[c] * end0[c] + beta2 * end1[c] * end1[c] +
+					                2.0f * (alphaBeta * end0[c] * end1[c] - alphaX * end0[c] - betaX * end1[c]);
+				}
 
-					cpx >>= 2;
+				if (clusterError < bestError) {
+					bestError = clusterError;
 
-					if ((destX < width) && (destY < height))
-						WRITE_BE_UINT32(dest + destY * pitch + destX * 4, pixel);
+					std::memcpy(best0, end0, sizeof(best0));
+					std::memcpy(best1, end1, sizeof(best1));
 				}
 			}
 		}
 	}
+
+	if (bestError == FLT_MAX)
+		return error;
+
+	uint16 clusterColor0 = convertToColor565(best0);
+	uint16 clusterColor1 = convertToColor565(best1);
+	uint32 clusterIndices;
+
+	const uint32 clusterError = fitColorIndices(block, clusterColor0, clusterColor1, clusterIndices);
+	if (clusterError < error) {
+		color0  = clusterColor0;
+		color1  = clusterColor1;
+		indices = clusterIndices;
+
+		error = clusterError;
+	}
+
+	return error;
+}
+
+/** Find the best alpha indices for a DXT5 block with these two endpoints.
+ *
+ *  The indices are stored with 3 bits per pixel in row-major order.
+ *
+ *  @return The sum of the squared errors of all pixels.
+ */
+static uint32 fitAlphaIndices(const byte (&block)[16][4], byte alpha0, byte alpha1, uint64 &indices) {
+	const byte endpoints[2] = { alpha0, alpha1 };
+
+	byte alphas[8];
+	readAlphas(alphas, endpoints);
+
+	uint32 error = 0;
+
+	indices = 0;
+	for (int i = 0; i < 16; i++) {
+		uint32 bestError = 0xFFFFFFFF;
+		int    bestIndex = 0;
+
+		for (int j = 0; j < 8; j++) {
+			const int    difference = block[i][3] - alphas[j];
+			const uint32 alphaError = difference * difference;
+
+			if (alphaError < bestError) {
+				bestError = alphaError;
+				bestIndex = j;
+			}
+		}
+
+		indices |= (uint64) bestIndex << (3 * i);
+		error   += bestError;
+	}
+
+	return error;
+}
+
+/** Find the alpha endpoints and indices of a DXT5 block.
+ *
+ *  The range of the block's alpha values is spread over eight steps. With
+ *  high quality, six steps between the values other than 0 and 255 are
+ *  tried as well, with the explicit 0 and 255 of the second mode.
+ */
+static void fitAlphas(const byte (&block)[16][4], S3TCQuality quality,
+                      byte &alpha0, byte &alpha1, uint64 &indices) {
+
+	byte minAlpha = 255, maxAlpha = 0;
+	byte minInner = 255, maxInner = 0;
+	for (int i = 0; i < 16; i++) {
+		const byte alpha = block[i][3];
+
+		minAlpha = MIN(minAlpha, alpha);
+		maxAlpha = MAX(maxAlpha, alpha);
+
+		if ((alpha != 0) && (alpha != 255)) {
+			minInner = MIN(minInner, alpha);
+			maxInner = MAX(maxInner, alpha);
+		}
+	}
+
+	alpha0 = maxAlpha;
+	alpha1 = minAlpha;
+
+	const uint32 error = fitAlphaIndices(block, alpha0, alpha1, indices);
+	if ((error == 0) || (quality != kS3TCQualityHigh))
+		return;
+
+	if (minInner > maxInner)
+		minInner = maxInner = 0;
+
+	uint64 innerIndices;
+	if (fitAlphaIndices(block, minInner, maxInner, innerIndices) < error) {
+		alpha0  = minInner;
+		alpha1  = maxInner;
+		indices = innerIndices;
+	}
+}
+
+/** Reorder row-major color indices the way decompressSmall() reads them. */
+static uint32 reorderSmallColorIndices(uint32 indices, uint32 blockWidth, uint32 blockHeight) {
+	uint32 smallIndices = 0;
+
+	for (uint32 y = 0; y < blockHeight; y++) {
+		for (uint32 x = 0; x < blockWidth; x++) {
+			const uint32 index = (indices >> (2 * ((blockHeight - 1 - y) * 4 + x))) & 3;
+
+			smallIndices |= index << (2 * (y * blockWidth + x));
+		}
+	}
+
+	return smallIndices;
+}
+
+/** Reorder row-major alpha indices the way decompressSmall() reads them. */
+static uint64 reorderSmallAlphaIndices(uint64 indices, uint32 blockWidth, uint32 blockHeight) {
+	uint64 smallIndices = 0;
+
+	for (uint32 y = 0; y < blockHeight; y++) {
+		for (uint32 x = 0; x < blockWidth; x++) {
+			const uint64 index = (indices >> (3 * (y * 4 + x))) & 7;
+
+			smallIndices |= index << (3 * (4 * (y + 4 - blockHeight) + x));
+		}
+	}
+
+	return smallIndices;
+}
+
+static void compress(byte *dest, const byte *src, uint32 width, uint32 height, uint32 pitch,
+                     S3TCQuality quality, uint32 top, uint32 bottom, DXTFormat format) {
+
+	if (((top % 4) != 0) || (bottom > height))
+		throw Common::Exception("Invalid row range %u-%u for a %ux%u DXT image", top, bottom, width, height);
+
+	if ((width == 0) || (height == 0))
+		return;
+
+	const uint32 blockSize = (format == kDXT1) ? 8 : 16;
+	const uint32 blocksX   = (width + 3) / 4;
+
+	// Skip the blocks above the first row
+	dest += (size_t) (top / 4) * blocksX * blockSize;
+
+	const bool   isSmall     = (width < 4) || (height < 4);
+	const uint32 blockWidth  = MIN<uint32>(width , 4);
+	const uint32 blockHeight = MIN<uint32>(height, 4);
+
+	for (uint32 y = top; y < bottom; y += 4) {
+		for (uint32 x = 0; x < width; x += 4, dest += blockSize) {
+			byte block[16][4];
+			readBlock(block, src, width, height, pitch, x, y);
+
+			byte *colorDest = dest;
+
+			if (format == kDXT5) {
+				byte alpha0, alpha1;
+				uint64 alphaIndices;
+				fitAlphas(block, quality, alpha0, alpha1, alphaIndices);
+
+				if (isSmall)
+					alphaIndices = reorderSmallAlphaIndices(alphaIndices, blockWidth, blockHeight);
+
+				dest[0] = alpha0;
+				dest[1] = alpha1;
+				WRITE_LE_UINT32(dest + 2, (uint32) alphaIndices);
+				WRITE_LE_UINT16(dest + 6, (uint16) (alphaIndices >> 32));
+
+				colorDest += 8;
+			}
+
+			uint16 color0, color1;
+			uint32 colorIndices;
+			if (quality == kS3TCQualityHigh)
+				fitColorsCluster(block, color0, color1, colorIndices);
+			else
+				fitColorsRange(block, color0, color1, colorIndices);
+
+			WRITE_LE_UINT16(colorDest    , color0);
+			WRITE_LE_UINT16(colorDest + 2, color1);
+
+			if (isSmall)
+				WRITE_BE_UINT32(colorDest + 4, reorderSmallColorIndices(colorIndices, blockWidth, blockHeight));
+			else
+				WRITE_LE_UINT32(colorDest + 4, colorIndices);
+		}
+	}
+}
+
+void compressDXT1(byte *dest, const byte *src, uint32 width, uint32 height, uint32 pitch,
+                  S3TCQuality quality) {
+
+	compress(dest, src, width, height, pitch, quality, 0, height, kDXT1);
+}
+
+void compressDXT5(byte *dest, const byte *src, uint32 width, uint32 height, uint32 pitch,
+                  S3TCQuality quality) {
+
+	compress(dest, src, width, height, pitch, quality, 0, height, kDXT5);
+}
+
+void compressDXT1(byte *dest, const byte *src, uint32 width, uint32 height, uint32 pitch,
+                  S3TCQuality quality, uint32 top, uint32 bottom) {
+
+	compress(dest, src, width, height, pitch, quality, top, bottom, kDXT1);
+}
+
+void compressDXT5(byte *dest, const byte *src, uint32 width, uint32 height, uint32 pitch,
+                  S3TCQuality quality, uint32 top, uint32 bottom) {
+
+	compress(dest, src, width, height, pitch, quality, top, bottom, kDXT5);
 }
 
 } // End of namespace Images
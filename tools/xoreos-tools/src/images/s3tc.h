@@ -19,7 +19,7 @@
  */
 
 /** @file
- *  Manual S3TC DXTn decompression methods.
+ *  Manual S3TC DXTn decompression and compression methods.
  */
 
 #ifndef IMAGES_S3TC_H
@@ -27,15 +27,80 @@
 
 #include "src/common/types.h"
 
-namespace Common {
-	class SeekableReadStream;
-}
+#include "src/images/types.h"
 
 namespace Images {
 
-void decompressDXT1(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch);
-void decompressDXT3(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch);
-void decompressDXT5(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch);
+/** Decompress DXT1 data into R8G8B8A8 pixels.
+ *
+ *  @param dest   The buffer to write the decompressed pixels into.
+ *  @param src    The compressed data, 8 bytes for each block of 4x4 pixels.
+ *  @param size   The size of the compressed data in bytes.
+ *  @param width  The width of the image in pixels.
+ *  @param height The height of the image in pixels.
+ *  @param pitch  The size of a row of decompressed pixels in bytes.
+ */
+void decompressDXT1(byte *dest, const byte *src, size_t size, uint32 width, uint32 height, uint32 pitch);
+
+/** Decompress DXT3 data into R8G8B8A8 pixels.
+ *
+ *  Same as decompressDXT1(), with 16 bytes for each block of 4x4 pixels.
+ */
+void decompressDXT3(byte *dest, const byte *src, size_t size, uint32 width, uint32 height, uint32 pitch);
+
+/** Decompress DXT5 data into R8G8B8A8 pixels.
+ *
+ *  Same as decompressDXT1(), with 16 bytes for each block of 4x4 pixels.
+ */
+void decompressDXT5(byte *dest, const byte *src, size_t size, uint32 width, uint32 height, uint32 pitch);
+
+/** Decompress only the pixel rows from top up to, but not including, bottom.
+ *
+ *  dest and src still point to the start of the whole image. top needs to
+ *  be a multiple of 4, the height of a block. Different row ranges of the
+ *  same image can be decompressed concurrently.
+ */
+void decompressDXT1(byte *dest, const byte *src, size_t size, uint32 width, uint32 height, uint32 pitch,
+                    uint32 top, uint32 bottom);
+void decompressDXT3(byte *dest, const byte *src, size_t size, uint32 width, uint32 height, uint32 pitch,
+                    uint32 top, uint32 bottom);
+void decompressDXT5(byte *dest, const byte *src, size_t size, uint32 width, uint32 height, uint32 pitch,
+                    uint32 top, uint32 bottom);
+
+/** Compress R8G8B8A8 pixels into DXT1 data.
+ *
+ *  DXT1 can't store an alpha channel, so it is ignored. Images narrower
+ *  or lower than a single block are stored the way decompressDXT1() reads
+ *  them back.
+ *
+ *  @param dest    The buffer to write the compressed data into, 8 bytes for
+ *                 each block of 4x4 pixels.
+ *  @param src     The pixels to compress.
+ *  @param width   The width of the image in pixels.
+ *  @param height  The height of the image in pixels.
+ *  @param pitch   The size of a row of pixels in bytes.
+ *  @param quality How thoroughly to search for the best encoding.
+ */
+void compressDXT1(byte *dest, const byte *src, uint32 width, uint32 height, uint32 pitch,
+                  S3TCQuality quality);
+
+/** Compress R8G8B8A8 pixels into DXT5 data.
+ *
+ *  Same as compressDXT1(), with 16 bytes for each block of 4x4 pixels.
+ */
+void compressDXT5(byte *dest, const byte *src, uint32 width, uint32 height, uint32 pitch,
+                  S3TCQuality quality);
+
+/** Compress only the pixel rows from top up to, but not including, bottom.
+ *
+ *  dest and src still point to the start of the whole image. top needs to
+ *  be a multiple of 4, the height of a block. Different row ranges of the
+ *  same image can be compressed concurrently.
+ */
+void compressDXT1(byte *dest, const byte *src, uint32 width, uint32 height, uint32 pitch,
+                  S3TCQuality quality, uint32 top, uint32 bottom);
+void compressDXT5(byte *dest, const byte *src, uint32 width, uint32 height, uint32 pitch,
+                  S3TCQuality quality, uint32 top, uint32 bottom);
 
 } // End of namespace Images
 
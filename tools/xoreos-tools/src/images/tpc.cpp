@@ -39,7 +39,8 @@ static const byte kEncodingSwizzledBGRA = 0x0C;
 
 namespace Images {
 
-TPC::TPC(Common::SeekableReadStream &tpc) : _txiData(0), _txiDataSize(0) {
+TPC::TPC(Common::SeekableReadStream &tpc, const DecodeOptions &options) : Decoder(options),
+	_txiData(0), _txiDataSize(0) {
 	load(tpc);
 }
 
@@ -56,7 +57,10 @@ void TPC::load(Common::SeekableReadStream &tpc) {
 		readData   (tpc, encoding);
 		readTXIData(tpc);
 
+		removeSkippedMipMaps(!isCubeMap() && _options.hasArea());
+
 		fixupCubeMap();
+		selectCubeMapSides();
 
 	} catch (Common::Exception &e) {
 		e.add("Failed reading TPC file");
@@ -254,27 +258,29 @@ bool TPC::checkCubeMap(uint32 &width, uint32 &height) {
 	return true;
 }
 
-void TPC::deSwizzle(byte *dst, const byte *src, uint32 width, uint32 height) {
-	for (uint32 y = 0; y < height; y++) {
-		for (uint32 x = 0; x < width; x++) {
-			const uint32 offset = deSwizzleOffset(x, y, width, height) * 4;
-
-			*dst++ = src[offset + 0];
-			*dst++ = src[offset + 1];
-			*dst++ = src[offset + 2];
-			*dst++ = src[offset + 3];
-		}
-	}
-}
-
 void TPC::readData(Common::SeekableReadStream &tpc, byte encoding) {
+	const size_t mipMapCount = getMipMapCount();
+
 	for (std::vector<MipMap *>::iterator mipMap = _mipMaps.begin(); mipMap != _mipMaps.end(); ++mipMap) {
+		const size_t layer = (mipMap - _mipMaps.begin()) / mipMapCount;
+		const size_t level = (mipMap - _mipMaps.begin()) % mipMapCount;
+
+		// Cube map sides are only put into their final order later, so all of them are read
+		if (!isMipMapWanted(level) || (!isCubeMap() && !isLayerWanted(layer))) {
+			tpc.skip((*mipMap)->size);
+			continue;
+		}
 
 		// If the texture width is a power of two, the texture memory layout is "swizzled"
 		const bool widthPOT = ((*mipMap)->width & ((*mipMap)->width - 1)) == 0;
 		const bool swizzled = (encoding == kEncodingSwizzledBGRA) && widthPOT;
 
-		(*mipMap)->data = new byte[(*mipMap)->size];
+		if (!swizzled && (encoding != kEncodingGray) && !isCubeMap()) {
+			readMipMap(tpc, **mipMap, level - _options.firstMipMap);
+			continue;
+		}
+
+		(*mipMap)->allocate((*mipMap)->size);
 
 		if (swizzled) {
 			std::vector<byte> tmp((*mipMap)->size);
@@ -283,6 +289,7 @@ void TPC::readData(Common::SeekableReadStream &tpc, byte encoding) {
 				throw Common::Exception(Common::kReadError);
 
 			deSwizzle((*mipMap)->data, &tmp[0], (*mipMap)->width, (*mipMap)->height);
+			_bytesCopied += (*mipMap)->size;
 
 		} else {
 			if (tpc.read((*mipMap)->data, (*mipMap)->size) != (*mipMap)->size)
@@ -290,18 +297,21 @@ void TPC::readData(Common::SeekableReadStream &tpc, byte encoding) {
 
 			// Unpacking 8bpp grayscale data into RGB
 			if (encoding == kEncodingGray) {
-				byte *dataGray = (*mipMap)->data;
+				MipMap rgb;
 
-				(*mipMap)->size = (*mipMap)->width * (*mipMap)->height * 3;
-				(*mipMap)->data = new byte[(*mipMap)->size];
+				rgb.width  = (*mipMap)->width;
+				rgb.height = (*mipMap)->height;
+				rgb.allocate(rgb.width * rgb.height * 3);
 
-				for (int i = 0; i < ((*mipMap)->width * (*mipMap)->height); i++)
-					std::memset((*mipMap)->data + i * 3, dataGray[i], 3);
+				for (int i = 0; i < (rgb.width * rgb.height); i++)
+					std::memset(rgb.data + i * 3, (*mipMap)->data[i], 3);
 
-				delete[] dataGray;
+				rgb.swap(**mipMap);
 			}
 		}
 
+		if (!isCubeMap() && _options.hasArea())
+			cropMipMap(**mipMap, level - _options.firstMipMap);
 	}
 }
 
@@ -377,4 +387,30 @@ void TPC::fixupCubeMap() {
 	}
 }
 
+void TPC::selectCubeMapSides() {
+	/* Now that the cube sides are in their final order, remove the ones that
+	 * weren't asked for, and crop the rest to the decode area. */
+
+	if (!isCubeMap())
+		return;
+
+	for (size_t i = 0; i < getLayerCount(); i++) {
+		for (size_t j = 0; j < getMipMapCount(); j++) {
+			MipMap &mipMap = *_mipMaps[i * getMipMapCount() + j];
+
+			if (!isLayerWanted(i)) {
+				MipMap skipped;
+				skipped.swap(mipMap);
+
+				continue;
+			}
+
+			if (_options.hasArea())
+				cropMipMap(mipMap, j);
+		}
+	}
+
+	removeSkippedMipMaps(_options.hasArea());
+}
+
 } // End of namespace Images
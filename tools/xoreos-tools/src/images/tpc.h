@@ -36,7 +36,7 @@ namespace Images {
 /** BioWare's own texture format, TPC. */
 class TPC : public Decoder {
 public:
-	TPC(Common::SeekableReadStream &tpc);
+	TPC(Common::SeekableReadStream &tpc, const DecodeOptions &options = DecodeOptions());
 	~TPC();
 
 	/** Return the enclosed TXI data. */
@@ -54,8 +54,7 @@ private:
 
 	bool checkCubeMap(uint32 &width, uint32 &height);
 	void fixupCubeMap();
-
-	static void deSwizzle(byte *dst, const byte *src, uint32 width, uint32 height);
+	void selectCubeMapSides();
 };
 
 } // End of namespace Images
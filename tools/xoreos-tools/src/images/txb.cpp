@@ -35,7 +35,8 @@ static const byte kEncodingDXT5 = 0x0C;
 
 namespace Images {
 
-TXB::TXB(Common::SeekableReadStream &txb) : _dataSize(0), _txiData(0), _txiDataSize(0) {
+TXB::TXB(Common::SeekableReadStream &txb, const DecodeOptions &options) : Decoder(options),
+	_dataSize(0), _txiData(0), _txiDataSize(0) {
 	load(txb);
 
 	// In xoreos-tools, we always want decompressed images
@@ -54,6 +55,8 @@ void TXB::load(Common::SeekableReadStream &txb) {
 		readHeader(txb, needDeSwizzle);
 		readData  (txb, needDeSwizzle);
 
+		removeSkippedMipMaps(_options.hasArea());
+
 		txb.seek(_dataSize + 128);
 
 		readTXIData(txb);
@@ -182,41 +185,37 @@ void TXB::readHeader(Common::SeekableReadStream &txb, bool &needDeSwizzle) {
 		throw Common::Exception("Couldn't read any mip maps");
 }
 
-void TXB::deSwizzle(byte *dst, const byte *src, uint32 width, uint32 height) {
-	for (uint32 y = 0; y < height; y++) {
-		for (uint32 x = 0; x < width; x++) {
-			const uint32 offset = deSwizzleOffset(x, y, width, height) * 4;
-
-			*dst++ = src[offset + 0];
-			*dst++ = src[offset + 1];
-			*dst++ = src[offset + 2];
-			*dst++ = src[offset + 3];
-		}
-	}
-}
-
 void TXB::readData(Common::SeekableReadStream &txb, bool needDeSwizzle) {
 	for (std::vector<MipMap *>::iterator mipMap = _mipMaps.begin(); mipMap != _mipMaps.end(); ++mipMap) {
+		const size_t level = mipMap - _mipMaps.begin();
+
+		// TXB files only have a single layer
+		if (!isMipMapWanted(level) || !isLayerWanted(0)) {
+			txb.skip((*mipMap)->size);
+			continue;
+		}
 
 		// If the texture width is a power of two, the texture memory layout is "swizzled"
 		const bool widthPOT = ((*mipMap)->width & ((*mipMap)->width - 1)) == 0;
 		const bool swizzled = needDeSwizzle && widthPOT;
 
-		(*mipMap)->data = new byte[(*mipMap)->size];
+		if (!swizzled) {
+			readMipMap(txb, **mipMap, level - _options.firstMipMap);
+			continue;
+		}
 
-		if (swizzled) {
-			std::vector<byte> tmp((*mipMap)->size);
+		(*mipMap)->allocate((*mipMap)->size);
 
-			if (txb.read(&tmp[0], (*mipMap)->size) != (*mipMap)->size)
-				throw Common::Exception(Common::kReadError);
+		std::vector<byte> tmp((*mipMap)->size);
 
-			deSwizzle((*mipMap)->data, &tmp[0], (*mipMap)->width, (*mipMap)->height);
+		if (txb.read(&tmp[0], (*mipMap)->size) != (*mipMap)->size)
+			throw Common::Exception(Common::kReadError);
 
-		} else {
-			if (txb.read((*mipMap)->data, (*mipMap)->size) != (*mipMap)->size)
-				throw Common::Exception(Common::kReadError);
-		}
+		deSwizzle((*mipMap)->data, &tmp[0], (*mipMap)->width, (*mipMap)->height);
+		_bytesCopied += (*mipMap)->size;
 
+		if (_options.hasArea())
+			cropMipMap(**mipMap, level - _options.firstMipMap);
 	}
 }
 
@@ -36,7 +36,7 @@ namespace Images {
 /** Another one of BioWare's own texture formats, TXB. */
 class TXB : public Decoder {
 public:
-	TXB(Common::SeekableReadStream &txb);
+	TXB(Common::SeekableReadStream &txb, const DecodeOptions &options = DecodeOptions());
 	~TXB();
 
 	/** Return the enclosed TXI data. */
@@ -53,8 +53,6 @@ private:
 	void readHeader(Common::SeekableReadStream &txb, bool &needDeSwizzle);
 	void readData(Common::SeekableReadStream &txb, bool needDeSwizzle);
 	void readTXIData(Common::SeekableReadStream &txb);
-
-	static void deSwizzle(byte *dst, const byte *src, uint32 width, uint32 height);
 };
 
 } // End of namespace Images
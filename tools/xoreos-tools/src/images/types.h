@@ -45,6 +45,22 @@ enum PixelFormat {
 	kPixelFormatDXT5
 };
 
+/** How thoroughly to search for the best encoding when compressing into S3TC. */
+enum S3TCQuality {
+	kS3TCQualityFast, ///< Range fit: spread the colors between the ends of their principal axis.
+	kS3TCQualityHigh  ///< Cluster fit: try every split of the colors along their principal axis.
+};
+
+/** How to filter the rows of a PNG before compressing them. */
+enum PNGFilter {
+	kPNGFilterNone,    ///< Leave the rows unfiltered.
+	kPNGFilterSub,     ///< Difference to the pixel to the left.
+	kPNGFilterUp,      ///< Difference to the pixel above.
+	kPNGFilterAverage, ///< Difference to the average of the pixels to the left and above.
+	kPNGFilterPaeth,   ///< Difference to the Paeth predictor of the left, above and upper left pixels.
+	kPNGFilterAdaptive ///< For each row, pick the filter with the smallest sum of absolute differences.
+};
+
 } // End of namespace Images
 
 #endif // IMAGES_TYPES_H
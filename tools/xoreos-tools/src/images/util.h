@@ -28,6 +28,9 @@
 #include <cassert>
 #include <cstring>
 
+#include <vector>
+#include <algorithm>
+
 #include "src/common/types.h"
 #include "src/common/util.h"
 #include "src/common/maths.h"
@@ -117,7 +120,7 @@ static inline bool hasValidDimensions(PixelFormat format, int32 width, int32 hei
 	return false;
 }
 
-/** Flip an image horizontally. */
+/** Flip an image horizontally, in place. */
 static inline void flipHorizontally(byte *data, int width, int height, int bpp) {
 	if ((width <= 0) || (height <= 0) || (bpp <= 0))
 		return;
@@ -125,16 +128,12 @@ static inline void flipHorizontally(byte *data, int width, int height, int bpp)
 	const size_t halfWidth = width / 2;
 	const size_t pitch     = bpp * width;
 
-	byte *buffer = new byte[bpp];
-
 	while (height-- > 0) {
 		byte *dataStart = data;
 		byte *dataEnd   = data + pitch - bpp;
 
 		for (size_t j = 0; j < halfWidth; j++) {
-			std::memcpy(buffer   , dataStart, bpp);
-			std::memcpy(dataStart, dataEnd  , bpp);
-			std::memcpy(dataEnd  , buffer   , bpp);
+			std::swap_ranges(dataStart, dataStart + bpp, dataEnd);
 
 			dataStart += bpp;
 			dataEnd   -= bpp;
@@ -142,11 +141,9 @@ static inline void flipHorizontally(byte *data, int width, int height, int bpp)
 
 		data += pitch;
 	}
-
-	delete[] buffer;
 }
 
-/** Flip an image vertically. */
+/** Flip an image vertically, in place. */
 static inline void flipVertically(byte *data, int width, int height, int bpp) {
 	if ((width <= 0) || (height <= 0) || (bpp <= 0))
 		return;
@@ -156,19 +153,13 @@ static inline void flipVertically(byte *data, int width, int height, int bpp) {
 	byte *dataStart = data;
 	byte *dataEnd   = data + (pitch * height) - pitch;
 
-	byte *buffer = new byte[pitch];
-
 	size_t halfHeight = height / 2;
 	while (halfHeight--) {
-		std::memcpy(buffer   , dataStart, pitch);
-		std::memcpy(dataStart, dataEnd  , pitch);
-		std::memcpy(dataEnd  , buffer   , pitch);
+		std::swap_ranges(dataStart, dataStart + pitch, dataEnd);
 
 		dataStart += pitch;
 		dataEnd   -= pitch;
 	}
-
-	delete[] buffer;
 }
 
 /** Rotate a square image in 90° steps. */
@@ -236,6 +227,32 @@ static inline uint32 deSwizzleOffset(uint32 x, uint32 y, uint32 width, uint32 he
 	return offset;
 }
 
+/** De-"swizzle" a whole texture with 4 bytes per pixel.
+ *
+ *  The swizzled offset interleaves the bits of the x and y coordinates, so
+ *  it is the bitwise or of a part that only depends on x and a part that
+ *  only depends on y. Both parts are looked up in tables, built once for
+ *  each texture, instead of interleaving the bits again for every pixel.
+ */
+static inline void deSwizzle(byte *dst, const byte *src, uint32 width, uint32 height) {
+	if ((width == 0) || (height == 0))
+		return;
+
+	std::vector<uint32> xOffsets(width), yOffsets(height);
+
+	for (uint32 x = 0; x < width; x++)
+		xOffsets[x] = deSwizzleOffset(x, 0, width, height) * 4;
+	for (uint32 y = 0; y < height; y++)
+		yOffsets[y] = deSwizzleOffset(0, y, width, height) * 4;
+
+	for (uint32 y = 0; y < height; y++) {
+		const uint32 yOffset = yOffsets[y];
+
+		for (uint32 x = 0; x < width; x++, dst += 4)
+			std::memcpy(dst, src + (xOffsets[x] | yOffset), 4);
+	}
+}
+
 } // End of namespace Images
 
 #endif // IMAGES_UTIL_H
@@ -140,7 +140,7 @@ void WinIconImage::readData(Common::SeekableReadStream &cur) {
 	_mipMaps[0]->width  = width;
 	_mipMaps[0]->height = height;
 	_mipMaps[0]->size   = width * height * 4;
-	_mipMaps[0]->data   = new byte[_mipMaps[0]->size];
+	_mipMaps[0]->allocate(_mipMaps[0]->size);
 
 	const byte *xorSrc = xorMap;
 	      byte *dst    = _mipMaps[0]->data;
@@ -95,7 +95,7 @@ void XEOSITEX::readMipMaps(Common::SeekableReadStream &xeositex) {
 		_mipMaps[i]->height = xeositex.readUint32LE();
 		_mipMaps[i]->size   = xeositex.readUint32LE();
 
-		_mipMaps[i]->data = new byte[_mipMaps[i]->size];
+		_mipMaps[i]->allocate(_mipMaps[i]->size);
 
 		if (xeositex.read(_mipMaps[i]->data, _mipMaps[i]->size) != _mipMaps[i]->size)
 			throw Common::Exception(Common::kReadError);
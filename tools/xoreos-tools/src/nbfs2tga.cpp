@@ -42,10 +42,10 @@
 void printUsage(FILE *stream, const Common::UString &name);
 bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
                       Common::UString &nbfsFile, Common::UString &nbfpFile,
-                      Common::UString &outFile, uint32 &width, uint32 &height);
+                      Common::UString &outFile, uint32 &width, uint32 &height, bool &png);
 
 void convert(const Common::UString &nbfsFile, const Common::UString &nbfpFile,
-             const Common::UString &outFile, uint32 width, uint32 height);
+             const Common::UString &outFile, uint32 width, uint32 height, bool png);
 
 int main(int argc, char **argv) {
 	try {
@@ -55,11 +55,12 @@ int main(int argc, char **argv) {
 		int returnValue = 1;
 		Common::UString nbfsFile, nbfpFile, outFile;
 		uint32 width = 0xFFFFFFFF, height = 0xFFFFFFFF;
+		bool png = false;
 
-		if (!parseCommandLine(args, returnValue, nbfsFile, nbfpFile, outFile, width, height))
+		if (!parseCommandLine(args, returnValue, nbfsFile, nbfpFile, outFile, width, height, png))
 			return returnValue;
 
-		convert(nbfsFile, nbfpFile, outFile, width, height);
+		convert(nbfsFile, nbfpFile, outFile, width, height, png);
 	} catch (...) {
 		Common::exceptionDispatcherError();
 	}
@@ -69,7 +70,7 @@ int main(int argc, char **argv) {
 
 bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
                       Common::UString &nbfsFile, Common::UString &nbfpFile,
-                      Common::UString &outFile, uint32 &width, uint32 &height) {
+                      Common::UString &outFile, uint32 &width, uint32 &height, bool &png) {
 
 	std::vector<Common::UString> args;
 
@@ -98,6 +99,12 @@ bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue
 				return false;
 			}
 
+			if (argv[i] == "--png") {
+				png = true;
+
+				continue;
+			}
+
 			if (argv[i].beginsWith("-") || argv[i].beginsWith("--")) {
 			  // An options, but we already checked for all known ones
 
@@ -138,15 +145,19 @@ void printUsage(FILE *stream, const Common::UString &name) {
 	std::fprintf(stream, "Usage: %s [<options>] <nbfs> <nbfp> <tga> [<width>] [<height>]\n", name.c_str());
 	std::fprintf(stream, "  -h      --help              This help text\n");
 	std::fprintf(stream, "          --version           Display version information\n");
+	std::fprintf(stream, "          --png               Write a PNG instead of a TGA\n");
 }
 
 void convert(const Common::UString &nbfsFile, const Common::UString &nbfpFile,
-             const Common::UString &outFile, uint32 width, uint32 height) {
+             const Common::UString &outFile, uint32 width, uint32 height, bool png) {
 
 	Common::ReadFile nbfs(nbfsFile), nbfp(nbfpFile);
 	Images::NBFS image(nbfs, nbfp, width, height);
 
 	image.flipVertically();
 
-	image.dumpTGA(outFile);
+	if (png)
+		image.dumpPNG(outFile);
+	else
+		image.dumpTGA(outFile);
 }
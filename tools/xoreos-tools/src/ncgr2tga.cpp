@@ -43,10 +43,10 @@
 void printUsage(FILE *stream, const Common::UString &name);
 bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
                       uint32 &width, uint32 &height, std::vector<Common::UString> &ncgrFiles,
-                      Common::UString &nclrFile, Common::UString &outFile);
+                      Common::UString &nclrFile, Common::UString &outFile, bool &png);
 
 void convert(std::vector<Common::UString> &ncgrFiles, Common::UString &nclrFile,
-             Common::UString &outFile, uint32 width, uint32 height);
+             Common::UString &outFile, uint32 width, uint32 height, bool png);
 
 int main(int argc, char **argv) {
 	try {
@@ -57,11 +57,12 @@ int main(int argc, char **argv) {
 		uint32 width, height;
 		std::vector<Common::UString> ncgrFiles;
 		Common::UString nclrFile, outFile;
+		bool png = false;
 
-		if (!parseCommandLine(args, returnValue, width, height, ncgrFiles, nclrFile, outFile))
+		if (!parseCommandLine(args, returnValue, width, height, ncgrFiles, nclrFile, outFile, png))
 			return returnValue;
 
-		convert(ncgrFiles, nclrFile, outFile, width, height);
+		convert(ncgrFiles, nclrFile, outFile, width, height, png);
 	} catch (...) {
 		Common::exceptionDispatcherError();
 	}
@@ -71,7 +72,7 @@ int main(int argc, char **argv) {
 
 bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
                       uint32 &width, uint32 &height, std::vector<Common::UString> &ncgrFiles,
-                      Common::UString &nclrFile, Common::UString &outFile) {
+                      Common::UString &nclrFile, Common::UString &outFile, bool &png) {
 
 	std::vector<Common::UString> args;
 
@@ -100,6 +101,12 @@ bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue
 				return false;
 			}
 
+			if (argv[i] == "--png") {
+				png = true;
+
+				continue;
+			}
+
 			if (argv[i].beginsWith("-") || argv[i].beginsWith("--")) {
 			  // An options, but we already checked for all known ones
 
@@ -145,10 +152,11 @@ void printUsage(FILE *stream, const Common::UString &name) {
 	std::fprintf(stream, "Usage: %s [<options>] <width> <height> <ncgr> [<ngr> [...]] <nclr> <tga>\n", name.c_str());
 	std::fprintf(stream, "  -h      --help              This help text\n");
 	std::fprintf(stream, "          --version           Display version information\n");
+	std::fprintf(stream, "          --png               Write a PNG instead of a TGA\n");
 }
 
 void convert(std::vector<Common::UString> &ncgrFiles, Common::UString &nclrFile,
-             Common::UString &outFile, uint32 width, uint32 height) {
+             Common::UString &outFile, uint32 width, uint32 height, bool png) {
 
 	Common::ReadFile nclr(nclrFile);
 
@@ -164,6 +172,9 @@ void convert(std::vector<Common::UString> &ncgrFiles, Common::UString &nclrFile,
 
 		image.flipVertically();
 
+		if (png)
+		image.dumpPNG(outFile);
+	else
 		image.dumpTGA(outFile);
 
 	} catch (...) {
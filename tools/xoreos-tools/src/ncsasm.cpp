@@ -0,0 +1,193 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Tool to assemble NWScript bytecode.
+ */
+
+#include <cstdio>
+
+#include <vector>
+
+#include "src/common/version.h"
+#include "src/common/ustring.h"
+#include "src/common/util.h"
+#include "src/common/strutil.h"
+#include "src/common/error.h"
+#include "src/common/platform.h"
+#include "src/common/readfile.h"
+#include "src/common/writefile.h"
+
+#include "src/aurora/types.h"
+
+#include "src/nwscript/assembler.h"
+
+void printUsage(FILE *stream, const Common::UString &name);
+bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
+                      Common::UString &inFile, Common::UString &outFile, Aurora::GameID &game);
+
+void assembleNCS(const Common::UString &inFile, const Common::UString &outFile, Aurora::GameID game);
+
+int main(int argc, char **argv) {
+	try {
+		std::vector<Common::UString> args;
+		Common::Platform::getParameters(argc, argv, args);
+
+		Aurora::GameID game = Aurora::kGameIDUnknown;
+
+		int returnValue = 1;
+		Common::UString inFile, outFile;
+
+		if (!parseCommandLine(args, returnValue, inFile, outFile, game))
+			return returnValue;
+
+		assembleNCS(inFile, outFile, game);
+	} catch (...) {
+		Common::exceptionDispatcherError();
+	}
+
+	return 0;
+}
+
+bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
+                      Common::UString &inFile, Common::UString &outFile, Aurora::GameID &game) {
+
+	inFile.clear();
+	outFile.clear();
+
+	std::vector<Common::UString> args;
+
+	bool optionsEnd = false;
+	for (size_t i = 1; i < argv.size(); i++) {
+		bool isOption = false;
+
+		// A "--" marks an end to all options
+		if (argv[i] == "--") {
+			optionsEnd = true;
+			continue;
+		}
+
+		// We're still handling options
+		if (!optionsEnd) {
+			// Help text
+			if ((argv[i] == "-h") || (argv[i] == "--help")) {
+				printUsage(stdout, argv[0]);
+				returnValue = 0;
+
+				return false;
+			}
+
+			if (argv[i] == "--version") {
+				printVersion();
+				returnValue = 0;
+
+				return false;
+			}
+
+			if        (argv[i] == "--nwn") {
+				isOption = true;
+				game     = Aurora::kGameIDNWN;
+			} else if (argv[i] == "--nwn2") {
+				isOption = true;
+				game     = Aurora::kGameIDNWN2;
+			} else if (argv[i] == "--kotor") {
+				isOption = true;
+				game     = Aurora::kGameIDKotOR;
+			} else if (argv[i] == "--kotor2") {
+				isOption = true;
+				game     = Aurora::kGameIDKotOR2;
+			} else if (argv[i] == "--jade") {
+				isOption = true;
+				game     = Aurora::kGameIDJade;
+			} else if (argv[i] == "--witcher") {
+				isOption = true;
+				game     = Aurora::kGameIDWitcher;
+			} else if (argv[i] == "--dragonage") {
+				isOption = true;
+				game     = Aurora::kGameIDDragonAge;
+			} else if (argv[i] == "--dragonage2") {
+				isOption = true;
+				game     = Aurora::kGameIDDragonAge2;
+			} else if (argv[i].beginsWith("-") || argv[i].beginsWith("--")) {
+			  // An options, but we already checked for all known ones
+
+				printUsage(stderr, argv[0]);
+				returnValue = 1;
+
+				return false;
+			}
+		}
+
+		// Was this a valid option? If so, don't try to use it as a file
+		if (isOption)
+			continue;
+
+		// This is a file to use
+		args.push_back(argv[i]);
+	}
+
+	if (args.size() != 2) {
+		printUsage(stderr, argv[0]);
+		returnValue = 1;
+
+		return false;
+	}
+
+	inFile  = args[0];
+	outFile = args[1];
+
+	return true;
+}
+
+void printUsage(FILE *stream, const Common::UString &name) {
+	std::fprintf(stream, "BioWare NWScript bytecode assembler\n\n");
+	std::fprintf(stream, "Usage: %s [<options>] <input file> <output file>\n", name.c_str());
+	std::fprintf(stream, "  -h      --help              This help text\n");
+	std::fprintf(stream, "          --version           Display version information\n\n");
+	std::fprintf(stream, "          --nwn               This is a Neverwinter Nights script\n");
+	std::fprintf(stream, "          --nwn2              This is a Neverwinter Nights 2 script\n");
+	std::fprintf(stream, "          --kotor             This is a Knights of the Old Republic script\n");
+	std::fprintf(stream, "          --kotor2            This is a Knights of the Old Republic II script\n");
+	std::fprintf(stream, "          --jade              This is a Jade Empire script\n");
+	std::fprintf(stream, "          --witcher           This is a The Witcher script\n");
+	std::fprintf(stream, "          --dragonage         This is a Dragon Age script\n");
+	std::fprintf(stream, "          --dragonage2        This is a Dragon Age II script\n\n");
+	std::fprintf(stream, "The input file is assembly as written by \"ncsdis --assembly\".\n");
+	std::fprintf(stream, "Without a game, engine functions need to be given by number.\n");
+}
+
+void assembleNCS(const Common::UString &inFile, const Common::UString &outFile, Aurora::GameID game) {
+	Common::ReadFile assembly(inFile);
+
+	try {
+		NWScript::Assembler assembler(assembly, game);
+
+		Common::WriteFile ncs(outFile);
+		assembler.writeNCS(ncs);
+
+		status("Assembled %s instructions into %s bytes",
+		       Common::composeString(assembler.getInstructionCount()).c_str(),
+		       Common::composeString(assembler.size()).c_str());
+
+	} catch (Common::Exception &e) {
+		e.add("Failed assembling \"%s\"", inFile.c_str());
+		throw;
+	}
+}
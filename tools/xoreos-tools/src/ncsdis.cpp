@@ -27,17 +27,24 @@
 #include <cstdio>
 
 #include <vector>
+#include <map>
 
 #include "src/common/version.h"
 #include "src/common/ustring.h"
 #include "src/common/util.h"
+#include "src/common/strutil.h"
 #include "src/common/error.h"
 #include "src/common/platform.h"
 #include "src/common/readfile.h"
 #include "src/common/writefile.h"
 #include "src/common/stdoutstream.h"
+#include "src/common/filepath.h"
+#include "src/common/thread.h"
 
 #include "src/aurora/types.h"
+#include "src/aurora/util.h"
+#include "src/aurora/archive.h"
+#include "src/aurora/archiveset.h"
 
 #include "src/nwscript/disassembler.h"
 
@@ -46,18 +53,25 @@ enum Command {
 	kCommandListing  =  0,
 	kCommandAssembly =  1,
 	kCommandDot      =  2,
+	kCommandNSS      =  3,
 	kCommandMAX
 };
 
+const char *kCommandExtension[kCommandMAX] = { ".lst", ".asm", ".dot", ".nss" };
+
 void printUsage(FILE *stream, const Common::UString &name);
 bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
-                      Common::UString &inFile, Common::UString &outFile,
-                      Aurora::GameID &game, Command &command,
-                      bool &printStack, bool &printControlTypes);
+                      std::vector<Common::UString> &files, Aurora::GameID &game, Command &command,
+                      bool &printStack, bool &printControlTypes,
+                      bool &batch, size_t &jobs, Common::UString &summaryFile);
 
 void disNCS(const Common::UString &inFile, const Common::UString &outFile,
             Aurora::GameID &game, Command &command, bool printStack, bool printControlTypes);
 
+void disNCSBatch(const std::vector<Common::UString> &files, const Common::UString &summaryFile,
+                 Aurora::GameID game, Command command, bool printStack, bool printControlTypes,
+                 size_t jobs);
+
 int main(int argc, char **argv) {
 	try {
 		std::vector<Common::UString> args;
@@ -69,12 +83,19 @@ int main(int argc, char **argv) {
 		Command command = kCommandNone;
 		bool printStack = false;
 		bool printControlTypes = false;
-		Common::UString inFile, outFile;
+		bool batch = false;
+		size_t jobs = Common::Thread::getProcessorCount();
+		Common::UString summaryFile = "summary.txt";
+		std::vector<Common::UString> files;
 
-		if (!parseCommandLine(args, returnValue, inFile, outFile, game, command, printStack, printControlTypes))
+		if (!parseCommandLine(args, returnValue, files, game, command, printStack, printControlTypes,
+		                      batch, jobs, summaryFile))
 			return returnValue;
 
-		disNCS(inFile, outFile, game, command, printStack, printControlTypes);
+		if (batch)
+			disNCSBatch(files, summaryFile, game, command, printStack, printControlTypes, jobs);
+		else
+			disNCS(files[0], (files.size() > 1) ? files[1] : "", game, command, printStack, printControlTypes);
 	} catch (...) {
 		Common::exceptionDispatcherError();
 	}
@@ -83,13 +104,11 @@ int main(int argc, char **argv) {
 }
 
 bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
-                      Common::UString &inFile, Common::UString &outFile,
-                      Aurora::GameID &game, Command &command,
-                      bool &printStack, bool &printControlTypes) {
+                      std::vector<Common::UString> &files, Aurora::GameID &game, Command &command,
+                      bool &printStack, bool &printControlTypes,
+                      bool &batch, size_t &jobs, Common::UString &summaryFile) {
 
-	inFile.clear();
-	outFile.clear();
-	std::vector<Common::UString> args;
+	files.clear();
 
 	command = kCommandListing;
 
@@ -129,12 +148,50 @@ bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue
 			} else if (argv[i] == "--dot") {
 				isOption = true;
 				command  = kCommandDot;
+			} else if (argv[i] == "--nss") {
+				isOption = true;
+				command  = kCommandNSS;
 			} else if (argv[i] == "--stack") {
 				isOption   = true;
 				printStack = true;
 			} else if (argv[i] == "--control") {
 				isOption          = true;
 				printControlTypes = true;
+			} else if (argv[i] == "--batch") {
+				isOption = true;
+				batch    = true;
+			} else if ((argv[i] == "-j") || (argv[i] == "--jobs")) {
+				isOption = true;
+
+				try {
+					// Needs the number of jobs as the next parameter
+					if (i++ == (argv.size() - 1))
+						throw 0;
+
+					Common::parseString(argv[i], jobs);
+					if (jobs == 0)
+						throw 0;
+
+				} catch (...) {
+					printUsage(stderr, argv[0]);
+					returnValue = 1;
+
+					return false;
+				}
+
+			} else if (argv[i] == "--summary") {
+				isOption = true;
+
+				// Needs the summary file name as the next parameter
+				if (i++ == (argv.size() - 1)) {
+					printUsage(stderr, argv[0]);
+					returnValue = 1;
+
+					return false;
+				}
+
+				summaryFile = argv[i];
+
 			} else if (argv[i] == "--nwn") {
 				isOption = true;
 				game     = Aurora::kGameIDNWN;
@@ -174,38 +231,40 @@ bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue
 			continue;
 
 		// This is a file to use
-		args.push_back(argv[i]);
+		files.push_back(argv[i]);
 	}
 
 	assert(command != kCommandNone);
 
-	if ((args.size() < 1) || (args.size() > 2)) {
+	if ((files.size() < 1) || (!batch && (files.size() > 2))) {
 		printUsage(stderr, argv[0]);
 		returnValue = 1;
 
 		return false;
 	}
 
-	inFile = args[0];
-
-	if (args.size() > 1)
-		outFile = args[1];
-
 	return true;
 }
 
 void printUsage(FILE *stream, const Common::UString &name) {
 	std::fprintf(stream, "BioWare NWScript bytecode disassembler\n\n");
 	std::fprintf(stream, "Usage: %s [<options>] <input file> [<output file>]\n", name.c_str());
+	std::fprintf(stream, "       %s [<options>] --batch <archive> [<archive> [...]]\n", name.c_str());
 	std::fprintf(stream, "  -h      --help              This help text\n");
 	std::fprintf(stream, "          --version           Display version information\n\n");
 	std::fprintf(stream, "          --list              Create full disassembly listing (default)\n");
 	std::fprintf(stream, "          --assembly          Only create disassembly mnemonics\n");
-	std::fprintf(stream, "          --dot               Create a graphviz dot file\n\n");
+	std::fprintf(stream, "          --dot               Create a graphviz dot file\n");
+	std::fprintf(stream, "          --nss               Decompile into NWScript source\n");
+	std::fprintf(stream, "                              (Needs a game to be specified)\n\n");
 	std::fprintf(stream, "          --stack             Print the stack frame for each instruction\n");
 	std::fprintf(stream, "                              (Only available in list or assembly mode)\n");
 	std::fprintf(stream, "          --control           Print the control types for each block\n");
 	std::fprintf(stream, "                              (Only available in dot mode)\n\n");
+	std::fprintf(stream, "          --batch             Disassemble all scripts in ERF, RIM or KEY/BIF archives\n");
+	std::fprintf(stream, "  -j <n>  --jobs <n>          Use n threads in batch mode (default: number of CPUs)\n");
+	std::fprintf(stream, "          --summary <file>    Write the batch summary to this file\n");
+	std::fprintf(stream, "                              (default: summary.txt)\n\n");
 	std::fprintf(stream, "          --nwn               This is a Neverwinter Nights script\n");
 	std::fprintf(stream, "          --nwn2              This is a Neverwinter Nights 2 script\n");
 	std::fprintf(stream, "          --kotor             This is a Knights of the Old Republic script\n");
@@ -214,7 +273,10 @@ void printUsage(FILE *stream, const Common::UString &name) {
 	std::fprintf(stream, "          --witcher           This is a The Witcher script\n");
 	std::fprintf(stream, "          --dragonage         This is a Dragon Age script\n");
 	std::fprintf(stream, "          --dragonage2        This is a Dragon Age II script\n\n");
-	std::fprintf(stream, "If no output file is given, the output is written to stdout.\n");
+	std::fprintf(stream, "If no output file is given, the output is written to stdout.\n\n");
+	std::fprintf(stream, "In batch mode, each script is disassembled into the current directory,\n");
+	std::fprintf(stream, "and per-script timing and errors are written into the summary file.\n");
+	std::fprintf(stream, "A KEY's BIFs are found relative to the KEY's directory.\n");
 }
 
 void disNCS(const Common::UString &inFile, const Common::UString &outFile,
@@ -261,6 +323,10 @@ void disNCS(const Common::UString &inFile, const Common::UString &outFile,
 				disassembler.createDot(*out, printControlTypes);
 				break;
 
+			case kCommandNSS:
+				disassembler.createNSS(*out);
+				break;
+
 			default:
 				throw Common::Exception("Invalid command %u", (uint)command);
 		}
@@ -279,3 +345,249 @@ void disNCS(const Common::UString &inFile, const Common::UString &outFile,
 	delete ncs;
 	delete out;
 }
+
+
+// .--- Batch mode ---.
+
+/** A script to disassemble in batch mode. */
+struct BatchJob {
+	size_t archive; ///< The archive containing the script.
+	uint32 index;   ///< The index of the script within the archive.
+
+	Common::UString archiveName; ///< The file name of the archive, for the summary.
+	Common::UString name;        ///< The name of the script.
+	Common::UString outFile;     ///< The file to write the disassembly into.
+
+	bool   success;      ///< Was the script successfully disassembled?
+	uint64 time;         ///< Time taken, in microseconds.
+	Common::UString log; ///< Errors and warnings encountered.
+
+	BatchJob() : archive(SIZE_MAX), index(0xFFFFFFFF), success(false), time(0) {
+	}
+};
+
+/** The state shared between all batch threads, disassembling scripts until no jobs are left. */
+struct BatchContext : public Common::ThreadPool {
+	std::vector<BatchJob> jobs;
+
+	const Aurora::ArchiveSet *archives;
+
+	Aurora::GameID game;
+	Command command;
+	bool printStack;
+	bool printControlTypes;
+
+	BatchContext() : archives(0), game(Aurora::kGameIDUnknown), command(kCommandListing),
+		printStack(false), printControlTypes(false) {
+	}
+
+protected:
+	void runJob(size_t n) {
+		runJob(jobs[n]);
+	}
+
+private:
+	void runJob(BatchJob &job);
+};
+
+/** Describe the exception currently being handled, including the reasons for it. */
+static Common::UString describeException() {
+	try {
+		throw;
+	} catch (Common::Exception &e) {
+		Common::UString description;
+
+		for (Common::Exception::Stack &stack = e.getStack(); !stack.empty(); stack.pop())
+			description += (description.empty() ? "" : ": ") + stack.top();
+
+		return description;
+	} catch (std::exception &e) {
+		return e.what();
+	} catch (...) {
+	}
+
+	return "Unknown exception";
+}
+
+static void addLog(BatchJob &job, const Common::UString &message) {
+	if (!job.log.empty())
+		job.log += "; ";
+
+	job.log += message;
+}
+
+void BatchContext::runJob(BatchJob &job) {
+	const uint64 startTime = Common::Platform::getMicroseconds();
+
+	Common::SeekableReadStream *ncs = 0;
+	Common::WriteFile *out = 0;
+
+	try {
+		ncs = archives->getResource(job.archive, job.index);
+
+		NWScript::Disassembler disassembler(*ncs, game);
+
+		if (game != Aurora::kGameIDUnknown) {
+			try {
+				disassembler.analyzeStack();
+			} catch (...) {
+				addLog(job, "Script analysis failed: " + describeException());
+			}
+
+			try {
+				disassembler.analyzeControlFlow();
+			} catch (...) {
+				addLog(job, "Control flow analysis failed: " + describeException());
+			}
+		}
+
+		out = new Common::WriteFile(job.outFile);
+
+		switch (command) {
+			case kCommandListing:
+				disassembler.createListing(*out, printStack);
+				break;
+
+			case kCommandAssembly:
+				disassembler.createAssembly(*out, printStack);
+				break;
+
+			case kCommandDot:
+				disassembler.createDot(*out, printControlTypes);
+				break;
+
+			case kCommandNSS:
+				disassembler.createNSS(*out);
+				break;
+
+			default:
+				throw Common::Exception("Invalid command %u", (uint)command);
+		}
+
+		out->flush();
+
+		job.success = true;
+
+	} catch (...) {
+		addLog(job, describeException());
+	}
+
+	delete ncs;
+	delete out;
+
+	job.time = Common::Platform::getMicroseconds() - startTime;
+}
+
+/** Collect all scripts in this archive as jobs. */
+static void collectJobs(const Aurora::ArchiveSet &archives, size_t archive,
+                        Aurora::GameID game, Command command, std::vector<BatchJob> &jobs,
+                        std::map<Common::UString, uint32, Common::UString::iless> &names) {
+
+	const Aurora::Archive::ResourceList &resources = archives.getArchive(archive).getResources();
+	for (Aurora::Archive::ResourceList::const_iterator r = resources.begin(); r != resources.end(); ++r) {
+		if (TypeMan.aliasFileType(r->type, game) != Aurora::kFileTypeNCS)
+			continue;
+
+		BatchJob job;
+
+		job.archive     = archive;
+		job.index       = r->index;
+		job.archiveName = Common::FilePath::getFile(archives.getFile(archive));
+		job.name        = TypeMan.setFileType(r->name, Aurora::kFileTypeNCS);
+
+		// Scripts of the same name in different archives must not overwrite each other
+		const uint32 count = names[r->name]++;
+
+		job.outFile = r->name;
+		if (count > 0)
+			job.outFile += Common::UString::format("_%u", count);
+
+		job.outFile += kCommandExtension[command];
+
+		jobs.push_back(job);
+	}
+}
+
+static void writeSummary(const Common::UString &summaryFile, const BatchContext &context,
+                         size_t threadCount, uint64 totalTime) {
+
+	Common::WriteFile summary(summaryFile);
+
+	size_t failed = 0, warned = 0;
+	uint64 scriptTime = 0;
+	for (std::vector<BatchJob>::const_iterator j = context.jobs.begin(); j != context.jobs.end(); ++j) {
+		if (!j->success)
+			failed++;
+		else if (!j->log.empty())
+			warned++;
+
+		scriptTime += j->time;
+	}
+
+	summary.writeString(Common::UString::format("Scripts: %u (%u failed, %u with warnings)\n",
+	                    (uint)context.jobs.size(), (uint)failed, (uint)warned));
+	summary.writeString(Common::UString::format("Threads: %u\n", (uint)threadCount));
+	summary.writeString(Common::UString::format("Time: %.3f ms (%.3f ms total script time)\n",
+	                    totalTime / 1000.0, scriptTime / 1000.0));
+	summary.writeString(Common::UString::format("Throughput: %.1f scripts/s\n\n",
+	                    (context.jobs.size() * 1000000.0) / MAX<uint64>(totalTime, 1)));
+
+	for (std::vector<BatchJob>::const_iterator j = context.jobs.begin(); j != context.jobs.end(); ++j) {
+		const char *result = !j->success ? "FAILED" : (j->log.empty() ? "OK" : "WARNING");
+
+		summary.writeString(Common::UString::format("%s\t%s\t%s\t%s\t%.3f ms", j->archiveName.c_str(),
+		                    j->name.c_str(), j->outFile.c_str(), result, j->time / 1000.0));
+
+		if (!j->log.empty())
+			summary.writeString("\t" + j->log);
+
+		summary.writeString("\n");
+	}
+
+	summary.flush();
+}
+
+void disNCSBatch(const std::vector<Common::UString> &files, const Common::UString &summaryFile,
+                 Aurora::GameID game, Command command, bool printStack, bool printControlTypes,
+                 size_t jobs) {
+
+	Aurora::ArchiveSet archives;
+	for (std::vector<Common::UString>::const_iterator f = files.begin(); f != files.end(); ++f)
+		archives.open(*f);
+
+	BatchContext context;
+
+	context.archives          = &archives;
+	context.game              = game;
+	context.command           = command;
+	context.printStack        = printStack;
+	context.printControlTypes = printControlTypes;
+
+	std::map<Common::UString, uint32, Common::UString::iless> names;
+	for (size_t i = 0; i < archives.size(); i++)
+		collectJobs(archives, i, game, command, context.jobs, names);
+
+	const size_t threadCount = MAX<size_t>(MIN(jobs, context.jobs.size()), 1);
+
+	status("Disassembling %u scripts with %u threads...", (uint)context.jobs.size(), (uint)threadCount);
+
+	const uint64 startTime = Common::Platform::getMicroseconds();
+
+	context.runJobs(context.jobs.size(), threadCount);
+
+	const uint64 totalTime = Common::Platform::getMicroseconds() - startTime;
+
+	writeSummary(summaryFile, context, threadCount, totalTime);
+
+	size_t failed = 0;
+	for (std::vector<BatchJob>::const_iterator j = context.jobs.begin(); j != context.jobs.end(); ++j)
+		if (!j->success)
+			failed++;
+
+	const double scriptsPerSecond = (context.jobs.size() * 1000000.0) / MAX<uint64>(totalTime, 1);
+
+	status("Disassembled %u scripts (%u failed) in %.3f ms (%.1f scripts/s), summary written to \"%s\"",
+	       (uint)(context.jobs.size() - failed), (uint)failed, totalTime / 1000.0, scriptsPerSecond,
+	       summaryFile.c_str());
+}
+// '--- Batch mode ---'
@@ -0,0 +1,259 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+/** @file
+ *  Tool to run NWScript bytecode.
+ */
+
+#include <cstdio>
+
+#include <vector>
+
+#include "src/common/version.h"
+#include "src/common/ustring.h"
+#include "src/common/util.h"
+#include "src/common/strutil.h"
+#include "src/common/error.h"
+#include "src/common/platform.h"
+#include "src/common/readfile.h"
+
+#include "src/aurora/types.h"
+
+#include "src/nwscript/ncsfile.h"
+#include "src/nwscript/vm.h"
+
+void printUsage(FILE *stream, const Common::UString &name);
+bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
+                      Common::UString &file, Aurora::GameID &game, bool &runActions, size_t &benchmark);
+
+void runNCS(const Common::UString &file, Aurora::GameID game, bool runActions);
+void benchmarkNCS(const Common::UString &file, Aurora::GameID game, bool runActions, size_t count);
+
+int main(int argc, char **argv) {
+	try {
+		std::vector<Common::UString> args;
+		Common::Platform::getParameters(argc, argv, args);
+
+		Aurora::GameID game = Aurora::kGameIDUnknown;
+
+		int returnValue = 1;
+		bool runActions = false;
+		size_t benchmark = 0;
+		Common::UString file;
+
+		if (!parseCommandLine(args, returnValue, file, game, runActions, benchmark))
+			return returnValue;
+
+		if (benchmark > 0)
+			benchmarkNCS(file, game, runActions, benchmark);
+		else
+			runNCS(file, game, runActions);
+	} catch (...) {
+		Common::exceptionDispatcherError();
+	}
+
+	return 0;
+}
+
+bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
+                      Common::UString &file, Aurora::GameID &game, bool &runActions, size_t &benchmark) {
+
+	file.clear();
+
+	std::vector<Common::UString> args;
+
+	bool optionsEnd = false;
+	for (size_t i = 1; i < argv.size(); i++) {
+		bool isOption = false;
+
+		// A "--" marks an end to all options
+		if (argv[i] == "--") {
+			optionsEnd = true;
+			continue;
+		}
+
+		// We're still handling options
+		if (!optionsEnd) {
+			// Help text
+			if ((argv[i] == "-h") || (argv[i] == "--help")) {
+				printUsage(stdout, argv[0]);
+				returnValue = 0;
+
+				return false;
+			}
+
+			if (argv[i] == "--version") {
+				printVersion();
+				returnValue = 0;
+
+				return false;
+			}
+
+			if        (argv[i] == "--actions") {
+				isOption   = true;
+				runActions = true;
+			} else if (argv[i] == "--benchmark") {
+				isOption = true;
+
+				try {
+					// Needs the number of runs as the next parameter
+					if (i++ == (argv.size() - 1))
+						throw 0;
+
+					Common::parseString(argv[i], benchmark);
+					if (benchmark == 0)
+						throw 0;
+
+				} catch (...) {
+					printUsage(stderr, argv[0]);
+					returnValue = 1;
+
+					return false;
+				}
+
+			} else if (argv[i] == "--nwn") {
+				isOption = true;
+				game     = Aurora::kGameIDNWN;
+			} else if (argv[i] == "--nwn2") {
+				isOption = true;
+				game     = Aurora::kGameIDNWN2;
+			} else if (argv[i] == "--kotor") {
+				isOption = true;
+				game     = Aurora::kGameIDKotOR;
+			} else if (argv[i] == "--kotor2") {
+				isOption = true;
+				game     = Aurora::kGameIDKotOR2;
+			} else if (argv[i] == "--jade") {
+				isOption = true;
+				game     = Aurora::kGameIDJade;
+			} else if (argv[i] == "--witcher") {
+				isOption = true;
+				game     = Aurora::kGameIDWitcher;
+			} else if (argv[i].beginsWith("-") || argv[i].beginsWith("--")) {
+			  // An options, but we already checked for all known ones
+
+				printUsage(stderr, argv[0]);
+				returnValue = 1;
+
+				return false;
+			}
+		}
+
+		// Was this a valid option? If so, don't try to use it as a file
+		if (isOption)
+			continue;
+
+		// This is a file to use
+		args.push_back(argv[i]);
+	}
+
+	// The engine functions can't be called without knowing the game
+	if ((args.size() != 1) || (game == Aurora::kGameIDUnknown)) {
+		printUsage(stderr, argv[0]);
+		returnValue = 1;
+
+		return false;
+	}
+
+	file = args[0];
+
+	return true;
+}
+
+void printUsage(FILE *stream, const Common::UString &name) {
+	std::fprintf(stream, "BioWare NWScript bytecode interpreter\n\n");
+	std::fprintf(stream, "Usage: %s [<options>] <game> <input file>\n", name.c_str());
+	std::fprintf(stream, "  -h      --help              This help text\n");
+	std::fprintf(stream, "          --version           Display version information\n\n");
+	std::fprintf(stream, "          --actions           Run actions passed to engine functions immediately\n");
+	std::fprintf(stream, "          --benchmark <n>     Run the script n times and print the speed\n\n");
+	std::fprintf(stream, "Game is one of:\n");
+	std::fprintf(stream, "          --nwn               This is a Neverwinter Nights script\n");
+	std::fprintf(stream, "          --nwn2              This is a Neverwinter Nights 2 script\n");
+	std::fprintf(stream, "          --kotor             This is a Knights of the Old Republic script\n");
+	std::fprintf(stream, "          --kotor2            This is a Knights of the Old Republic II script\n");
+	std::fprintf(stream, "          --jade              This is a Jade Empire script\n");
+	std::fprintf(stream, "          --witcher           This is a The Witcher script\n\n");
+	std::fprintf(stream, "Engine functions are not implemented. Instead, each call is printed\n");
+	std::fprintf(stream, "to stdout, and a default value is returned.\n");
+}
+
+static NWScript::NCSFile *openNCS(const Common::UString &file, Aurora::GameID game) {
+	Common::ReadFile ncs(file);
+
+	return new NWScript::NCSFile(ncs, game);
+}
+
+void runNCS(const Common::UString &file, Aurora::GameID game, bool runActions) {
+	NWScript::NCSFile *ncs = openNCS(file, game);
+
+	try {
+		NWScript::VirtualMachine vm(*ncs, game);
+		vm.setRunActions(runActions);
+
+		status("Running script...");
+		const int32 result = vm.run();
+
+		const std::vector<Common::UString> &calls = vm.getCallLog();
+		for (std::vector<Common::UString>::const_iterator c = calls.begin(); c != calls.end(); ++c)
+			std::printf("%s\n", c->c_str());
+
+		status("Script returned %d after %s instructions", result,
+		       Common::composeString(vm.getInstructionCount()).c_str());
+
+	} catch (...) {
+		delete ncs;
+		throw;
+	}
+
+	delete ncs;
+}
+
+void benchmarkNCS(const Common::UString &file, Aurora::GameID game, bool runActions, size_t count) {
+	NWScript::NCSFile *ncs = openNCS(file, game);
+
+	try {
+		NWScript::VirtualMachine vm(*ncs, game);
+		vm.setRunActions(runActions);
+
+		status("Running script %s times...", Common::composeString(count).c_str());
+
+		const uint64 start = Common::Platform::getMicroseconds();
+
+		for (size_t i = 0; i < count; i++) {
+			vm.run();
+			vm.clearCallLog();
+		}
+
+		const uint64 time = Common::Platform::getMicroseconds() - start;
+
+		const uint64 instructions = vm.getInstructionCount();
+		const double seconds      = MAX<uint64>(time, 1) / 1000000.0;
+
+		status("%s instructions in %.3fs", Common::composeString(instructions).c_str(), seconds);
+		status("Speed: %.1f million instructions/s, %.1f runs/s",
+		       instructions / seconds / 1000000.0, count / seconds);
+
+	} catch (...) {
+		delete ncs;
+		throw;
+	}
+
+	delete ncs;
+}
@@ -0,0 +1,485 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+/** @file
+ *  Tool to index and query cross-references of NWScript bytecode.
+ */
+
+#include <cstdio>
+
+#include <vector>
+
+#include "src/common/version.h"
+#include "src/common/ustring.h"
+#include "src/common/util.h"
+#include "src/common/strutil.h"
+#include "src/common/error.h"
+#include "src/common/platform.h"
+#include "src/common/readfile.h"
+#include "src/common/writefile.h"
+#include "src/common/filepath.h"
+#include "src/common/thread.h"
+
+#include "src/aurora/types.h"
+#include "src/aurora/util.h"
+#include "src/aurora/archive.h"
+#include "src/aurora/archiveset.h"
+
+#include "src/nwscript/ncsfile.h"
+#include "src/nwscript/xref.h"
+
+enum Query {
+	kQueryNone,
+	kQueryFunction,
+	kQueryString,
+	kQueryGlobal,
+	kQueryScript
+};
+
+void printUsage(FILE *stream, const Common::UString &name);
+bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
+                      std::vector<Common::UString> &files, Aurora::GameID &game,
+                      Common::UString &indexFile, size_t &jobs, Query &query, Common::UString &term);
+
+void createIndex(const std::vector<Common::UString> &files, const Common::UString &indexFile,
+                 Aurora::GameID game, size_t jobs);
+void queryIndex(const Common::UString &indexFile, Query query, const Common::UString &term);
+
+int main(int argc, char **argv) {
+	try {
+		std::vector<Common::UString> args;
+		Common::Platform::getParameters(argc, argv, args);
+
+		Aurora::GameID game = Aurora::kGameIDUnknown;
+
+		int returnValue = 1;
+		size_t jobs = Common::Thread::getProcessorCount();
+		Query query = kQueryNone;
+		Common::UString indexFile, term;
+		std::vector<Common::UString> files;
+
+		if (!parseCommandLine(args, returnValue, files, game, indexFile, jobs, query, term))
+			return returnValue;
+
+		if (query == kQueryNone)
+			createIndex(files, indexFile, game, jobs);
+		else
+			queryIndex(indexFile, query, term);
+	} catch (...) {
+		Common::exceptionDispatcherError();
+	}
+
+	return 0;
+}
+
+bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
+                      std::vector<Common::UString> &files, Aurora::GameID &game,
+                      Common::UString &indexFile, size_t &jobs, Query &query, Common::UString &term) {
+
+	files.clear();
+
+	bool create = false;
+
+	bool optionsEnd = false;
+	for (size_t i = 1; i < argv.size(); i++) {
+		bool isOption = false;
+
+		// A "--" marks an end to all options
+		if (argv[i] == "--") {
+			optionsEnd = true;
+			continue;
+		}
+
+		// We're still handling options
+		if (!optionsEnd) {
+			// Help text
+			if ((argv[i] == "-h") || (argv[i] == "--help")) {
+				printUsage(stdout, argv[0]);
+				returnValue = 0;
+
+				return false;
+			}
+
+			if (argv[i] == "--version") {
+				printVersion();
+				returnValue = 0;
+
+				return false;
+			}
+
+			Query newQuery = kQueryNone;
+			if      (argv[i] == "--function")
+				newQuery = kQueryFunction;
+			else if (argv[i] == "--string")
+				newQuery = kQueryString;
+			else if (argv[i] == "--global")
+				newQuery = kQueryGlobal;
+			else if (argv[i] == "--script")
+				newQuery = kQueryScript;
+
+			if (newQuery != kQueryNone) {
+				isOption = true;
+
+				// Needs the search term as the next parameter, and only one query at a time
+				if ((i++ == (argv.size() - 1)) || (query != kQueryNone)) {
+					printUsage(stderr, argv[0]);
+					returnValue = 1;
+
+					return false;
+				}
+
+				query = newQuery;
+				term  = argv[i];
+
+			} else if (argv[i] == "--create") {
+				isOption = true;
+				create   = true;
+			} else if ((argv[i] == "-j") || (argv[i] == "--jobs")) {
+				isOption = true;
+
+				try {
+					// Needs the number of jobs as the next parameter
+					if (i++ == (argv.size() - 1))
+						throw 0;
+
+					Common::parseString(argv[i], jobs);
+					if (jobs == 0)
+						throw 0;
+
+				} catch (...) {
+					printUsage(stderr, argv[0]);
+					returnValue = 1;
+
+					return false;
+				}
+
+			} else if (argv[i] == "--nwn") {
+				isOption = true;
+				game     = Aurora::kGameIDNWN;
+			} else if (argv[i] == "--nwn2") {
+				isOption = true;
+				game     = Aurora::kGameIDNWN2;
+			} else if (argv[i] == "--kotor") {
+				isOption = true;
+				game     = Aurora::kGameIDKotOR;
+			} else if (argv[i] == "--kotor2") {
+				isOption = true;
+				game     = Aurora::kGameIDKotOR2;
+			} else if (argv[i] == "--jade") {
+				isOption = true;
+				game     = Aurora::kGameIDJade;
+			} else if (argv[i] == "--witcher") {
+				isOption = true;
+				game     = Aurora::kGameIDWitcher;
+			} else if (argv[i] == "--dragonage") {
+				isOption = true;
+				game     = Aurora::kGameIDDragonAge;
+			} else if (argv[i] == "--dragonage2") {
+				isOption = true;
+				game     = Aurora::kGameIDDragonAge2;
+			} else if (argv[i].beginsWith("-") || argv[i].beginsWith("--")) {
+			  // An options, but we already checked for all known ones
+
+				printUsage(stderr, argv[0]);
+				returnValue = 1;
+
+				return false;
+			}
+		}
+
+		// Was this a valid option? If so, don't try to use it as a file
+		if (isOption)
+			continue;
+
+		// This is a file to use
+		files.push_back(argv[i]);
+	}
+
+	/* Creating an index needs the game, the index file and at least one archive.
+	 * A query needs only the index file. */
+	const bool valid = create ? ((query == kQueryNone) && (game != Aurora::kGameIDUnknown) && (files.size() >= 2))
+	                          : ((query != kQueryNone) && (files.size() == 1));
+
+	if (!valid) {
+		printUsage(stderr, argv[0]);
+		returnValue = 1;
+
+		return false;
+	}
+
+	indexFile = files[0];
+	files.erase(files.begin());
+
+	return true;
+}
+
+void printUsage(FILE *stream, const Common::UString &name) {
+	std::fprintf(stream, "BioWare NWScript bytecode cross-referencer\n\n");
+	std::fprintf(stream, "Usage: %s [<options>] <game> --create <index> <archive> [<archive> [...]]\n", name.c_str());
+	std::fprintf(stream, "       %s <query> <index>\n", name.c_str());
+	std::fprintf(stream, "  -h      --help              This help text\n");
+	std::fprintf(stream, "          --version           Display version information\n\n");
+	std::fprintf(stream, "          --create            Index all scripts in ERF, RIM or KEY/BIF archives\n");
+	std::fprintf(stream, "  -j <n>  --jobs <n>          Use n threads to create the index\n");
+	std::fprintf(stream, "                              (default: number of CPUs)\n\n");
+	std::fprintf(stream, "Game is one of:\n");
+	std::fprintf(stream, "          --nwn               These are Neverwinter Nights scripts\n");
+	std::fprintf(stream, "          --nwn2              These are Neverwinter Nights 2 scripts\n");
+	std::fprintf(stream, "          --kotor             These are Knights of the Old Republic scripts\n");
+	std::fprintf(stream, "          --kotor2            These are Knights of the Old Republic II scripts\n");
+	std::fprintf(stream, "          --jade              These are Jade Empire scripts\n");
+	std::fprintf(stream, "          --witcher           These are The Witcher scripts\n");
+	std::fprintf(stream, "          --dragonage         These are Dragon Age scripts\n");
+	std::fprintf(stream, "          --dragonage2        These are Dragon Age II scripts\n\n");
+	std::fprintf(stream, "Query is one of:\n");
+	std::fprintf(stream, "          --function <name>   Find all calls of this engine function\n");
+	std::fprintf(stream, "          --string <string>   Find all uses of this string constant\n");
+	std::fprintf(stream, "          --global <name>     Find all accesses of this global variable\n");
+	std::fprintf(stream, "          --script <name>     Print the subroutines and calls of this script\n");
+}
+
+
+// .--- Creating the index ---.
+
+/** A script to index. */
+struct IndexJob {
+	size_t archive; ///< The archive containing the script.
+	uint32 index;   ///< The index of the script within the archive.
+
+	NWScript::XRefScript xref; ///< The collected cross-references.
+	bool success;              ///< Could the script be read at all?
+
+
+	IndexJob() : archive(SIZE_MAX), index(0xFFFFFFFF), success(false) {
+	}
+};
+
+/** The state shared between all index threads, indexing scripts until no jobs are left. */
+struct IndexContext : public Common::ThreadPool {
+	std::vector<IndexJob> jobs;
+
+	const Aurora::ArchiveSet *archives;
+	Aurora::GameID game;
+
+
+	IndexContext() : archives(0), game(Aurora::kGameIDUnknown) {
+	}
+
+protected:
+	void runJob(size_t n) {
+		runJob(jobs[n]);
+	}
+
+private:
+	void runJob(IndexJob &job);
+};
+
+/** Describe the exception currently being handled, including the reasons for it. */
+static Common::UString describeException() {
+	try {
+		throw;
+	} catch (Common::Exception &e) {
+		Common::UString description;
+
+		for (Common::Exception::Stack &stack = e.getStack(); !stack.empty(); stack.pop())
+			description += (description.empty() ? "" : ": ") + stack.top();
+
+		return description;
+	} catch (std::exception &e) {
+		return e.what();
+	} catch (...) {
+	}
+
+	return "Unknown exception";
+}
+
+void IndexContext::runJob(IndexJob &job) {
+	Common::SeekableReadStream *stream = 0;
+	NWScript::NCSFile *ncs = 0;
+
+	try {
+		stream = archives->getResource(job.archive, job.index);
+		ncs    = new NWScript::NCSFile(*stream, game);
+
+		// Without the stack analysis, we still know the calls and strings, just not the arguments
+		try {
+			ncs->analyzeStack();
+		} catch (...) {
+			job.xref.error = "Script analysis failed: " + describeException();
+		}
+
+		NWScript::collectXRefs(*ncs, job.xref);
+
+		job.success = true;
+
+	} catch (...) {
+		job.xref.error = describeException();
+	}
+
+	delete ncs;
+	delete stream;
+}
+
+void createIndex(const std::vector<Common::UString> &files, const Common::UString &indexFile,
+                 Aurora::GameID game, size_t jobs) {
+
+	Aurora::ArchiveSet archives;
+	for (std::vector<Common::UString>::const_iterator f = files.begin(); f != files.end(); ++f)
+		archives.open(*f);
+
+	IndexContext context;
+
+	context.archives = &archives;
+	context.game     = game;
+
+	for (size_t i = 0; i < archives.size(); i++) {
+		const Aurora::Archive::ResourceList &resources = archives.getArchive(i).getResources();
+
+		for (Aurora::Archive::ResourceList::const_iterator r = resources.begin(); r != resources.end(); ++r) {
+			if (TypeMan.aliasFileType(r->type, game) != Aurora::kFileTypeNCS)
+				continue;
+
+			context.jobs.push_back(IndexJob());
+
+			IndexJob &job = context.jobs.back();
+
+			job.archive      = i;
+			job.index        = r->index;
+			job.xref.archive = Common::FilePath::getFile(archives.getFile(i));
+			job.xref.name    = TypeMan.setFileType(r->name, Aurora::kFileTypeNCS);
+		}
+	}
+
+	const size_t threadCount = MAX<size_t>(MIN(jobs, context.jobs.size()), 1);
+
+	status("Indexing %u scripts with %u threads...", (uint)context.jobs.size(), (uint)threadCount);
+
+	const uint64 startTime = Common::Platform::getMicroseconds();
+
+	context.runJobs(context.jobs.size(), threadCount);
+
+	const uint64 totalTime = Common::Platform::getMicroseconds() - startTime;
+
+	// Add the scripts in archive order, so that the index doesn't depend on thread timing
+	NWScript::XRefIndex index(game);
+
+	size_t failed = 0, warned = 0;
+	for (std::vector<IndexJob>::const_iterator j = context.jobs.begin(); j != context.jobs.end(); ++j) {
+		if (!j->success)
+			failed++;
+		else if (!j->xref.error.empty())
+			warned++;
+
+		if (!j->xref.error.empty())
+			warning("%s: %s: %s", j->xref.archive.c_str(), j->xref.name.c_str(), j->xref.error.c_str());
+
+		index.add(j->xref);
+	}
+
+	Common::WriteFile out(indexFile);
+	index.write(out);
+
+	status("Indexed %u scripts (%u failed, %u only partially) in %.3f ms, written to \"%s\"",
+	       (uint)(context.jobs.size() - failed), (uint)failed, (uint)warned, totalTime / 1000.0,
+	       indexFile.c_str());
+}
+
+// '--- Creating the index ---'
+
+
+// .--- Querying the index ---.
+
+static Common::UString getSubRoutineSignature(const NWScript::XRefScript &script, uint32 address) {
+	for (std::vector<NWScript::XRefSubRoutine>::const_iterator s = script.subRoutines.begin();
+	     s != script.subRoutines.end(); ++s)
+		if (s->address == address)
+			return s->signature;
+
+	return Common::UString::format("sub_%08X", address);
+}
+
+static void printMatch(const NWScript::XRefIndex &index, const NWScript::XRefIndex::Match &match) {
+	const NWScript::XRefScript &script = *match.script;
+
+	if (match.call) {
+		std::printf("%s\t%s\t%08X\t%s\t%s\n", script.archive.c_str(), script.name.c_str(), match.call->address,
+		            getSubRoutineSignature(script, match.call->subRoutine).c_str(),
+		            index.formatCall(*match.call).c_str());
+	} else if (match.string) {
+		std::printf("%s\t%s\t%08X\t%s\n", script.archive.c_str(), script.name.c_str(), match.string->address,
+		            match.string->value.c_str());
+	}
+}
+
+static void printScript(const NWScript::XRefIndex &index, const NWScript::XRefScript &script) {
+	std::printf("%s\t%s\n", script.archive.c_str(), script.name.c_str());
+	if (!script.error.empty())
+		std::printf("\tError: %s\n", script.error.c_str());
+
+	for (std::vector<NWScript::XRefSubRoutine>::const_iterator s = script.subRoutines.begin();
+	     s != script.subRoutines.end(); ++s) {
+
+		std::printf("\t%08X\t%s\n", s->address, s->signature.c_str());
+
+		for (std::vector<NWScript::XRefCall>::const_iterator c = script.calls.begin(); c != script.calls.end(); ++c)
+			if (c->subRoutine == s->address)
+				std::printf("\t\t%08X\t%s\n", c->address, index.formatCall(*c).c_str());
+	}
+}
+
+void queryIndex(const Common::UString &indexFile, Query query, const Common::UString &term) {
+	Common::ReadFile file(indexFile);
+	NWScript::XRefIndex index(file);
+
+	if (query == kQueryScript) {
+		std::vector<const NWScript::XRefScript *> scripts;
+		index.findScripts(term, scripts);
+
+		for (std::vector<const NWScript::XRefScript *>::const_iterator s = scripts.begin(); s != scripts.end(); ++s)
+			printScript(index, **s);
+
+		status("%u matches", (uint)scripts.size());
+		return;
+	}
+
+	NWScript::XRefIndex::Matches matches;
+	switch (query) {
+		case kQueryFunction:
+			index.findCalls(term, matches);
+			break;
+
+		case kQueryString:
+			index.findStrings(term, matches);
+			break;
+
+		case kQueryGlobal:
+			index.findGlobals(term, matches);
+			break;
+
+		default:
+			throw Common::Exception("Invalid query %u", (uint)query);
+	}
+
+	for (NWScript::XRefIndex::Matches::const_iterator m = matches.begin(); m != matches.end(); ++m)
+		printMatch(index, *m);
+
+	status("%u matches", (uint)matches.size());
+}
+
+// '--- Querying the index ---'
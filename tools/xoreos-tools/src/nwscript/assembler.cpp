@@ -0,0 +1,588 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Assembling NWScript bytecode.
+ */
+
+#include <cstdlib>
+#include <cstring>
+
+#include "src/common/util.h"
+#include "src/common/strutil.h"
+#include "src/common/error.h"
+#include "src/common/readstream.h"
+#include "src/common/writestream.h"
+#include "src/common/encoding.h"
+
+#include "src/nwscript/assembler.h"
+#include "src/nwscript/util.h"
+#include "src/nwscript/game.h"
+
+namespace NWScript {
+
+static const uint32 kHeaderSize = 13;
+
+static const char * const kInvalidFunction = "InvalidFunction";
+
+/** Split an assembly line into whitespace-separated tokens.
+ *
+ *  A quoted string is kept as one token, including the quotes and any
+ *  escape sequences. A ";" outside of a string starts a comment, which
+ *  ends the line.
+ */
+static void tokenizeLine(const Common::UString &line, std::vector<Common::UString> &tokens) {
+	tokens.clear();
+
+	Common::UString::iterator c = line.begin();
+	while (c != line.end()) {
+		if (Common::UString::isSpace(*c)) {
+			++c;
+			continue;
+		}
+
+		if (*c == ';')
+			break;
+
+		Common::UString token;
+
+		if (*c == '"') {
+			token += *c++;
+
+			bool closed = false;
+			while (c != line.end()) {
+				const uint32 t = *c++;
+				token += t;
+
+				if (t == '"') {
+					closed = true;
+					break;
+				}
+
+				if ((t == '\\') && (c != line.end()))
+					token += *c++;
+			}
+
+			if (!closed)
+				throw Common::Exception("Unterminated string");
+
+		} else
+			while ((c != line.end()) && !Common::UString::isSpace(*c) && (*c != ';'))
+				token += *c++;
+
+		tokens.push_back(token);
+	}
+}
+
+static int parseHexDigit(uint32 c) {
+	if ((c >= '0') && (c <= '9'))
+		return c - '0';
+	if ((c >= 'A') && (c <= 'F'))
+		return c - 'A' + 10;
+	if ((c >= 'a') && (c <= 'f'))
+		return c - 'a' + 10;
+
+	return -1;
+}
+
+/** Turn a quoted string token back into the raw bytes of the string.
+ *
+ *  This reverses the quoting done by readStringQuoting() when parsing
+ *  the CONST instruction.
+ */
+static void unquoteString(const Common::UString &token, std::vector<byte> &str) {
+	str.clear();
+
+	if ((token.size() < 2) || (*token.begin() != '"'))
+		throw Common::Exception("Not a string: %s", token.c_str());
+
+	Common::UString::iterator end = token.end();
+	--end;
+
+	for (Common::UString::iterator c = ++token.begin(); c != end; ++c) {
+		if (*c > 0xFF)
+			throw Common::Exception("Non-ASCII character in string %s", token.c_str());
+
+		if (*c != '\\') {
+			str.push_back((byte) *c);
+			continue;
+		}
+
+		if (++c == end)
+			throw Common::Exception("Broken escape sequence in string %s", token.c_str());
+
+		if      (*c == 'n')
+			str.push_back('\n');
+		else if (*c == 'r')
+			str.push_back('\r');
+		else if (*c == 't')
+			str.push_back('\t');
+		else if (*c == '"')
+			str.push_back('"');
+		else if (*c == '\\')
+			str.push_back('\\');
+		else if (*c == 'x') {
+			int hi = -1, lo = -1;
+
+			if (++c != end)
+				hi = parseHexDigit(*c);
+			if ((hi >= 0) && (++c != end))
+				lo = parseHexDigit(*c);
+
+			if ((hi < 0) || (lo < 0))
+				throw Common::Exception("Broken escape sequence in string %s", token.c_str());
+
+			str.push_back((byte) ((hi << 4) | lo));
+		} else
+			throw Common::Exception("Unknown escape sequence in string %s", token.c_str());
+	}
+
+	if (str.size() > 0xFFFF)
+		throw Common::Exception("String too long (%u bytes)", (uint)str.size());
+}
+
+/** Parse a floating point constant.
+ *
+ *  Reads the value the same way formatFloat() checks it, and unlike
+ *  Common::parseString(), this also accepts denormal numbers.
+ */
+static float parseFloat(const Common::UString &str) {
+	char *end = 0;
+	const double value = std::strtod(str.c_str(), &end);
+
+	if (str.empty() || !end || (*end != '\0'))
+		throw Common::Exception("Can't convert \"%s\" to a float", str.c_str());
+
+	return (float) value;
+}
+
+/** The instruction type of an opcode written without a type suffix. */
+static InstructionType getDefaultType(Opcode opcode) {
+	switch (opcode) {
+		case kOpcodeCPDOWNSP:
+		case kOpcodeCPTOPSP:
+		case kOpcodeCPDOWNBP:
+		case kOpcodeCPTOPBP:
+		case kOpcodeDESTRUCT:
+			return kInstTypeDirect;
+
+		default:
+			break;
+	}
+
+	return kInstTypeNone;
+}
+
+/** Split a mnemonic into the opcode and the instruction type suffix. */
+static bool parseMnemonic(const Common::UString &mnemonic, Opcode &opcode, InstructionType &type) {
+	for (size_t i = 0; i < (size_t)kOpcodeMAX; i++) {
+		const Common::UString name = getOpcodeName((Opcode) i);
+		if ((name == "??") || !mnemonic.beginsWith(name))
+			continue;
+
+		opcode = (Opcode) i;
+
+		const Common::UString suffix = mnemonic.substr(mnemonic.getPosition(name.size()), mnemonic.end());
+		if (suffix.empty()) {
+			type = getDefaultType(opcode);
+			return true;
+		}
+
+		for (size_t j = 0; j < (size_t)kInstTypeInstTypeMAX; j++) {
+			if (getInstTypeName((InstructionType) j) == suffix) {
+				type = (InstructionType) j;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+static bool hasStructArgument(Opcode opcode, InstructionType type) {
+	return ((opcode == kOpcodeEQ) || (opcode == kOpcodeNEQ)) && (type == kInstTypeStructStruct);
+}
+
+static size_t getArgumentCount(Opcode opcode, InstructionType type) {
+	if (opcode == kOpcodeCONST)
+		return 1;
+	if (opcode == kOpcodeSTORESTATE)
+		return 3;
+	if (hasStructArgument(opcode, type))
+		return 1;
+
+	return getDirectArgumentCount(opcode);
+}
+
+static uint32 getArgumentSize(OpcodeArgument arg) {
+	switch (arg) {
+		case kOpcodeArgUint8:
+			return 1;
+
+		case kOpcodeArgUint16:
+		case kOpcodeArgSint16:
+			return 2;
+
+		case kOpcodeArgSint32:
+		case kOpcodeArgUint32:
+			return 4;
+
+		default:
+			break;
+	}
+
+	return 0;
+}
+
+
+Assembler::Assembler(Common::SeekableReadStream &assembly, Aurora::GameID game) :
+	_game(game), _size(kHeaderSize) {
+
+	const size_t functionCount = getFunctionCount(_game);
+	for (size_t i = 0; i < functionCount; i++) {
+		const Common::UString name = getFunctionName(_game, i);
+		if (!name.empty())
+			_functions.insert(std::make_pair(name, (uint16) i));
+	}
+
+	parse(assembly);
+}
+
+Assembler::~Assembler() {
+}
+
+size_t Assembler::size() const {
+	return _size;
+}
+
+size_t Assembler::getInstructionCount() const {
+	return _statements.size();
+}
+
+void Assembler::parse(Common::SeekableReadStream &assembly) {
+	size_t lineNumber = 0;
+	while (!assembly.eos()) {
+		const Common::UString line = Common::readStringLine(assembly, Common::kEncodingUTF8);
+		lineNumber++;
+
+		try {
+			parseLine(line, lineNumber);
+		} catch (Common::Exception &e) {
+			e.add("Line %u", (uint)lineNumber);
+			throw;
+		}
+	}
+}
+
+void Assembler::parseLine(const Common::UString &line, size_t lineNumber) {
+	std::vector<Common::UString> tokens;
+	tokenizeLine(line, tokens);
+
+	if (tokens.empty())
+		return;
+
+	// A label marks the address of the following instruction
+	if (tokens[0].endsWith(":")) {
+		Common::UString label = tokens[0];
+		label.truncate(label.size() - 1);
+
+		if (label.empty())
+			throw Common::Exception("Empty label");
+
+		if (!_labels.insert(std::make_pair(label, _size)).second)
+			throw Common::Exception("Duplicate label \"%s\"", label.c_str());
+
+		tokens.erase(tokens.begin());
+		if (tokens.empty())
+			return;
+	}
+
+	Statement statement;
+
+	statement.lineNumber = lineNumber;
+	statement.address    = _size;
+
+	if (!parseMnemonic(tokens[0], statement.opcode, statement.type))
+		throw Common::Exception("Unknown instruction \"%s\"", tokens[0].c_str());
+
+	statement.args.assign(tokens.begin() + 1, tokens.end());
+
+	const size_t argCount = getArgumentCount(statement.opcode, statement.type);
+	if (statement.args.size() != argCount)
+		throw Common::Exception("%s takes %u arguments, got %u", tokens[0].c_str(),
+		                        (uint)argCount, (uint)statement.args.size());
+
+	const uint32 size = getSize(statement);
+	if (_size > (0xFFFFFFFF - size))
+		throw Common::Exception("Script too big");
+
+	_size += size;
+
+	_statements.push_back(statement);
+}
+
+uint32 Assembler::getSize(const Statement &statement) const {
+	// Opcode and instruction type
+	uint32 size = 2;
+
+	if (statement.opcode == kOpcodeCONST) {
+		switch (statement.type) {
+			case kInstTypeInt:
+			case kInstTypeFloat:
+			case kInstTypeObject:
+				return size + 4;
+
+			case kInstTypeString:
+			case kInstTypeResource: {
+					std::vector<byte> str;
+					unquoteString(statement.args[0], str);
+
+					return size + 2 + str.size();
+				}
+
+			default:
+				throw Common::Exception("Illegal type for opcode CONST: %s",
+				                        getInstTypeName(statement.type).c_str());
+		}
+	}
+
+	if (statement.opcode == kOpcodeSTORESTATE)
+		return size + 8;
+
+	if (hasStructArgument(statement.opcode, statement.type))
+		return size + 2;
+
+	const OpcodeArgument * const args = getDirectArguments(statement.opcode);
+	for (size_t i = 0; i < statement.args.size(); i++)
+		size += getArgumentSize(args[i]);
+
+	return size;
+}
+
+void Assembler::writeNCS(Common::WriteStream &ncs) const {
+	ncs.writeString("NCS V1.0");
+
+	ncs.writeByte((byte) kOpcodeSCRIPTSIZE);
+	ncs.writeUint32BE(_size);
+
+	for (std::vector<Statement>::const_iterator s = _statements.begin(); s != _statements.end(); ++s) {
+		try {
+			writeInstruction(ncs, *s);
+		} catch (Common::Exception &e) {
+			e.add("Line %u", (uint)s->lineNumber);
+			throw;
+		}
+	}
+
+	ncs.flush();
+}
+
+void Assembler::writeInstruction(Common::WriteStream &ncs, const Statement &statement) const {
+	ncs.writeByte((byte) statement.opcode);
+
+	// STORESTATE stores the offset to the subroutine in the type byte
+	if (statement.opcode == kOpcodeSTORESTATE) {
+		writeStoreState(ncs, statement);
+		return;
+	}
+
+	ncs.writeByte((byte) statement.type);
+
+	if (statement.opcode == kOpcodeCONST) {
+		writeConst(ncs, statement);
+		return;
+	}
+
+	if (statement.opcode == kOpcodeACTION) {
+		writeAction(ncs, statement);
+		return;
+	}
+
+	if ((statement.opcode == kOpcodeJMP) || (statement.opcode == kOpcodeJSR) ||
+	    (statement.opcode == kOpcodeJZ ) || (statement.opcode == kOpcodeJNZ)) {
+
+		ncs.writeSint32BE(getOffset(statement, statement.args[0]));
+		return;
+	}
+
+	if (hasStructArgument(statement.opcode, statement.type)) {
+		uint16 size;
+		Common::parseString(statement.args[0], size);
+
+		ncs.writeUint16BE(size);
+		return;
+	}
+
+	const OpcodeArgument * const args = getDirectArguments(statement.opcode);
+	for (size_t i = 0; i < statement.args.size(); i++) {
+		switch (args[i]) {
+			case kOpcodeArgUint8: {
+					uint8 value;
+					Common::parseString(statement.args[i], value);
+
+					ncs.writeByte(value);
+				}
+				break;
+
+			case kOpcodeArgUint16: {
+					uint16 value;
+					Common::parseString(statement.args[i], value);
+
+					ncs.writeUint16BE(value);
+				}
+				break;
+
+			case kOpcodeArgSint16: {
+					int16 value;
+					Common::parseString(statement.args[i], value);
+
+					ncs.writeSint16BE(value);
+				}
+				break;
+
+			case kOpcodeArgSint32: {
+					int32 value;
+					Common::parseString(statement.args[i], value);
+
+					ncs.writeSint32BE(value);
+				}
+				break;
+
+			case kOpcodeArgUint32: {
+					uint32 value;
+					Common::parseString(statement.args[i], value);
+
+					ncs.writeUint32BE(value);
+				}
+				break;
+
+			default:
+				break;
+		}
+	}
+}
+
+void Assembler::writeConst(Common::WriteStream &ncs, const Statement &statement) const {
+	const Common::UString &arg = statement.args[0];
+
+	switch (statement.type) {
+		case kInstTypeInt: {
+				int32 value;
+				Common::parseString(arg, value);
+
+				ncs.writeSint32BE(value);
+			}
+			break;
+
+		case kInstTypeFloat: {
+				ncs.writeIEEEFloatBE(parseFloat(arg));
+			}
+			break;
+
+		case kInstTypeObject: {
+				// The disassembler prints object IDs as signed values
+				int64 value;
+				Common::parseString(arg, value);
+
+				if ((value < -(int64)0x80000000) || (value > (int64)0xFFFFFFFF))
+					throw Common::Exception("Object ID \"%s\" out of range", arg.c_str());
+
+				ncs.writeUint32BE((uint32) value);
+			}
+			break;
+
+		case kInstTypeString:
+		case kInstTypeResource: {
+				std::vector<byte> str;
+				unquoteString(arg, str);
+
+				ncs.writeUint16BE(str.size());
+				if (!str.empty())
+					ncs.write(&str[0], str.size());
+			}
+			break;
+
+		default:
+			throw Common::Exception("Illegal type for opcode CONST: %s", getInstTypeName(statement.type).c_str());
+	}
+}
+
+void Assembler::writeAction(Common::WriteStream &ncs, const Statement &statement) const {
+	uint8 paramCount;
+	Common::parseString(statement.args[1], paramCount);
+
+	ncs.writeUint16BE(getFunction(statement.args[0]));
+	ncs.writeByte(paramCount);
+}
+
+void Assembler::writeStoreState(Common::WriteStream &ncs, const Statement &statement) const {
+	const int32 offset = getOffset(statement, statement.args[0]);
+	if ((offset < 0) || (offset > 0xFF))
+		throw Common::Exception("STORESTATE destination \"%s\" out of range (%d)",
+		                        statement.args[0].c_str(), offset);
+
+	uint32 sizeBP, sizeSP;
+	Common::parseString(statement.args[1], sizeBP);
+	Common::parseString(statement.args[2], sizeSP);
+
+	ncs.writeByte((byte) offset);
+	ncs.writeUint32BE(sizeBP);
+	ncs.writeUint32BE(sizeSP);
+}
+
+int32 Assembler::getOffset(const Statement &statement, const Common::UString &destination) const {
+	Labels::const_iterator label = _labels.find(destination);
+	if (label != _labels.end())
+		return (int32) (label->second - statement.address);
+
+	// Not a label, so this needs to be a literal relative offset
+	int32 offset;
+	try {
+		Common::parseString(destination, offset);
+	} catch (...) {
+		throw Common::Exception("Unknown label \"%s\"", destination.c_str());
+	}
+
+	return offset;
+}
+
+uint16 Assembler::getFunction(const Common::UString &function) const {
+	Functions::const_iterator f = _functions.find(function);
+	if (f != _functions.end())
+		return f->second;
+
+	/* The disassembler writes functions it doesn't know by number. We
+	 * also accept a bare function number here. */
+
+	Common::UString number = function;
+	if (number.beginsWith(kInvalidFunction))
+		number = number.substr(number.getPosition(std::strlen(kInvalidFunction)), number.end());
+
+	uint16 id;
+	try {
+		Common::parseString(number, id);
+	} catch (...) {
+		throw Common::Exception("Unknown engine function \"%s\"", function.c_str());
+	}
+
+	return id;
+}
+
+} // End of namespace NWScript
@@ -0,0 +1,115 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Assembling NWScript bytecode.
+ */
+
+#ifndef NWSCRIPT_ASSEMBLER_H
+#define NWSCRIPT_ASSEMBLER_H
+
+#include <vector>
+#include <map>
+
+#include "src/common/types.h"
+#include "src/common/ustring.h"
+
+#include "src/aurora/types.h"
+
+#include "src/nwscript/instruction.h"
+
+namespace Common {
+	class SeekableReadStream;
+	class WriteStream;
+}
+
+namespace NWScript {
+
+/** Assemble NWScript bytecode from the assembly written by the disassembler.
+ *
+ *  The assembly format is the one produced by Disassembler::createAssembly():
+ *  one instruction per line, consisting of the opcode name with the type
+ *  suffix appended, followed by the direct arguments. Lines ending in a ":"
+ *  define a jump label, and everything after a ";" is a comment.
+ *
+ *  Jumps, subroutine calls and STORESTATE instructions take a label as their
+ *  destination; the relative offsets are recalculated when assembling. ACTION
+ *  takes the name of the engine function, which requires knowing the game.
+ *
+ *  Assembling the unaltered disassembly of a script recreates the original
+ *  script byte for byte.
+ */
+class Assembler {
+public:
+	Assembler(Common::SeekableReadStream &assembly, Aurora::GameID game = Aurora::kGameIDUnknown);
+	~Assembler();
+
+	/** Return the size of the assembled NCS file, in bytes. */
+	size_t size() const;
+	/** Return the number of assembled instructions. */
+	size_t getInstructionCount() const;
+
+	/** Write the assembled script as an NCS file. */
+	void writeNCS(Common::WriteStream &ncs) const;
+
+
+private:
+	/** A single assembly instruction. */
+	struct Statement {
+		size_t lineNumber; ///< The line in the assembly the instruction is on.
+		uint32 address;    ///< The address of the instruction in the NCS file.
+
+		Opcode opcode;
+		InstructionType type;
+
+		/** The direct arguments, as written in the assembly. */
+		std::vector<Common::UString> args;
+	};
+
+	typedef std::map<Common::UString, uint32> Labels;
+	typedef std::map<Common::UString, uint16> Functions;
+
+	Aurora::GameID _game;
+
+	std::vector<Statement> _statements;
+
+	Labels    _labels;
+	Functions _functions;
+
+	uint32 _size;
+
+
+	void parse(Common::SeekableReadStream &assembly);
+	void parseLine(const Common::UString &line, size_t lineNumber);
+
+	uint32 getSize(const Statement &statement) const;
+
+	void writeInstruction(Common::WriteStream &ncs, const Statement &statement) const;
+	void writeConst(Common::WriteStream &ncs, const Statement &statement) const;
+	void writeAction(Common::WriteStream &ncs, const Statement &statement) const;
+	void writeStoreState(Common::WriteStream &ncs, const Statement &statement) const;
+
+	int32  getOffset(const Statement &statement, const Common::UString &destination) const;
+	uint16 getFunction(const Common::UString &function) const;
+};
+
+} // End of namespace NWScript
+
+#endif // NWSCRIPT_ASSEMBLER_H
@@ -0,0 +1,1649 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Decompiling NWScript bytecode into NSS source.
+ */
+
+#include <cassert>
+
+#include <vector>
+#include <map>
+#include <set>
+#include <algorithm>
+
+#include "src/common/util.h"
+#include "src/common/strutil.h"
+#include "src/common/error.h"
+#include "src/common/writestream.h"
+
+#include "src/nwscript/decompiler.h"
+#include "src/nwscript/ncsfile.h"
+#include "src/nwscript/util.h"
+#include "src/nwscript/game.h"
+
+namespace NWScript {
+
+/** The precedence of an expression's outermost operator. The lower, the tighter it binds. */
+enum Precedence {
+	kPrecedenceAtom           =  0,
+	kPrecedenceUnary          =  1,
+	kPrecedenceMultiplicative =  2,
+	kPrecedenceAdditive       =  3,
+	kPrecedenceShift          =  4,
+	kPrecedenceRelational     =  5,
+	kPrecedenceEquality       =  6,
+	kPrecedenceBitAnd         =  7,
+	kPrecedenceBitXor         =  8,
+	kPrecedenceBitOr          =  9,
+	kPrecedenceLogicalAnd     = 10,
+	kPrecedenceLogicalOr      = 11
+};
+
+/** An expression, rebuilt out of a value on the stack. */
+struct Expression {
+	Common::UString text;
+	Precedence precedence;
+
+	/** Does evaluating this expression call a function? */
+	bool sideEffects;
+
+
+	Expression(const Common::UString &t = "", Precedence p = kPrecedenceAtom, bool s = false) :
+		text(t), precedence(p), sideEffects(s) {
+
+	}
+};
+
+/** A line of decompiled source code. */
+struct Line {
+	size_t indent;
+	Common::UString text;
+
+
+	Line(size_t i, const Common::UString &t) : indent(i), text(t) {
+	}
+};
+
+typedef std::vector<Line> Lines;
+
+/** Information about a script shared between all its decompiled subroutines. */
+struct DecompileScript {
+	const NCSFile *ncs;
+	Aurora::GameID game;
+
+	/** The variables each instruction created, in order of creation. */
+	std::map<const Instruction *, std::vector<const Variable *> > created;
+
+	/** All global variables. */
+	std::set<const Variable *> globals;
+
+	/** STORESTATE subroutines that couldn't be folded into a single expression. */
+	std::vector<Lines> storeStates;
+
+
+	DecompileScript(const NCSFile &n) : ncs(&n), game(n.getGame()) {
+		const VariableSpace &variables = ncs->getVariables();
+		for (VariableSpace::const_iterator v = variables.begin(); v != variables.end(); ++v)
+			if (v->creator)
+				created[v->creator].push_back(&*v);
+
+		const Stack &globalStack = ncs->getGlobals();
+		for (Stack::const_iterator g = globalStack.begin(); g != globalStack.end(); ++g)
+			globals.insert(g->variable);
+	}
+};
+
+/** A loop we're currently decompiling. */
+struct Loop {
+	const Block *head;
+	const Block *tail;
+	const Block *next;
+
+	bool doWhile;
+
+	/** The condition of a do-while loop, once we found it. */
+	bool hasCondition;
+	Expression condition;
+
+
+	Loop(const ControlStructure &control, bool d) : head(control.loopHead), tail(control.loopTail),
+		next(control.loopNext), doWhile(d), hasCondition(false) {
+
+	}
+};
+
+/** What a decompiled block ended with. */
+struct BlockEnd {
+	/** The last instruction of the block. */
+	const Instruction *last;
+
+	/** Does the block end in a conditional jump? */
+	bool conditional;
+	/** The value the conditional jump checks. */
+	Expression condition;
+
+
+	BlockEnd() : last(0), conditional(false) {
+	}
+};
+
+
+static Expression wrap(const Expression &expr, Precedence precedence, bool rightHand = false) {
+	/* Put the expression into parenthesis, if it would otherwise bind less tightly
+	 * than the operator it's an operand of. Right-hand operands are also wrapped
+	 * when they bind equally tight, since all our binary operators are left-associative. */
+
+	if ((expr.precedence < precedence) || (!rightHand && (expr.precedence == precedence)))
+		return expr;
+
+	return Expression("(" + expr.text + ")", kPrecedenceAtom, expr.sideEffects);
+}
+
+static Expression makeUnary(const Common::UString &op, const Expression &expr) {
+	Expression operand = expr;
+	if (operand.precedence >= kPrecedenceUnary)
+		operand = Expression("(" + expr.text + ")", kPrecedenceAtom, expr.sideEffects);
+
+	return Expression(op + operand.text, kPrecedenceUnary, expr.sideEffects);
+}
+
+static Expression makeBinary(const Expression &left, const Common::UString &op,
+                             const Expression &right, Precedence precedence) {
+
+	return Expression(wrap(left, precedence).text + " " + op + " " + wrap(right, precedence, true).text,
+	                  precedence, left.sideEffects || right.sideEffects);
+}
+
+static Expression negate(const Expression &expr) {
+	// Remove an existing negation instead of doubling it
+	if ((expr.precedence == kPrecedenceUnary) && expr.text.beginsWith("!")) {
+		Common::UString text = expr.text;
+		text.erase(text.begin());
+
+		return Expression(text, kPrecedenceAtom, expr.sideEffects);
+	}
+
+	return makeUnary("!", expr);
+}
+
+static Expression makeVector(const Expression &x, const Expression &y, const Expression &z) {
+	// Are these the three components of one vector variable?
+	if (x.text.endsWith(".x")) {
+		Common::UString base = x.text;
+		base.truncate(base.size() - 2);
+
+		if ((y.text == (base + ".y")) && (z.text == (base + ".z")))
+			return Expression(base, kPrecedenceAtom, false);
+	}
+
+	return Expression("Vector(" + x.text + ", " + y.text + ", " + z.text + ")", kPrecedenceAtom,
+	                  x.sideEffects || y.sideEffects || z.sideEffects);
+}
+
+static bool getBinaryOperator(Opcode opcode, Common::UString &op, Precedence &precedence) {
+	switch (opcode) {
+		case kOpcodeLOGAND:   op = "&&";  precedence = kPrecedenceLogicalAnd;     break;
+		case kOpcodeLOGOR:    op = "||";  precedence = kPrecedenceLogicalOr;      break;
+		case kOpcodeINCOR:    op = "|";   precedence = kPrecedenceBitOr;          break;
+		case kOpcodeEXCOR:    op = "^";   precedence = kPrecedenceBitXor;         break;
+		case kOpcodeBOOLAND:  op = "&";   precedence = kPrecedenceBitAnd;         break;
+		case kOpcodeEQ:       op = "==";  precedence = kPrecedenceEquality;       break;
+		case kOpcodeNEQ:      op = "!=";  precedence = kPrecedenceEquality;       break;
+		case kOpcodeGEQ:      op = ">=";  precedence = kPrecedenceRelational;     break;
+		case kOpcodeGT:       op = ">";   precedence = kPrecedenceRelational;     break;
+		case kOpcodeLT:       op = "<";   precedence = kPrecedenceRelational;     break;
+		case kOpcodeLEQ:      op = "<=";  precedence = kPrecedenceRelational;     break;
+		case kOpcodeSHLEFT:   op = "<<";  precedence = kPrecedenceShift;          break;
+		case kOpcodeSHRIGHT:  op = ">>";  precedence = kPrecedenceShift;          break;
+		case kOpcodeUSHRIGHT: op = ">>>"; precedence = kPrecedenceShift;          break;
+		case kOpcodeADD:      op = "+";   precedence = kPrecedenceAdditive;       break;
+		case kOpcodeSUB:      op = "-";   precedence = kPrecedenceAdditive;       break;
+		case kOpcodeMUL:      op = "*";   precedence = kPrecedenceMultiplicative; break;
+		case kOpcodeDIV:      op = "/";   precedence = kPrecedenceMultiplicative; break;
+		case kOpcodeMOD:      op = "%";   precedence = kPrecedenceMultiplicative; break;
+
+		default:
+			return false;
+	}
+
+	return true;
+}
+
+static size_t getStackOffset(const Instruction &instr, int32 offset) {
+	if ((offset > -4) || ((offset % 4) != 0))
+		throw Common::Exception("@%08X: Invalid stack offset %d", instr.address, offset);
+
+	return (offset / -4) - 1;
+}
+
+static size_t getStackSize(const Instruction &instr, int32 size) {
+	if ((size < 0) || ((size % 4) != 0))
+		throw Common::Exception("@%08X: Invalid stack size %d", instr.address, size);
+
+	return size / 4;
+}
+
+/** Return the children of a block that continue the control flow within the subroutine. */
+static std::vector<const Block *> getFlowChildren(const Block &block) {
+	std::vector<const Block *> children;
+
+	for (size_t i = 0; i < block.children.size(); i++) {
+		if ((block.childrenTypes[i] == kBlockEdgeTypeSubRoutineCall ) ||
+		    (block.childrenTypes[i] == kBlockEdgeTypeSubRoutineStore) ||
+		    (block.childrenTypes[i] == kBlockEdgeTypeDead           ))
+			continue;
+
+		if (std::find(children.begin(), children.end(), block.children[i]) == children.end())
+			children.push_back(block.children[i]);
+	}
+
+	return children;
+}
+
+static bool isVoid(const SubRoutine &sub) {
+	return sub.returns.empty();
+}
+
+static bool isVector(const std::vector<const Variable *> &vars) {
+	if (vars.size() != 3)
+		return false;
+
+	for (std::vector<const Variable *>::const_iterator v = vars.begin(); v != vars.end(); ++v)
+		if (!*v || ((*v)->type != kTypeFloat))
+			return false;
+
+	return true;
+}
+
+
+/** Decompiles the code of a single subroutine. */
+class SubRoutineDecompiler {
+public:
+	SubRoutineDecompiler(DecompileScript &script, const SubRoutine &sub, size_t indent,
+	                     const SubRoutineDecompiler *parent = 0, const Instruction *storeState = 0) :
+		_script(&script), _sub(&sub), _parent(parent), _storeState(storeState),
+		_baseIndent(indent), _indent(indent), _global(false), _stopped(false),
+		_hasStoredAction(false), _returned(false) {
+
+	}
+
+	/** Decompile the global variables set up in the _global subroutine. */
+	void decompileGlobals() {
+		_global = true;
+
+		if (!_sub->blocks.empty())
+			decompileBlocks(_sub->blocks.front());
+	}
+
+	/** Decompile the body of the subroutine. */
+	void decompileBody() {
+		if (!_sub->blocks.empty())
+			decompileBlocks(_sub->blocks.front());
+
+		// A return at the very end of a function returning nothing is implied
+		if (isVoid(*_sub) && !_lines.empty() &&
+		    (_lines.back().indent == _baseIndent) && (_lines.back().text == "return;"))
+			_lines.pop_back();
+	}
+
+	/** Return the signature of the subroutine. */
+	Common::UString getSignature() const {
+		Common::UString returnType = formatReturn(_sub->returns, _script->game);
+		if (isVector(_sub->returns))
+			returnType = "vector";
+
+		return returnType + " " + formatJumpLabelName(*_sub) + "(" +
+		       formatParameters(_sub->params, _script->game, true) + ")";
+	}
+
+	/** Return the decompiled code, with hoisted variable declarations first. */
+	Lines getLines() const {
+		Lines lines = _declarations;
+
+		lines.insert(lines.end(), _lines.begin(), _lines.end());
+
+		return lines;
+	}
+
+	/** Does the decompiled code consist of nothing but a single expression statement? */
+	bool getSingleExpression(Common::UString &expr) const {
+		if (!_declarations.empty() || (_lines.size() != 1) || !_lines[0].text.endsWith(";"))
+			return false;
+
+		expr = _lines[0].text;
+		expr.truncate(expr.size() - 1);
+
+		// A declaration or assignment is not an expression we can pass around
+		return !expr.contains(" = ");
+	}
+
+
+private:
+	DecompileScript *_script;
+
+	const SubRoutine *_sub;
+
+	/** The subroutine that created this STORESTATE subroutine. */
+	const SubRoutineDecompiler *_parent;
+	/** The STORESTATE instruction that created this subroutine. */
+	const Instruction *_storeState;
+
+	size_t _baseIndent;
+	size_t _indent;
+
+	/** Are we decompiling the globals? */
+	bool _global;
+	/** Did we reach the end of the globals? */
+	bool _stopped;
+
+	Lines _lines;
+	Lines _declarations;
+
+	/** Values on the stack that have not been written into a variable yet. */
+	std::map<const Variable *, Expression> _pending;
+	/** Variables that have been reserved on the stack, but not yet declared. */
+	std::set<const Variable *> _slots;
+	/** Sibling groups of variables we already declared. */
+	std::set<size_t> _declared;
+	/** Sibling groups of variables that are members of a vector variable. */
+	std::map<size_t, Common::UString> _members;
+
+	std::set<const Block *> _visited;
+	std::vector<const Block *> _stops;
+	std::vector<Loop> _loops;
+
+	/** The subroutine a STORESTATE created, to be passed to an engine function. */
+	bool _hasStoredAction;
+	Expression _storedAction;
+
+	/** The parts of the return value we've seen so far. */
+	std::map<size_t, Expression> _returnValues;
+	/** Did we already write a return statement for the current block? */
+	bool _returned;
+
+
+	// .--- Variables
+
+	const Variable &getStackVariable(const Instruction &instr, size_t offset) const {
+		if (offset < instr.stack.size()) {
+			if (!instr.stack[offset].variable)
+				throw Common::Exception("@%08X: Missing stack variable", instr.address);
+
+			return *instr.stack[offset].variable;
+		}
+
+		offset -= instr.stack.size();
+
+		// The stack of a STORESTATE subroutine continues into the stack of its creator
+		if (_parent && _storeState)
+			return _parent->getStackVariable(*_storeState, offset);
+
+		// Below the stack frame of the subroutine, there are the parameters, then the return values
+
+		if (offset < _sub->params.size())
+			return *_sub->params[offset];
+
+		offset -= _sub->params.size();
+
+		if ((offset < _sub->returns.size()) && _sub->returns[offset])
+			return *_sub->returns[offset];
+
+		throw Common::Exception("@%08X: Stack underrun", instr.address);
+	}
+
+	const std::vector<const Variable *> &getCreated(const Instruction &instr, size_t count) const {
+		std::map<const Instruction *, std::vector<const Variable *> >::const_iterator c =
+			_script->created.find(&instr);
+
+		if ((c == _script->created.end()) || (c->second.size() < count))
+			throw Common::Exception("@%08X: Missing created variables", instr.address);
+
+		return c->second;
+	}
+
+	bool isParameter(const Variable &var) const {
+		if (std::find(_sub->params.begin(), _sub->params.end(), &var) != _sub->params.end())
+			return true;
+
+		return _parent && _parent->isParameter(var);
+	}
+
+	bool isGlobal(const Variable &var) const {
+		return _script->globals.find(&var) != _script->globals.end();
+	}
+
+	bool isDeclared(const Variable &var) const {
+		if (isParameter(var) || (isGlobal(var) && !_global))
+			return true;
+
+		if (_declared.find(var.getLowestSibling()) != _declared.end())
+			return true;
+
+		return _parent && _parent->isDeclared(var);
+	}
+
+	Common::UString getName(const Variable &var) const {
+		std::map<size_t, Common::UString>::const_iterator m = _members.find(var.getLowestSibling());
+		if (m != _members.end())
+			return m->second;
+
+		if (_parent && !isParameter(var) && !isGlobal(var))
+			return _parent->getName(var);
+
+		if (isParameter(var))
+			return "arg_" + Common::composeString(var.id);
+
+		if (isGlobal(var))
+			return "global_" + Common::composeString(var.id);
+
+		return "var_" + Common::composeString(var.getLowestSibling());
+	}
+
+	Common::UString getTypeName(VariableType type) const {
+		if ((type == kTypeAny) || (type == kTypeVoid))
+			type = kTypeInt;
+
+		return getVariableTypeName(type, _script->game).toLower();
+	}
+
+	const Expression *findPending(const Variable &var) const {
+		std::map<const Variable *, Expression>::const_iterator p = _pending.find(&var);
+		if (p != _pending.end())
+			return &p->second;
+
+		return _parent ? _parent->findPending(var) : 0;
+	}
+
+	void setPending(const Variable &var, const Expression &expr) {
+		_slots.erase(&var);
+		_pending[&var] = expr;
+	}
+
+	/** Should the declaration of this variable be moved to the start of the subroutine?
+	 *
+	 *  This is necessary when the variable is declared within a nested block,
+	 *  but the same logical variable is also used outside of it.
+	 */
+	bool needsHoisting(const Variable &var) const {
+		return !_global && (_indent > _baseIndent) && !var.siblings.empty();
+	}
+
+	void declare(const Variable &var) {
+		if (isDeclared(var))
+			return;
+
+		_declared.insert(var.getLowestSibling());
+
+		const Common::UString declaration = getTypeName(var.type) + " " + getName(var) + ";";
+
+		if (needsHoisting(var))
+			_declarations.push_back(Line(_baseIndent, declaration));
+		else
+			addLine(declaration);
+	}
+
+	void assign(const Variable &var, const Expression &expr) {
+		const Common::UString name = getName(var);
+		if (expr.text == name)
+			return;
+
+		if (isDeclared(var) || needsHoisting(var)) {
+			declare(var);
+			addLine(name + " = " + expr.text + ";");
+			return;
+		}
+
+		_declared.insert(var.getLowestSibling());
+		addLine(getTypeName(var.type) + " " + name + " = " + expr.text + ";");
+	}
+
+	/** Return the expression for this variable, and optionally remove it from the pending values. */
+	Expression getExpression(const Variable &var, bool consume = true) {
+		std::map<const Variable *, Expression>::iterator p = _pending.find(&var);
+		if (p != _pending.end()) {
+			const Expression expr = p->second;
+			if (consume)
+				_pending.erase(p);
+
+			return expr;
+		}
+
+		// Reading a variable that was reserved, but never written
+		if (_slots.erase(&var))
+			declare(var);
+
+		// A STORESTATE subroutine can read the values of its creator
+		if (_parent) {
+			const Expression *expr = _parent->findPending(var);
+			if (expr && !expr->sideEffects)
+				return *expr;
+		}
+
+		return Expression(getName(var));
+	}
+
+	Expression getStackExpression(const Instruction &instr, size_t offset, bool consume = true) {
+		return getExpression(getStackVariable(instr, offset), consume);
+	}
+
+	/** Write a pending value into its variable. */
+	void materialize(const Variable &var) {
+		std::map<const Variable *, Expression>::iterator p = _pending.find(&var);
+		if (p != _pending.end()) {
+			const Expression expr = p->second;
+			_pending.erase(p);
+
+			assign(var, expr);
+			return;
+		}
+
+		if (_slots.erase(&var))
+			declare(var);
+	}
+
+	/** Write all pending values on the stack into variables, from the bottom up. */
+	void materializeStack(const Instruction &instr, const std::set<const Variable *> &except) {
+		if (_pending.empty() && _slots.empty())
+			return;
+
+		for (size_t i = instr.stack.size(); i-- > 0; ) {
+			const Variable *var = instr.stack[i].variable;
+			if (var && (except.find(var) == except.end()))
+				materialize(*var);
+		}
+	}
+
+	void materializeStack(const Instruction &instr) {
+		materializeStack(instr, std::set<const Variable *>());
+	}
+
+	/** Write a statement, making sure all values calculated before it are kept. */
+	void addStatement(const Instruction &instr, const Common::UString &statement,
+	                  const std::set<const Variable *> &except) {
+
+		materializeStack(instr, except);
+		addLine(statement);
+	}
+
+	void addLine(const Common::UString &line) {
+		_lines.push_back(Line(_indent, line));
+	}
+
+	// '--- Variables
+
+	// .--- Instructions
+
+	void decompileBlock(const Block &block, BlockEnd &end) {
+		_returned = false;
+
+		for (std::vector<const Instruction *>::const_iterator i = block.instructions.begin();
+		     i != block.instructions.end(); ++i) {
+
+			assert(*i);
+
+			end.last = *i;
+			decompileInstruction(**i, end);
+
+			if (_stopped)
+				break;
+		}
+	}
+
+	void decompileInstruction(const Instruction &instr, BlockEnd &end) {
+		switch (instr.opcode) {
+			case kOpcodeCPDOWNSP:
+			case kOpcodeCPDOWNBP:
+				decompileCopyDown(instr);
+				break;
+
+			case kOpcodeCPTOPSP:
+			case kOpcodeCPTOPBP:
+				decompileCopyTop(instr);
+				break;
+
+			case kOpcodeRSADD:
+				_slots.insert(getCreated(instr, 1)[0]);
+				break;
+
+			case kOpcodeCONST:
+				decompileConst(instr);
+				break;
+
+			case kOpcodeACTION:
+				decompileAction(instr);
+				break;
+
+			case kOpcodeLOGAND:
+			case kOpcodeLOGOR:
+			case kOpcodeINCOR:
+			case kOpcodeEXCOR:
+			case kOpcodeBOOLAND:
+			case kOpcodeGEQ:
+			case kOpcodeGT:
+			case kOpcodeLT:
+			case kOpcodeLEQ:
+			case kOpcodeSHLEFT:
+			case kOpcodeSHRIGHT:
+			case kOpcodeUSHRIGHT:
+			case kOpcodeMOD:
+				decompileBinary(instr);
+				break;
+
+			case kOpcodeEQ:
+			case kOpcodeNEQ:
+				decompileEquality(instr);
+				break;
+
+			case kOpcodeADD:
+			case kOpcodeSUB:
+			case kOpcodeMUL:
+			case kOpcodeDIV:
+				decompileArithmetic(instr);
+				break;
+
+			case kOpcodeNEG:
+				setPending(*getCreated(instr, 1)[0], makeUnary("-", getStackExpression(instr, 0)));
+				break;
+
+			case kOpcodeCOMP:
+				setPending(*getCreated(instr, 1)[0], makeUnary("~", getStackExpression(instr, 0)));
+				break;
+
+			case kOpcodeNOT:
+				setPending(*getCreated(instr, 1)[0], negate(getStackExpression(instr, 0)));
+				break;
+
+			case kOpcodeMOVSP:
+				decompilePop(instr, getStackSize(instr, -instr.args[0]));
+				break;
+
+			case kOpcodeJSR:
+				decompileCall(instr);
+				break;
+
+			case kOpcodeJZ:
+			case kOpcodeJNZ:
+				end.conditional = true;
+				end.condition   = getStackExpression(instr, 0);
+
+				materializeStack(instr);
+				break;
+
+			case kOpcodeDESTRUCT:
+				decompileDestruct(instr);
+				break;
+
+			case kOpcodeDECSP:
+			case kOpcodeINCSP:
+			case kOpcodeDECBP:
+			case kOpcodeINCBP:
+				decompileIncDec(instr);
+				break;
+
+			case kOpcodeSAVEBP:
+				// In the _global subroutine, this finalizes the global variables
+				if (_global) {
+					materializeStack(instr);
+					_stopped = true;
+				}
+				break;
+
+			case kOpcodeSTORESTATE:
+				decompileStoreState(instr);
+				break;
+
+			case kOpcodeREADARRAY:
+			case kOpcodeWRITEARRAY:
+			case kOpcodeGETREF:
+			case kOpcodeGETREFARRAY:
+				decompileArray(instr);
+				break;
+
+			default:
+				// JMP, RETN, RESTOREBP, NOP and friends don't leave anything in the source
+				break;
+		}
+	}
+
+	void decompileCopyDown(const Instruction &instr) {
+		/* Copy values from the top of the stack down into variables. This is an
+		 * assignment, or, when copying into the return value, a return statement. */
+
+		const bool global = instr.opcode == kOpcodeCPDOWNBP;
+		const size_t size = getStackSize(instr, instr.args[1]);
+		size_t offset     = getStackOffset(instr, instr.args[0]);
+
+		const Stack &globals = _script->ncs->getGlobals();
+
+		std::vector<const Variable *> sources, targets;
+		std::set<const Variable *> except;
+
+		for (size_t i = 0; i < size; i++, offset--) {
+			const Variable &source = getStackVariable(instr, size - 1 - i);
+
+			const Variable *target = 0;
+			if (global) {
+				if ((offset >= globals.size()) || !globals[offset].variable)
+					throw Common::Exception("@%08X: Globals underrun", instr.address);
+
+				target = globals[offset].variable;
+			} else
+				target = &getStackVariable(instr, offset);
+
+			sources.push_back(&source);
+			targets.push_back(target);
+
+			except.insert(&source);
+			if (_slots.find(target) != _slots.end())
+				except.insert(target);
+		}
+
+		materializeStack(instr, except);
+
+		for (size_t i = 0; i < size; i++) {
+			const Expression value = getExpression(*sources[i], false);
+
+			std::vector<const Variable *>::const_iterator r =
+				std::find(_sub->returns.begin(), _sub->returns.end(), targets[i]);
+
+			if (!global && (r != _sub->returns.end())) {
+				addReturnValue(r - _sub->returns.begin(), value);
+				continue;
+			}
+
+			_slots.erase(targets[i]);
+			assign(*targets[i], value);
+
+			// The value stays on the stack, but it's now found in the variable
+			if (_pending.find(sources[i]) != _pending.end())
+				setPending(*sources[i], Expression(getName(*targets[i])));
+		}
+	}
+
+	void addReturnValue(size_t index, const Expression &value) {
+		_returnValues[index] = value;
+		if (_returnValues.size() < _sub->returns.size())
+			return;
+
+		Expression result = _returnValues[0];
+		if (isVector(_sub->returns))
+			result = makeVector(_returnValues[2], _returnValues[1], _returnValues[0]);
+		else if (_sub->returns.size() > 1)
+			throw Common::Exception("Returning structs is not supported");
+
+		addLine("return " + result.text + ";");
+
+		_returnValues.clear();
+		_returned = true;
+	}
+
+	void decompileCopyTop(const Instruction &instr) {
+		/* Copy variables onto the top of the stack. */
+
+		const bool global = instr.opcode == kOpcodeCPTOPBP;
+		const size_t size = getStackSize(instr, instr.args[1]);
+		size_t offset     = getStackOffset(instr, instr.args[0]);
+
+		const Stack &globals = _script->ncs->getGlobals();
+		const std::vector<const Variable *> &created = getCreated(instr, size);
+
+		for (size_t i = 0; i < size; i++, offset--) {
+			const Variable *source = 0;
+			if (global) {
+				if ((offset >= globals.size()) || !globals[offset].variable)
+					throw Common::Exception("@%08X: Globals underrun", instr.address);
+
+				source = globals[offset].variable;
+			} else
+				source = &getStackVariable(instr, offset);
+
+			// A value that's read more than once needs to live in a variable
+			if (_pending.find(source) != _pending.end())
+				materializeStack(instr);
+
+			setPending(*created[i], getExpression(*source, false));
+		}
+	}
+
+	void decompileConst(const Instruction &instr) {
+		const Variable &var = *getCreated(instr, 1)[0];
+
+		switch (instr.type) {
+			case kInstTypeInt:
+				setPending(var, Expression(Common::composeString(instr.constValueInt),
+				                           (instr.constValueInt < 0) ? kPrecedenceUnary : kPrecedenceAtom));
+				break;
+
+			case kInstTypeFloat:
+				setPending(var, Expression(formatFloat(instr.constValueFloat),
+				                           (instr.constValueFloat < 0.0f) ? kPrecedenceUnary : kPrecedenceAtom));
+				break;
+
+			case kInstTypeString:
+			case kInstTypeResource:
+				setPending(var, Expression("\"" + *instr.constValueString + "\""));
+				break;
+
+			case kInstTypeObject:
+				if      (instr.constValueObject == 0)
+					setPending(var, Expression("OBJECT_SELF"));
+				else if (instr.constValueObject == 1)
+					setPending(var, Expression("OBJECT_INVALID"));
+				else
+					setPending(var, Expression(Common::composeString(instr.constValueObject)));
+				break;
+
+			default:
+				throw Common::Exception("@%08X: Invalid constant type %u", instr.address, (uint)instr.type);
+		}
+	}
+
+	void decompileAction(const Instruction &instr) {
+		/* Call an engine function. */
+
+		const Aurora::GameID game = _script->game;
+
+		const size_t function   = (size_t)instr.args[0];
+		const size_t paramCount = (size_t)instr.args[1];
+
+		if (!hasFunction(game, function) || (getFunctionParameterCount(game, function) < paramCount))
+			throw Common::Exception("@%08X: Invalid engine function call", instr.address);
+
+		const VariableType *types = getFunctionParameters(game, function);
+
+		Common::UString args;
+		size_t offset = 0;
+
+		std::set<const Variable *> except;
+		for (size_t i = 0; i < paramCount; i++) {
+			Expression arg;
+
+			if (types[i] == kTypeScriptState) {
+				// The script state isn't put on the stack, it has been created by a STORESTATE
+				arg = _hasStoredAction ? _storedAction : Expression("/* unknown action */");
+				_hasStoredAction = false;
+
+			} else if (types[i] == kTypeVector) {
+				const Expression z = getStackExpression(instr, offset++);
+				const Expression y = getStackExpression(instr, offset++);
+				const Expression x = getStackExpression(instr, offset++);
+
+				arg = makeVector(x, y, z);
+
+			} else
+				arg = getStackExpression(instr, offset++);
+
+			args += ((i > 0) ? ", " : "") + arg.text;
+		}
+
+		for (size_t i = 0; i < offset; i++)
+			except.insert(&getStackVariable(instr, i));
+
+		const Expression call(getFunctionName(game, function) + "(" + args + ")", kPrecedenceAtom, true);
+
+		const VariableType returnType = getFunctionReturnType(game, function);
+		if (returnType == kTypeVoid) {
+			addStatement(instr, call.text + ";", except);
+			return;
+		}
+
+		if (returnType == kTypeVector) {
+			materializeStack(instr, except);
+			setVector(getCreated(instr, 3), call);
+			return;
+		}
+
+		setPending(*getCreated(instr, 1)[0], call);
+	}
+
+	/** Write a vector value into a new vector variable, whose members are the three components. */
+	void setVector(const std::vector<const Variable *> &components, const Expression &value) {
+		static const char * const kMembers[] = { ".x", ".y", ".z" };
+
+		const Common::UString name = "vec_" + Common::composeString(components[0]->getLowestSibling());
+
+		bool hoist = false;
+		for (size_t i = 0; i < 3; i++) {
+			_slots.erase(components[i]);
+			_pending.erase(components[i]);
+
+			_members[components[i]->getLowestSibling()] = name + kMembers[i];
+			_declared.insert(components[i]->getLowestSibling());
+
+			hoist = hoist || needsHoisting(*components[i]);
+		}
+
+		if (hoist) {
+			_declarations.push_back(Line(_baseIndent, "vector " + name + ";"));
+			addLine(name + " = " + value.text + ";");
+		} else
+			addLine("vector " + name + " = " + value.text + ";");
+	}
+
+	void decompileBinary(const Instruction &instr) {
+		Common::UString op;
+		Precedence precedence;
+		if (!getBinaryOperator(instr.opcode, op, precedence))
+			throw Common::Exception("@%08X: Invalid binary operator", instr.address);
+
+		const Expression right = getStackExpression(instr, 0);
+		const Expression left  = getStackExpression(instr, 1);
+
+		setPending(*getCreated(instr, 1)[0], makeBinary(left, op, right, precedence));
+	}
+
+	void decompileEquality(const Instruction &instr) {
+		/* Compare values. Structs compare several values at once, and the vector
+		 * comparison compares three floats. */
+
+		size_t size = 1;
+		if (instr.argCount == 1)
+			size = getStackSize(instr, instr.args[0]);
+		else if (instr.type == kInstTypeVectorVector)
+			size = 3;
+
+		Common::UString op;
+		Precedence precedence;
+		getBinaryOperator(instr.opcode, op, precedence);
+
+		const Variable &result = *getCreated(instr, 1)[0];
+
+		if (size == 1) {
+			decompileBinary(instr);
+			return;
+		}
+
+		std::vector<Expression> right, left;
+		for (size_t i = 0; i < size; i++)
+			right.push_back(getStackExpression(instr, i));
+		for (size_t i = 0; i < size; i++)
+			left.push_back(getStackExpression(instr, size + i));
+
+		if (size == 3) {
+			setPending(result, makeBinary(makeVector(left[2], left[1], left[0]), op,
+			                              makeVector(right[2], right[1], right[0]), precedence));
+			return;
+		}
+
+		// Compare the struct member-wise
+		const bool equal = instr.opcode == kOpcodeEQ;
+
+		Expression expr;
+		for (size_t i = size; i-- > 0; ) {
+			const Expression member = makeBinary(left[i], op, right[i], precedence);
+
+			if (i == (size - 1))
+				expr = member;
+			else
+				expr = makeBinary(expr, equal ? "&&" : "||", member,
+				                  equal ? kPrecedenceLogicalAnd : kPrecedenceLogicalOr);
+		}
+
+		setPending(result, expr);
+	}
+
+	void decompileArithmetic(const Instruction &instr) {
+		/* Arithmetic on vectors creates a new vector, everything else works like
+		 * any other binary operator. */
+
+		Common::UString op;
+		Precedence precedence;
+		getBinaryOperator(instr.opcode, op, precedence);
+
+		Expression left, right;
+
+		switch (instr.type) {
+			case kInstTypeVectorVector:
+				right = makeVector(getStackExpression(instr, 2), getStackExpression(instr, 1),
+				                   getStackExpression(instr, 0));
+				left  = makeVector(getStackExpression(instr, 5), getStackExpression(instr, 4),
+				                   getStackExpression(instr, 3));
+				break;
+
+			case kInstTypeVectorFloat:
+				right = getStackExpression(instr, 0);
+				left  = makeVector(getStackExpression(instr, 3), getStackExpression(instr, 2),
+				                   getStackExpression(instr, 1));
+				break;
+
+			case kInstTypeFloatVector:
+				right = makeVector(getStackExpression(instr, 2), getStackExpression(instr, 1),
+				                   getStackExpression(instr, 0));
+				left  = getStackExpression(instr, 3);
+				break;
+
+			default:
+				decompileBinary(instr);
+				return;
+		}
+
+		std::set<const Variable *> except;
+		for (size_t i = 0; i < ((instr.type == kInstTypeVectorVector) ? 6 : 4); i++)
+			except.insert(&getStackVariable(instr, i));
+
+		materializeStack(instr, except);
+		setVector(getCreated(instr, 3), makeBinary(left, op, right, precedence));
+	}
+
+	void decompilePop(const Instruction &instr, size_t size) {
+		/* Remove values from the stack. Values with side effects, like return values
+		 * of function calls nobody cares about, still need to be evaluated. */
+
+		size = MIN(size, instr.stack.size());
+
+		std::set<const Variable *> popped;
+		for (size_t i = 0; i < size; i++)
+			popped.insert(&getStackVariable(instr, i));
+
+		materializeStack(instr, popped);
+
+		for (size_t i = size; i-- > 0; ) {
+			const Variable &var = getStackVariable(instr, i);
+
+			std::map<const Variable *, Expression>::iterator p = _pending.find(&var);
+			if (p != _pending.end()) {
+				if (p->second.sideEffects)
+					addLine(p->second.text + ";");
+
+				_pending.erase(p);
+			}
+
+			_slots.erase(&var);
+		}
+	}
+
+	void decompileCall(const Instruction &instr) {
+		/* Call a subroutine. The parameters are on top of the stack, the space
+		 * for the return value directly below. */
+
+		if (instr.branches.empty() || !instr.branches[0] || !instr.branches[0]->block ||
+		    !instr.branches[0]->block->subRoutine)
+			throw Common::Exception("@%08X: Call into an unknown subroutine", instr.address);
+
+		const SubRoutine &sub = *instr.branches[0]->block->subRoutine;
+
+		const size_t paramCount  = sub.params.size();
+		const size_t returnCount = sub.returns.size();
+
+		Common::UString args;
+		std::set<const Variable *> except;
+
+		for (size_t i = 0; i < paramCount; i++) {
+			args += ((i > 0) ? ", " : "") + getStackExpression(instr, i).text;
+			except.insert(&getStackVariable(instr, i));
+		}
+
+		const Expression call(formatJumpLabelName(sub) + "(" + args + ")", kPrecedenceAtom, true);
+
+		if (returnCount == 0) {
+			addStatement(instr, call.text + ";", except);
+			return;
+		}
+
+		std::vector<const Variable *> returns;
+		for (size_t i = 0; i < returnCount; i++) {
+			returns.push_back(&getStackVariable(instr, paramCount + i));
+			except.insert(returns.back());
+		}
+
+		if (returnCount == 1) {
+			setPending(*returns[0], call);
+			return;
+		}
+
+		if (!isVector(sub.returns))
+			throw Common::Exception("@%08X: Returning structs is not supported", instr.address);
+
+		materializeStack(instr, except);
+
+		std::vector<const Variable *> components;
+		components.push_back(returns[2]);
+		components.push_back(returns[1]);
+		components.push_back(returns[0]);
+
+		setVector(components, call);
+	}
+
+	void decompileDestruct(const Instruction &instr) {
+		/* Remove parts of a struct from the stack, keeping a few members. */
+
+		materializeStack(instr);
+
+		const size_t size = getStackSize(instr, instr.args[0]);
+		for (size_t i = 0; i < size; i++)
+			_pending.erase(&getStackVariable(instr, i));
+	}
+
+	void decompileIncDec(const Instruction &instr) {
+		const bool global = (instr.opcode == kOpcodeDECBP) || (instr.opcode == kOpcodeINCBP);
+		const bool inc    = (instr.opcode == kOpcodeINCSP) || (instr.opcode == kOpcodeINCBP);
+
+		const size_t offset = getStackOffset(instr, instr.args[0]);
+
+		const Variable *var = 0;
+		if (global) {
+			const Stack &globals = _script->ncs->getGlobals();
+			if ((offset >= globals.size()) || !globals[offset].variable)
+				throw Common::Exception("@%08X: Globals underrun", instr.address);
+
+			var = globals[offset].variable;
+		} else
+			var = &getStackVariable(instr, offset);
+
+		materializeStack(instr);
+
+		addLine(getExpression(*var, false).text + (inc ? "++;" : "--;"));
+	}
+
+	void decompileStoreState(const Instruction &instr) {
+		/* Create a functor for an engine function taking an action. The functor
+		 * is a subroutine evaluated later, with a copy of the current stack. */
+
+		if (instr.branches.empty() || !instr.branches[0] || !instr.branches[0]->block ||
+		    !instr.branches[0]->block->subRoutine)
+			throw Common::Exception("@%08X: STORESTATE of an unknown subroutine", instr.address);
+
+		const SubRoutine &sub = *instr.branches[0]->block->subRoutine;
+
+		SubRoutineDecompiler storeState(*_script, sub, 1, this, &instr);
+		storeState.decompileBody();
+
+		Common::UString expr;
+		if (!storeState.getSingleExpression(expr)) {
+			// Not a simple expression, so put it into its own function
+			Lines lines;
+
+			lines.push_back(Line(0, "// Created by a STORESTATE in " + formatJumpLabelName(*_sub) +
+			                        "; uses its variables"));
+			lines.push_back(Line(0, "void " + formatJumpLabelName(sub) + "() {"));
+
+			const Lines body = storeState.getLines();
+			lines.insert(lines.end(), body.begin(), body.end());
+
+			lines.push_back(Line(0, "}"));
+
+			_script->storeStates.push_back(lines);
+
+			expr = formatJumpLabelName(sub) + "()";
+		}
+
+		_hasStoredAction = true;
+		_storedAction    = Expression(expr, kPrecedenceAtom, true);
+	}
+
+	void decompileArray(const Instruction &instr) {
+		/* Array and reference access, only used in Dragon Age scripts. */
+
+		const size_t offset = getStackOffset(instr, instr.args[0]);
+
+		switch (instr.opcode) {
+			case kOpcodeGETREF: {
+					const Variable &var = getStackVariable(instr, offset);
+					if (_pending.find(&var) != _pending.end())
+						materializeStack(instr);
+
+					setPending(*getCreated(instr, 1)[0], Expression(getName(var)));
+				}
+				break;
+
+			case kOpcodeREADARRAY:
+			case kOpcodeGETREFARRAY: {
+					const Expression index = getStackExpression(instr, 0);
+
+					const Variable &array = getStackVariable(instr, offset);
+					if (_pending.find(&array) != _pending.end())
+						materializeStack(instr);
+
+					setPending(*getCreated(instr, 1)[0], Expression(getName(array) + "[" + index.text + "]"));
+				}
+				break;
+
+			case kOpcodeWRITEARRAY: {
+					const Expression index = getStackExpression(instr, 0);
+					const Expression value = getStackExpression(instr, 1, false);
+
+					std::set<const Variable *> except;
+					except.insert(&getStackVariable(instr, 0));
+					except.insert(&getStackVariable(instr, 1));
+
+					const Variable &array = getStackVariable(instr, offset);
+					const Common::UString element = getName(array) + "[" + index.text + "]";
+
+					materializeStack(instr, except);
+					addLine(element + " = " + value.text + ";");
+
+					setPending(getStackVariable(instr, 1), Expression(element));
+				}
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	// '--- Instructions
+
+	// .--- Control flow
+
+	bool isStop(const Block &block) const {
+		return std::find(_stops.begin(), _stops.end(), &block) != _stops.end();
+	}
+
+	Loop *getLoop() {
+		return _loops.empty() ? 0 : &_loops.back();
+	}
+
+	static bool isLoopBoundary(const Loop &loop, const Block &block) {
+		return (&block == loop.head) || (&block == loop.tail) || (&block == loop.next);
+	}
+
+	/** Return the condition under which the control flow goes from this block into that child. */
+	Expression getCondition(const Block &block, const Block &child, const BlockEnd &end) const {
+		const size_t index = findParentChildBlock(block, child);
+		if ((index == SIZE_MAX) || !end.last)
+			return end.condition;
+
+		// The jump is taken when the value is zero (JZ) or not zero (JNZ)
+		const bool jump    = block.childrenTypes[index] == kBlockEdgeTypeConditionalTrue;
+		const bool notZero = jump == (end.last->opcode == kOpcodeJNZ);
+
+		return notZero ? end.condition : negate(end.condition);
+	}
+
+	/** Write all pending values at the end of this block. */
+	void materializeBlockEnd(const BlockEnd &end) {
+		if (!end.last)
+			return;
+
+		if ((end.last->opcode == kOpcodeJMP) || !end.last->follower)
+			materializeStack(*end.last);
+		else
+			materializeStack(*end.last->follower);
+	}
+
+	void decompileBlocks(const Block *block) {
+		/* Decompile a sequence of blocks, until we reach a block that ends the
+		 * current control structure. */
+
+		while (block && !_stopped) {
+			if (isStop(*block))
+				return;
+
+			// A loop starts here
+			if (block->isLoopHead() && (!getLoop() || (getLoop()->head != block))) {
+				block = decompileLoop(*block);
+				continue;
+			}
+
+			// Reaching the start of the loop again is the natural end of the loop body
+			if (getLoop() && (getLoop()->head == block) && (_visited.find(block) != _visited.end()))
+				return;
+
+			if (!_visited.insert(block).second) {
+				addLine("// Jump back to " + formatJumpDestination(block->address));
+				return;
+			}
+
+			BlockEnd end;
+			decompileBlock(*block, end);
+
+			if (_stopped || _returned)
+				return;
+
+			if (block->isControl(kControlTypeReturn)) {
+				addLine("return;");
+				return;
+			}
+
+			if (block->isControl(kControlTypeBreak)) {
+				materializeBlockEnd(end);
+				addLine("break;");
+				return;
+			}
+
+			if (block->isControl(kControlTypeContinue)) {
+				materializeBlockEnd(end);
+				addLine("continue;");
+				return;
+			}
+
+			const std::vector<const Block *> children = getFlowChildren(*block);
+
+			if (end.conditional && (children.size() == 2)) {
+				block = decompileConditional(*block, end, children);
+				continue;
+			}
+
+			if (end.conditional && end.condition.sideEffects)
+				addLine(end.condition.text + ";");
+
+			const Block *next = children.empty() ? 0 : children.front();
+
+			// Only keep values pending if the flow continues linearly into the next block
+			const bool isTail = getLoop() && (getLoop()->tail == block);
+			if (!next || isTail || isStop(*next) || (next->parents.size() > 1))
+				materializeBlockEnd(end);
+
+			if (isTail)
+				return;
+
+			block = next;
+		}
+	}
+
+	const Block *decompileConditional(const Block &block, const BlockEnd &end,
+	                                  const std::vector<const Block *> &children) {
+
+		Loop *loop = getLoop();
+		if (loop) {
+			const bool hasNext = (children[0] == loop->next) || (children[1] == loop->next);
+
+			// The condition at the end of a do-while loop
+			if (loop->doWhile && hasNext && (&block == loop->tail)) {
+				const Block *body = (children[0] == loop->next) ? children[1] : children[0];
+
+				loop->hasCondition = true;
+				loop->condition    = getCondition(block, *body, end);
+
+				return 0;
+			}
+
+			// Jumping out of the loop, or back to its start
+			for (size_t i = 0; i < 2; i++) {
+				const Block *other = children[1 - i];
+
+				if (children[i] == loop->next) {
+					addLine("if (" + getCondition(block, *children[i], end).text + ")");
+					addLine("\tbreak;");
+					return other;
+				}
+			}
+
+			for (size_t i = 0; i < 2; i++) {
+				const Block *other = children[1 - i];
+
+				if (children[i] == loop->head) {
+					addLine("if (" + getCondition(block, *children[i], end).text + ")");
+					addLine("\tcontinue;");
+					return other;
+				}
+			}
+		}
+
+		const Block *ifTrue = 0, *ifElse = 0, *ifNext = 0;
+
+		const ControlStructure *control = block.getControl(kControlTypeIfCond);
+		if (control) {
+			ifTrue = control->ifTrue;
+			ifElse = control->ifElse;
+			ifNext = control->ifNext;
+		} else {
+			// No known structure, so treat the earlier block as the body of an if
+			const bool firstEarlier = children[0]->address < children[1]->address;
+
+			ifTrue = firstEarlier ? children[0] : children[1];
+			ifNext = firstEarlier ? children[1] : children[0];
+		}
+
+		/* Prefer the branch that doesn't need a negated condition as the true
+		 * branch, since that's most likely how the if was originally written. */
+		Expression condition = getCondition(block, *ifTrue, end);
+		if (ifElse && (condition.precedence == kPrecedenceUnary) && condition.text.beginsWith("!")) {
+			std::swap(ifTrue, ifElse);
+
+			condition = getCondition(block, *ifTrue, end);
+		}
+
+		// A branch leading to the end of the loop is not a real else branch
+		if (loop && ifElse && isLoopBoundary(*loop, *ifTrue)) {
+			std::swap(ifTrue, ifElse);
+
+			condition = getCondition(block, *ifTrue, end);
+		}
+
+		if (loop && ifElse && isLoopBoundary(*loop, *ifElse)) {
+			ifNext = ifElse;
+			ifElse = 0;
+		}
+
+		addLine("if (" + condition.text + ") {");
+		decompileBranch(ifTrue, ifNext, ifElse);
+
+		if (ifElse) {
+			addLine("} else {");
+			decompileBranch(ifElse, ifNext, 0);
+		}
+
+		addLine("}");
+
+		return ifNext;
+	}
+
+	void decompileBranch(const Block *block, const Block *stop1, const Block *stop2) {
+		const size_t stopCount = _stops.size();
+
+		if (stop1)
+			_stops.push_back(stop1);
+		if (stop2)
+			_stops.push_back(stop2);
+
+		_indent++;
+		decompileBlocks(block);
+		_indent--;
+
+		_stops.resize(stopCount);
+	}
+
+	/** Does this block end with a condition that decides whether to leave the loop? */
+	static bool exitsLoop(const Block &block, const ControlStructure &control) {
+		if (block.instructions.empty() || !block.instructions.back())
+			return false;
+
+		const Opcode opcode = block.instructions.back()->opcode;
+		if ((opcode != kOpcodeJZ) && (opcode != kOpcodeJNZ))
+			return false;
+
+		const std::vector<const Block *> children = getFlowChildren(block);
+
+		return (children.size() == 2) &&
+		       ((children[0] == control.loopNext) || (children[1] == control.loopNext));
+	}
+
+	const Block *decompileLoop(const Block &head) {
+		const ControlStructure *control = head.getControl(kControlTypeWhileHead);
+		if (!control)
+			control = head.getControl(kControlTypeDoWhileHead);
+
+		assert(control && control->loopTail && control->loopNext);
+
+		/* A loop checking its condition in the head is a while loop, a loop checking
+		 * its condition in the tail is a do-while loop. Anything else is an endless
+		 * loop that's left with a break. */
+
+		const bool headExits = exitsLoop(head, *control);
+		const bool tailExits = !headExits && exitsLoop(*control->loopTail, *control);
+
+		_loops.push_back(Loop(*control, tailExits));
+
+		const size_t stopCount = _stops.size();
+		_stops.push_back(control->loopNext);
+
+		if (headExits) {
+			/* The head of a while loop evaluates the loop condition. If that needs more
+			 * than a single expression, we have to move it into the loop body. */
+
+			_visited.insert(&head);
+
+			const size_t lineCount = _lines.size();
+
+			BlockEnd end;
+			decompileBlock(head, end);
+
+			const std::vector<const Block *> children = getFlowChildren(head);
+			const Block *body = (children[0] == control->loopNext) ? children[1] : children[0];
+
+			if (_lines.size() == lineCount) {
+				addLine("while (" + getCondition(head, *body, end).text + ") {");
+			} else {
+				Lines condition(_lines.begin() + lineCount, _lines.end());
+				_lines.erase(_lines.begin() + lineCount, _lines.end());
+
+				addLine("while (TRUE) {");
+				for (Lines::iterator l = condition.begin(); l != condition.end(); ++l)
+					_lines.push_back(Line(l->indent + 1, l->text));
+
+				addLine("\tif (" + getCondition(head, *control->loopNext, end).text + ")");
+				addLine("\t\tbreak;");
+			}
+
+			_indent++;
+			if (body != &head)
+				decompileBlocks(body);
+			_indent--;
+
+			addLine("}");
+
+		} else {
+			addLine(tailExits ? "do {" : "while (TRUE) {");
+
+			_indent++;
+			decompileBlocks(&head);
+			_indent--;
+
+			const Loop &loop = _loops.back();
+			if (tailExits)
+				addLine("} while (" + (loop.hasCondition ? loop.condition.text : Common::UString("TRUE")) + ");");
+			else
+				addLine("}");
+		}
+
+		_stops.resize(stopCount);
+		_loops.pop_back();
+
+		return control->loopNext;
+	}
+
+	// '--- Control flow
+};
+
+
+Decompiler::Decompiler(const NCSFile &ncs) : _ncs(&ncs) {
+}
+
+Decompiler::~Decompiler() {
+}
+
+static void writeLines(Common::WriteStream &out, const Lines &lines) {
+	for (Lines::const_iterator l = lines.begin(); l != lines.end(); ++l) {
+		for (size_t i = 0; i < l->indent; i++)
+			out.writeString("\t");
+
+		out.writeString(l->text);
+		out.writeString("\n");
+	}
+}
+
+void Decompiler::createNSS(Common::WriteStream &out) {
+	if (!_ncs->hasStackAnalysis())
+		throw Common::Exception("Decompiling requires a stack analysis");
+	if (!_ncs->hasControlFlowAnalysis())
+		throw Common::Exception("Decompiling requires a control flow analysis");
+
+	DecompileScript script(*_ncs);
+
+	/* Decompile all subroutines, except the ones created by the compiler. The
+	 * STORESTATE subroutines are decompiled as part of the subroutine creating them. */
+
+	std::vector<const SubRoutine *> subs;
+	std::vector<Common::UString> signatures;
+	std::vector<Lines> bodies;
+
+	const SubRoutines &subRoutines = _ncs->getSubRoutines();
+	for (SubRoutines::const_iterator s = subRoutines.begin(); s != subRoutines.end(); ++s) {
+		if ((s->type == kSubRoutineTypeStart) || (s->type == kSubRoutineTypeGlobal) ||
+		    (s->type == kSubRoutineTypeStoreState))
+			continue;
+
+		try {
+			SubRoutineDecompiler decompiler(script, *s, 1);
+			decompiler.decompileBody();
+
+			subs.push_back(&*s);
+			signatures.push_back(decompiler.getSignature());
+			bodies.push_back(decompiler.getLines());
+
+		} catch (Common::Exception &e) {
+			e.add("Failed to decompile subroutine %s", formatJumpLabelName(*s).c_str());
+			throw;
+		}
+	}
+
+	Lines globals;
+	if (_ncs->getGlobalSubRoutine() && !_ncs->getGlobals().empty()) {
+		try {
+			SubRoutineDecompiler decompiler(script, *_ncs->getGlobalSubRoutine(), 0);
+			decompiler.decompileGlobals();
+
+			globals = decompiler.getLines();
+
+		} catch (Common::Exception &e) {
+			e.add("Failed to decompile the global variables");
+			throw;
+		}
+	}
+
+	out.writeString(Common::UString::format("// %s bytes, %s instructions\n\n",
+	                Common::composeString(_ncs->size()).c_str(),
+	                Common::composeString(_ncs->getInstructions().size()).c_str()));
+
+	// Prototypes, so that the order of the functions doesn't matter
+	bool hasPrototypes = false;
+	for (size_t i = 0; i < subs.size(); i++) {
+		if (subs[i]->type == kSubRoutineTypeNone) {
+			out.writeString(signatures[i] + ";\n");
+			hasPrototypes = true;
+		}
+	}
+
+	if (hasPrototypes)
+		out.writeString("\n");
+
+	if (!globals.empty()) {
+		writeLines(out, globals);
+		out.writeString("\n");
+	}
+
+	for (std::vector<Lines>::const_iterator s = script.storeStates.begin(); s != script.storeStates.end(); ++s) {
+		writeLines(out, *s);
+		out.writeString("\n");
+	}
+
+	for (size_t i = 0; i < subs.size(); i++) {
+		out.writeString(signatures[i] + " {\n");
+		writeLines(out, bodies[i]);
+		out.writeString("}\n");
+
+		if (i < (subs.size() - 1))
+			out.writeString("\n");
+	}
+}
+
+} // End of namespace NWScript
@@ -0,0 +1,70 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Decompiling NWScript bytecode into NSS source.
+ */
+
+#ifndef NWSCRIPT_DECOMPILER_H
+#define NWSCRIPT_DECOMPILER_H
+
+#include "src/common/types.h"
+
+namespace Common {
+	class WriteStream;
+}
+
+namespace NWScript {
+
+class NCSFile;
+
+/** Turn the analyzed structure of an NCS file back into NWScript source.
+ *
+ *  The decompiler works on top of the stack and control flow analysis
+ *  of an NCSFile: the expressions are rebuilt by following the values
+ *  on the analyzed stack, the variables are named after their sibling
+ *  groups, and the detected control structures are turned into if, while,
+ *  do-while, break, continue and return statements.
+ *
+ *  Vectors are rebuilt where the bytecode treats three floats as one
+ *  value. Structs, on the other hand, stay split into their individual
+ *  members.
+ */
+class Decompiler {
+public:
+	/** Decompile this NCS file.
+	 *
+	 *  Both the stack and the control flow of the NCS file need to have been
+	 *  analyzed already.
+	 */
+	Decompiler(const NCSFile &ncs);
+	~Decompiler();
+
+	/** Create NWScript source code out of the script. */
+	void createNSS(Common::WriteStream &out);
+
+
+private:
+	const NCSFile *_ncs;
+};
+
+} // End of namespace NWScript
+
+#endif // NWSCRIPT_DECOMPILER_H
@@ -30,6 +30,7 @@
 #include "src/common/writestream.h"
 
 #include "src/nwscript/disassembler.h"
+#include "src/nwscript/decompiler.h"
 #include "src/nwscript/ncsfile.h"
 #include "src/nwscript/util.h"
 #include "src/nwscript/game.h"
@@ -134,6 +135,12 @@ void Disassembler::createDot(Common::WriteStream &out, bool printControlTypes) {
 	out.writeString("}\n");
 }
 
+void Disassembler::createNSS(Common::WriteStream &out) {
+	Decompiler decompiler(*_ncs);
+
+	decompiler.createNSS(out);
+}
+
 void Disassembler::writeDotClusteredBlocks(Common::WriteStream &out, bool printControlTypes) {
 	const SubRoutines &subs = _ncs->getSubRoutines();
 
@@ -62,6 +62,8 @@ public:
 	void createAssembly(Common::WriteStream &out, bool printStack = false);
 	/** Create a graphviz dot file that can be plotted into a control flow graph. */
 	void createDot     (Common::WriteStream &out, bool printControlTypes = false);
+	/** Decompile the script back into NWScript source code. */
+	void createNSS     (Common::WriteStream &out);
 
 
 private:
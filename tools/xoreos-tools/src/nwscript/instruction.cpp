@@ -51,13 +51,13 @@ static Instruction *findInstruction(Instructions &instructions, uint32 address)
 }
 
 
-typedef void (*ParseFunc)(Instruction &instr, Common::SeekableReadStream &ncs);
+typedef void (*ParseFunc)(Instruction &instr, Common::SeekableReadStream &ncs, StringPool &strings);
 
-static void parseOpcodeConst  (Instruction &instr, Common::SeekableReadStream &ncs);
-static void parseOpcodeEq     (Instruction &instr, Common::SeekableReadStream &ncs);
-static void parseOpcodeNEq    (Instruction &instr, Common::SeekableReadStream &ncs);
-static void parseOpcodeStore  (Instruction &instr, Common::SeekableReadStream &ncs);
-static void parseOpcodeDefault(Instruction &instr, Common::SeekableReadStream &ncs);
+static void parseOpcodeConst  (Instruction &instr, Common::SeekableReadStream &ncs, StringPool &strings);
+static void parseOpcodeEq     (Instruction &instr, Common::SeekableReadStream &ncs, StringPool &strings);
+static void parseOpcodeNEq    (Instruction &instr, Common::SeekableReadStream &ncs, StringPool &strings);
+static void parseOpcodeStore  (Instruction &instr, Common::SeekableReadStream &ncs, StringPool &strings);
+static void parseOpcodeDefault(Instruction &instr, Common::SeekableReadStream &ncs, StringPool &strings);
 
 static const ParseFunc kParseFunc[kOpcodeMAX] = {
 	// 0x00
@@ -154,20 +154,7 @@ static Common::UString readStringQuoting(Common::SeekableReadStream &ncs, size_t
 		if (!c)
 			break;
 
-		if      (c == '\n')
-			str += "\\n";
-		else if (c == '\r')
-			str += "\\r";
-		else if (c == '\t')
-			str += "\\t";
-		else if (c == '\"')
-			str += "\\\"";
-		else if (c == '\\')
-			str += "\\\\";
-		else if (c < 32 || c > 126)
-			str += Common::UString::format("\\x%02X", c);
-		else
-			str += (uint32) c;
+		escapeStringByte(str, c);
 	}
 
 	if (length != SIZE_MAX)
@@ -177,7 +164,7 @@ static Common::UString readStringQuoting(Common::SeekableReadStream &ncs, size_t
 }
 
 
-void parseOpcodeConst(Instruction &instr, Common::SeekableReadStream &ncs) {
+void parseOpcodeConst(Instruction &instr, Common::SeekableReadStream &ncs, StringPool &strings) {
 	switch (instr.type) {
 		case kInstTypeInt:
 			instr.constValueInt = ncs.readSint32BE();
@@ -189,7 +176,7 @@ void parseOpcodeConst(Instruction &instr, Common::SeekableReadStream &ncs) {
 
 		case kInstTypeString:
 		case kInstTypeResource:
-			instr.constValueString = readStringQuoting(ncs, ncs.readUint16BE());
+			instr.constValueString = &*strings.insert(readStringQuoting(ncs, ncs.readUint16BE())).first;
 			break;
 
 		case kInstTypeObject:
@@ -205,7 +192,7 @@ void parseOpcodeConst(Instruction &instr, Common::SeekableReadStream &ncs) {
 	instr.argCount = 1;
 }
 
-void parseOpcodeEq(Instruction &instr, Common::SeekableReadStream &ncs) {
+void parseOpcodeEq(Instruction &instr, Common::SeekableReadStream &ncs, StringPool &UNUSED(strings)) {
 	if (instr.type != kInstTypeStructStruct)
 		return;
 
@@ -215,7 +202,7 @@ void parseOpcodeEq(Instruction &instr, Common::SeekableReadStream &ncs) {
 	instr.argCount = 1;
 }
 
-void parseOpcodeNEq(Instruction &instr, Common::SeekableReadStream &ncs) {
+void parseOpcodeNEq(Instruction &instr, Common::SeekableReadStream &ncs, StringPool &UNUSED(strings)) {
 	if (instr.type != kInstTypeStructStruct)
 		return;
 
@@ -225,7 +212,7 @@ void parseOpcodeNEq(Instruction &instr, Common::SeekableReadStream &ncs) {
 	instr.argCount = 1;
 }
 
-void parseOpcodeStore(Instruction &instr, Common::SeekableReadStream &ncs) {
+void parseOpcodeStore(Instruction &instr, Common::SeekableReadStream &ncs, StringPool &UNUSED(strings)) {
 	instr.args[0] = (uint8) instr.type;
 	instr.args[1] = ncs.readUint32BE();
 	instr.args[2] = ncs.readUint32BE();
@@ -239,7 +226,7 @@ void parseOpcodeStore(Instruction &instr, Common::SeekableReadStream &ncs) {
 	instr.type = kInstTypeDirect;
 }
 
-void parseOpcodeDefault(Instruction &instr, Common::SeekableReadStream &ncs) {
+void parseOpcodeDefault(Instruction &instr, Common::SeekableReadStream &ncs, StringPool &UNUSED(strings)) {
 	instr.argCount = getDirectArgumentCount(instr.opcode);
 
 	const OpcodeArgument * const args = getDirectArguments(instr.opcode);
@@ -274,7 +261,7 @@ void parseOpcodeDefault(Instruction &instr, Common::SeekableReadStream &ncs) {
 }
 
 
-bool parseInstruction(Common::SeekableReadStream &ncs, Instruction &instr) {
+bool parseInstruction(Common::SeekableReadStream &ncs, Instruction &instr, StringPool &strings) {
 	instr.address = ncs.pos();
 
 	try {
@@ -291,7 +278,7 @@ bool parseInstruction(Common::SeekableReadStream &ncs, Instruction &instr) {
 		throw Common::Exception("Invalid opcode 0x%02X", (uint8)instr.opcode);
 
 	const ParseFunc func = kParseFunc[(size_t)instr.opcode];
-	(*func)(instr, ncs);
+	(*func)(instr, ncs, strings);
 
 	return true;
 }
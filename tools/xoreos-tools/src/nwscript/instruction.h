@@ -27,6 +27,7 @@
 
 #include <vector>
 #include <deque>
+#include <set>
 
 #include "src/common/types.h"
 #include "src/common/ustring.h"
@@ -193,8 +194,12 @@ struct Instruction {
 	float constValueFloat;
 	/** Parameter for kOpcodeCONST + kInstTypeObject. */
 	uint32 constValueObject;
-	/** Parameter for kOpcodeCONST + kInstTypeString or kInstTypeResource. */
-	Common::UString constValueString;
+	/** Parameter for kOpcodeCONST + kInstTypeString or kInstTypeResource.
+	 *
+	 *  The string itself is interned in the StringPool of the script, so that
+	 *  the same constant used many times over is only stored once.
+	 */
+	const Common::UString *constValueString;
 
 	/** The type of this instruction address. */
 	AddressType addressType;
@@ -227,7 +232,7 @@ struct Instruction {
 	const Block *block;
 
 	/** The NWScript stack before this instruction is executed. */
-	Stack stack;
+	StackFrame stack;
 
 	/** The variables this instruction manipulates (creates, writes, reads). */
 	std::vector<const Variable *> variables;
@@ -235,7 +240,7 @@ struct Instruction {
 
 	Instruction(uint32 addr = 0) : address(addr),
 		opcode(kOpcodeMAX), type(kInstTypeInstTypeMAX), argCount(0),
-		constValueInt(0), constValueFloat(0.0f), constValueObject(0),
+		constValueInt(0), constValueFloat(0.0f), constValueObject(0), constValueString(0),
 		addressType(kAddressTypeNone), follower(0), block(0) {
 
 		for (size_t i = 0; i < kOpcodeMaxArgumentCount; i++) {
@@ -257,8 +262,15 @@ struct Instruction {
 /** The whole set of instructions found in a script. */
 typedef std::deque<Instruction> Instructions;
 
-/** Parse an instruction out of the NCS stream. */
-bool parseInstruction(Common::SeekableReadStream &ncs, Instruction &instr);
+/** A pool of unique strings, for interning the string constants of a script. */
+typedef std::set<Common::UString> StringPool;
+
+/** Parse an instruction out of the NCS stream.
+ *
+ *  String constants are interned into the given pool, which needs to live
+ *  at least as long as the instruction.
+ */
+bool parseInstruction(Common::SeekableReadStream &ncs, Instruction &instr, StringPool &strings);
 
 /** Given a whole set of script instructions, interlink branching instructions. */
 void linkInstructionBranches(Instructions &instructions);
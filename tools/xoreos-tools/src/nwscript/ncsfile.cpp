@@ -152,7 +152,7 @@ void NCSFile::parse(Common::SeekableReadStream &ncs) {
 bool NCSFile::parseStep(Common::SeekableReadStream &ncs) {
 	Instruction instr;
 
-	if (!parseInstruction(ncs, instr))
+	if (!parseInstruction(ncs, instr, _strings))
 		return false;
 
 	_instructions.push_back(instr);
@@ -200,9 +200,9 @@ void NCSFile::analyzeStack() {
 	_globals.clear();
 
 	if (_specialSubRoutines.globalSub)
-		analyzeStackGlobals(*_specialSubRoutines.globalSub, _variables, _game, _globals);
+		analyzeStackGlobals(*_specialSubRoutines.globalSub, _variables, _arena, _game, _globals);
 
-	analyzeStackSubRoutine(*_specialSubRoutines.mainSub, _variables, _game, &_globals);
+	analyzeStackSubRoutine(*_specialSubRoutines.mainSub, _variables, _arena, _game, &_globals);
 
 	_hasStackAnalysis = true;
 }
@@ -27,6 +27,7 @@
 
 #include "src/common/types.h"
 #include "src/common/ustring.h"
+#include "src/common/memarena.h"
 
 #include "src/aurora/types.h"
 #include "src/aurora/aurorafile.h"
@@ -128,6 +129,11 @@ private:
 	Blocks       _blocks;
 	SubRoutines  _subRoutines;
 
+	/** The string constants used by the instructions. */
+	StringPool _strings;
+	/** Memory for the stack snapshots of the instructions. */
+	Common::MemoryArena _arena;
+
 	SpecialSubRoutines _specialSubRoutines;
 
 	bool _hasStackAnalysis;
@@ -23,9 +23,11 @@
  */
 
 #include <cassert>
+#include <new>
 
 #include "src/common/util.h"
 #include "src/common/error.h"
+#include "src/common/memarena.h"
 
 #include "src/nwscript/stack.h"
 #include "src/nwscript/instruction.h"
@@ -55,6 +57,7 @@ struct AnalyzeStackContext {
 	Instruction *instruction;
 
 	VariableSpace *variables;
+	Common::MemoryArena *arena;
 
 	Aurora::GameID game;
 	Stack *stack;
@@ -67,9 +70,9 @@ struct AnalyzeStackContext {
 	Stack returnStack;
 
 
-	AnalyzeStackContext(AnalyzeMode m, SubRoutine &s, VariableSpace &vars,
+	AnalyzeStackContext(AnalyzeMode m, SubRoutine &s, VariableSpace &vars, Common::MemoryArena &a,
 	                    Aurora::GameID g = Aurora::kGameIDUnknown) :
-		mode(m), sub(&s), block(0), instruction(0), variables(&vars), game(g),
+		mode(m), sub(&s), block(0), instruction(0), variables(&vars), arena(&a), game(g),
 		stack(0), globals(0), subStack(0), subRETN(false) {
 
 	}
@@ -176,7 +179,7 @@ struct AnalyzeStackContext {
 
 		Variable *var2 = stack->front().variable;
 
-		connectSets(var1, var2, var1->duplicates, var2->duplicates);
+		var2->original = var1->original ? var1->original : var1;
 	}
 
 	bool checkVariableType(size_t offset, VariableType type) {
@@ -349,16 +352,23 @@ static const AnalyzeStackFunc kAnalyzeStackFunc[kOpcodeMAX] = {
 
 
 static void fixupDuplicateTypes(VariableSpace &variables) {
-	for (VariableSpace::iterator v = variables.begin(); v != variables.end(); ++v) {
-		VariableType type = v->type;
+	/* All duplicates of a variable need to have the same type. Find the type
+	 * of each group of duplicates, then set it on every member of the group. */
+
+	std::vector<VariableType> types(variables.size(), kTypeAny);
+
+	for (VariableSpace::const_iterator v = variables.begin(); v != variables.end(); ++v) {
+		const size_t group = v->original ? v->original->id : v->id;
+
+		if (v->type != kTypeAny)
+			types[group] = v->type;
+	}
 
-		for (std::set<const Variable *>::iterator d = v->duplicates.begin(); d != v->duplicates.end(); ++d)
-			if ((*d)->type != kTypeAny)
-				type = (*d)->type;
+	for (VariableSpace::iterator v = variables.begin(); v != variables.end(); ++v) {
+		const size_t group = v->original ? v->original->id : v->id;
 
-		v->type = type;
-		for (std::set<const Variable *>::iterator d = v->duplicates.begin(); d != v->duplicates.end(); ++d)
-			const_cast<Variable *>(*d)->type = type;
+		if (types[group] != kTypeAny)
+			v->type = types[group];
 	}
 }
 
@@ -541,14 +551,8 @@ static void analyzeStackBlock(AnalyzeStackContext &ctx) {
 }
 
 static void analyzeStackInstruction(AnalyzeStackContext &ctx) {
-	ctx.instruction->stack = *ctx.stack;
-
 	// For the instruction stack, only keep the stack frame of the current subroutine
-	if (ctx.instruction->stack.size() > ctx.subStack) {
-		const size_t outsideSize = ctx.instruction->stack.size() - ctx.subStack;
-
-		ctx.instruction->stack.erase(ctx.instruction->stack.end() - outsideSize, ctx.instruction->stack.end());
-	}
+	ctx.instruction->stack = StackFrame(*ctx.arena, *ctx.stack, MIN(ctx.stack->size(), ctx.subStack));
 
 	// Call the specific stack analyze function for this opcode
 
@@ -1353,8 +1357,25 @@ static void analyzeStackGETREFARRAY(AnalyzeStackContext &ctx) {
 }
 
 
-void analyzeStackGlobals(SubRoutine &sub, VariableSpace &variables, Aurora::GameID game, Stack &globals) {
-	AnalyzeStackContext ctx(kAnalyzeStackGlobal, sub, variables, game);
+StackFrame::StackFrame(Common::MemoryArena &arena, const Stack &stack, size_t size) :
+	_variables(0), _size(size) {
+
+	assert(size <= stack.size());
+	if (size == 0)
+		return;
+
+	StackVariable *variables = arena.allocate<StackVariable>(size);
+	for (size_t i = 0; i < size; i++)
+		new (&variables[i]) StackVariable(stack[i]);
+
+	_variables = variables;
+}
+
+
+void analyzeStackGlobals(SubRoutine &sub, VariableSpace &variables, Common::MemoryArena &arena,
+                         Aurora::GameID game, Stack &globals) {
+
+	AnalyzeStackContext ctx(kAnalyzeStackGlobal, sub, variables, arena, game);
 
 	ctx.globals = &globals;
 
@@ -1367,8 +1388,10 @@ void analyzeStackGlobals(SubRoutine &sub, VariableSpace &variables, Aurora::Game
 	analyzeStackSubRoutine(ctx);
 }
 
-void analyzeStackSubRoutine(SubRoutine &sub, VariableSpace &variables, Aurora::GameID game, Stack *globals) {
-	AnalyzeStackContext ctx(kAnalyzeStackSubRoutine, sub, variables, game);
+void analyzeStackSubRoutine(SubRoutine &sub, VariableSpace &variables, Common::MemoryArena &arena,
+                            Aurora::GameID game, Stack *globals) {
+
+	AnalyzeStackContext ctx(kAnalyzeStackSubRoutine, sub, variables, arena, game);
 
 	ctx.globals = globals;
 
@@ -25,12 +25,17 @@
 #ifndef NWSCRIPT_STACK_H
 #define NWSCRIPT_STACK_H
 
+#include <cassert>
 #include <deque>
 
 #include "src/aurora/types.h"
 
 #include "src/nwscript/variable.h"
 
+namespace Common {
+	class MemoryArena;
+}
+
 namespace NWScript {
 
 struct SubRoutine;
@@ -54,6 +59,48 @@ struct StackVariable {
 /** A stack frame in a script. */
 typedef std::deque<StackVariable> Stack;
 
+/** A read-only snapshot of a stack frame.
+ *
+ *  The elements are stored in a memory arena, owned by the NCSFile, so
+ *  that keeping a snapshot for every single instruction stays cheap.
+ */
+class StackFrame {
+public:
+	typedef const StackVariable *const_iterator;
+
+	StackFrame() : _variables(0), _size(0) {
+	}
+
+	/** Take a snapshot of the top-most size elements of this stack. */
+	StackFrame(Common::MemoryArena &arena, const Stack &stack, size_t size);
+
+	size_t size() const {
+		return _size;
+	}
+
+	bool empty() const {
+		return _size == 0;
+	}
+
+	const StackVariable &operator[](size_t n) const {
+		assert(n < _size);
+
+		return _variables[n];
+	}
+
+	const_iterator begin() const {
+		return _variables;
+	}
+
+	const_iterator end() const {
+		return _variables + _size;
+	}
+
+private:
+	const StackVariable *_variables;
+	size_t _size;
+};
+
 /** Analyze the stack of this "_global"-type subroutine.
  *
  *  Every single instruction in every single block of this subroutine will be
@@ -63,9 +110,11 @@ typedef std::deque<StackVariable> Stack;
  *  At the end, the parameter globals will be updated with information on all
  *  the global variables this "_global" subroutine defines, and the parameter
  *  variables will contain unique Variable objects for each variable created
- *  during the subroutine.
+ *  during the subroutine. The stack snapshots of the instructions are
+ *  allocated from the arena.
  */
-void analyzeStackGlobals(SubRoutine &sub, VariableSpace &variables, Aurora::GameID game, Stack &globals);
+void analyzeStackGlobals(SubRoutine &sub, VariableSpace &variables, Common::MemoryArena &arena,
+                         Aurora::GameID game, Stack &globals);
 
 /** Analyze the stack throughout this subroutine.
  *
@@ -73,7 +122,8 @@ void analyzeStackGlobals(SubRoutine &sub, VariableSpace &variables, Aurora::Game
  *  analyzed, and its stack information updated. Subroutines that are called
  *  will be recursed into and also updated. Each unique variable created
  *  during this process will have a Variable object added to the variables
- *  parameter.
+ *  parameter. The stack snapshots of the instructions are allocated from
+ *  the arena.
  *
  *  The game the subroutine's script is from needs to be set to a valid value.
  *
@@ -82,8 +132,8 @@ void analyzeStackGlobals(SubRoutine &sub, VariableSpace &variables, Aurora::Game
  *
  *  Should the analysis fail for any reason, an exception will be thrown.
  */
-void analyzeStackSubRoutine(SubRoutine &sub, VariableSpace &variables, Aurora::GameID game,
-                            Stack *globals = 0);
+void analyzeStackSubRoutine(SubRoutine &sub, VariableSpace &variables, Common::MemoryArena &arena,
+                            Aurora::GameID game, Stack *globals = 0);
 
 } // End of namespace NWScript
 
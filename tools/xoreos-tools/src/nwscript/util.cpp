@@ -22,6 +22,8 @@
  *  NWScript utility functions.
  */
 
+#include <cstdlib>
+
 #include "src/common/util.h"
 #include "src/common/strutil.h"
 #include "src/common/error.h"
@@ -491,6 +493,47 @@ Common::UString formatBytes(const Instruction &instr) {
 	return str;
 }
 
+void escapeStringByte(Common::UString &str, byte c) {
+	if      (c == '\n')
+		str += "\\n";
+	else if (c == '\r')
+		str += "\\r";
+	else if (c == '\t')
+		str += "\\t";
+	else if (c == '\"')
+		str += "\\\"";
+	else if (c == '\\')
+		str += "\\\\";
+	else if (c < 32 || c > 126)
+		str += Common::UString::format("\\x%02X", c);
+	else
+		str += (uint32) c;
+}
+
+Common::UString escapeString(const Common::UString &str) {
+	Common::UString escaped;
+
+	for (const char *c = str.c_str(); *c; c++)
+		escapeStringByte(escaped, (byte) *c);
+
+	return escaped;
+}
+
+Common::UString formatFloat(float f) {
+	// Find the shortest representation that reads back as the same value
+	Common::UString str;
+	for (int precision = 6; precision <= 9; precision++) {
+		str = Common::UString::format("%.*g", precision, f);
+		if ((float) std::strtod(str.c_str(), 0) == f)
+			break;
+	}
+
+	if (str.contains('.') || str.contains('e') || str.contains('n') || str.contains('N'))
+		return str;
+
+	return str + ".0";
+}
+
 Common::UString formatInstruction(const Instruction &instr, Aurora::GameID game) {
 	Common::UString str = Common::UString::format("%s%s", getOpcodeName(instr.opcode).c_str(),
 	                                                      getInstTypeName(instr.type).c_str());
@@ -541,12 +584,12 @@ Common::UString formatInstruction(const Instruction &instr, Aurora::GameID game)
 						break;
 
 					case kInstTypeFloat:
-						str += Common::UString::format(" %f", instr.constValueFloat);
+						str += " " + formatFloat(instr.constValueFloat);
 						break;
 
 					case kInstTypeString:
 					case kInstTypeResource:
-						str += Common::UString::format(" \"%s\"", instr.constValueString.c_str());
+						str += Common::UString::format(" \"%s\"", instr.constValueString->c_str());
 						break;
 
 					case kInstTypeObject:
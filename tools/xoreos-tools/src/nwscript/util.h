@@ -110,6 +110,26 @@ size_t getDirectArgumentCount(Opcode op);
  */
 Common::UString formatBytes(const Instruction &instr);
 
+/** Append a byte of a string constant to str, escaped the way the disassembly shows it.
+ *
+ *  Newlines, carriage returns, tabs, quotes and backslashes are escaped
+ *  with a backslash, and all other bytes outside of printable ASCII are
+ *  written as \xNN.
+ */
+void escapeStringByte(Common::UString &str, byte c);
+
+/** Escape all bytes of this string, as escapeStringByte() does. */
+Common::UString escapeString(const Common::UString &str);
+
+/** Format a floating point constant.
+ *
+ *  This is the shortest representation that reads back as the exact
+ *  same value, and it always contains a decimal point or an exponent.
+ *
+ *  Examples: "1.5", "3.0", "0.1", "1e+10".
+ */
+Common::UString formatFloat(float f);
+
 /** Format the instruction into an assembly-like mnemonic string.
  *
  *  This includes the opcode, the instruction type and the direct
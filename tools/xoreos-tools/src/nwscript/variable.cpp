@@ -24,6 +24,8 @@
 
 #include <algorithm>
 
+#include "src/common/util.h"
+
 #include "src/nwscript/variable.h"
 
 namespace NWScript {
@@ -43,7 +45,11 @@ std::vector<size_t> Variable::getSiblingGroup() const {
 }
 
 size_t Variable::getLowestSibling() const {
-	return getSiblingGroup().front();
+	size_t lowest = id;
+	for (std::set<const Variable *>::const_iterator s = siblings.begin(); s != siblings.end(); ++s)
+		lowest = MIN(lowest, (*s)->id);
+
+	return lowest;
 }
 
 } // End of namespace NWScript
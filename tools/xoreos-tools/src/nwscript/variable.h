@@ -152,8 +152,12 @@ struct Variable {
 	/** Instructions that write this variable. */
 	std::vector<const Instruction *> writers;
 
-	/** Variables that were created by duplicating this variable. */
-	std::set<const Variable *> duplicates;
+	/** The variable this variable is a duplicate of, if any.
+	 *
+	 *  This always points to the original variable, never to a duplicate
+	 *  itself, so all duplicates of one variable form a flat group.
+	 */
+	const Variable *original;
 
 	/** Variables that are logically the very same variable as this one.
 	 *
@@ -164,11 +168,11 @@ struct Variable {
 	std::set<const Variable *> siblings;
 
 	/** Instructions that helped to infer the type of this variable. */
-	std::deque<TypeInference> typeInference;
+	std::vector<TypeInference> typeInference;
 
 
 	Variable(size_t i, VariableType t, VariableUse u = kVariableUseUnknown) :
-		id(i), type(t), use(u), creator(0) {
+		id(i), type(t), use(u), creator(0), original(0) {
 
 	}
 
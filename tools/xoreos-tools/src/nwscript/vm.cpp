@@ -0,0 +1,1414 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+/** @file
+ *  A virtual machine executing NWScript bytecode.
+ */
+
+#include <cassert>
+#include <cstring>
+
+#include <map>
+#include <algorithm>
+
+#include "src/common/error.h"
+
+#include "src/nwscript/vm.h"
+#include "src/nwscript/ncsfile.h"
+#include "src/nwscript/game.h"
+#include "src/nwscript/util.h"
+
+/* The handlers of the dispatch loop.
+ *
+ * Most opcodes have exactly one handler. The instructions making up the bulk
+ * of every script, copying single stack elements and integer arithmetic and
+ * comparisons, get handlers of their own, so that they don't need to look at
+ * the instruction type at run time.
+ */
+#define VM_HANDLERS \
+	VM_HANDLER(Invalid) \
+	VM_HANDLER(CPDOWNSP) VM_HANDLER(CPDOWNSP1) VM_HANDLER(CPTOPSP) VM_HANDLER(CPTOPSP1) \
+	VM_HANDLER(CPDOWNBP) VM_HANDLER(CPTOPBP) VM_HANDLER(RSADD) VM_HANDLER(CONST) VM_HANDLER(ACTION) \
+	VM_HANDLER(LOGAND) VM_HANDLER(LOGOR) VM_HANDLER(INCOR) VM_HANDLER(EXCOR) VM_HANDLER(BOOLAND) \
+	VM_HANDLER(EQ) VM_HANDLER(NEQ) VM_HANDLER(EQII) VM_HANDLER(NEQII) \
+	VM_HANDLER(GEQ) VM_HANDLER(GT) VM_HANDLER(LT) VM_HANDLER(LEQ) \
+	VM_HANDLER(GEQII) VM_HANDLER(GTII) VM_HANDLER(LTII) VM_HANDLER(LEQII) \
+	VM_HANDLER(SHLEFT) VM_HANDLER(SHRIGHT) VM_HANDLER(USHRIGHT) \
+	VM_HANDLER(ADD) VM_HANDLER(SUB) VM_HANDLER(MUL) VM_HANDLER(DIV) VM_HANDLER(MOD) \
+	VM_HANDLER(ADDII) VM_HANDLER(SUBII) VM_HANDLER(MULII) \
+	VM_HANDLER(NEG) VM_HANDLER(COMP) VM_HANDLER(NOT) VM_HANDLER(MOVSP) \
+	VM_HANDLER(JMP) VM_HANDLER(JSR) VM_HANDLER(JZ) VM_HANDLER(JNZ) VM_HANDLER(RETN) \
+	VM_HANDLER(DESTRUCT) VM_HANDLER(DECSP) VM_HANDLER(INCSP) VM_HANDLER(DECBP) VM_HANDLER(INCBP) \
+	VM_HANDLER(SAVEBP) VM_HANDLER(RESTOREBP) VM_HANDLER(STORESTATE) VM_HANDLER(NOP)
+
+namespace NWScript {
+
+enum Handler {
+#define VM_HANDLER(x) kHandler##x,
+	VM_HANDLERS
+#undef VM_HANDLER
+	kHandlerMAX
+};
+
+/** The number of elements on the stack. */
+static const size_t kStackSize = 65536;
+/** The maximum depth of nested subroutine calls. */
+static const size_t kCallDepth = 4096;
+
+
+NORETURN_PRE static void throwStackOverflow(uint32 address) NORETURN_POST;
+NORETURN_PRE static void throwStackUnderflow(uint32 address) NORETURN_POST;
+NORETURN_PRE static void throwTypeMismatch(uint32 address) NORETURN_POST;
+
+static void throwStackOverflow(uint32 address) {
+	throw Common::Exception("VirtualMachine: @%08X: Stack overflow", address);
+}
+
+static void throwStackUnderflow(uint32 address) {
+	throw Common::Exception("VirtualMachine: @%08X: Stack underflow", address);
+}
+
+static void throwTypeMismatch(uint32 address) {
+	throw Common::Exception("VirtualMachine: @%08X: Type mismatch", address);
+}
+
+/* Integer arithmetic in NWScript wraps around. Do the calculations unsigned,
+ * so that overflows are well-defined. */
+
+static inline int32 wrapAdd(int32 a, int32 b) {
+	return (int32) ((uint32) a + (uint32) b);
+}
+
+static inline int32 wrapSub(int32 a, int32 b) {
+	return (int32) ((uint32) a - (uint32) b);
+}
+
+static inline int32 wrapMul(int32 a, int32 b) {
+	return (int32) ((uint32) a * (uint32) b);
+}
+
+static int32 intArithmetic(Opcode opcode, int32 a, int32 b, uint32 address) {
+	switch (opcode) {
+		case kOpcodeADD:
+			return wrapAdd(a, b);
+
+		case kOpcodeSUB:
+			return wrapSub(a, b);
+
+		case kOpcodeMUL:
+			return wrapMul(a, b);
+
+		case kOpcodeDIV:
+		case kOpcodeMOD:
+			if (b == 0)
+				throw Common::Exception("VirtualMachine: @%08X: Division by zero", address);
+
+			if (b == -1)
+				return (opcode == kOpcodeDIV) ? wrapSub(0, a) : 0;
+
+			return (opcode == kOpcodeDIV) ? (a / b) : (a % b);
+
+		default:
+			break;
+	}
+
+	throwTypeMismatch(address);
+}
+
+static float floatArithmetic(Opcode opcode, float a, float b, uint32 address) {
+	switch (opcode) {
+		case kOpcodeADD:
+			return a + b;
+
+		case kOpcodeSUB:
+			return a - b;
+
+		case kOpcodeMUL:
+			return a * b;
+
+		case kOpcodeDIV:
+			return a / b;
+
+		default:
+			break;
+	}
+
+	throwTypeMismatch(address);
+}
+
+static Value defaultValue(VariableType type) {
+	Value value;
+
+	value.type = type;
+	if (type == kTypeObject)
+		value.o = kObjectInvalid;
+
+	return value;
+}
+
+static Value makeInt(int32 i) {
+	Value value;
+
+	value.type = kTypeInt;
+	value.i    = i;
+
+	return value;
+}
+
+static Value makeFloat(float f) {
+	Value value;
+
+	value.type = kTypeFloat;
+	value.f    = f;
+
+	return value;
+}
+
+
+size_t FunctionCall::getFunction() const {
+	return _function;
+}
+
+Common::UString FunctionCall::getName() const {
+	return getFunctionName(_vm->_game, _function);
+}
+
+size_t FunctionCall::getParameterCount() const {
+	return _parameters.size();
+}
+
+VariableType FunctionCall::getParameterType(size_t n) const {
+	if (n >= _types.size())
+		throw Common::Exception("FunctionCall::getParameterType(): %s has no parameter %u",
+		                        getName().c_str(), (uint)n);
+
+	return _types[n];
+}
+
+const Value &FunctionCall::getValue(size_t n) const {
+	if (n >= _parameters.size())
+		throw Common::Exception("FunctionCall::getValue(): %s has no parameter %u",
+		                        getName().c_str(), (uint)n);
+
+	return _values[_parameters[n]];
+}
+
+int32 FunctionCall::getInt(size_t n) const {
+	const Value &value = getValue(n);
+	if (value.type != kTypeInt)
+		throw Common::Exception("FunctionCall::getInt(): Parameter %u of %s is not an int",
+		                        (uint)n, getName().c_str());
+
+	return value.i;
+}
+
+float FunctionCall::getFloat(size_t n) const {
+	const Value &value = getValue(n);
+	if (value.type != kTypeFloat)
+		throw Common::Exception("FunctionCall::getFloat(): Parameter %u of %s is not a float",
+		                        (uint)n, getName().c_str());
+
+	return value.f;
+}
+
+Common::UString FunctionCall::getString(size_t n) const {
+	const Value &value = getValue(n);
+	if ((value.type != kTypeString) && (value.type != kTypeResource))
+		throw Common::Exception("FunctionCall::getString(): Parameter %u of %s is not a string",
+		                        (uint)n, getName().c_str());
+
+	return _vm->getString(value.handle);
+}
+
+uint32 FunctionCall::getObject(size_t n) const {
+	const Value &value = getValue(n);
+	if (value.type != kTypeObject)
+		throw Common::Exception("FunctionCall::getObject(): Parameter %u of %s is not an object",
+		                        (uint)n, getName().c_str());
+
+	return value.o;
+}
+
+Vector3 FunctionCall::getVector(size_t n) const {
+	if (getParameterType(n) != kTypeVector)
+		throw Common::Exception("FunctionCall::getVector(): Parameter %u of %s is not a vector",
+		                        (uint)n, getName().c_str());
+
+	const Value *value = &_values[_parameters[n]];
+
+	return Vector3(value[0].f, value[1].f, value[2].f);
+}
+
+Common::UString FunctionCall::formatParameter(size_t n) const {
+	if (getParameterType(n) == kTypeVector) {
+		const Vector3 v = getVector(n);
+
+		return Common::UString::format("[%f, %f, %f]", v.x, v.y, v.z);
+	}
+
+	return _vm->formatValue(getValue(n));
+}
+
+VariableType FunctionCall::getReturnType() const {
+	return _returnType;
+}
+
+void FunctionCall::setReturn(int32 value) {
+	if (_returnType != kTypeInt)
+		throw Common::Exception("FunctionCall::setReturn(): %s doesn't return an int", getName().c_str());
+
+	_return[0] = makeInt(value);
+}
+
+void FunctionCall::setReturn(float value) {
+	if (_returnType != kTypeFloat)
+		throw Common::Exception("FunctionCall::setReturn(): %s doesn't return a float", getName().c_str());
+
+	_return[0] = makeFloat(value);
+}
+
+void FunctionCall::setReturn(const Common::UString &value) {
+	if ((_returnType != kTypeString) && (_returnType != kTypeResource))
+		throw Common::Exception("FunctionCall::setReturn(): %s doesn't return a string", getName().c_str());
+
+	_return[0].type   = _returnType;
+	_return[0].handle = _vm->addString(value);
+}
+
+void FunctionCall::setReturnObject(uint32 value) {
+	if (_returnType != kTypeObject)
+		throw Common::Exception("FunctionCall::setReturnObject(): %s doesn't return an object", getName().c_str());
+
+	_return[0].type = kTypeObject;
+	_return[0].o    = value;
+}
+
+void FunctionCall::setReturn(const Vector3 &value) {
+	if (_returnType != kTypeVector)
+		throw Common::Exception("FunctionCall::setReturn(): %s doesn't return a vector", getName().c_str());
+
+	_return[0] = makeFloat(value.x);
+	_return[1] = makeFloat(value.y);
+	_return[2] = makeFloat(value.z);
+}
+
+void FunctionCall::setReturn(const Value &value) {
+	if ((_returnType == kTypeVector) || (value.type != _returnType))
+		throw Common::Exception("FunctionCall::setReturn(): %s doesn't return a %s", getName().c_str(),
+		                        getVariableTypeName(value.type, _vm->_game).c_str());
+
+	_return[0] = value;
+}
+
+VirtualMachine &FunctionCall::getVM() const {
+	return *_vm;
+}
+
+FunctionCall::FunctionCall(VirtualMachine &vm, size_t function) : _vm(&vm), _function(function),
+	_returnType(getFunctionReturnType(vm._game, function)) {
+
+	_return[0] = _return[1] = _return[2] = defaultValue(_returnType);
+	if (_returnType == kTypeVector)
+		_return[0] = _return[1] = _return[2] = makeFloat(0.0f);
+}
+
+
+VirtualMachine::VirtualMachine(const NCSFile &ncs, Aurora::GameID game) : _game(game),
+	_runActions(false), _sp(0), _bp(0), _constantStrings(0), _engineTypeCount(0), _instructionCount(0) {
+
+	_functions.resize(getFunctionCount(_game), &recordCall);
+
+	_stack.resize(kStackSize);
+
+	// Handle 0 is the empty string, the value of a fresh string variable
+	_strings.push_back("");
+
+	try {
+		decode(ncs);
+	} catch (Common::Exception &e) {
+		e.add("Failed to decode script for the virtual machine");
+		throw;
+	}
+
+	_constantStrings = _strings.size();
+}
+
+VirtualMachine::~VirtualMachine() {
+}
+
+Aurora::GameID VirtualMachine::getGame() const {
+	return _game;
+}
+
+void VirtualMachine::setEngineFunction(size_t function, EngineFunction implementation) {
+	if (function >= _functions.size())
+		throw Common::Exception("VirtualMachine::setEngineFunction(): Invalid function %u", (uint)function);
+
+	_functions[function] = implementation ? implementation : &recordCall;
+}
+
+void VirtualMachine::setEngineFunction(const Common::UString &name, EngineFunction implementation) {
+	for (size_t i = 0; i < _functions.size(); i++) {
+		if (getFunctionName(_game, i) == name) {
+			setEngineFunction(i, implementation);
+			return;
+		}
+	}
+
+	throw Common::Exception("VirtualMachine::setEngineFunction(): No engine function \"%s\"", name.c_str());
+}
+
+void VirtualMachine::setRunActions(bool runActions) {
+	_runActions = runActions;
+}
+
+const std::vector<Common::UString> &VirtualMachine::getCallLog() const {
+	return _callLog;
+}
+
+void VirtualMachine::addCallLog(const Common::UString &entry) {
+	_callLog.push_back(entry);
+}
+
+void VirtualMachine::clearCallLog() {
+	_callLog.clear();
+}
+
+uint64 VirtualMachine::getInstructionCount() const {
+	return _instructionCount;
+}
+
+const Common::UString &VirtualMachine::getString(uint32 handle) const {
+	if (handle >= _strings.size())
+		throw Common::Exception("VirtualMachine::getString(): Invalid string handle %u", handle);
+
+	return _strings[handle];
+}
+
+uint32 VirtualMachine::addString(const Common::UString &str) {
+	if (str.empty())
+		return 0;
+
+	_strings.push_back(str);
+
+	return _strings.size() - 1;
+}
+
+Value VirtualMachine::createEngineType(VariableType type) {
+	if ((type < kTypeEngineType0) || (type > kTypeEngineType5))
+		throw Common::Exception("VirtualMachine::createEngineType(): %s is not an engine type",
+		                        getVariableTypeName(type, _game).c_str());
+
+	Value value;
+
+	value.type   = type;
+	value.handle = ++_engineTypeCount;
+
+	return value;
+}
+
+Common::UString VirtualMachine::formatValue(const Value &value) const {
+	switch (value.type) {
+		case kTypeInt:
+			return Common::UString::format("%d", value.i);
+
+		case kTypeFloat:
+			return Common::UString::format("%f", value.f);
+
+		case kTypeString:
+		case kTypeResource:
+			return "\"" + getString(value.handle) + "\"";
+
+		case kTypeObject:
+			if (value.o == kObjectSelf)
+				return "OBJECT_SELF";
+			if (value.o == kObjectInvalid)
+				return "OBJECT_INVALID";
+
+			return Common::UString::format("0x%08X", value.o);
+
+		case kTypeEngineType0:
+		case kTypeEngineType1:
+		case kTypeEngineType2:
+		case kTypeEngineType3:
+		case kTypeEngineType4:
+		case kTypeEngineType5:
+			return Common::UString::format("<%s #%u>",
+			       getVariableTypeName(value.type, _game).c_str(), value.handle);
+
+		case kTypeScriptState:
+			if (value.handle < _actions.size())
+				return Common::UString::format("<action @%08X>", _ops[_actions[value.handle].target].address);
+
+			break;
+
+		default:
+			break;
+	}
+
+	return "<" + getVariableTypeName(value.type, _game) + ">";
+}
+
+void VirtualMachine::decode(const NCSFile &ncs) {
+	const Instructions &instructions = ncs.getInstructions();
+
+	// One more for the sentinel at the end, catching runaway scripts
+	_ops.resize(instructions.size() + 1);
+
+	std::map<const Common::UString *, uint32> strings;
+
+	for (size_t i = 0; i < instructions.size(); i++) {
+		const Instruction &instr = instructions[i];
+
+		decodeInstruction(instr, instructions, _ops[i]);
+
+		if ((instr.opcode != kOpcodeCONST) || !instr.constValueString)
+			continue;
+
+		// Intern the string constants
+		std::map<const Common::UString *, uint32>::const_iterator s = strings.find(instr.constValueString);
+		if (s == strings.end())
+			s = strings.insert(std::make_pair(instr.constValueString, addString(*instr.constValueString))).first;
+
+		_ops[i].value.handle = s->second;
+	}
+
+	_ops.back().handler = kHandlerInvalid;
+	_ops.back().address = ncs.size();
+}
+
+void VirtualMachine::decodeInstruction(const Instruction &instr, const Instructions &instructions, Op &op) {
+	op.handler = kHandlerInvalid;
+	op.type    = instr.type;
+	op.target  = 0;
+	op.address = instr.address;
+
+	for (size_t i = 0; i < 3; i++)
+		op.args[i] = instr.args[i];
+
+	const uint32 address = instr.address;
+
+	/* Jumps go to an instruction index. */
+	if ((instr.opcode == kOpcodeJMP) || (instr.opcode == kOpcodeJSR) ||
+	    (instr.opcode == kOpcodeJZ ) || (instr.opcode == kOpcodeJNZ) ||
+	    (instr.opcode == kOpcodeSTORESTATE)) {
+
+		const uint32 destination = address + instr.args[0];
+
+		Instructions::const_iterator it = std::lower_bound(instructions.begin(), instructions.end(), destination);
+		if ((it == instructions.end()) || (it->address != destination))
+			throw Common::Exception("VirtualMachine: @%08X: Invalid jump destination %08X", address, destination);
+
+		op.target = it - instructions.begin();
+	}
+
+	/* Stack offsets and sizes are given in bytes, with each element being 4 bytes.
+	 * Convert them into element counts, checking that they make sense. */
+	switch (instr.opcode) {
+		case kOpcodeCPDOWNSP:
+		case kOpcodeCPTOPSP:
+		case kOpcodeCPDOWNBP:
+		case kOpcodeCPTOPBP:
+			if ((instr.args[0] > -4) || ((instr.args[0] % 4) != 0) ||
+			    (instr.args[1] <   4) || ((instr.args[1] % 4) != 0) || ((instr.args[0] + instr.args[1]) > 0))
+				throw Common::Exception("VirtualMachine: @%08X: Invalid arguments %d, %d",
+				                        address, instr.args[0], instr.args[1]);
+
+			op.args[0] /= 4;
+			op.args[1] /= 4;
+			break;
+
+		case kOpcodeMOVSP:
+			if ((instr.args[0] > 0) || ((instr.args[0] % 4) != 0))
+				throw Common::Exception("VirtualMachine: @%08X: Invalid argument %d", address, instr.args[0]);
+
+			op.args[0] /= -4;
+			break;
+
+		case kOpcodeDESTRUCT:
+			if ((instr.args[0] < 0) || (instr.args[1] < 0) || (instr.args[2] < 0) ||
+			    ((instr.args[0] % 4) != 0) || ((instr.args[1] % 4) != 0) || ((instr.args[2] % 4) != 0) ||
+			    ((instr.args[1] + instr.args[2]) > instr.args[0]))
+				throw Common::Exception("VirtualMachine: @%08X: Invalid arguments %d, %d, %d",
+				                        address, instr.args[0], instr.args[1], instr.args[2]);
+
+			op.args[0] /= 4;
+			op.args[1] /= 4;
+			op.args[2] /= 4;
+			break;
+
+		case kOpcodeDECSP:
+		case kOpcodeINCSP:
+		case kOpcodeDECBP:
+		case kOpcodeINCBP:
+			if ((instr.args[0] > -4) || ((instr.args[0] % 4) != 0))
+				throw Common::Exception("VirtualMachine: @%08X: Invalid argument %d", address, instr.args[0]);
+
+			op.args[0] /= 4;
+			break;
+
+		case kOpcodeSTORESTATE:
+			if ((instr.args[1] < 0) || (instr.args[2] < 0) ||
+			    ((instr.args[1] % 4) != 0) || ((instr.args[2] % 4) != 0))
+				throw Common::Exception("VirtualMachine: @%08X: Invalid arguments %d, %d",
+				                        address, instr.args[1], instr.args[2]);
+
+			op.args[1] /= 4;
+			op.args[2] /= 4;
+			break;
+
+		case kOpcodeEQ:
+		case kOpcodeNEQ:
+			// The number of elements to compare on each side
+			if (instr.type == kInstTypeStructStruct) {
+				if ((instr.args[0] < 4) || ((instr.args[0] % 4) != 0))
+					throw Common::Exception("VirtualMachine: @%08X: Invalid argument %d", address, instr.args[0]);
+
+				op.args[0] /= 4;
+			} else
+				op.args[0] = 1;
+			break;
+
+		case kOpcodeACTION:
+			if (!hasFunction(_game, instr.args[0]) ||
+			    ((size_t)instr.args[1] > getFunctionParameterCount(_game, instr.args[0])))
+				throw Common::Exception("VirtualMachine: @%08X: Invalid engine function call %d, %d",
+				                        address, instr.args[0], instr.args[1]);
+			break;
+
+		default:
+			break;
+	}
+
+	const bool isIntInt = instr.type == kInstTypeIntInt;
+
+	switch (instr.opcode) {
+		case kOpcodeCPDOWNSP:
+			op.handler = (op.args[1] == 1) ? kHandlerCPDOWNSP1 : kHandlerCPDOWNSP;
+			break;
+
+		case kOpcodeCPTOPSP:
+			op.handler = (op.args[1] == 1) ? kHandlerCPTOPSP1 : kHandlerCPTOPSP;
+			break;
+
+		case kOpcodeRSADD:
+		case kOpcodeCONST:
+			op.handler = (instr.opcode == kOpcodeRSADD) ? kHandlerRSADD : kHandlerCONST;
+
+			op.value = defaultValue(instructionTypeToVariableType(instr.type));
+			if ((op.value.type == kTypeVoid) || (op.value.type == kTypeAny))
+				op.handler = kHandlerInvalid;
+
+			if (instr.opcode == kOpcodeCONST) {
+				if      (op.value.type == kTypeInt)
+					op.value.i = instr.constValueInt;
+				else if (op.value.type == kTypeFloat)
+					op.value.f = instr.constValueFloat;
+				else if (op.value.type == kTypeObject)
+					op.value.o = instr.constValueObject;
+				else if ((op.value.type != kTypeString) && (op.value.type != kTypeResource))
+					op.handler = kHandlerInvalid;
+			}
+			break;
+
+		case kOpcodeACTION:    op.handler = kHandlerACTION;    break;
+		case kOpcodeLOGAND:    op.handler = kHandlerLOGAND;    break;
+		case kOpcodeLOGOR:     op.handler = kHandlerLOGOR;     break;
+		case kOpcodeINCOR:     op.handler = kHandlerINCOR;     break;
+		case kOpcodeEXCOR:     op.handler = kHandlerEXCOR;     break;
+		case kOpcodeBOOLAND:   op.handler = kHandlerBOOLAND;   break;
+		case kOpcodeEQ:        op.handler = isIntInt ? kHandlerEQII  : kHandlerEQ;  break;
+		case kOpcodeNEQ:       op.handler = isIntInt ? kHandlerNEQII : kHandlerNEQ; break;
+		case kOpcodeGEQ:       op.handler = isIntInt ? kHandlerGEQII : kHandlerGEQ; break;
+		case kOpcodeGT:        op.handler = isIntInt ? kHandlerGTII  : kHandlerGT;  break;
+		case kOpcodeLT:        op.handler = isIntInt ? kHandlerLTII  : kHandlerLT;  break;
+		case kOpcodeLEQ:       op.handler = isIntInt ? kHandlerLEQII : kHandlerLEQ; break;
+		case kOpcodeSHLEFT:    op.handler = kHandlerSHLEFT;    break;
+		case kOpcodeSHRIGHT:   op.handler = kHandlerSHRIGHT;   break;
+		case kOpcodeUSHRIGHT:  op.handler = kHandlerUSHRIGHT;  break;
+		case kOpcodeADD:       op.handler = isIntInt ? kHandlerADDII : kHandlerADD; break;
+		case kOpcodeSUB:       op.handler = isIntInt ? kHandlerSUBII : kHandlerSUB; break;
+		case kOpcodeMUL:       op.handler = isIntInt ? kHandlerMULII : kHandlerMUL; break;
+		case kOpcodeDIV:       op.handler = kHandlerDIV;       break;
+		case kOpcodeMOD:       op.handler = kHandlerMOD;       break;
+		case kOpcodeNEG:       op.handler = kHandlerNEG;       break;
+		case kOpcodeCOMP:      op.handler = kHandlerCOMP;      break;
+		case kOpcodeMOVSP:     op.handler = kHandlerMOVSP;     break;
+		case kOpcodeJMP:       op.handler = kHandlerJMP;       break;
+		case kOpcodeJSR:       op.handler = kHandlerJSR;       break;
+		case kOpcodeJZ:        op.handler = kHandlerJZ;        break;
+		case kOpcodeRETN:      op.handler = kHandlerRETN;      break;
+		case kOpcodeDESTRUCT:  op.handler = kHandlerDESTRUCT;  break;
+		case kOpcodeNOT:       op.handler = kHandlerNOT;       break;
+		case kOpcodeDECSP:     op.handler = kHandlerDECSP;     break;
+		case kOpcodeINCSP:     op.handler = kHandlerINCSP;     break;
+		case kOpcodeJNZ:       op.handler = kHandlerJNZ;       break;
+		case kOpcodeCPDOWNBP:  op.handler = kHandlerCPDOWNBP;  break;
+		case kOpcodeCPTOPBP:   op.handler = kHandlerCPTOPBP;   break;
+		case kOpcodeDECBP:     op.handler = kHandlerDECBP;     break;
+		case kOpcodeINCBP:     op.handler = kHandlerINCBP;     break;
+		case kOpcodeSAVEBP:    op.handler = kHandlerSAVEBP;    break;
+		case kOpcodeRESTOREBP: op.handler = kHandlerRESTOREBP; break;
+		case kOpcodeSTORESTATE:op.handler = kHandlerSTORESTATE;break;
+		case kOpcodeNOP:       op.handler = kHandlerNOP;       break;
+		case kOpcodeSCRIPTSIZE:op.handler = kHandlerNOP;       break;
+
+		default:
+			// Arrays, references and STORESTATEALL aren't supported. Fail when they're reached.
+			break;
+	}
+}
+
+void VirtualMachine::reset() {
+	_sp = 0;
+	_bp = 0;
+
+	_returnStack.clear();
+
+	_strings.resize(_constantStrings);
+
+	_actions.clear();
+	_storedAction = Value();
+
+	_engineTypeCount = 0;
+}
+
+int32 VirtualMachine::run() {
+	reset();
+
+	execute(0);
+
+	if ((_sp > 0) && (_stack[_sp - 1].type == kTypeInt))
+		return _stack[_sp - 1].i;
+
+	return 0;
+}
+
+void VirtualMachine::runAction(const Value &action) {
+	if ((action.type != kTypeScriptState) || (action.handle >= _actions.size()))
+		throw Common::Exception("VirtualMachine::runAction(): Invalid action");
+
+	// Copy, since running the action might create new actions
+	const Action state = _actions[action.handle];
+
+	const size_t sp = _sp;
+	const size_t bp = _bp;
+
+	if ((state.globals.size() + state.locals.size()) > (kStackSize - _sp))
+		throwStackOverflow(_ops[state.target].address);
+
+	/* Recreate the stack frame of the action: the globals, with the base
+	 * pointer directly above them, followed by the local variables. */
+
+	std::copy(state.globals.begin(), state.globals.end(), _stack.begin() + _sp);
+	_sp += state.globals.size();
+
+	_bp = _sp;
+
+	std::copy(state.locals.begin(), state.locals.end(), _stack.begin() + _sp);
+	_sp += state.locals.size();
+
+	execute(state.target);
+
+	_sp = sp;
+	_bp = bp;
+}
+
+void VirtualMachine::storeState(const Op &op) {
+	const size_t sizeBP = op.args[1];
+	const size_t sizeSP = op.args[2];
+
+	if ((sizeBP > _bp) || (sizeSP > _sp))
+		throwStackUnderflow(op.address);
+
+	Action action;
+
+	action.target = op.target;
+
+	action.globals.assign(_stack.begin() + (_bp - sizeBP), _stack.begin() + _bp);
+	action.locals.assign (_stack.begin() + (_sp - sizeSP), _stack.begin() + _sp);
+
+	_actions.push_back(action);
+
+	_storedAction.type   = kTypeScriptState;
+	_storedAction.handle = _actions.size() - 1;
+}
+
+void VirtualMachine::callFunction(const Op &op) {
+	const size_t function = op.args[0];
+	const size_t argCount = op.args[1];
+
+	const VariableType *params = getFunctionParameters(_game, function);
+
+	FunctionCall call(*this, function);
+
+	call._parameters.reserve(argCount);
+	call._types.reserve(argCount);
+
+	/* Parameters are pushed in reverse, so that the first parameter is on top.
+	 * The exception are actions, which are created by the STORESTATE directly
+	 * preceeding the call. */
+
+	for (size_t i = 0; i < argCount; i++) {
+		const VariableType type = params[i];
+
+		call._parameters.push_back(call._values.size());
+		call._types.push_back(type);
+
+		if (type == kTypeScriptState) {
+			if (_storedAction.type != kTypeScriptState)
+				throw Common::Exception("VirtualMachine: @%08X: No stored state for an action parameter", op.address);
+
+			call._values.push_back(_storedAction);
+			_storedAction = Value();
+			continue;
+		}
+
+		const size_t count = (type == kTypeVector) ? 3 : 1;
+		if (_sp < count)
+			throwStackUnderflow(op.address);
+
+		for (size_t j = 0; j < count; j++) {
+			const Value &value = _stack[_sp - count + j];
+
+			const bool matches = (type == kTypeAny) || (value.type == type) ||
+			                     ((type == kTypeVector) && (value.type == kTypeFloat));
+			if (!matches)
+				throwTypeMismatch(op.address);
+
+			call._values.push_back(value);
+		}
+
+		_sp -= count;
+	}
+
+	(*_functions[function])(call);
+
+	if (call._returnType == kTypeVoid)
+		return;
+
+	const size_t count = (call._returnType == kTypeVector) ? 3 : 1;
+	if (count > (kStackSize - _sp))
+		throwStackOverflow(op.address);
+
+	for (size_t i = 0; i < count; i++)
+		_stack[_sp++] = call._return[i];
+}
+
+void VirtualMachine::recordCall(FunctionCall &call) {
+	Common::UString entry = call.getName() + "(";
+
+	for (size_t i = 0; i < call.getParameterCount(); i++) {
+		if (i > 0)
+			entry += ", ";
+
+		entry += call.formatParameter(i);
+	}
+
+	entry += ")";
+
+	call.getVM().addCallLog(entry);
+
+	if (!call.getVM()._runActions)
+		return;
+
+	for (size_t i = 0; i < call.getParameterCount(); i++)
+		if (call.getParameterType(i) == kTypeScriptState)
+			call.getVM().runAction(call.getValue(i));
+}
+
+bool VirtualMachine::isEqual(const Value &a, const Value &b) const {
+	if (a.type != b.type)
+		return false;
+
+	switch (a.type) {
+		case kTypeFloat:
+			return a.f == b.f;
+
+		case kTypeString:
+		case kTypeResource:
+			return (a.handle == b.handle) || (getString(a.handle) == getString(b.handle));
+
+		default:
+			break;
+	}
+
+	return a.handle == b.handle;
+}
+
+size_t VirtualMachine::arithmetic(Opcode opcode, const Op &op, size_t sp) {
+	Value *stack = &_stack[0];
+
+	switch (op.type) {
+		case kInstTypeIntInt:
+			if (sp < 2)
+				throwStackUnderflow(op.address);
+			if ((stack[sp - 2].type != kTypeInt) || (stack[sp - 1].type != kTypeInt))
+				throwTypeMismatch(op.address);
+
+			stack[sp - 2].i = intArithmetic(opcode, stack[sp - 2].i, stack[sp - 1].i, op.address);
+			return sp - 1;
+
+		case kInstTypeIntFloat:
+		case kInstTypeFloatInt:
+		case kInstTypeFloatFloat:
+			{
+				if (sp < 2)
+					throwStackUnderflow(op.address);
+
+				const Value &a = stack[sp - 2];
+				const Value &b = stack[sp - 1];
+
+				const bool aInt = op.type == kInstTypeIntFloat;
+				const bool bInt = op.type == kInstTypeFloatInt;
+
+				if ((a.type != (aInt ? kTypeInt : kTypeFloat)) || (b.type != (bInt ? kTypeInt : kTypeFloat)))
+					throwTypeMismatch(op.address);
+
+				const float result = floatArithmetic(opcode, aInt ? (float) a.i : a.f,
+				                                             bInt ? (float) b.i : b.f, op.address);
+
+				stack[sp - 2] = makeFloat(result);
+				return sp - 1;
+			}
+
+		case kInstTypeStringString:
+			if (opcode != kOpcodeADD)
+				break;
+			if (sp < 2)
+				throwStackUnderflow(op.address);
+			if ((stack[sp - 2].type != kTypeString) || (stack[sp - 1].type != kTypeString))
+				throwTypeMismatch(op.address);
+
+			stack[sp - 2].handle = addString(getString(stack[sp - 2].handle) + getString(stack[sp - 1].handle));
+			return sp - 1;
+
+		case kInstTypeVectorVector:
+			if ((opcode != kOpcodeADD) && (opcode != kOpcodeSUB))
+				break;
+			if (sp < 6)
+				throwStackUnderflow(op.address);
+
+			for (size_t i = 0; i < 3; i++) {
+				Value &a = stack[sp - 6 + i];
+				const Value &b = stack[sp - 3 + i];
+
+				if ((a.type != kTypeFloat) || (b.type != kTypeFloat))
+					throwTypeMismatch(op.address);
+
+				a.f = floatArithmetic(opcode, a.f, b.f, op.address);
+			}
+			return sp - 3;
+
+		case kInstTypeVectorFloat:
+			if ((opcode != kOpcodeMUL) && (opcode != kOpcodeDIV))
+				break;
+			if (sp < 4)
+				throwStackUnderflow(op.address);
+			if (stack[sp - 1].type != kTypeFloat)
+				throwTypeMismatch(op.address);
+
+			for (size_t i = 0; i < 3; i++) {
+				Value &a = stack[sp - 4 + i];
+				if (a.type != kTypeFloat)
+					throwTypeMismatch(op.address);
+
+				a.f = floatArithmetic(opcode, a.f, stack[sp - 1].f, op.address);
+			}
+			return sp - 1;
+
+		case kInstTypeFloatVector:
+			{
+				if (opcode != kOpcodeMUL)
+					break;
+				if (sp < 4)
+					throwStackUnderflow(op.address);
+				if (stack[sp - 4].type != kTypeFloat)
+					throwTypeMismatch(op.address);
+
+				const float f = stack[sp - 4].f;
+				for (size_t i = 0; i < 3; i++) {
+					const Value &b = stack[sp - 3 + i];
+					if (b.type != kTypeFloat)
+						throwTypeMismatch(op.address);
+
+					stack[sp - 4 + i] = makeFloat(f * b.f);
+				}
+				return sp - 1;
+			}
+
+		default:
+			break;
+	}
+
+	throwTypeMismatch(op.address);
+}
+
+size_t VirtualMachine::compare(Opcode opcode, const Op &op, size_t sp) {
+	Value *stack = &_stack[0];
+
+	if ((opcode == kOpcodeEQ) || (opcode == kOpcodeNEQ)) {
+		const size_t count = op.args[0];
+		if (sp < (2 * count))
+			throwStackUnderflow(op.address);
+
+		sp -= 2 * count;
+
+		bool equal = true;
+		for (size_t i = 0; (i < count) && equal; i++)
+			equal = isEqual(stack[sp + i], stack[sp + count + i]);
+
+		stack[sp++] = makeInt((opcode == kOpcodeEQ) ? equal : !equal);
+		return sp;
+	}
+
+	if (op.type != kInstTypeFloatFloat)
+		throwTypeMismatch(op.address);
+	if (sp < 2)
+		throwStackUnderflow(op.address);
+	if ((stack[sp - 2].type != kTypeFloat) || (stack[sp - 1].type != kTypeFloat))
+		throwTypeMismatch(op.address);
+
+	const float a = stack[sp - 2].f;
+	const float b = stack[sp - 1].f;
+
+	bool result = false;
+	switch (opcode) {
+		case kOpcodeGEQ:
+			result = a >= b;
+			break;
+
+		case kOpcodeGT:
+			result = a >  b;
+			break;
+
+		case kOpcodeLT:
+			result = a <  b;
+			break;
+
+		case kOpcodeLEQ:
+			result = a <= b;
+			break;
+
+		default:
+			throwTypeMismatch(op.address);
+	}
+
+	stack[sp - 2] = makeInt(result);
+	return sp - 1;
+}
+
+/* The dispatch loop.
+ *
+ * With GCC and compatible compilers, each handler jumps directly to the
+ * handler of the next instruction, through a table of label addresses.
+ * This gives the branch predictor one indirect jump per handler to learn,
+ * instead of the single, hard to predict, jump of a switch. Elsewhere, we
+ * fall back to a switch in a loop.
+ *
+ * The stack and base pointers are kept in local variables while running,
+ * and are only synchronized with the members when calling out of the loop.
+ */
+
+#define VM_CHECK_POP(n)  do { if (sp < (size_t)(n)) throwStackUnderflow(op->address); } while (0)
+#define VM_CHECK_PUSH(n) do { if ((size_t)(n) > (kStackSize - sp)) throwStackOverflow(op->address); } while (0)
+
+#define VM_CHECK_INT(v) do { if ((v).type != kTypeInt) throwTypeMismatch(op->address); } while (0)
+
+/* Pop two integers and push the result of an expression using them, a and b. */
+#define VM_BINARY_II(expr) \
+	do { \
+		VM_CHECK_POP(2); \
+		Value &a = stack[sp - 2]; \
+		const Value &b = stack[sp - 1]; \
+		if ((a.type != kTypeInt) || (b.type != kTypeInt)) \
+			throwTypeMismatch(op->address); \
+		a.i = (expr); \
+		sp--; \
+	} while (0)
+
+#define VM_SYNC_OUT() do { _sp = sp; _bp = bp; _instructionCount += count; count = 0; } while (0)
+#define VM_SYNC_IN()  do { sp = _sp; bp = _bp; } while (0)
+
+#if defined(__GNUC__)
+	#define VM_CASE(x) handle##x:
+	#define VM_NEXT() do { op = &ops[pc++]; count++; goto *kDispatch[op->handler]; } while (0)
+#else
+	#define VM_CASE(x) case kHandler##x:
+	#define VM_NEXT() continue
+#endif
+
+void VirtualMachine::execute(size_t start) {
+#if defined(__GNUC__)
+	static const void * const kDispatch[kHandlerMAX] = {
+	#define VM_HANDLER(x) &&handle##x,
+		VM_HANDLERS
+	#undef VM_HANDLER
+	};
+#endif
+
+	const Op *ops   = &_ops[0];
+	Value    *stack = &_stack[0];
+
+	size_t sp = _sp;
+	size_t bp = _bp;
+
+	const size_t depth = _returnStack.size();
+
+	size_t pc = start;
+	const Op *op = 0;
+
+	uint64 count = 0;
+
+#if defined(__GNUC__)
+	VM_NEXT();
+	{
+#else
+	for (;;) {
+		op = &ops[pc++];
+		count++;
+
+		switch (op->handler) {
+#endif
+
+	VM_CASE(Invalid)
+		if (op == &_ops.back())
+			throw Common::Exception("VirtualMachine: Script ran past its end");
+
+		throw Common::Exception("VirtualMachine: @%08X: Unsupported instruction", op->address);
+
+	VM_CASE(CPDOWNSP)
+		{
+			const size_t n = op->args[1];
+			VM_CHECK_POP(-op->args[0]);
+
+			Value *src = stack + sp - n;
+			Value *dst = stack + sp + op->args[0];
+			if (src != dst)
+				std::memmove(dst, src, n * sizeof(Value));
+		}
+		VM_NEXT();
+
+	VM_CASE(CPDOWNSP1)
+		VM_CHECK_POP(-op->args[0]);
+		stack[sp + op->args[0]] = stack[sp - 1];
+		VM_NEXT();
+
+	VM_CASE(CPTOPSP)
+		{
+			const size_t n = op->args[1];
+			VM_CHECK_POP(-op->args[0]);
+			VM_CHECK_PUSH(n);
+
+			std::memcpy(stack + sp, stack + sp + op->args[0], n * sizeof(Value));
+			sp += n;
+		}
+		VM_NEXT();
+
+	VM_CASE(CPTOPSP1)
+		VM_CHECK_POP(-op->args[0]);
+		VM_CHECK_PUSH(1);
+		stack[sp] = stack[sp + op->args[0]];
+		sp++;
+		VM_NEXT();
+
+	VM_CASE(CPDOWNBP)
+		{
+			const size_t n = op->args[1];
+			VM_CHECK_POP(n);
+			if (bp < (size_t) -op->args[0])
+				throwStackUnderflow(op->address);
+
+			Value *src = stack + sp - n;
+			Value *dst = stack + bp + op->args[0];
+			if (src != dst)
+				std::memmove(dst, src, n * sizeof(Value));
+		}
+		VM_NEXT();
+
+	VM_CASE(CPTOPBP)
+		{
+			const size_t n = op->args[1];
+			VM_CHECK_PUSH(n);
+			if (bp < (size_t) -op->args[0])
+				throwStackUnderflow(op->address);
+
+			std::memmove(stack + sp, stack + bp + op->args[0], n * sizeof(Value));
+			sp += n;
+		}
+		VM_NEXT();
+
+	VM_CASE(RSADD)
+	VM_CASE(CONST)
+		VM_CHECK_PUSH(1);
+		stack[sp++] = op->value;
+		VM_NEXT();
+
+	VM_CASE(ACTION)
+		VM_SYNC_OUT();
+		callFunction(*op);
+		VM_SYNC_IN();
+		VM_NEXT();
+
+	VM_CASE(LOGAND)
+		VM_BINARY_II(a.i && b.i);
+		VM_NEXT();
+
+	VM_CASE(LOGOR)
+		VM_BINARY_II(a.i || b.i);
+		VM_NEXT();
+
+	VM_CASE(INCOR)
+		VM_BINARY_II(a.i | b.i);
+		VM_NEXT();
+
+	VM_CASE(EXCOR)
+		VM_BINARY_II(a.i ^ b.i);
+		VM_NEXT();
+
+	VM_CASE(BOOLAND)
+		VM_BINARY_II(a.i & b.i);
+		VM_NEXT();
+
+	VM_CASE(EQ)
+		sp = compare(kOpcodeEQ, *op, sp);
+		VM_NEXT();
+
+	VM_CASE(NEQ)
+		sp = compare(kOpcodeNEQ, *op, sp);
+		VM_NEXT();
+
+	VM_CASE(EQII)
+		VM_BINARY_II(a.i == b.i);
+		VM_NEXT();
+
+	VM_CASE(NEQII)
+		VM_BINARY_II(a.i != b.i);
+		VM_NEXT();
+
+	VM_CASE(GEQ)
+		sp = compare(kOpcodeGEQ, *op, sp);
+		VM_NEXT();
+
+	VM_CASE(GT)
+		sp = compare(kOpcodeGT, *op, sp);
+		VM_NEXT();
+
+	VM_CASE(LT)
+		sp = compare(kOpcodeLT, *op, sp);
+		VM_NEXT();
+
+	VM_CASE(LEQ)
+		sp = compare(kOpcodeLEQ, *op, sp);
+		VM_NEXT();
+
+	VM_CASE(GEQII)
+		VM_BINARY_II(a.i >= b.i);
+		VM_NEXT();
+
+	VM_CASE(GTII)
+		VM_BINARY_II(a.i >  b.i);
+		VM_NEXT();
+
+	VM_CASE(LTII)
+		VM_BINARY_II(a.i <  b.i);
+		VM_NEXT();
+
+	VM_CASE(LEQII)
+		VM_BINARY_II(a.i <= b.i);
+		VM_NEXT();
+
+	VM_CASE(SHLEFT)
+		VM_BINARY_II((int32) ((uint32) a.i << (b.i & 31)));
+		VM_NEXT();
+
+	VM_CASE(SHRIGHT)
+		VM_BINARY_II(a.i >> (b.i & 31));
+		VM_NEXT();
+
+	VM_CASE(USHRIGHT)
+		VM_BINARY_II((int32) ((uint32) a.i >> (b.i & 31)));
+		VM_NEXT();
+
+	VM_CASE(ADD)
+		sp = arithmetic(kOpcodeADD, *op, sp);
+		VM_NEXT();
+
+	VM_CASE(SUB)
+		sp = arithmetic(kOpcodeSUB, *op, sp);
+		VM_NEXT();
+
+	VM_CASE(MUL)
+		sp = arithmetic(kOpcodeMUL, *op, sp);
+		VM_NEXT();
+
+	VM_CASE(DIV)
+		sp = arithmetic(kOpcodeDIV, *op, sp);
+		VM_NEXT();
+
+	VM_CASE(MOD)
+		if (op->type != kInstTypeIntInt)
+			throwTypeMismatch(op->address);
+
+		sp = arithmetic(kOpcodeMOD, *op, sp);
+		VM_NEXT();
+
+	VM_CASE(ADDII)
+		VM_BINARY_II(wrapAdd(a.i, b.i));
+		VM_NEXT();
+
+	VM_CASE(SUBII)
+		VM_BINARY_II(wrapSub(a.i, b.i));
+		VM_NEXT();
+
+	VM_CASE(MULII)
+		VM_BINARY_II(wrapMul(a.i, b.i));
+		VM_NEXT();
+
+	VM_CASE(NEG)
+		VM_CHECK_POP(1);
+		if      ((op->type == kInstTypeInt  ) && (stack[sp - 1].type == kTypeInt))
+			stack[sp - 1].i = wrapSub(0, stack[sp - 1].i);
+		else if ((op->type == kInstTypeFloat) && (stack[sp - 1].type == kTypeFloat))
+			stack[sp - 1].f = -stack[sp - 1].f;
+		else
+			throwTypeMismatch(op->address);
+		VM_NEXT();
+
+	VM_CASE(COMP)
+		VM_CHECK_POP(1);
+		VM_CHECK_INT(stack[sp - 1]);
+		stack[sp - 1].i = ~stack[sp - 1].i;
+		VM_NEXT();
+
+	VM_CASE(NOT)
+		VM_CHECK_POP(1);
+		VM_CHECK_INT(stack[sp - 1]);
+		stack[sp - 1].i = !stack[sp - 1].i;
+		VM_NEXT();
+
+	VM_CASE(MOVSP)
+		VM_CHECK_POP(op->args[0]);
+		sp -= op->args[0];
+		VM_NEXT();
+
+	VM_CASE(JMP)
+		pc = op->target;
+		VM_NEXT();
+
+	VM_CASE(JSR)
+		if (_returnStack.size() >= kCallDepth)
+			throw Common::Exception("VirtualMachine: @%08X: Call stack overflow", op->address);
+
+		_returnStack.push_back(pc);
+		pc = op->target;
+		VM_NEXT();
+
+	VM_CASE(JZ)
+		VM_CHECK_POP(1);
+		VM_CHECK_INT(stack[sp - 1]);
+		if (stack[--sp].i == 0)
+			pc = op->target;
+		VM_NEXT();
+
+	VM_CASE(JNZ)
+		VM_CHECK_POP(1);
+		VM_CHECK_INT(stack[sp - 1]);
+		if (stack[--sp].i != 0)
+			pc = op->target;
+		VM_NEXT();
+
+	VM_CASE(RETN)
+		if (_returnStack.size() == depth)
+			goto halt;
+
+		pc = _returnStack.back();
+		_returnStack.pop_back();
+		VM_NEXT();
+
+	VM_CASE(DESTRUCT)
+		{
+			VM_CHECK_POP(op->args[0]);
+
+			Value *base = stack + sp - op->args[0];
+			std::memmove(base, base + op->args[1], op->args[2] * sizeof(Value));
+
+			sp = sp - op->args[0] + op->args[2];
+		}
+		VM_NEXT();
+
+	VM_CASE(DECSP)
+		VM_CHECK_POP(-op->args[0]);
+		VM_CHECK_INT(stack[sp + op->args[0]]);
+		stack[sp + op->args[0]].i = wrapSub(stack[sp + op->args[0]].i, 1);
+		VM_NEXT();
+
+	VM_CASE(INCSP)
+		VM_CHECK_POP(-op->args[0]);
+		VM_CHECK_INT(stack[sp + op->args[0]]);
+		stack[sp + op->args[0]].i = wrapAdd(stack[sp + op->args[0]].i, 1);
+		VM_NEXT();
+
+	VM_CASE(DECBP)
+		if (bp < (size_t) -op->args[0])
+			throwStackUnderflow(op->address);
+		VM_CHECK_INT(stack[bp + op->args[0]]);
+		stack[bp + op->args[0]].i = wrapSub(stack[bp + op->args[0]].i, 1);
+		VM_NEXT();
+
+	VM_CASE(INCBP)
+		if (bp < (size_t) -op->args[0])
+			throwStackUnderflow(op->address);
+		VM_CHECK_INT(stack[bp + op->args[0]]);
+		stack[bp + op->args[0]].i = wrapAdd(stack[bp + op->args[0]].i, 1);
+		VM_NEXT();
+
+	VM_CASE(SAVEBP)
+		// The globals end directly below the base pointer, followed by the saved base pointer
+		VM_CHECK_PUSH(1);
+		stack[sp] = makeInt((int32) bp);
+		bp = sp++;
+		VM_NEXT();
+
+	VM_CASE(RESTOREBP)
+		VM_CHECK_POP(1);
+		VM_CHECK_INT(stack[sp - 1]);
+		bp = stack[--sp].i;
+		if (bp > sp)
+			throwStackUnderflow(op->address);
+		VM_NEXT();
+
+	VM_CASE(STORESTATE)
+		VM_SYNC_OUT();
+		storeState(*op);
+		VM_NEXT();
+
+	VM_CASE(NOP)
+		VM_NEXT();
+
+#if !defined(__GNUC__)
+		}
+#endif
+	}
+
+halt:
+	VM_SYNC_OUT();
+}
+
+} // End of namespace NWScript
@@ -0,0 +1,279 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A virtual machine executing NWScript bytecode.
+ */
+
+#ifndef NWSCRIPT_VM_H
+#define NWSCRIPT_VM_H
+
+#include <vector>
+
+#include "src/common/types.h"
+#include "src/common/ustring.h"
+
+#include "src/aurora/types.h"
+
+#include "src/nwscript/variable.h"
+#include "src/nwscript/instruction.h"
+
+namespace NWScript {
+
+class NCSFile;
+class VirtualMachine;
+
+/** The object ID the bytecode uses for OBJECT_SELF. */
+static const uint32 kObjectSelf    = 0;
+/** The object ID the bytecode uses for OBJECT_INVALID. */
+static const uint32 kObjectInvalid = 1;
+
+/** A single element on the stack of the virtual machine.
+ *
+ *  Strings, engine types and actions are stored as handles into tables
+ *  owned by the virtual machine, so that a value is just a small, plain
+ *  type tag and 32 bits of data.
+ */
+struct Value {
+	VariableType type;
+
+	union {
+		int32  i;      ///< kTypeInt.
+		float  f;      ///< kTypeFloat.
+		uint32 o;      ///< kTypeObject.
+		uint32 handle; ///< kTypeString, kTypeResource, kTypeEngineType* and kTypeScriptState.
+	};
+
+
+	Value() : type(kTypeVoid), i(0) {
+	}
+};
+
+/** A vector, as taken and returned by engine functions. */
+struct Vector3 {
+	float x, y, z;
+
+
+	Vector3(float vX = 0.0f, float vY = 0.0f, float vZ = 0.0f) : x(vX), y(vY), z(vZ) {
+	}
+};
+
+/** A call of an engine function, as seen by the function's implementation. */
+class FunctionCall {
+public:
+	/** Return the ID of the called function. */
+	size_t getFunction() const;
+	/** Return the name of the called function. */
+	Common::UString getName() const;
+
+	/** Return the number of parameters the function was called with. */
+	size_t getParameterCount() const;
+	/** Return the type of this parameter. */
+	VariableType getParameterType(size_t n) const;
+
+	int32           getInt   (size_t n) const;
+	float           getFloat (size_t n) const;
+	Common::UString getString(size_t n) const;
+	uint32          getObject(size_t n) const;
+	Vector3         getVector(size_t n) const;
+	/** Return the raw value of this parameter, for engine types and actions. */
+	const Value    &getValue (size_t n) const;
+
+	/** Format this parameter as NWScript source. */
+	Common::UString formatParameter(size_t n) const;
+
+	/** Return the return type of the function. */
+	VariableType getReturnType() const;
+
+	void setReturn(int32 value);
+	void setReturn(float value);
+	void setReturn(const Common::UString &value);
+	void setReturnObject(uint32 value);
+	void setReturn(const Vector3 &value);
+	/** Set a raw return value, for engine types. */
+	void setReturn(const Value &value);
+
+	/** Return the virtual machine running the script. */
+	VirtualMachine &getVM() const;
+
+
+private:
+	VirtualMachine *_vm;
+
+	size_t _function;
+	VariableType _returnType;
+
+	/** The parameters. Vectors take up three values, in x, y, z order. */
+	std::vector<Value> _values;
+	/** Where in _values each parameter starts. */
+	std::vector<size_t> _parameters;
+	std::vector<VariableType> _types;
+
+	/** The return value. A vector takes up three values, in x, y, z order. */
+	Value _return[3];
+
+
+	FunctionCall(VirtualMachine &vm, size_t function);
+
+	friend class VirtualMachine;
+};
+
+/** A virtual machine executing the bytecode of a NWScript script.
+ *
+ *  The instructions of the NCSFile are decoded once into a compact form,
+ *  with all jump targets, stack offsets and constants resolved, which the
+ *  dispatch loop then runs through. Where the compiler supports it, the
+ *  dispatch loop jumps directly from one instruction handler to the next.
+ *
+ *  Engine functions are looked up in a table built from the game's function
+ *  signatures. By default, every engine function is a stub that records the
+ *  call into the call log and returns a default value of the right type.
+ *  Stubs can be replaced by real implementations with setEngineFunction().
+ *
+ *  Actions, the closures created by STORESTATE and taken by engine functions
+ *  like DelayCommand() or AssignCommand(), can be executed with runAction().
+ *
+ *  Dragon Age's arrays and references are not supported.
+ */
+class VirtualMachine {
+public:
+	/** The implementation of an engine function. */
+	typedef void (*EngineFunction)(FunctionCall &call);
+
+	VirtualMachine(const NCSFile &ncs, Aurora::GameID game);
+	~VirtualMachine();
+
+	/** Return the game this virtual machine uses the engine functions of. */
+	Aurora::GameID getGame() const;
+
+	/** Replace the implementation of this engine function. */
+	void setEngineFunction(size_t function, EngineFunction implementation);
+	/** Replace the implementation of the engine function with this name. */
+	void setEngineFunction(const Common::UString &name, EngineFunction implementation);
+
+	/** Should actions passed to engine function stubs be run immediately? */
+	void setRunActions(bool runActions);
+
+	/** Run the script from the start.
+	 *
+	 *  Returns the result of a StartingConditional() script, or 0 for scripts
+	 *  with a void main().
+	 */
+	int32 run();
+
+	/** Run an action created by the script. */
+	void runAction(const Value &action);
+
+	/** Return the engine function calls recorded by the stubs. */
+	const std::vector<Common::UString> &getCallLog() const;
+	/** Add an entry to the call log. */
+	void addCallLog(const Common::UString &entry);
+	void clearCallLog();
+
+	/** Return the number of instructions executed so far. */
+	uint64 getInstructionCount() const;
+
+	/** Return the string this handle refers to. */
+	const Common::UString &getString(uint32 handle) const;
+	/** Add a string to the string table and return its handle. */
+	uint32 addString(const Common::UString &str);
+
+	/** Create a new value of this engine type. */
+	Value createEngineType(VariableType type);
+
+	/** Format a value as NWScript source. */
+	Common::UString formatValue(const Value &value) const;
+
+
+private:
+	/** An instruction, decoded for fast execution. */
+	struct Op {
+		uint32 handler;       ///< The handler executing this instruction.
+		InstructionType type; ///< The type of the instruction.
+
+		int32 args[3]; ///< Arguments, converted to stack elements where applicable.
+		size_t target; ///< The index of the instruction jumped to.
+
+		Value value; ///< The value of a CONST instruction.
+
+		uint32 address; ///< The address of the original instruction.
+	};
+
+	/** A closure created by STORESTATE. */
+	struct Action {
+		size_t target;
+
+		std::vector<Value> globals;
+		std::vector<Value> locals;
+	};
+
+	Aurora::GameID _game;
+
+	std::vector<Op> _ops;
+
+	std::vector<EngineFunction> _functions;
+	bool _runActions;
+
+	std::vector<Value> _stack;
+	size_t _sp;
+	size_t _bp;
+
+	std::vector<size_t> _returnStack;
+
+	std::vector<Common::UString> _strings;
+	size_t _constantStrings;
+
+	std::vector<Action> _actions;
+	/** The action created by the last STORESTATE, to be passed to the next engine function. */
+	Value _storedAction;
+
+	uint32 _engineTypeCount;
+
+	std::vector<Common::UString> _callLog;
+
+	uint64 _instructionCount;
+
+
+	void decode(const NCSFile &ncs);
+	void decodeInstruction(const Instruction &instr, const Instructions &instructions, Op &op);
+
+	void reset();
+
+	/** Run instructions, starting at this index, until the call stack is empty. */
+	void execute(size_t start);
+
+	/** Execute an arithmetic instruction on anything but two integers. Returns the new stack pointer. */
+	size_t arithmetic(Opcode opcode, const Op &op, size_t sp);
+	/** Execute a comparison on anything but two integers. Returns the new stack pointer. */
+	size_t compare(Opcode opcode, const Op &op, size_t sp);
+
+	bool isEqual(const Value &a, const Value &b) const;
+
+	void callFunction(const Op &op);
+	void storeState(const Op &op);
+
+	static void recordCall(FunctionCall &call);
+
+	friend class FunctionCall;
+};
+
+} // End of namespace NWScript
+
+#endif // NWSCRIPT_VM_H
@@ -0,0 +1,405 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+/** @file
+ *  Cross-referencing the engine function calls and strings of NWScript bytecode.
+ */
+
+#include "src/common/error.h"
+#include "src/common/strutil.h"
+#include "src/common/encoding.h"
+#include "src/common/readstream.h"
+#include "src/common/writestream.h"
+
+#include "src/nwscript/xref.h"
+#include "src/nwscript/ncsfile.h"
+#include "src/nwscript/instruction.h"
+#include "src/nwscript/variable.h"
+#include "src/nwscript/block.h"
+#include "src/nwscript/subroutine.h"
+#include "src/nwscript/game.h"
+#include "src/nwscript/util.h"
+
+static const char * const kIndexID = "NCSXREF V1.0";
+
+namespace NWScript {
+
+/** Format the value pushed by this instruction, if it is a CONST. */
+static Common::UString formatConstant(const Instruction *instr) {
+	if (!instr || (instr->opcode != kOpcodeCONST))
+		return "";
+
+	switch (instr->type) {
+		case kInstTypeInt:
+			return Common::composeString(instr->constValueInt);
+
+		case kInstTypeFloat:
+			return Common::UString::format("%f", instr->constValueFloat);
+
+		case kInstTypeString:
+		case kInstTypeResource:
+			// The string is already escaped, as the disassembly shows it
+			return instr->constValueString ? ("\"" + *instr->constValueString + "\"") : "";
+
+		case kInstTypeObject:
+			if (instr->constValueObject == 0)
+				return "OBJECT_SELF";
+			if (instr->constValueObject == 1)
+				return "OBJECT_INVALID";
+
+			return Common::composeString(instr->constValueObject);
+
+		default:
+			break;
+	}
+
+	return "";
+}
+
+static const Instruction *getCreator(const StackFrame &stack, size_t n) {
+	if ((n >= stack.size()) || !stack[n].variable)
+		return 0;
+
+	return stack[n].variable->creator;
+}
+
+/** Find the arguments of an engine function call that are constants. */
+static void collectArguments(const Instruction &instr, Aurora::GameID game, std::vector<Common::UString> &args) {
+	const size_t function = instr.args[0];
+	const size_t argCount = instr.args[1];
+
+	const VariableType *types = getFunctionParameters(game, function);
+	if (!types)
+		return;
+
+	args.resize(argCount);
+
+	// The first parameter is on the top of the stack
+	size_t position = 0;
+	for (size_t i = 0; i < argCount; i++) {
+		// Actions are not kept on the stack, and can never be constant anyway
+		if (types[i] == kTypeScriptState)
+			continue;
+
+		if (types[i] == kTypeVector) {
+			// The vector's z component is on top
+			const Common::UString x = formatConstant(getCreator(instr.stack, position + 2));
+			const Common::UString y = formatConstant(getCreator(instr.stack, position + 1));
+			const Common::UString z = formatConstant(getCreator(instr.stack, position + 0));
+
+			if (!x.empty() && !y.empty() && !z.empty())
+				args[i] = "[" + x + ", " + y + ", " + z + "]";
+
+			position += 3;
+			continue;
+		}
+
+		args[i] = formatConstant(getCreator(instr.stack, position++));
+	}
+}
+
+void collectXRefs(const NCSFile &ncs, XRefScript &xref) {
+	const Aurora::GameID game = ncs.getGame();
+
+	const SubRoutines &subs = ncs.getSubRoutines();
+	for (SubRoutines::const_iterator s = subs.begin(); s != subs.end(); ++s) {
+		XRefSubRoutine sub;
+
+		sub.address   = s->address;
+		sub.signature = ncs.hasStackAnalysis() ? formatSignature(*s, game) : formatJumpLabelName(*s);
+
+		xref.subRoutines.push_back(sub);
+	}
+
+	const Instructions &instructions = ncs.getInstructions();
+	for (Instructions::const_iterator i = instructions.begin(); i != instructions.end(); ++i) {
+		if ((i->opcode == kOpcodeCONST) && i->constValueString &&
+		    ((i->type == kInstTypeString) || (i->type == kInstTypeResource))) {
+
+			XRefString str;
+
+			str.address = i->address;
+			str.value   = *i->constValueString;
+
+			xref.strings.push_back(str);
+			continue;
+		}
+
+		if (i->opcode != kOpcodeACTION)
+			continue;
+
+		XRefCall call;
+
+		call.address  = i->address;
+		call.function = i->args[0];
+
+		if (i->block && i->block->subRoutine)
+			call.subRoutine = i->block->subRoutine->address;
+
+		if (ncs.hasStackAnalysis())
+			collectArguments(*i, game, call.arguments);
+
+		xref.calls.push_back(call);
+	}
+}
+
+
+XRefIndex::XRefIndex(Aurora::GameID game) : _game(game) {
+}
+
+XRefIndex::XRefIndex(Common::SeekableReadStream &index) : _game(Aurora::kGameIDUnknown) {
+	try {
+		read(index);
+	} catch (Common::Exception &e) {
+		e.add("Failed to read NCS cross-reference index");
+		throw;
+	}
+}
+
+XRefIndex::~XRefIndex() {
+}
+
+Aurora::GameID XRefIndex::getGame() const {
+	return _game;
+}
+
+void XRefIndex::add(const XRefScript &script) {
+	_scripts.push_back(script);
+}
+
+const std::vector<XRefScript> &XRefIndex::getScripts() const {
+	return _scripts;
+}
+
+/** Escape a field, so that it doesn't contain any tabs or line breaks. */
+static Common::UString escapeField(const Common::UString &str) {
+	Common::UString escaped;
+
+	for (Common::UString::iterator c = str.begin(); c != str.end(); ++c) {
+		if      (*c == '\\')
+			escaped += "\\\\";
+		else if (*c == '\t')
+			escaped += "\\t";
+		else if (*c == '\n')
+			escaped += "\\n";
+		else if (*c == '\r')
+			escaped += "\\r";
+		else
+			escaped += *c;
+	}
+
+	return escaped;
+}
+
+/** Split a line into its tab-separated fields, undoing escapeField(). */
+static void splitFields(const Common::UString &line, std::vector<Common::UString> &fields) {
+	fields.clear();
+	fields.push_back("");
+
+	bool escaped = false;
+	for (Common::UString::iterator c = line.begin(); c != line.end(); ++c) {
+		if (escaped) {
+			escaped = false;
+
+			if      (*c == 't')
+				fields.back() += '\t';
+			else if (*c == 'n')
+				fields.back() += '\n';
+			else if (*c == 'r')
+				fields.back() += '\r';
+			else
+				fields.back() += *c;
+
+			continue;
+		}
+
+		if      (*c == '\\')
+			escaped = true;
+		else if (*c == '\t')
+			fields.push_back("");
+		else
+			fields.back() += *c;
+	}
+}
+
+static uint32 parseAddress(const Common::UString &str) {
+	uint32 address = 0;
+	Common::parseString("0x" + str, address);
+
+	return address;
+}
+
+void XRefIndex::write(Common::WriteStream &out) const {
+	out.writeString(Common::UString(kIndexID) + "\n");
+	out.writeString(Common::UString::format("GAME\t%d\n", (int)_game));
+
+	for (std::vector<XRefScript>::const_iterator s = _scripts.begin(); s != _scripts.end(); ++s) {
+		out.writeString("SCRIPT\t" + escapeField(s->archive) + "\t" + escapeField(s->name) + "\t" +
+		                escapeField(s->error) + "\n");
+
+		for (std::vector<XRefSubRoutine>::const_iterator u = s->subRoutines.begin(); u != s->subRoutines.end(); ++u)
+			out.writeString(Common::UString::format("SUB\t%08X\t", u->address) + escapeField(u->signature) + "\n");
+
+		for (std::vector<XRefCall>::const_iterator c = s->calls.begin(); c != s->calls.end(); ++c) {
+			out.writeString(Common::UString::format("CALL\t%08X\t%08X\t%u\t", c->address, c->subRoutine,
+			                                        (uint)c->function));
+			out.writeString(escapeField(getFunctionName(_game, c->function)));
+
+			for (std::vector<Common::UString>::const_iterator a = c->arguments.begin(); a != c->arguments.end(); ++a)
+				out.writeString("\t" + escapeField(*a));
+
+			out.writeString("\n");
+		}
+
+		for (std::vector<XRefString>::const_iterator t = s->strings.begin(); t != s->strings.end(); ++t)
+			out.writeString(Common::UString::format("STRING\t%08X\t", t->address) + escapeField(t->value) + "\n");
+	}
+
+	out.flush();
+}
+
+void XRefIndex::read(Common::SeekableReadStream &index) {
+	if (Common::readStringLine(index, Common::kEncodingUTF8) != kIndexID)
+		throw Common::Exception("Not an NCS cross-reference index");
+
+	std::vector<Common::UString> fields;
+
+	size_t lineNumber = 1;
+	while (!index.eos()) {
+		const Common::UString line = Common::readStringLine(index, Common::kEncodingUTF8);
+		lineNumber++;
+
+		if (line.empty())
+			continue;
+
+		splitFields(line, fields);
+
+		const Common::UString &type = fields[0];
+
+		if ((type == "GAME") && (fields.size() == 2)) {
+			int game;
+			Common::parseString(fields[1], game);
+
+			_game = (Aurora::GameID) game;
+			continue;
+		}
+
+		if ((type == "SCRIPT") && (fields.size() == 4)) {
+			_scripts.push_back(XRefScript());
+
+			_scripts.back().archive = fields[1];
+			_scripts.back().name    = fields[2];
+			_scripts.back().error   = fields[3];
+			continue;
+		}
+
+		if (_scripts.empty())
+			throw Common::Exception("Line %u: Record outside of a script", (uint)lineNumber);
+
+		XRefScript &script = _scripts.back();
+
+		if ((type == "SUB") && (fields.size() == 3)) {
+			script.subRoutines.push_back(XRefSubRoutine());
+
+			script.subRoutines.back().address   = parseAddress(fields[1]);
+			script.subRoutines.back().signature = fields[2];
+			continue;
+		}
+
+		if ((type == "CALL") && (fields.size() >= 5)) {
+			script.calls.push_back(XRefCall());
+
+			XRefCall &call = script.calls.back();
+
+			call.address    = parseAddress(fields[1]);
+			call.subRoutine = parseAddress(fields[2]);
+			Common::parseString(fields[3], call.function);
+
+			// fields[4] is the function name, for the benefit of other tools
+			call.arguments.assign(fields.begin() + 5, fields.end());
+			continue;
+		}
+
+		if ((type == "STRING") && (fields.size() == 3)) {
+			script.strings.push_back(XRefString());
+
+			script.strings.back().address = parseAddress(fields[1]);
+			script.strings.back().value   = fields[2];
+			continue;
+		}
+
+		throw Common::Exception("Line %u: Invalid record \"%s\"", (uint)lineNumber, type.c_str());
+	}
+}
+
+void XRefIndex::findCalls(const Common::UString &function, Matches &matches) const {
+	for (std::vector<XRefScript>::const_iterator s = _scripts.begin(); s != _scripts.end(); ++s)
+		for (std::vector<XRefCall>::const_iterator c = s->calls.begin(); c != s->calls.end(); ++c)
+			if (getFunctionName(_game, c->function).equalsIgnoreCase(function))
+				matches.push_back(Match(*s, &*c));
+}
+
+void XRefIndex::findStrings(const Common::UString &str, Matches &matches) const {
+	// The strings are stored escaped, so the query needs to be, too
+	const Common::UString escaped = escapeString(str);
+
+	for (std::vector<XRefScript>::const_iterator s = _scripts.begin(); s != _scripts.end(); ++s)
+		for (std::vector<XRefString>::const_iterator t = s->strings.begin(); t != s->strings.end(); ++t)
+			if (t->value.equalsIgnoreCase(escaped))
+				matches.push_back(Match(*s, 0, &*t));
+}
+
+void XRefIndex::findGlobals(const Common::UString &name, Matches &matches) const {
+	/* Global variables are accessed through engine functions like GetGlobalNumber()
+	 * and SetGlobalBoolean(), with the name of the variable as the first argument. */
+
+	const Common::UString quoted = "\"" + escapeString(name) + "\"";
+
+	for (std::vector<XRefScript>::const_iterator s = _scripts.begin(); s != _scripts.end(); ++s) {
+		for (std::vector<XRefCall>::const_iterator c = s->calls.begin(); c != s->calls.end(); ++c) {
+			if (c->arguments.empty() || !c->arguments[0].equalsIgnoreCase(quoted))
+				continue;
+
+			const Common::UString function = getFunctionName(_game, c->function);
+			if ((function.beginsWith("GetGlobal") || function.beginsWith("SetGlobal")))
+				matches.push_back(Match(*s, &*c));
+		}
+	}
+}
+
+void XRefIndex::findScripts(const Common::UString &name, std::vector<const XRefScript *> &scripts) const {
+	for (std::vector<XRefScript>::const_iterator s = _scripts.begin(); s != _scripts.end(); ++s)
+		if (s->name.equalsIgnoreCase(name) || s->name.equalsIgnoreCase(name + ".ncs"))
+			scripts.push_back(&*s);
+}
+
+Common::UString XRefIndex::formatCall(const XRefCall &call) const {
+	Common::UString str = getFunctionName(_game, call.function) + "(";
+
+	for (size_t i = 0; i < call.arguments.size(); i++) {
+		if (i > 0)
+			str += ", ";
+
+		str += call.arguments[i].empty() ? "?" : call.arguments[i];
+	}
+
+	return str + ")";
+}
+
+} // End of namespace NWScript
@@ -0,0 +1,164 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+/** @file
+ *  Cross-referencing the engine function calls and strings of NWScript bytecode.
+ */
+
+#ifndef NWSCRIPT_XREF_H
+#define NWSCRIPT_XREF_H
+
+#include <vector>
+
+#include "src/common/types.h"
+#include "src/common/ustring.h"
+
+#include "src/aurora/types.h"
+
+namespace Common {
+	class SeekableReadStream;
+	class WriteStream;
+}
+
+namespace NWScript {
+
+class NCSFile;
+
+/** A call of an engine function. */
+struct XRefCall {
+	uint32 address;    ///< The address of the ACTION instruction.
+	uint32 subRoutine; ///< The address of the subroutine the call is in.
+	size_t function;   ///< The engine function called.
+
+	/** The arguments of the call, formatted as NWScript source.
+	 *
+	 *  Only arguments that are constant values are known. All
+	 *  others are empty.
+	 */
+	std::vector<Common::UString> arguments;
+
+
+	XRefCall() : address(0), subRoutine(0), function(0) {
+	}
+};
+
+/** A string constant. */
+struct XRefString {
+	uint32 address;        ///< The address of the CONST instruction.
+	Common::UString value; ///< The string itself, escaped as the disassembly shows it.
+
+
+	XRefString() : address(0) {
+	}
+};
+
+/** A subroutine. */
+struct XRefSubRoutine {
+	uint32 address;            ///< The address the subroutine starts at.
+	Common::UString signature; ///< The signature of the subroutine.
+
+
+	XRefSubRoutine() : address(0) {
+	}
+};
+
+/** Everything we know about the cross-references of a single script. */
+struct XRefScript {
+	Common::UString archive; ///< The archive the script is in.
+	Common::UString name;    ///< The name of the script.
+
+	/** The reason the script couldn't be (fully) analyzed, if any. */
+	Common::UString error;
+
+	std::vector<XRefSubRoutine> subRoutines;
+	std::vector<XRefCall> calls;
+	std::vector<XRefString> strings;
+};
+
+/** Collect the cross-references of this script.
+ *
+ *  Subroutine signatures and the arguments of engine function calls are
+ *  only available if the stack of the script has been analyzed.
+ */
+void collectXRefs(const NCSFile &ncs, XRefScript &xref);
+
+/** A persistent index of the cross-references of many scripts.
+ *
+ *  The index is written as a tab-separated text file, one record per line,
+ *  so that it can be queried by this class without having to analyze the
+ *  scripts again, and by standard text tools as well.
+ */
+class XRefIndex {
+public:
+	/** A single match of a query. */
+	struct Match {
+		const XRefScript *script;
+
+		const XRefCall   *call;   ///< The matching call, if any.
+		const XRefString *string; ///< The matching string, if any.
+
+
+		Match(const XRefScript &s, const XRefCall *c, const XRefString *str = 0) :
+			script(&s), call(c), string(str) {
+		}
+	};
+
+	typedef std::vector<Match> Matches;
+
+	XRefIndex(Aurora::GameID game);
+	/** Read an index that was written by write(). */
+	XRefIndex(Common::SeekableReadStream &index);
+	~XRefIndex();
+
+	/** Return the game the indexed scripts are from. */
+	Aurora::GameID getGame() const;
+
+	/** Add the cross-references of a script to the index. */
+	void add(const XRefScript &script);
+
+	const std::vector<XRefScript> &getScripts() const;
+
+	/** Write the index into a stream. */
+	void write(Common::WriteStream &out) const;
+
+	/** Find all calls of the engine function with this name. */
+	void findCalls(const Common::UString &function, Matches &matches) const;
+	/** Find all uses of this string constant, ignoring case. */
+	void findStrings(const Common::UString &str, Matches &matches) const;
+	/** Find all calls of Get/Set functions that access a global variable of this name. */
+	void findGlobals(const Common::UString &name, Matches &matches) const;
+	/** Find all scripts of this name. */
+	void findScripts(const Common::UString &name, std::vector<const XRefScript *> &scripts) const;
+
+	/** Format a call as NWScript source. */
+	Common::UString formatCall(const XRefCall &call) const;
+
+
+private:
+	Aurora::GameID _game;
+
+	std::vector<XRefScript> _scripts;
+
+
+	void read(Common::SeekableReadStream &index);
+};
+
+} // End of namespace NWScript
+
+#endif // NWSCRIPT_XREF_H
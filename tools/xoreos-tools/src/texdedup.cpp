@@ -0,0 +1,673 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Tool to find duplicate textures within BioWare archives.
+ */
+
+#include <cstring>
+#include <cstdio>
+
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include "src/common/version.h"
+#include "src/common/ustring.h"
+#include "src/common/util.h"
+#include "src/common/strutil.h"
+#include "src/common/error.h"
+#include "src/common/platform.h"
+#include "src/common/readstream.h"
+#include "src/common/readfile.h"
+#include "src/common/writefile.h"
+#include "src/common/filepath.h"
+#include "src/common/thread.h"
+#include "src/common/md5.h"
+
+#include "src/aurora/types.h"
+#include "src/aurora/util.h"
+#include "src/aurora/archive.h"
+#include "src/aurora/archiveset.h"
+
+#include "src/images/util.h"
+#include "src/images/bufferpool.h"
+#include "src/images/pixelrows.h"
+#include "src/images/decoder.h"
+#include "src/images/dds.h"
+#include "src/images/sbm.h"
+#include "src/images/tpc.h"
+#include "src/images/txb.h"
+
+void printUsage(FILE *stream, const Common::UString &name);
+bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
+                      std::vector<Common::UString> &files, size_t &jobs, Common::UString &planFile);
+
+void findDuplicates(const std::vector<Common::UString> &files, const Common::UString &planFile, size_t jobs);
+
+int main(int argc, char **argv) {
+	try {
+		std::vector<Common::UString> args;
+		Common::Platform::getParameters(argc, argv, args);
+
+		int returnValue = 1;
+		size_t jobs = Common::Thread::getProcessorCount();
+		Common::UString planFile;
+		std::vector<Common::UString> files;
+
+		if (!parseCommandLine(args, returnValue, files, jobs, planFile))
+			return returnValue;
+
+		findDuplicates(files, planFile, jobs);
+	} catch (...) {
+		Common::exceptionDispatcherError();
+	}
+
+	return 0;
+}
+
+bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
+                      std::vector<Common::UString> &files, size_t &jobs, Common::UString &planFile) {
+
+	files.clear();
+
+	bool optionsEnd = false;
+	for (size_t i = 1; i < argv.size(); i++) {
+		bool isOption = false;
+
+		// A "--" marks an end to all options
+		if (argv[i] == "--") {
+			optionsEnd = true;
+			continue;
+		}
+
+		// We're still handling options
+		if (!optionsEnd) {
+			// Help text
+			if ((argv[i] == "-h") || (argv[i] == "--help")) {
+				printUsage(stdout, argv[0]);
+				returnValue = 0;
+
+				return false;
+			}
+
+			if (argv[i] == "--version") {
+				printVersion();
+				returnValue = 0;
+
+				return false;
+			}
+
+			if        ((argv[i] == "-j") || (argv[i] == "--jobs")) {
+				isOption = true;
+
+				try {
+					// Needs the number of jobs as the next parameter
+					if (i++ == (argv.size() - 1))
+						throw 0;
+
+					Common::parseString(argv[i], jobs);
+					if (jobs == 0)
+						throw 0;
+
+				} catch (...) {
+					printUsage(stderr, argv[0]);
+					returnValue = 1;
+
+					return false;
+				}
+
+			} else if (argv[i] == "--plan") {
+				isOption = true;
+
+				// Needs the plan file name as the next parameter
+				if (i++ == (argv.size() - 1)) {
+					printUsage(stderr, argv[0]);
+					returnValue = 1;
+
+					return false;
+				}
+
+				planFile = argv[i];
+
+			} else if (argv[i].beginsWith("-") || argv[i].beginsWith("--")) {
+			  // An options, but we already checked for all known ones
+
+				printUsage(stderr, argv[0]);
+				returnValue = 1;
+
+				return false;
+			}
+		}
+
+		// Was this a valid option? If so, don't try to use it as a file
+		if (isOption)
+			continue;
+
+		// This is a file to use
+		files.push_back(argv[i]);
+	}
+
+	if (files.empty()) {
+		printUsage(stderr, argv[0]);
+		returnValue = 1;
+
+		return false;
+	}
+
+	return true;
+}
+
+void printUsage(FILE *stream, const Common::UString &name) {
+	std::fprintf(stream, "BioWare texture duplicate finder\n\n");
+	std::fprintf(stream, "Usage: %s [<options>] <file> [<file> [...]]\n", name.c_str());
+	std::fprintf(stream, "  -h      --help              This help text\n");
+	std::fprintf(stream, "          --version           Display version information\n");
+	std::fprintf(stream, "  -j <n>  --jobs <n>          Hash with n threads\n");
+	std::fprintf(stream, "                              (Default: number of processors)\n");
+	std::fprintf(stream, "          --plan <file>       Write a plan for repacking the archives\n");
+	std::fprintf(stream, "                              without duplicates into this file\n\n");
+	std::fprintf(stream, "The files can be ERF (including MOD, HAK, SAV and NWM), RIM and KEY archives,\n");
+	std::fprintf(stream, "as well as single DDS, SBM, TPC and TXB textures, like those in an override\n");
+	std::fprintf(stream, "directory. Groups of duplicate textures are printed to stdout.\n");
+}
+
+static bool isTextureType(Aurora::FileType type) {
+	switch (type) {
+		case Aurora::kFileTypeDDS:
+		case Aurora::kFileTypeSBM:
+		case Aurora::kFileTypeTPC:
+		case Aurora::kFileTypeTXB:
+			return true;
+
+		default:
+			break;
+	}
+
+	return false;
+}
+
+static Images::Decoder *openImage(Common::SeekableReadStream &stream, Aurora::FileType type) {
+	// Only the largest mip map is compared, so there's no need to read the others
+	Images::DecodeOptions options;
+	options.mipMapCount = 1;
+
+	// The textures are already spread over the workers
+	options.threads = 1;
+
+	switch (type) {
+		case Aurora::kFileTypeDDS:
+			return new Images::DDS(stream, options);
+		case Aurora::kFileTypeSBM:
+			return new Images::SBM(stream);
+		case Aurora::kFileTypeTPC:
+			return new Images::TPC(stream, options);
+		case Aurora::kFileTypeTXB:
+			return new Images::TXB(stream, options);
+
+		default:
+			throw Common::Exception("Invalid image type %d", (int) type);
+	}
+}
+
+/** The size of the pool of freed pixel buffers, for each thread. */
+static const size_t kBufferPoolSize = 64 * 1024 * 1024;
+
+/** A texture to hash. */
+struct HashJob {
+	size_t archive; ///< The archive containing the texture, or SIZE_MAX for a single file.
+	uint32 index;   ///< The index of the texture within the archive.
+
+	Aurora::FileType type; ///< The type of the texture.
+
+	Common::UString archiveName; ///< The archive, or the directory of a single file.
+	Common::UString name;        ///< The name of the texture.
+	Common::UString file;        ///< The path of a single texture file.
+
+	bool   hashed;  ///< Were the raw bytes of the texture read and hashed?
+	bool   decoded; ///< Were the pixels of the texture decoded and hashed?
+	uint32 size;    ///< Size of the texture resource in bytes.
+	uint32 width;   ///< Width of the largest mip map.
+	uint32 height;  ///< Height of the largest mip map.
+	uint32 layers;  ///< Number of layers.
+
+	std::vector<byte> rawHash;   ///< MD5 of the resource data.
+	std::vector<byte> pixelHash; ///< MD5 of the dimensions and the B8G8R8A8 pixels of the largest mip map.
+	std::vector<byte> txiHash;   ///< MD5 of the embedded TXI, if any.
+
+	uint64 time;         ///< Time taken, in microseconds.
+	Common::UString log; ///< Errors encountered.
+
+	HashJob() : archive(SIZE_MAX), index(0xFFFFFFFF), type(Aurora::kFileTypeNone),
+		hashed(false), decoded(false), size(0), width(0), height(0), layers(0), time(0) {
+	}
+};
+
+/** The state shared between all hash threads, hashing textures until no jobs are left.
+ *
+ *  Like in texpack2tga, each thread takes a texture from reading to
+ *  hashing its pixels before it picks the next one, so the archive
+ *  reads overlap with the other threads' decoding.
+ */
+struct HashContext : public Common::ThreadPool {
+	std::vector<HashJob> jobs;
+
+	const Aurora::ArchiveSet *archives;
+
+	HashContext() : archives(0) {
+	}
+
+protected:
+	void runJob(size_t n) {
+		runJob(jobs[n]);
+	}
+
+private:
+	void runJob(HashJob &job);
+};
+
+/** Describe the exception currently being handled, including the reasons for it. */
+static Common::UString describeException() {
+	try {
+		throw;
+	} catch (Common::Exception &e) {
+		Common::UString description;
+
+		for (Common::Exception::Stack &stack = e.getStack(); !stack.empty(); stack.pop())
+			description += (description.empty() ? "" : ": ") + stack.top();
+
+		return description;
+	} catch (std::exception &e) {
+		return e.what();
+	} catch (...) {
+	}
+
+	return "Unknown exception";
+}
+
+static void writeUint32(byte *data, uint32 value) {
+	data[0] =  value        & 0xFF;
+	data[1] = (value >>  8) & 0xFF;
+	data[2] = (value >> 16) & 0xFF;
+	data[3] = (value >> 24) & 0xFF;
+}
+
+/** Hash the largest mip map of all layers, converted into B8G8R8A8.
+ *
+ *  Converting first makes the hash independent of the pixel format, so that
+ *  the same image stored compressed and uncompressed, or as DDS and TPC,
+ *  hashes the same. The dimensions are hashed along with the pixels.
+ */
+static void hashPixels(HashJob &job, const Images::Decoder &image) {
+	const Images::PixelFormat format = image.getFormat();
+
+	const size_t lineSize  = job.width * 4;
+	const size_t layerSize = lineSize * job.height;
+
+	std::vector<byte> pixels(12 + layerSize * job.layers), rows;
+
+	writeUint32(&pixels[0], job.width);
+	writeUint32(&pixels[4], job.height);
+	writeUint32(&pixels[8], job.layers);
+
+	for (uint32 layer = 0; layer < job.layers; layer++) {
+		const Images::Decoder::MipMap &mipMap = image.getMipMap(0, layer);
+		if (((uint32)mipMap.width != job.width) || ((uint32)mipMap.height != job.height))
+			throw Common::Exception("Layers of different sizes");
+
+		byte *dest = &pixels[12 + layer * layerSize];
+
+		if (Images::isCompressed(format)) {
+			rows.resize(layerSize);
+			Images::decompressRows(&rows[0], mipMap, format, 0, job.height);
+
+			for (uint32 y = 0; y < job.height; y++)
+				Images::convertRow(dest + y * lineSize, &rows[y * lineSize], job.width,
+				                   Images::kPixelFormatR8G8B8A8);
+
+		} else {
+			const size_t srcLineSize = job.width * Images::getBPP(format);
+			if (mipMap.size < srcLineSize * job.height)
+				throw Common::Exception("Mip map too small");
+
+			for (uint32 y = 0; y < job.height; y++)
+				Images::convertRow(dest + y * lineSize, mipMap.data + y * srcLineSize, job.width, format);
+		}
+	}
+
+	Common::hashMD5(&pixels[0], pixels.size(), job.pixelHash);
+}
+
+void HashContext::runJob(HashJob &job) {
+	const uint64 startTime = Common::Platform::getMicroseconds();
+
+	Common::SeekableReadStream *stream = 0;
+	Common::SeekableReadStream *txi    = 0;
+	Images::Decoder *image = 0;
+
+	try {
+		if (job.archive == SIZE_MAX)
+			stream = new Common::ReadFile(job.file);
+		else
+			stream = archives->getResource(job.archive, job.index);
+
+		job.size = stream->size();
+
+		Common::hashMD5(*stream, job.rawHash);
+		job.hashed = true;
+
+		stream->seek(0);
+
+		image = openImage(*stream, job.type);
+
+		// The compressed texture data isn't needed anymore
+		delete stream;
+		stream = 0;
+
+		if ((image->getLayerCount() < 1) || (image->getMipMapCount() < 1))
+			throw Common::Exception("No image");
+
+		job.width  = image->getMipMap(0, 0).width;
+		job.height = image->getMipMap(0, 0).height;
+		job.layers = image->getLayerCount();
+
+		hashPixels(job, *image);
+
+		if ((txi = image->getTXI()) && (txi->size() > 0)) {
+			txi->seek(0);
+			Common::hashMD5(*txi, job.txiHash);
+		}
+
+		job.decoded = true;
+
+	} catch (...) {
+		job.log = describeException();
+	}
+
+	delete stream;
+	delete txi;
+	delete image;
+
+	job.time = Common::Platform::getMicroseconds() - startTime;
+}
+
+/** Collect all textures in this archive as jobs. */
+static void collectJobs(const Aurora::ArchiveSet &archives, size_t archive, std::vector<HashJob> &jobs) {
+	const Aurora::Archive::ResourceList &resources = archives.getArchive(archive).getResources();
+	for (Aurora::Archive::ResourceList::const_iterator r = resources.begin(); r != resources.end(); ++r) {
+		if (!isTextureType(r->type))
+			continue;
+
+		HashJob job;
+
+		job.archive     = archive;
+		job.index       = r->index;
+		job.type        = r->type;
+		job.archiveName = archives.getFile(archive);
+		job.name        = TypeMan.setFileType(r->name, r->type);
+
+		jobs.push_back(job);
+	}
+}
+
+/** A group of textures with the same hash, as indices into the jobs. */
+typedef std::vector<size_t> HashGroup;
+typedef std::map<std::vector<byte>, HashGroup> HashGroupMap;
+
+/** Sort groups by the number of bytes they waste, the largest first. */
+struct GroupCompare {
+	const std::vector<HashJob> *jobs;
+
+	GroupCompare(const std::vector<HashJob> &j) : jobs(&j) {
+	}
+
+	uint64 wasted(const HashGroup &group) const {
+		uint64 total = 0;
+		for (HashGroup::const_iterator g = group.begin(); g != group.end(); ++g)
+			total += (*jobs)[*g].size;
+
+		return total - (*jobs)[group.front()].size;
+	}
+
+	bool operator()(const HashGroup &a, const HashGroup &b) const {
+		const uint64 wastedA = wasted(a), wastedB = wasted(b);
+		if (wastedA != wastedB)
+			return wastedA > wastedB;
+
+		return a.front() < b.front();
+	}
+};
+
+/** Find the groups of more than one texture with the same raw or pixel hash.
+ *
+ *  Pixel groups are only kept if they contain textures that differ in their
+ *  raw data, since they would otherwise just repeat a raw group.
+ */
+static void groupJobs(const std::vector<HashJob> &jobs,
+                      std::vector<HashGroup> &rawGroups, std::vector<HashGroup> &pixelGroups) {
+
+	HashGroupMap rawMap, pixelMap;
+	for (size_t i = 0; i < jobs.size(); i++) {
+		if (jobs[i].hashed)
+			rawMap[jobs[i].rawHash].push_back(i);
+		if (jobs[i].decoded)
+			pixelMap[jobs[i].pixelHash].push_back(i);
+	}
+
+	for (HashGroupMap::const_iterator r = rawMap.begin(); r != rawMap.end(); ++r)
+		if (r->second.size() > 1)
+			rawGroups.push_back(r->second);
+
+	for (HashGroupMap::const_iterator p = pixelMap.begin(); p != pixelMap.end(); ++p) {
+		if (p->second.size() < 2)
+			continue;
+
+		const std::vector<byte> &rawHash = jobs[p->second.front()].rawHash;
+
+		for (HashGroup::const_iterator g = p->second.begin() + 1; g != p->second.end(); ++g) {
+			if (jobs[*g].rawHash != rawHash) {
+				pixelGroups.push_back(p->second);
+				break;
+			}
+		}
+	}
+
+	std::sort(rawGroups.begin(), rawGroups.end(), GroupCompare(jobs));
+	std::sort(pixelGroups.begin(), pixelGroups.end(), GroupCompare(jobs));
+}
+
+static void printJob(const HashJob &job) {
+	std::printf("  %s\t%s\t%s bytes\t%ux%u", job.archiveName.c_str(), job.name.c_str(),
+	            Common::composeString(job.size).c_str(), job.width, job.height);
+
+	if (job.layers > 1)
+		std::printf("x%u", job.layers);
+
+	std::printf("\n");
+}
+
+static void printReport(const std::vector<HashJob> &jobs,
+                        const std::vector<HashGroup> &rawGroups, const std::vector<HashGroup> &pixelGroups) {
+
+	const GroupCompare compare(jobs);
+
+	size_t rawDuplicates = 0;
+	uint64 rawWasted = 0;
+	for (std::vector<HashGroup>::const_iterator g = rawGroups.begin(); g != rawGroups.end(); ++g) {
+		rawDuplicates += g->size() - 1;
+		rawWasted     += compare.wasted(*g);
+	}
+
+	size_t pixelTextures = 0;
+	for (std::vector<HashGroup>::const_iterator g = pixelGroups.begin(); g != pixelGroups.end(); ++g)
+		pixelTextures += g->size();
+
+	size_t failed = 0;
+	for (std::vector<HashJob>::const_iterator j = jobs.begin(); j != jobs.end(); ++j)
+		if (!j->decoded)
+			failed++;
+
+	std::printf("Textures: %u (%u failed to decode)\n", (uint)jobs.size(), (uint)failed);
+	std::printf("Byte-identical: %u groups, %u duplicates, %s bytes wasted\n",
+	            (uint)rawGroups.size(), (uint)rawDuplicates, Common::composeString(rawWasted).c_str());
+	std::printf("Pixel-identical with different data: %u groups, %u textures\n",
+	            (uint)pixelGroups.size(), (uint)pixelTextures);
+
+	for (size_t i = 0; i < rawGroups.size(); i++) {
+		std::printf("\nByte-identical group %u: %u textures, %s bytes wasted\n", (uint)(i + 1),
+		            (uint)rawGroups[i].size(), Common::composeString(compare.wasted(rawGroups[i])).c_str());
+
+		for (HashGroup::const_iterator g = rawGroups[i].begin(); g != rawGroups[i].end(); ++g)
+			printJob(jobs[*g]);
+	}
+
+	for (size_t i = 0; i < pixelGroups.size(); i++) {
+		const HashGroup &group = pixelGroups[i];
+
+		// Textures with the same pixels still behave differently with a different TXI
+		bool sameTXI = true;
+		for (HashGroup::const_iterator g = group.begin() + 1; g != group.end(); ++g)
+			if (jobs[*g].txiHash != jobs[group.front()].txiHash)
+				sameTXI = false;
+
+		std::printf("\nPixel-identical group %u: %u textures%s\n", (uint)(i + 1),
+		            (uint)group.size(), sameTXI ? "" : ", TXI differs");
+
+		for (HashGroup::const_iterator g = group.begin(); g != group.end(); ++g)
+			printJob(jobs[*g]);
+	}
+
+	if (failed > 0) {
+		std::printf("\nFailed:\n");
+
+		for (std::vector<HashJob>::const_iterator j = jobs.begin(); j != jobs.end(); ++j)
+			if (!j->decoded)
+				std::printf("  %s\t%s\t%s\n", j->archiveName.c_str(), j->name.c_str(), j->log.c_str());
+	}
+}
+
+/** Write the plan for repacking the archives without byte-identical duplicates.
+ *
+ *  A duplicate within the same archive can share the data of the first copy,
+ *  since an ERF or RIM resource table may point several entries at the same
+ *  offset. A duplicate of the same name in a later file is redundant, as long
+ *  as the files are loaded together, in the order they were given.
+ */
+static void writePlan(const Common::UString &planFile, const std::vector<HashJob> &jobs,
+                      const std::vector<HashGroup> &rawGroups) {
+
+	Common::WriteFile plan(planFile);
+
+	plan.writeString("# share <archive> <resource> <resource to share the data of>\n");
+	plan.writeString("# drop <archive> <resource> <earlier archive with the same resource>\n");
+
+	size_t shared = 0, dropped = 0;
+	for (std::vector<HashGroup>::const_iterator g = rawGroups.begin(); g != rawGroups.end(); ++g) {
+		for (HashGroup::const_iterator d = g->begin() + 1; d != g->end(); ++d) {
+			const HashJob &dup = jobs[*d];
+
+			for (HashGroup::const_iterator k = g->begin(); k != d; ++k) {
+				const HashJob &keep = jobs[*k];
+
+				if ((dup.archive != SIZE_MAX) && (dup.archive == keep.archive)) {
+					plan.writeString(Common::UString::format("share\t%s\t%s\t%s\n", dup.archiveName.c_str(),
+					                 dup.name.c_str(), keep.name.c_str()));
+					shared++;
+					break;
+				}
+
+				if (dup.name.equalsIgnoreCase(keep.name) && (dup.archiveName != keep.archiveName)) {
+					plan.writeString(Common::UString::format("drop\t%s\t%s\t%s\n", dup.archiveName.c_str(),
+					                 dup.name.c_str(), keep.archiveName.c_str()));
+					dropped++;
+					break;
+				}
+			}
+		}
+	}
+
+	plan.flush();
+
+	status("Dedup plan with %u shared and %u dropped textures written to \"%s\"",
+	       (uint)shared, (uint)dropped, planFile.c_str());
+}
+
+void findDuplicates(const std::vector<Common::UString> &files, const Common::UString &planFile, size_t jobs) {
+	Aurora::ArchiveSet archives;
+
+	HashContext context;
+
+	context.archives = &archives;
+
+	// Single textures are hashed in place, everything else is opened as an archive
+	size_t collected = 0;
+	for (std::vector<Common::UString>::const_iterator f = files.begin(); f != files.end(); ++f) {
+		const Aurora::FileType type = TypeMan.getFileType(*f);
+		if (!isTextureType(type)) {
+			archives.open(*f);
+
+			for ( ; collected < archives.size(); collected++)
+				collectJobs(archives, collected, context.jobs);
+
+			continue;
+		}
+
+		HashJob job;
+
+		job.type        = type;
+		job.file        = *f;
+		job.archiveName = Common::FilePath::getDirectory(*f);
+		job.name        = Common::FilePath::getFile(*f);
+
+		if (job.archiveName.empty())
+			job.archiveName = ".";
+
+		context.jobs.push_back(job);
+	}
+
+	const size_t threadCount = MAX<size_t>(MIN(jobs, context.jobs.size()), 1);
+
+	status("Hashing %u textures with %u threads...", (uint)context.jobs.size(), (uint)threadCount);
+
+	Images::setBufferPoolSize(threadCount * kBufferPoolSize);
+
+	const uint64 startTime = Common::Platform::getMicroseconds();
+
+	try {
+		context.runJobs(context.jobs.size(), threadCount);
+	} catch (...) {
+		Images::setBufferPoolSize(0);
+		throw;
+	}
+
+	const uint64 totalTime = Common::Platform::getMicroseconds() - startTime;
+
+	Images::setBufferPoolSize(0);
+
+	status("Hashed %u textures in %.3f ms", (uint)context.jobs.size(), totalTime / 1000.0);
+
+	std::vector<HashGroup> rawGroups, pixelGroups;
+	groupJobs(context.jobs, rawGroups, pixelGroups);
+
+	printReport(context.jobs, rawGroups, pixelGroups);
+
+	if (!planFile.empty())
+		writePlan(planFile, context.jobs, rawGroups);
+}
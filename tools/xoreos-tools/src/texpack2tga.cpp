@@ -0,0 +1,511 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Tool to convert all textures within BioWare archives into TGA.
+ */
+
+#include <cstring>
+#include <cstdio>
+
+#include <vector>
+#include <map>
+
+#include "src/common/version.h"
+#include "src/common/ustring.h"
+#include "src/common/util.h"
+#include "src/common/strutil.h"
+#include "src/common/error.h"
+#include "src/common/platform.h"
+#include "src/common/readstream.h"
+#include "src/common/writefile.h"
+#include "src/common/filepath.h"
+#include "src/common/thread.h"
+
+#include "src/aurora/types.h"
+#include "src/aurora/util.h"
+#include "src/aurora/archive.h"
+#include "src/aurora/archiveset.h"
+
+#include "src/images/bufferpool.h"
+#include "src/images/decoder.h"
+#include "src/images/dds.h"
+#include "src/images/sbm.h"
+#include "src/images/tpc.h"
+#include "src/images/txb.h"
+
+void printUsage(FILE *stream, const Common::UString &name);
+bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
+                      std::vector<Common::UString> &files, bool &flip, bool &rle, bool &png, bool &writeTXI,
+                      size_t &jobs, Common::UString &summaryFile);
+
+void convertArchives(const std::vector<Common::UString> &files, const Common::UString &summaryFile,
+                     bool flip, bool rle, bool png, bool writeTXI, size_t jobs);
+
+int main(int argc, char **argv) {
+	try {
+		std::vector<Common::UString> args;
+		Common::Platform::getParameters(argc, argv, args);
+
+		int returnValue = 1;
+		bool flip = false;
+		bool rle = false;
+		bool png = false;
+		bool writeTXI = true;
+		size_t jobs = Common::Thread::getProcessorCount();
+		Common::UString summaryFile = "summary.txt";
+		std::vector<Common::UString> files;
+
+		if (!parseCommandLine(args, returnValue, files, flip, rle, png, writeTXI, jobs, summaryFile))
+			return returnValue;
+
+		convertArchives(files, summaryFile, flip, rle, png, writeTXI, jobs);
+	} catch (...) {
+		Common::exceptionDispatcherError();
+	}
+
+	return 0;
+}
+
+bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
+                      std::vector<Common::UString> &files, bool &flip, bool &rle, bool &png, bool &writeTXI,
+                      size_t &jobs, Common::UString &summaryFile) {
+
+	files.clear();
+
+	bool optionsEnd = false;
+	for (size_t i = 1; i < argv.size(); i++) {
+		bool isOption = false;
+
+		// A "--" marks an end to all options
+		if (argv[i] == "--") {
+			optionsEnd = true;
+			continue;
+		}
+
+		// We're still handling options
+		if (!optionsEnd) {
+			// Help text
+			if ((argv[i] == "-h") || (argv[i] == "--help")) {
+				printUsage(stdout, argv[0]);
+				returnValue = 0;
+
+				return false;
+			}
+
+			if (argv[i] == "--version") {
+				printVersion();
+				returnValue = 0;
+
+				return false;
+			}
+
+			if        ((argv[i] == "-f") || (argv[i] == "--flip")) {
+				isOption = true;
+				flip     = true;
+			} else if (argv[i] == "--rle") {
+				isOption = true;
+				rle      = true;
+			} else if (argv[i] == "--png") {
+				isOption = true;
+				png      = true;
+			} else if (argv[i] == "--no-txi") {
+				isOption = true;
+				writeTXI = false;
+			} else if ((argv[i] == "-j") || (argv[i] == "--jobs")) {
+				isOption = true;
+
+				try {
+					// Needs the number of jobs as the next parameter
+					if (i++ == (argv.size() - 1))
+						throw 0;
+
+					Common::parseString(argv[i], jobs);
+					if (jobs == 0)
+						throw 0;
+
+				} catch (...) {
+					printUsage(stderr, argv[0]);
+					returnValue = 1;
+
+					return false;
+				}
+
+			} else if (argv[i] == "--summary") {
+				isOption = true;
+
+				// Needs the summary file name as the next parameter
+				if (i++ == (argv.size() - 1)) {
+					printUsage(stderr, argv[0]);
+					returnValue = 1;
+
+					return false;
+				}
+
+				summaryFile = argv[i];
+
+			} else if (argv[i].beginsWith("-") || argv[i].beginsWith("--")) {
+			  // An options, but we already checked for all known ones
+
+				printUsage(stderr, argv[0]);
+				returnValue = 1;
+
+				return false;
+			}
+		}
+
+		// Was this a valid option? If so, don't try to use it as a file
+		if (isOption)
+			continue;
+
+		// This is a file to use
+		files.push_back(argv[i]);
+	}
+
+	if (files.empty()) {
+		printUsage(stderr, argv[0]);
+		returnValue = 1;
+
+		return false;
+	}
+
+	return true;
+}
+
+void printUsage(FILE *stream, const Common::UString &name) {
+	std::fprintf(stream, "BioWare texture archive to TGA converter\n\n");
+	std::fprintf(stream, "Usage: %s [<options>] <archive> [<archive> [...]]\n", name.c_str());
+	std::fprintf(stream, "  -h      --help              This help text\n");
+	std::fprintf(stream, "          --version           Display version information\n");
+	std::fprintf(stream, "  -f      --flip              Flip the images vertically\n");
+	std::fprintf(stream, "          --rle               Write run-length encoded TGAs\n");
+	std::fprintf(stream, "          --png               Write PNGs instead of TGAs\n");
+	std::fprintf(stream, "          --no-txi            Don't write the embedded TXI files\n");
+	std::fprintf(stream, "  -j <n>  --jobs <n>          Convert with n threads\n");
+	std::fprintf(stream, "                              (Default: number of processors)\n");
+	std::fprintf(stream, "          --summary <file>    Write the summary into this file\n");
+	std::fprintf(stream, "                              (Default: summary.txt)\n\n");
+	std::fprintf(stream, "Supported archives are ERF (including MOD, HAK, SAV and NWM), RIM and KEY.\n");
+	std::fprintf(stream, "All DDS, SBM, TPC and TXB textures are converted into the current directory.\n");
+}
+
+static bool isTextureType(Aurora::FileType type) {
+	switch (type) {
+		case Aurora::kFileTypeDDS:
+		case Aurora::kFileTypeSBM:
+		case Aurora::kFileTypeTPC:
+		case Aurora::kFileTypeTXB:
+			return true;
+
+		default:
+			break;
+	}
+
+	return false;
+}
+
+static Images::Decoder *openImage(Common::SeekableReadStream &stream, Aurora::FileType type) {
+	// Only the largest mip map is written, so there's no need to read the others
+	Images::DecodeOptions options;
+	options.mipMapCount = 1;
+
+	// The textures are already spread over the workers
+	options.threads = 1;
+
+	switch (type) {
+		case Aurora::kFileTypeDDS:
+			return new Images::DDS(stream, options);
+		case Aurora::kFileTypeSBM:
+			return new Images::SBM(stream);
+		case Aurora::kFileTypeTPC:
+			return new Images::TPC(stream, options);
+		case Aurora::kFileTypeTXB:
+			return new Images::TXB(stream, options);
+
+		default:
+			throw Common::Exception("Invalid image type %d", (int) type);
+	}
+}
+
+/** The size of the pool of freed pixel buffers, for each thread. */
+static const size_t kBufferPoolSize = 64 * 1024 * 1024;
+
+/** A texture to convert. */
+struct ConvertJob {
+	size_t archive; ///< The archive containing the texture.
+	uint32 index;   ///< The index of the texture within the archive.
+
+	Aurora::FileType type; ///< The type of the texture.
+
+	Common::UString archiveName; ///< The file name of the archive, for the summary.
+	Common::UString name;        ///< The name of the texture.
+	Common::UString outFile;     ///< The base name of the files to write, without extension.
+
+	bool   success;      ///< Was the texture successfully converted?
+	bool   hasTXI;       ///< Was a TXI file written?
+	uint32 width;        ///< Width of the converted image.
+	uint32 height;       ///< Height of the converted image.
+	uint64 time;         ///< Time taken, in microseconds.
+	uint64 bytesCopied;  ///< Bytes of pixel data copied without being converted.
+	Common::UString log; ///< Errors encountered.
+
+	ConvertJob() : archive(SIZE_MAX), index(0xFFFFFFFF), type(Aurora::kFileTypeNone),
+		success(false), hasTXI(false), width(0), height(0), time(0), bytesCopied(0) {
+	}
+};
+
+/** The state shared between all convert threads, converting textures until no jobs are left.
+ *
+ *  Each thread takes a texture through all steps of the conversion,
+ *  reading, decoding and writing, before it picks the next one. So at
+ *  most one texture per thread is held in memory, and the archive reads,
+ *  which the ArchiveSet serializes, overlap with the other threads'
+ *  decoding and writing.
+ */
+struct ConvertContext : public Common::ThreadPool {
+	std::vector<ConvertJob> jobs;
+
+	const Aurora::ArchiveSet *archives;
+
+	bool flip;
+	bool rle;
+	bool png;
+	bool writeTXI;
+
+	ConvertContext() : archives(0), flip(false), rle(false), png(false), writeTXI(true) {
+	}
+
+protected:
+	void runJob(size_t n) {
+		runJob(jobs[n]);
+	}
+
+private:
+	void runJob(ConvertJob &job);
+};
+
+/** Describe the exception currently being handled, including the reasons for it. */
+static Common::UString describeException() {
+	try {
+		throw;
+	} catch (Common::Exception &e) {
+		Common::UString description;
+
+		for (Common::Exception::Stack &stack = e.getStack(); !stack.empty(); stack.pop())
+			description += (description.empty() ? "" : ": ") + stack.top();
+
+		return description;
+	} catch (std::exception &e) {
+		return e.what();
+	} catch (...) {
+	}
+
+	return "Unknown exception";
+}
+
+static void writeTXIFile(const Common::UString &fileName, Common::SeekableReadStream &txi) {
+	Common::WriteFile out(fileName);
+
+	txi.seek(0);
+	out.writeStream(txi);
+
+	out.flush();
+}
+
+void ConvertContext::runJob(ConvertJob &job) {
+	const uint64 startTime = Common::Platform::getMicroseconds();
+
+	Common::SeekableReadStream *stream = 0;
+	Common::SeekableReadStream *txi    = 0;
+	Images::Decoder *image = 0;
+
+	try {
+		stream = archives->getResource(job.archive, job.index);
+
+		image = openImage(*stream, job.type);
+
+		// The compressed texture data isn't needed anymore
+		delete stream;
+		stream = 0;
+
+		if ((image->getLayerCount() < 1) || (image->getMipMapCount() < 1))
+			throw Common::Exception("No image");
+
+		job.width  = image->getMipMap(0, 0).width;
+		job.height = image->getMipMap(0, 0).height * image->getLayerCount();
+
+		if (flip)
+			image->flipVertically();
+
+		if (png) {
+			// The textures are already spread over the workers
+			Images::PNGOptions options;
+			options.threads = 1;
+
+			image->dumpPNG(job.outFile + ".png", options);
+		} else
+			image->dumpTGA(job.outFile + ".tga", rle);
+
+		job.bytesCopied = image->getBytesCopied();
+
+		if (writeTXI && (txi = image->getTXI()) && (txi->size() > 0)) {
+			writeTXIFile(job.outFile + ".txi", *txi);
+
+			job.hasTXI = true;
+		}
+
+		job.success = true;
+
+	} catch (...) {
+		job.log = describeException();
+	}
+
+	delete stream;
+	delete txi;
+	delete image;
+
+	job.time = Common::Platform::getMicroseconds() - startTime;
+}
+
+/** Collect all textures in this archive as jobs. */
+static void collectJobs(const Aurora::ArchiveSet &archives, size_t archive, std::vector<ConvertJob> &jobs,
+                        std::map<Common::UString, uint32, Common::UString::iless> &names) {
+
+	const Aurora::Archive::ResourceList &resources = archives.getArchive(archive).getResources();
+	for (Aurora::Archive::ResourceList::const_iterator r = resources.begin(); r != resources.end(); ++r) {
+		if (!isTextureType(r->type))
+			continue;
+
+		ConvertJob job;
+
+		job.archive     = archive;
+		job.index       = r->index;
+		job.type        = r->type;
+		job.archiveName = Common::FilePath::getFile(archives.getFile(archive));
+		job.name        = TypeMan.setFileType(r->name, r->type);
+
+		// Textures of the same name must not overwrite each other
+		const uint32 count = names[r->name]++;
+
+		job.outFile = r->name;
+		if (count > 0)
+			job.outFile += Common::UString::format("_%u", count);
+
+		jobs.push_back(job);
+	}
+}
+
+static void writeSummary(const Common::UString &summaryFile, const ConvertContext &context,
+                         size_t threadCount, uint64 totalTime) {
+
+	Common::WriteFile summary(summaryFile);
+
+	size_t failed = 0;
+	uint64 textureTime = 0, pixels = 0, bytesCopied = 0;
+	for (std::vector<ConvertJob>::const_iterator j = context.jobs.begin(); j != context.jobs.end(); ++j) {
+		if (!j->success)
+			failed++;
+
+		textureTime += j->time;
+		pixels      += (uint64)j->width * j->height;
+		bytesCopied += j->bytesCopied;
+	}
+
+	summary.writeString(Common::UString::format("Textures: %u (%u failed)\n",
+	                    (uint)context.jobs.size(), (uint)failed));
+	summary.writeString(Common::UString::format("Threads: %u\n", (uint)threadCount));
+	summary.writeString(Common::UString::format("Time: %.3f ms (%.3f ms total texture time)\n",
+	                    totalTime / 1000.0, textureTime / 1000.0));
+	summary.writeString(Common::UString::format("Throughput: %.1f textures/s, %.2f megapixels/s\n",
+	                    (context.jobs.size() * 1000000.0) / MAX<uint64>(totalTime, 1),
+	                    pixels / (double)MAX<uint64>(totalTime, 1)));
+	summary.writeString(Common::UString::format("Copied: %s bytes of pixel data\n\n",
+	                    Common::composeString(bytesCopied).c_str()));
+
+	for (std::vector<ConvertJob>::const_iterator j = context.jobs.begin(); j != context.jobs.end(); ++j) {
+		summary.writeString(Common::UString::format("%s\t%s\t%s\t%s\t%ux%u\t%.3f ms\t%s bytes copied",
+		                    j->archiveName.c_str(), j->name.c_str(), j->outFile.c_str(),
+		                    j->success ? "OK" : "FAILED", j->width, j->height, j->time / 1000.0,
+		                    Common::composeString(j->bytesCopied).c_str()));
+
+		if (j->hasTXI)
+			summary.writeString("\tTXI");
+
+		if (!j->log.empty())
+			summary.writeString("\t" + j->log);
+
+		summary.writeString("\n");
+	}
+
+	summary.flush();
+}
+
+void convertArchives(const std::vector<Common::UString> &files, const Common::UString &summaryFile,
+                     bool flip, bool rle, bool png, bool writeTXI, size_t jobs) {
+
+	Aurora::ArchiveSet archives;
+	for (std::vector<Common::UString>::const_iterator f = files.begin(); f != files.end(); ++f)
+		archives.open(*f);
+
+	ConvertContext context;
+
+	context.archives = &archives;
+	context.flip     = flip;
+	context.rle      = rle;
+	context.png      = png;
+	context.writeTXI = writeTXI;
+
+	std::map<Common::UString, uint32, Common::UString::iless> names;
+	for (size_t i = 0; i < archives.size(); i++)
+		collectJobs(archives, i, context.jobs, names);
+
+	const size_t threadCount = MAX<size_t>(MIN(jobs, context.jobs.size()), 1);
+
+	status("Converting %u textures with %u threads...", (uint)context.jobs.size(), (uint)threadCount);
+
+	// Every texture needs buffers of the same few sizes, so keep freed ones around
+	Images::setBufferPoolSize(threadCount * kBufferPoolSize);
+
+	const uint64 startTime = Common::Platform::getMicroseconds();
+
+	try {
+		context.runJobs(context.jobs.size(), threadCount);
+	} catch (...) {
+		Images::setBufferPoolSize(0);
+		throw;
+	}
+
+	const uint64 totalTime = Common::Platform::getMicroseconds() - startTime;
+
+	Images::setBufferPoolSize(0);
+
+	writeSummary(summaryFile, context, threadCount, totalTime);
+
+	size_t failed = 0;
+	for (std::vector<ConvertJob>::const_iterator j = context.jobs.begin(); j != context.jobs.end(); ++j)
+		if (!j->success)
+			failed++;
+
+	const double texturesPerSecond = (context.jobs.size() * 1000000.0) / MAX<uint64>(totalTime, 1);
+
+	status("Converted %u textures (%u failed) in %.3f ms (%.1f textures/s), summary written to \"%s\"",
+	       (uint)(context.jobs.size() - failed), (uint)failed, totalTime / 1000.0, texturesPerSecond,
+	       summaryFile.c_str());
+}
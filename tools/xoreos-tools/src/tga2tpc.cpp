@@ -0,0 +1,253 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Tool to convert TGA images into TPC or DDS textures.
+ */
+
+#include <cstring>
+#include <cstdio>
+
+#include "src/common/version.h"
+#include "src/common/ustring.h"
+#include "src/common/util.h"
+#include "src/common/strutil.h"
+#include "src/common/error.h"
+#include "src/common/platform.h"
+#include "src/common/readfile.h"
+
+#include "src/aurora/types.h"
+#include "src/aurora/util.h"
+
+#include "src/images/decoder.h"
+#include "src/images/tga.h"
+#include "src/images/dumptpc.h"
+#include "src/images/dumpdds.h"
+
+void printUsage(FILE *stream, const Common::UString &name);
+bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
+                      Common::UString &inFile, Common::UString &outFile, Common::UString &txiFile,
+                      Aurora::FileType &type, Images::PixelFormat &format, Images::S3TCQuality &quality,
+                      bool &mipMaps, bool &flip);
+
+void convert(const Common::UString &inFile, const Common::UString &outFile, const Common::UString &txiFile,
+             Aurora::FileType type, Images::PixelFormat format, Images::S3TCQuality quality,
+             bool mipMaps, bool flip);
+
+int main(int argc, char **argv) {
+	try {
+		std::vector<Common::UString> args;
+		Common::Platform::getParameters(argc, argv, args);
+
+		int returnValue = 1;
+		Common::UString inFile, outFile, txiFile;
+		Aurora::FileType type = Aurora::kFileTypeNone;
+		Images::PixelFormat format = Images::kPixelFormatR8G8B8A8;
+		Images::S3TCQuality quality = Images::kS3TCQualityFast;
+		bool mipMaps = true;
+		bool flip = false;
+
+		if (!parseCommandLine(args, returnValue, inFile, outFile, txiFile, type, format, quality, mipMaps, flip))
+			return returnValue;
+
+		convert(inFile, outFile, txiFile, type, format, quality, mipMaps, flip);
+	} catch (...) {
+		Common::exceptionDispatcherError();
+	}
+
+	return 0;
+}
+
+bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
+                      Common::UString &inFile, Common::UString &outFile, Common::UString &txiFile,
+                      Aurora::FileType &type, Images::PixelFormat &format, Images::S3TCQuality &quality,
+                      bool &mipMaps, bool &flip) {
+
+	std::vector<Common::UString> files;
+
+	bool optionsEnd = false;
+	for (size_t i = 1; i < argv.size(); i++) {
+		bool isOption = false;
+
+		// A "--" marks an end to all options
+		if (argv[i] == "--") {
+			optionsEnd = true;
+			continue;
+		}
+
+		// We're still handling options
+		if (!optionsEnd) {
+			// Help text
+			if ((argv[i] == "-h") || (argv[i] == "--help")) {
+				printUsage(stdout, argv[0]);
+				returnValue = 0;
+
+				return false;
+			}
+
+			if (argv[i] == "--version") {
+				printVersion();
+				returnValue = 0;
+
+				return false;
+			}
+
+			if        (argv[i] == "--tpc") {
+				isOption = true;
+				type     = Aurora::kFileTypeTPC;
+			} else if (argv[i] == "--dds") {
+				isOption = true;
+				type     = Aurora::kFileTypeDDS;
+			} else if (argv[i] == "--auto") {
+				isOption = true;
+				format   = Images::kPixelFormatR8G8B8A8;
+			} else if (argv[i] == "--dxt1") {
+				isOption = true;
+				format   = Images::kPixelFormatDXT1;
+			} else if (argv[i] == "--dxt5") {
+				isOption = true;
+				format   = Images::kPixelFormatDXT5;
+			} else if (argv[i] == "--high-quality") {
+				isOption = true;
+				quality  = Images::kS3TCQualityHigh;
+			} else if (argv[i] == "--no-mipmaps") {
+				isOption = true;
+				mipMaps  = false;
+			} else if ((argv[i] == "-f") || (argv[i] == "--flip")) {
+				isOption = true;
+				flip     = true;
+			} else if (argv[i] == "--txi") {
+				isOption = true;
+
+				// Needs the TXI file name as the next parameter
+				if (i++ == (argv.size() - 1)) {
+					printUsage(stderr, argv[0]);
+					returnValue = 1;
+
+					return false;
+				}
+
+				txiFile = argv[i];
+
+			} else if (argv[i].beginsWith("-") || argv[i].beginsWith("--")) {
+			  // An options, but we already checked for all known ones
+
+				printUsage(stderr, argv[0]);
+				returnValue = 1;
+
+				return false;
+			}
+		}
+
+		// Was this a valid option? If so, don't try to use it as a file
+		if (isOption)
+			continue;
+
+		files.push_back(argv[i]);
+	}
+
+	if (files.size() != 2) {
+		printUsage(stderr, argv[0]);
+		returnValue = 1;
+
+		return false;
+	}
+
+	inFile  = files[0];
+	outFile = files[1];
+
+	return true;
+}
+
+void printUsage(FILE *stream, const Common::UString &name) {
+	std::fprintf(stream, "TGA to BioWare textures converter\n");
+	std::fprintf(stream, "Usage: %s [<options>] <input file> <output file>\n", name.c_str());
+	std::fprintf(stream, "  -h      --help              This help text\n");
+	std::fprintf(stream, "          --version           Display version information\n");
+	std::fprintf(stream, "  -f      --flip              Flip the image vertically\n");
+	std::fprintf(stream, "          --tpc               Write a TPC texture (default)\n");
+	std::fprintf(stream, "          --dds               Write a DDS texture\n");
+	std::fprintf(stream, "                              (Default: detect by output file extension)\n");
+	std::fprintf(stream, "          --auto              DXT5 if the image has alpha, DXT1 otherwise\n");
+	std::fprintf(stream, "                              (default)\n");
+	std::fprintf(stream, "          --dxt1              Compress into DXT1\n");
+	std::fprintf(stream, "          --dxt5              Compress into DXT5\n");
+	std::fprintf(stream, "          --high-quality      Slower compression with a better fit\n");
+	std::fprintf(stream, "          --no-mipmaps        Don't create mip maps\n");
+	std::fprintf(stream, "          --txi <file>        Embed this TXI file into the TPC\n");
+}
+
+/** Does the image have any pixels that aren't fully opaque? */
+static bool hasAlpha(const Images::Decoder &image) {
+	if ((image.getFormat() != Images::kPixelFormatR8G8B8A8) &&
+	    (image.getFormat() != Images::kPixelFormatB8G8R8A8))
+		return false;
+
+	const Images::Decoder::MipMap &mipMap = image.getMipMap(0);
+
+	for (uint32 i = 3; i < mipMap.size; i += 4)
+		if (mipMap.data[i] != 0xFF)
+			return true;
+
+	return false;
+}
+
+void convert(const Common::UString &inFile, const Common::UString &outFile, const Common::UString &txiFile,
+             Aurora::FileType type, Images::PixelFormat format, Images::S3TCQuality quality,
+             bool mipMaps, bool flip) {
+
+	if (type == Aurora::kFileTypeNone)
+		type = (TypeMan.getFileType(outFile) == Aurora::kFileTypeDDS) ? Aurora::kFileTypeDDS : Aurora::kFileTypeTPC;
+
+	if (!txiFile.empty() && (type != Aurora::kFileTypeTPC))
+		throw Common::Exception("Only TPC textures can embed TXI data");
+
+	Common::ReadFile in(inFile);
+	Images::TGA image(in);
+
+	if (format == Images::kPixelFormatR8G8B8A8)
+		format = hasAlpha(image) ? Images::kPixelFormatDXT5 : Images::kPixelFormatDXT1;
+
+	if (flip)
+		image.flipVertically();
+
+	if (mipMaps)
+		image.createMipMaps();
+
+	image.compress(format, quality);
+
+	if (type == Aurora::kFileTypeDDS) {
+		Images::dumpDDS(outFile, image);
+	} else {
+		Common::ReadFile *txi = txiFile.empty() ? 0 : new Common::ReadFile(txiFile);
+
+		try {
+			Images::dumpTPC(outFile, image, txi);
+		} catch (...) {
+			delete txi;
+			throw;
+		}
+
+		delete txi;
+	}
+
+	status("Converted \"%s\" into %s \"%s\"", inFile.c_str(),
+	       (format == Images::kPixelFormatDXT1) ? "DXT1" : "DXT5", outFile.c_str());
+}
@@ -0,0 +1,369 @@
+/* xoreos-tools - Tools to help with xoreos development
+ *
+ * xoreos-tools is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos-tools is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos-tools is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos-tools. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Tool to search for strings in TLK files.
+ */
+
+#include <cstring>
+#include <cstdio>
+
+#include "src/common/version.h"
+#include "src/common/ustring.h"
+#include "src/common/util.h"
+#include "src/common/error.h"
+#include "src/common/platform.h"
+#include "src/common/readfile.h"
+#include "src/common/memreadstream.h"
+#include "src/common/writefile.h"
+#include "src/common/encoding.h"
+
+#include "src/aurora/types.h"
+#include "src/aurora/language.h"
+#include "src/aurora/talktable.h"
+#include "src/aurora/talktableindex.h"
+
+void printUsage(FILE *stream, const Common::UString &name);
+bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
+                      Common::UString &inFile, Common::UString &query,
+                      Common::Encoding &encoding, Aurora::GameID &game,
+                      bool &ignoreCase, bool &useIndex);
+
+void searchTLK(const Common::UString &inFile, const Common::UString &query,
+               Common::Encoding encoding, bool ignoreCase, bool useIndex);
+
+int main(int argc, char **argv) {
+	try {
+		std::vector<Common::UString> args;
+		Common::Platform::getParameters(argc, argv, args);
+
+		Common::Encoding encoding = Common::kEncodingInvalid;
+		Aurora::GameID   game     = Aurora::kGameIDUnknown;
+
+		bool ignoreCase = false;
+		bool useIndex   = true;
+
+		int returnValue = 1;
+		Common::UString inFile, query;
+
+		if (!parseCommandLine(args, returnValue, inFile, query, encoding, game, ignoreCase, useIndex))
+			return returnValue;
+
+		LangMan.declareLanguages(game);
+
+		searchTLK(inFile, query, encoding, ignoreCase, useIndex);
+	} catch (...) {
+		Common::exceptionDispatcherError();
+	}
+
+	return 0;
+}
+
+bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
+                      Common::UString &inFile, Common::UString &query,
+                      Common::Encoding &encoding, Aurora::GameID &game,
+                      bool &ignoreCase, bool &useIndex) {
+
+	inFile.clear();
+	query.clear();
+	std::vector<Common::UString> args;
+
+	bool optionsEnd = false;
+	for (size_t i = 1; i < argv.size(); i++) {
+		bool isOption = false;
+
+		// A "--" marks an end to all options
+		if (argv[i] == "--") {
+			optionsEnd = true;
+			continue;
+		}
+
+		// We're still handling options
+		if (!optionsEnd) {
+			// Help text
+			if ((argv[i] == "-h") || (argv[i] == "--help")) {
+				printUsage(stdout, argv[0]);
+				returnValue = 0;
+
+				return false;
+			}
+
+			if (argv[i] == "--version") {
+				printVersion();
+				returnValue = 0;
+
+				return false;
+			}
+
+			if        ((argv[i] == "-i") || (argv[i] == "--ignore-case")) {
+				isOption   = true;
+				ignoreCase = true;
+			} else if (argv[i] == "--no-index") {
+				isOption = true;
+				useIndex = false;
+			} else if (argv[i] == "--cp1250") {
+				isOption = true;
+				encoding = Common::kEncodingCP1250;
+				game     = Aurora::kGameIDUnknown;
+			} else if (argv[i] == "--cp1251") {
+				isOption = true;
+				encoding = Common::kEncodingCP1251;
+				game     = Aurora::kGameIDUnknown;
+			} else if (argv[i] == "--cp1252") {
+				isOption = true;
+				encoding = Common::kEncodingCP1252;
+				game     = Aurora::kGameIDUnknown;
+			} else if (argv[i] == "--cp932") {
+				isOption = true;
+				encoding = Common::kEncodingCP932;
+				game     = Aurora::kGameIDUnknown;
+			} else if (argv[i] == "--cp936") {
+				isOption = true;
+				encoding = Common::kEncodingCP936;
+				game     = Aurora::kGameIDUnknown;
+			} else if (argv[i] == "--cp949") {
+				isOption = true;
+				encoding = Common::kEncodingCP949;
+				game     = Aurora::kGameIDUnknown;
+			} else if (argv[i] == "--cp950") {
+				isOption = true;
+				encoding = Common::kEncodingCP950;
+				game     = Aurora::kGameIDUnknown;
+			} else if (argv[i] == "--utf8") {
+				isOption = true;
+				encoding = Common::kEncodingUTF8;
+				game     = Aurora::kGameIDUnknown;
+			} else if (argv[i] == "--utf16le") {
+				isOption = true;
+				encoding = Common::kEncodingUTF16LE;
+				game     = Aurora::kGameIDUnknown;
+			} else if (argv[i] == "--utf16be") {
+				isOption = true;
+				encoding = Common::kEncodingUTF16BE;
+				game     = Aurora::kGameIDUnknown;
+			} else if (argv[i] == "--nwn") {
+				isOption = true;
+				encoding = Common::kEncodingInvalid;
+				game     = Aurora::kGameIDNWN;
+			} else if (argv[i] == "--nwn2") {
+				isOption = true;
+				encoding = Common::kEncodingInvalid;
+				game     = Aurora::kGameIDNWN2;
+			} else if (argv[i] == "--kotor") {
+				isOption = true;
+				encoding = Common::kEncodingInvalid;
+				game     = Aurora::kGameIDKotOR;
+			} else if (argv[i] == "--kotor2") {
+				isOption = true;
+				encoding = Common::kEncodingInvalid;
+				game     = Aurora::kGameIDKotOR2;
+			} else if (argv[i] == "--jade") {
+				isOption = true;
+				encoding = Common::kEncodingInvalid;
+				game     = Aurora::kGameIDJade;
+			} else if (argv[i] == "--witcher") {
+				isOption = true;
+				encoding = Common::kEncodingInvalid;
+				game     = Aurora::kGameIDWitcher;
+			} else if (argv[i] == "--dragonage") {
+				isOption = true;
+				encoding = Common::kEncodingInvalid;
+				game     = Aurora::kGameIDDragonAge;
+			} else if (argv[i] == "--dragonage2") {
+				isOption = true;
+				encoding = Common::kEncodingInvalid;
+				game     = Aurora::kGameIDDragonAge2;
+			} else if (argv[i].beginsWith("-") || argv[i].beginsWith("--")) {
+			  // An options, but we already checked for all known ones
+
+				printUsage(stderr, argv[0]);
+				returnValue = 1;
+
+				return false;
+			}
+		}
+
+		// Was this a valid option? If so, don't try to use it as a file
+		if (isOption)
+			continue;
+
+		// This is a file or the query
+		args.push_back(argv[i]);
+	}
+
+	if (args.size() != 2) {
+		printUsage(stderr, argv[0]);
+		returnValue = 1;
+
+		return false;
+	}
+
+	inFile = args[0];
+	query  = args[1];
+
+	return true;
+}
+
+void printUsage(FILE *stream, const Common::UString &name) {
+	std::fprintf(stream, "BioWare TLK string search\n\n");
+	std::fprintf(stream, "Usage: %s [<options>] <tlk file> <query>\n", name.c_str());
+	std::fprintf(stream, "  -h      --help              This help text\n");
+	std::fprintf(stream, "          --version           Display version information\n\n");
+	std::fprintf(stream, "  -i      --ignore-case       Ignore the case of ASCII characters\n");
+	std::fprintf(stream, "          --no-index          Don't read or write a search index file\n\n");
+	std::fprintf(stream, "          --cp1250            Read TLK strings as Windows CP-1250\n");
+	std::fprintf(stream, "          --cp1251            Read TLK strings as Windows CP-1251\n");
+	std::fprintf(stream, "          --cp1252            Read TLK strings as Windows CP-1252\n");
+	std::fprintf(stream, "          --cp932             Read TLK strings as Windows CP-932\n");
+	std::fprintf(stream, "          --cp936             Read TLK strings as Windows CP-936\n");
+	std::fprintf(stream, "          --cp949             Read TLK strings as Windows CP-949\n");
+	std::fprintf(stream, "          --cp950             Read TLK strings as Windows CP-950\n");
+	std::fprintf(stream, "          --utf8              Read TLK strings as UTF-8\n");
+	std::fprintf(stream, "          --utf16le           Read TLK strings as little-endian UTF-16\n");
+	std::fprintf(stream, "          --utf16be           Read TLK strings as big-endian UTF-16\n\n");
+	std::fprintf(stream, "          --nwn               Use Neverwinter Nights encodings\n");
+	std::fprintf(stream, "          --nwn2              Use Neverwinter Nights 2 encodings\n");
+	std::fprintf(stream, "          --kotor             Use Knights of the Old Republic encodings\n");
+	std::fprintf(stream, "          --kotor2            Use Knights of the Old Republic II encodings\n");
+	std::fprintf(stream, "          --jade              Use Jade Empire encodings\n");
+	std::fprintf(stream, "          --witcher           Use The Witcher encodings\n");
+	std::fprintf(stream, "          --dragonage         Use Dragon Age encodings\n");
+	std::fprintf(stream, "          --dragonage2        Use Dragon Age II encodings\n\n");
+	std::fprintf(stream, "Prints the StrRef, sound ResRef and text of every string containing\n");
+	std::fprintf(stream, "the query, one per line and separated by tabs.\n\n");
+	std::fprintf(stream, "To speed up repeated searches, an index of the strings is written\n");
+	std::fprintf(stream, "next to the TLK file, as <tlk file>.idx. It is recreated whenever\n");
+	std::fprintf(stream, "the TLK file or the encoding changes.\n\n");
+	std::fprintf(stream, "There is no way to autodetect the encoding of strings in TLK files,\n");
+	std::fprintf(stream, "so an encoding must be specified. Alternatively, the game this TLK\n");
+	std::fprintf(stream, "is from can be given, and an appropriate encoding according to that\n");
+	std::fprintf(stream, "game and the language ID found in the TLK is used.\n");
+}
+
+/** Read the index file, if it exists and matches the talk table. */
+static Aurora::TalkTableIndex *readIndex(const Common::UString &indexFile, uint32 checksum,
+                                         Common::Encoding encoding) {
+
+	Common::ReadFile file;
+	if (!file.open(indexFile))
+		return 0;
+
+	Aurora::TalkTableIndex *index = 0;
+	Common::SeekableReadStream *data = 0;
+
+	try {
+		data  = file.readStream(file.size());
+		index = new Aurora::TalkTableIndex(*data);
+	} catch (Common::Exception &e) {
+		delete data;
+
+		Common::printException(e, "WARNING: ");
+		return 0;
+	}
+
+	delete data;
+
+	if (!index->matches(checksum, encoding)) {
+		delete index;
+		return 0;
+	}
+
+	return index;
+}
+
+/** Write the index file, warning if that's not possible. */
+static void writeIndex(const Common::UString &indexFile, const Aurora::TalkTableIndex &index) {
+	Common::WriteFile file;
+	if (!file.open(indexFile)) {
+		warning("Can't write index file \"%s\"", indexFile.c_str());
+		return;
+	}
+
+	try {
+		index.write(file);
+		file.flush();
+	} catch (Common::Exception &e) {
+		Common::printException(e, "WARNING: ");
+	}
+}
+
+static Aurora::TalkTableIndex *getIndex(const Common::UString &inFile, const Aurora::TalkTable &tlk,
+                                        uint32 checksum, bool useIndex) {
+
+	const Common::UString indexFile = inFile + ".idx";
+
+	Aurora::TalkTableIndex *index = 0;
+	if (useIndex)
+		index = readIndex(indexFile, checksum, tlk.getEncoding());
+
+	if (index)
+		return index;
+
+	index = new Aurora::TalkTableIndex(tlk, checksum);
+
+	if (useIndex)
+		writeIndex(indexFile, *index);
+
+	return index;
+}
+
+void searchTLK(const Common::UString &inFile, const Common::UString &query,
+               Common::Encoding encoding, bool ignoreCase, bool useIndex) {
+
+	Common::SeekableReadStream *tlkFile = new Common::ReadFile(inFile);
+
+	uint32 checksum = 0;
+	if (useIndex) {
+		try {
+			checksum = Aurora::TalkTableIndex::getChecksum(*tlkFile);
+		} catch (...) {
+			delete tlkFile;
+			throw;
+		}
+	}
+
+	Aurora::TalkTable *tlk = Aurora::TalkTable::load(tlkFile, encoding);
+	if (!tlk)
+		throw Common::Exception("\"%s\" is not a talk table", inFile.c_str());
+
+	Aurora::TalkTableIndex *index = 0;
+
+	try {
+		index = getIndex(inFile, *tlk, checksum, useIndex);
+
+		std::vector<uint32> strRefs;
+		index->search(*tlk, query, ignoreCase, strRefs);
+
+		for (std::vector<uint32>::const_iterator s = strRefs.begin(); s != strRefs.end(); ++s) {
+			Common::UString string, soundResRef;
+			tlk->getString(*s, string, soundResRef);
+
+			std::printf("%u\t%s\t%s\n", *s, soundResRef.c_str(), string.c_str());
+		}
+
+	} catch (...) {
+		delete index;
+		delete tlk;
+		throw;
+	}
+
+	delete index;
+	delete tlk;
+}
@@ -50,10 +50,10 @@ const char *kCommandChar[kCommandMAX] = { "l", "e" };
 
 void printUsage(FILE *stream, const Common::UString &name);
 bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
-                      Command &command, Common::UString &file);
+                      Command &command, Common::UString &file, bool &png);
 
-void listFiles(Aurora::NSBTXFile &nsbtx);
-void extractFiles(Aurora::NSBTXFile &nsbtx);
+void listFiles(Aurora::NSBTXFile &nsbtx, bool png);
+void extractFiles(Aurora::NSBTXFile &nsbtx, bool png);
 
 int main(int argc, char **argv) {
 	try {
@@ -63,16 +63,17 @@ int main(int argc, char **argv) {
 		int returnValue = 1;
 		Command command = kCommandNone;
 		Common::UString file;
+		bool png = false;
 
-		if (!parseCommandLine(args, returnValue, command, file))
+		if (!parseCommandLine(args, returnValue, command, file, png))
 			return returnValue;
 
 		Aurora::NSBTXFile nsbtx(new Common::ReadFile(file));
 
 		if      (command == kCommandList)
-			listFiles(nsbtx);
+			listFiles(nsbtx, png);
 		else if (command == kCommandExtract)
-			extractFiles(nsbtx);
+			extractFiles(nsbtx, png);
 
 	} catch (...) {
 		Common::exceptionDispatcherError();
@@ -82,7 +83,7 @@ int main(int argc, char **argv) {
 }
 
 bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
-                      Command &command, Common::UString &file) {
+                      Command &command, Common::UString &file, bool &png) {
 
 	file.clear();
 	std::vector<Common::UString> args;
@@ -112,6 +113,12 @@ bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue
 				return false;
 			}
 
+			if (argv[i] == "--png") {
+				png = true;
+
+				continue;
+			}
+
 			if (argv[i].beginsWith("-") || argv[i].beginsWith("--")) {
 			  // An options, but we already checked for all known ones
 
@@ -156,13 +163,14 @@ void printUsage(FILE *stream, const Common::UString &name) {
 	std::fprintf(stream, "Usage: %s [<options>] <command> <file>\n\n", name.c_str());
 	std::fprintf(stream, "Options:\n");
 	std::fprintf(stream, "  -h      --help              This help text\n");
-	std::fprintf(stream, "          --version           Display version information\n\n");
+	std::fprintf(stream, "          --version           Display version information\n");
+	std::fprintf(stream, "          --png               Extract PNGs instead of TGAs\n\n");
 	std::fprintf(stream, "Commands:\n");
 	std::fprintf(stream, "  l          List texture\n");
 	std::fprintf(stream, "  e          Extract images to current directory\n");
 }
 
-void listFiles(Aurora::NSBTXFile &nsbtx) {
+void listFiles(Aurora::NSBTXFile &nsbtx, bool png) {
 	const Aurora::Archive::ResourceList &resources = nsbtx.getResources();
 	const size_t fileCount = resources.size();
 
@@ -172,18 +180,21 @@ void listFiles(Aurora::NSBTXFile &nsbtx) {
 	std::printf("=====================|===========\n");
 
 	for (Aurora::Archive::ResourceList::const_iterator r = resources.begin(); r != resources.end(); ++r)
-		std::printf("%16s.tga | %10d\n", r->name.c_str(), nsbtx.getResourceSize(r->index));
+		std::printf("%16s.%s | %10d\n", r->name.c_str(), png ? "png" : "tga", nsbtx.getResourceSize(r->index));
 }
 
-void dumpImage(Common::SeekableReadStream &stream, const Common::UString &fileName) {
+void dumpImage(Common::SeekableReadStream &stream, const Common::UString &fileName, bool png) {
 	Images::XEOSITEX itex(stream);
 
 	itex.flipVertically();
 
-	itex.dumpTGA(fileName);
+	if (png)
+		itex.dumpPNG(fileName);
+	else
+		itex.dumpTGA(fileName);
 }
 
-void extractFiles(Aurora::NSBTXFile &nsbtx) {
+void extractFiles(Aurora::NSBTXFile &nsbtx, bool png) {
 	const Aurora::Archive::ResourceList &resources = nsbtx.getResources();
 	const size_t fileCount = resources.size();
 
@@ -191,7 +202,7 @@ void extractFiles(Aurora::NSBTXFile &nsbtx) {
 
 	size_t i = 1;
 	for (Aurora::Archive::ResourceList::const_iterator r = resources.begin(); r != resources.end(); ++r, ++i) {
-		const Common::UString fileName = r->name + ".tga";
+		const Common::UString fileName = r->name + (png ? ".png" : ".tga");
 
 		std::printf("Extracting %u/%u: %s ... ", (uint)i, (uint)fileCount, fileName.c_str());
 
@@ -199,7 +210,7 @@ void extractFiles(Aurora::NSBTXFile &nsbtx) {
 		try {
 			stream = nsbtx.getResource(r->index);
 
-			dumpImage(*stream, fileName);
+			dumpImage(*stream, fileName, png);
 
 			std::printf("Done\n");
 		} catch (Common::Exception &e) {
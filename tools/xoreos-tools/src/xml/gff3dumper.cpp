@@ -274,10 +274,10 @@ void GFF3Dumper::dumpStruct(const Aurora::GFF3Struct &strct, const Common::UStri
 	if (strct.getFieldCount() > 0)
 		_xml->breakLine();
 
-	const std::vector<Common::UString> &fields = strct.getFieldNames();
+	const Aurora::GFFLabelSpan fields = strct.getFieldLabels();
 
-	for (std::vector<Common::UString>::const_iterator f = fields.begin(); f != fields.end(); ++f)
-		dumpField(strct, *f);
+	for (Aurora::GFFLabelSpan::const_iterator f = fields.begin(); f != fields.end(); ++f)
+		dumpField(strct, GFFLabels.getLabel(*f));
 
 	_xml->closeTag();
 	_xml->breakLine();
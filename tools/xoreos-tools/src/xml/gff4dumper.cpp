@@ -134,9 +134,9 @@ void GFF4Dumper::dumpStruct(const Aurora::GFF4Struct *strct, bool hasLabel, uint
 
 			_xml->breakLine();
 
-			const std::vector<uint32> &fields = strct->getFieldLabels();
+			const Aurora::GFFLabelSpan fields = strct->getFieldLabels();
 
-			for (std::vector<uint32>::const_iterator f = fields.begin(); f != fields.end(); ++f)
+			for (Aurora::GFFLabelSpan::const_iterator f = fields.begin(); f != fields.end(); ++f)
 				dumpField(*strct, *f, false);
 		} else
 			_xml->addProperty("ref_id", Common::composeString(strct->getID()));
@@ -335,9 +335,9 @@ void GFF4Dumper::dumpFieldGeneric(const GFF4Field &field) {
 	if (!generic)
 		return;
 
-	const std::vector<uint32> &fields = generic->getFieldLabels();
+	const Aurora::GFFLabelSpan fields = generic->getFieldLabels();
 
-	for (std::vector<uint32>::const_iterator f = fields.begin(); f != fields.end(); ++f) {
+	for (Aurora::GFFLabelSpan::const_iterator f = fields.begin(); f != fields.end(); ++f) {
 		if (f == fields.begin())
 			_xml->breakLine();
 
@@ -36,7 +36,7 @@
 namespace XML {
 
 void SSFCreator::create(Common::WriteStream &output, Common::ReadStream &input, Aurora::GameID game) {
-	XMLParser xml(input, true);
+	XMLReader xml(input, true);
 	const XMLNode &xmlRoot = xml.getRoot();
 
 	if (xmlRoot.getName() != "ssf")
@@ -44,13 +44,12 @@ void SSFCreator::create(Common::WriteStream &output, Common::ReadStream &input,
 
 	Aurora::SSFFile ssf;
 
-	const XMLNode::Children &strings = xmlRoot.getChildren();
-
-	for (XMLNode::Children::const_iterator s = strings.begin(); s != strings.end(); ++s) {
-		if ((*s)->getName() != "sound")
+	const XMLNode *s;
+	while ((s = xml.readChild())) {
+		if (s->getName() != "sound")
 			throw Common::Exception("XML tag \"sound\" expected");
 
-		const Common::UString xmlID = (*s)->getProperty("id");
+		const Common::UString xmlID = s->getProperty("id");
 		if (xmlID.empty())
 			throw Common::Exception("XML property \"id\" expected");
 
@@ -58,12 +57,12 @@ void SSFCreator::create(Common::WriteStream &output, Common::ReadStream &input,
 		Common::parseString(xmlID, soundID, false);
 
 		Common::UString soundFile;
-		const XMLNode *text = (*s)->findChild("text");
+		const XMLNode *text = s->findChild("text");
 		if (text)
 			soundFile = text->getContent();
 
 		uint32 strRef = 0xFFFFFFFF;
-		Common::parseString((*s)->getProperty("strref"), strRef, true);
+		Common::parseString(s->getProperty("strref"), strRef, true);
 
 		ssf.setSound(soundID, soundFile, strRef);
 	}
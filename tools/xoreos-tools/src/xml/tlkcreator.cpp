@@ -42,7 +42,10 @@ void TLKCreator::create(Common::WriteStream &output, Common::ReadStream &input,
 	if ((version != kVersion30) && (version != kVersion40))
 		throw Common::Exception("Invalid TLK version");
 
-	XMLParser xml(input, true);
+	/* TSL's dialog.tlk alone has about 140k strings. Instead of holding the
+	 * whole XML document in memory, we read the strings one by one. */
+
+	XMLReader xml(input, true);
 	const XMLNode &xmlRoot = xml.getRoot();
 
 	if (xmlRoot.getName() != "tlk")
@@ -66,24 +69,12 @@ void TLKCreator::create(Common::WriteStream &output, Common::ReadStream &input,
 
 	Aurora::TalkTable_TLK tlk(encoding, languageID);
 
-	const XMLNode::Children &strings = xmlRoot.getChildren();
-
-	// Look at the ID of the last string entry, and create a dummy entry to speed up re-allocation
-	if (!strings.empty()) {
-		uint32 lastID = 0xFFFFFFFF;
-
-		XMLNode::Children::const_iterator last = --strings.end();
-		Common::parseString((*last)->getProperty("id"), lastID, true);
-
-		if (lastID != 0xFFFFFFFF)
-			tlk.setEntry(lastID, "", "", 0, 0, -1.0f, 0xFFFFFFFF);
-	}
-
-	for (XMLNode::Children::const_iterator s = strings.begin(); s != strings.end(); ++s) {
-		if ((*s)->getName() != "string")
+	const XMLNode *s;
+	while ((s = xml.readChild())) {
+		if (s->getName() != "string")
 			throw Common::Exception("XML tag \"string\" expected");
 
-		const Common::UString xmlID = (*s)->getProperty("id");
+		const Common::UString xmlID = s->getProperty("id");
 		if (xmlID.empty())
 			throw Common::Exception("XML property \"id\" expected");
 
@@ -91,19 +82,19 @@ void TLKCreator::create(Common::WriteStream &output, Common::ReadStream &input,
 		Common::parseString(xmlID, strRef, false);
 
 		Common::UString string;
-		const XMLNode *text = (*s)->findChild("text");
+		const XMLNode *text = s->findChild("text");
 		if (text)
 			string = text->getContent();
 
-		const Common::UString soundResRef = (*s)->getProperty("sound");
+		const Common::UString soundResRef = s->getProperty("sound");
 
 		uint32 volumeVariance = 0, pitchVariance = 0, soundID = 0xFFFFFFFF;
-		Common::parseString((*s)->getProperty("volumevariance"), volumeVariance, true);
-		Common::parseString((*s)->getProperty("pitchvariance" ), pitchVariance , true);
-		Common::parseString((*s)->getProperty("soundid"       ), soundID       , true);
+		Common::parseString(s->getProperty("volumevariance"), volumeVariance, true);
+		Common::parseString(s->getProperty("pitchvariance" ), pitchVariance , true);
+		Common::parseString(s->getProperty("soundid"       ), soundID       , true);
 
 		float soundLength = -1.0f;
-		Common::parseString((*s)->getProperty("soundlength"), soundLength, true);
+		Common::parseString(s->getProperty("soundlength"), soundLength, true);
 
 		tlk.setEntry(strRef, string, soundResRef, volumeVariance, pitchVariance, soundLength, soundID);
 	}
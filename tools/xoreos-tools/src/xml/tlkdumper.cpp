@@ -50,9 +50,9 @@ void TLKDumper::dump(Common::WriteStream &output, Common::SeekableReadStream *in
 		xml.addProperty("language", Common::composeString(languageID));
 	xml.breakLine();
 
-	const std::list<uint32> &strRefs = tlk->getStrRefs();
+	const std::vector<uint32> &strRefs = tlk->getStrRefs();
 
-	for (std::list<uint32>::const_iterator s = strRefs.begin(); s != strRefs.end(); ++s) {
+	for (std::vector<uint32>::const_iterator s = strRefs.begin(); s != strRefs.end(); ++s) {
 		const uint32 strRef = *s;
 
 		Common::UString str, sound;
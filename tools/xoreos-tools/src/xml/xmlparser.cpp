@@ -27,6 +27,7 @@
 
 #include <libxml/parser.h>
 #include <libxml/xmlerror.h>
+#include <libxml/xmlreader.h>
 
 #include "src/common/util.h"
 #include "src/common/error.h"
@@ -70,6 +71,9 @@ static void deinitXML() {
 	xmlCleanupParser();
 }
 
+static const int kParseOptions = XML_PARSE_NOWARNING | XML_PARSE_NOBLANKS | XML_PARSE_NONET |
+                                 XML_PARSE_NSCLEAN   | XML_PARSE_NOCDATA;
+
 
 XMLParser::XMLParser(Common::ReadStream &stream, bool makeLower) : _rootNode(0) {
 	initXML();
@@ -77,10 +81,7 @@ XMLParser::XMLParser(Common::ReadStream &stream, bool makeLower) : _rootNode(0)
 
 	try {
 
-		const int options = XML_PARSE_NOWARNING | XML_PARSE_NOBLANKS | XML_PARSE_NONET |
-		                    XML_PARSE_NSCLEAN   | XML_PARSE_NOCDATA;
-
-		xml = xmlReadIO(readStream, closeStream, static_cast<void *>(&stream), "stream.xml", 0, options);
+		xml = xmlReadIO(readStream, closeStream, static_cast<void *>(&stream), "stream.xml", 0, kParseOptions);
 		if (!xml)
 			throw Common::Exception("XML document failed to parse");
 
@@ -111,10 +112,117 @@ const XMLNode &XMLParser::getRoot() const {
 }
 
 
-XMLNode::XMLNode(_xmlNode &node, bool makeLower, XMLNode *parent) : _parent(parent) {
+XMLReader::XMLReader(Common::ReadStream &stream, bool makeLower) : _reader(0), _makeLower(makeLower),
+	_rootNode(0), _child(0), _skipChildren(false), _finished(false) {
+
+	initXML();
+
 	try {
 
-		load(node, makeLower);
+		_reader = xmlReaderForIO(readStream, closeStream, static_cast<void *>(&stream), "stream.xml", 0, kParseOptions);
+		if (!_reader)
+			throw Common::Exception("XML document failed to parse");
+
+		// Look for the root element
+		int result;
+		while ((result = xmlTextReaderRead(_reader)) == 1)
+			if (xmlTextReaderNodeType(_reader) == XML_READER_TYPE_ELEMENT)
+				break;
+
+		if (result < 0)
+			throw Common::Exception("XML document failed to parse");
+
+		xmlNodePtr root = (result == 1) ? xmlTextReaderCurrentNode(_reader) : 0;
+		if (!root)
+			throw Common::Exception("XML document has no root node");
+
+		// The root's children will be read one by one later
+		_rootNode = new XMLNode(*root, makeLower, 0, false);
+
+		// An empty root element has no children, and no end element
+		_finished = xmlTextReaderIsEmptyElement(_reader) == 1;
+
+	} catch (...) {
+		clear();
+		throw;
+	}
+}
+
+XMLReader::~XMLReader() {
+	clear();
+}
+
+void XMLReader::clear() {
+	delete _child;
+	delete _rootNode;
+
+	_child    = 0;
+	_rootNode = 0;
+
+	if (_reader) {
+		xmlFreeTextReader(_reader);
+		deinitXML();
+	}
+
+	_reader = 0;
+}
+
+const XMLNode &XMLReader::getRoot() const {
+	return *_rootNode;
+}
+
+const XMLNode *XMLReader::readChild() {
+	// Free the previous child and its subtree
+	delete _child;
+	_child = 0;
+
+	while (!_finished) {
+		// Skip over the subtree of the last child, which we've already read
+		const int result = _skipChildren ? xmlTextReaderNext(_reader) : xmlTextReaderRead(_reader);
+		_skipChildren = false;
+
+		if (result < 0)
+			throw Common::Exception("XML document failed to parse");
+
+		if (result == 0) {
+			_finished = true;
+			break;
+		}
+
+		const int type  = xmlTextReaderNodeType(_reader);
+		const int depth = xmlTextReaderDepth(_reader);
+
+		// Reaching the end of the root element means there are no more children
+		if (depth == 0) {
+			if (type == XML_READER_TYPE_END_ELEMENT)
+				_finished = true;
+
+			continue;
+		}
+
+		if ((depth != 1) || (type == XML_READER_TYPE_END_ELEMENT) ||
+		    (type == XML_READER_TYPE_WHITESPACE) || (type == XML_READER_TYPE_SIGNIFICANT_WHITESPACE))
+			continue;
+
+		// Parse this child's complete subtree
+		xmlNodePtr node = xmlTextReaderExpand(_reader);
+		if (!node)
+			throw Common::Exception("XML document failed to parse");
+
+		_child = new XMLNode(*node, _makeLower, _rootNode);
+		_skipChildren = true;
+
+		return _child;
+	}
+
+	return 0;
+}
+
+
+XMLNode::XMLNode(_xmlNode &node, bool makeLower, XMLNode *parent, bool loadChildren) : _parent(parent) {
+	try {
+
+		load(node, makeLower, loadChildren);
 
 	} catch (...) {
 		clean();
@@ -168,14 +276,17 @@ Common::UString XMLNode::getProperty(const Common::UString &name, const Common::
 	return def;
 }
 
-void XMLNode::load(_xmlNode &node, bool makeLower) {
+void XMLNode::load(_xmlNode &node, bool makeLower, bool loadChildren) {
 	_name    = node.name    ? reinterpret_cast<const char *>(node.name)    : "";
 	_content = node.content ? reinterpret_cast<const char *>(node.content) : "";
 
 	if (makeLower)
 		_name.makeLower();
 
-	for (xmlAttrPtr attrib = node.properties; attrib; attrib = attrib->next) {
+	// Only elements have properties. libxml2 might use that field for other purposes in other node types
+	xmlAttrPtr attribs = (node.type == XML_ELEMENT_NODE) ? node.properties : 0;
+
+	for (xmlAttrPtr attrib = attribs; attrib; attrib = attrib->next) {
 		Common::UString name (attrib->name     ? reinterpret_cast<const char *>(attrib->name)              : "");
 		Common::UString value(attrib->children ? reinterpret_cast<const char *>(attrib->children->content) : "");
 
@@ -185,6 +296,9 @@ void XMLNode::load(_xmlNode &node, bool makeLower) {
 		_properties.insert(std::make_pair(name, value));
 	}
 
+	if (!loadChildren)
+		return;
+
 	for (xmlNodePtr child = node.children; child; child = child->next) {
 		_children.push_back(new XMLNode(*child, makeLower, this));
 
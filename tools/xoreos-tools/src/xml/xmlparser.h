@@ -31,6 +31,7 @@
 #include "src/common/ustring.h"
 
 struct _xmlNode;
+struct _xmlTextReader;
 
 namespace Common {
 	class ReadStream;
@@ -53,6 +54,49 @@ private:
 	XMLNode *_rootNode;
 };
 
+/** Class to parse a ReadStream into a stream of XML nodes.
+ *
+ *  Unlike XMLParser, this does not build a tree of the whole XML
+ *  document. Instead, only the root node (without its children) is
+ *  available at all times, while the root's children, each with its
+ *  complete subtree, are read one by one.
+ *
+ *  This is useful for huge XML documents that consist of a long
+ *  list of small, independent entries, since only one such entry
+ *  has to be kept in memory at any time.
+ */
+class XMLReader {
+public:
+	XMLReader(Common::ReadStream &stream, bool makeLower = false);
+	~XMLReader();
+
+	/** Return the XML root node. It has no children. */
+	const XMLNode &getRoot() const;
+
+	/** Read the next child of the root node, together with all its own children.
+	 *
+	 *  The returned node is only valid until the next call to readChild().
+	 *
+	 *  @return The next child node, or 0 if all children have been read.
+	 */
+	const XMLNode *readChild();
+
+private:
+	_xmlTextReader *_reader;
+
+	bool _makeLower;
+
+	XMLNode *_rootNode;
+	XMLNode *_child;
+
+	/** Should the next read skip over the subtree of the current node? */
+	bool _skipChildren;
+	/** Have we read all of the root's children? */
+	bool _finished;
+
+	void clear();
+};
+
 class XMLNode {
 public:
 	typedef std::map<Common::UString, Common::UString> Properties;
@@ -90,13 +134,14 @@ private:
 	Properties _properties;
 
 
-	XMLNode(_xmlNode &node, bool makeLower = false, XMLNode *parent = 0);
+	XMLNode(_xmlNode &node, bool makeLower = false, XMLNode *parent = 0, bool loadChildren = true);
 	~XMLNode();
 
-	void load(_xmlNode &node, bool makeLower);
+	void load(_xmlNode &node, bool makeLower, bool loadChildren);
 	void clean();
 
 	friend class XMLParser;
+	friend class XMLReader;
 };
 
 } // End of namespace XML
@@ -102,28 +102,32 @@ void XMLWriter::writeTag() {
 	_stream->writeString(">");
 
 	if (!tag.empty) {
-		if (!tag.base64.empty()) {
+		if (!tag.data.empty()) {
 
-			if (tag.base64.size() == 1) {
+			writeBase64(tag);
 
-				_stream->writeString(tag.base64.front());
-				tag.base64.pop_front();
+		} else
+			_stream->writeString(escape(tag.contents));
+	}
+}
 
-			} else {
+void XMLWriter::writeBase64(Tag &tag) {
+	static const size_t kLineLength = 64;
 
-				while (!tag.base64.empty()) {
-					breakLine();
-					indent(_openTags.size());
-					_stream->writeString(tag.base64.front());
-					tag.base64.pop_front();
-				}
-				breakLine();
+	Common::MemoryReadStream data(&tag.data[0], tag.data.size());
 
-			}
+	if (Common::getBase64Length(tag.data.size()) <= kLineLength) {
+		// Fits onto a single line, write it directly after the opening tag
+		Common::encodeBase64(data, *_stream, kLineLength);
 
-		} else
-			_stream->writeString(escape(tag.contents));
+	} else {
+		// Write every line on its own, properly indented
+		Common::encodeBase64(data, *_stream, kLineLength, "\n" + Common::UString(' ', _openTags.size() * 2));
+
+		breakLine();
 	}
+
+	std::vector<byte>().swap(tag.data);
 }
 
 void XMLWriter::indent(size_t level) {
@@ -182,7 +186,7 @@ void XMLWriter::setContents(const Common::UString &contents) {
 
 	Tag &tag = _openTags.back();
 
-	tag.base64.clear();
+	tag.data.clear();
 
 	tag.contents = contents;
 	tag.empty    = false;
@@ -194,11 +198,9 @@ void XMLWriter::setContents(const byte *data, size_t size) {
 
 	Tag &tag = _openTags.back();
 
-	tag.base64.clear();
 	tag.contents.clear();
 
-	Common::MemoryReadStream stream(data, size);
-	Common::encodeBase64(stream, tag.base64, 64);
+	tag.data.assign(data, data + size);
 
 	tag.empty = false;
 }
@@ -209,10 +211,10 @@ void XMLWriter::setContents(Common::SeekableReadStream &stream) {
 
 	Tag &tag = _openTags.back();
 
-	tag.base64.clear();
 	tag.contents.clear();
 
-	Common::encodeBase64(stream, tag.base64, 64);
+	tag.data.resize(stream.size() - stream.pos());
+	tag.data.resize(stream.read(tag.data.empty() ? 0 : &tag.data[0], tag.data.size()));
 
 	tag.empty = false;
 }
@@ -26,6 +26,7 @@
 #define XML_XMLWRITER_H
 
 #include <list>
+#include <vector>
 
 #include "src/common/ustring.h"
 
@@ -73,7 +74,7 @@ private:
 		std::list<Property> properties;
 
 		Common::UString contents;
-		std::list<Common::UString> base64;
+		std::vector<byte> data; ///< Binary contents, base64-encoded when written.
 
 		bool written;
 		bool empty;
@@ -89,6 +90,7 @@ private:
 
 	void indent(size_t level);
 	void writeTag();
+	void writeBase64(Tag &tag);
 
 	Common::UString escape(const Common::UString &str);
 };
@@ -47,10 +47,10 @@
 void printUsage(FILE *stream, const Common::UString &name);
 bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
                       Common::UString &inFile, Common::UString &outFile,
-                      Aurora::FileType &type, bool &flip);
+                      Aurora::FileType &type, bool &flip, bool &rle, bool &png, Images::DecodeOptions &options);
 
 void convert(const Common::UString &inFile, const Common::UString &outFile,
-             Aurora::FileType type, bool flip);
+             Aurora::FileType type, bool flip, bool rle, bool png, const Images::DecodeOptions &options);
 
 int main(int argc, char **argv) {
 	try {
@@ -61,11 +61,17 @@ int main(int argc, char **argv) {
 		Common::UString inFile, outFile;
 		Aurora::FileType type = Aurora::kFileTypeNone;
 		bool flip = false;
+		bool rle = false;
+		bool png = false;
 
-		if (!parseCommandLine(args, returnValue, inFile, outFile, type, flip))
+		// Only a single mip map is written, so there's no need to read the others
+		Images::DecodeOptions options;
+		options.mipMapCount = 1;
+
+		if (!parseCommandLine(args, returnValue, inFile, outFile, type, flip, rle, png, options))
 			return returnValue;
 
-		convert(inFile, outFile, type, flip);
+		convert(inFile, outFile, type, flip, rle, png, options);
 	} catch (...) {
 		Common::exceptionDispatcherError();
 	}
@@ -75,7 +81,7 @@ int main(int argc, char **argv) {
 
 bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue,
                       Common::UString &inFile, Common::UString &outFile,
-                      Aurora::FileType &type, bool &flip) {
+                      Aurora::FileType &type, bool &flip, bool &rle, bool &png, Images::DecodeOptions &options) {
 
 	std::vector<Common::UString> files;
 
@@ -127,6 +133,75 @@ bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue
 			} else if ((argv[i] == "-f") || (argv[i] == "--flip")) {
 				isOption = true;
 				flip     = true;
+			} else if (argv[i] == "--rle") {
+				isOption = true;
+				rle      = true;
+			} else if (argv[i] == "--png") {
+				isOption = true;
+				png      = true;
+			} else if ((argv[i] == "-m") || (argv[i] == "--mipmap")) {
+				isOption = true;
+
+				try {
+					// Needs the mip map as the next parameter
+					if (i++ == (argv.size() - 1))
+						throw 0;
+
+					Common::parseString(argv[i], options.firstMipMap);
+
+				} catch (...) {
+					printUsage(stderr, argv[0]);
+					returnValue = 1;
+
+					return false;
+				}
+
+			} else if ((argv[i] == "-l") || (argv[i] == "--layer")) {
+				isOption = true;
+
+				try {
+					// Needs the layer as the next parameter
+					if (i++ == (argv.size() - 1))
+						throw 0;
+
+					Common::parseString(argv[i], options.firstLayer);
+					options.layerCount = 1;
+
+				} catch (...) {
+					printUsage(stderr, argv[0]);
+					returnValue = 1;
+
+					return false;
+				}
+
+			} else if (argv[i] == "--area") {
+				isOption = true;
+
+				try {
+					// Needs the area as the next parameter
+					if (i++ == (argv.size() - 1))
+						throw 0;
+
+					std::vector<Common::UString> area;
+					Common::UString::split(argv[i], ',', area);
+					if (area.size() != 4)
+						throw 0;
+
+					Common::parseString(area[0], options.areaX);
+					Common::parseString(area[1], options.areaY);
+					Common::parseString(area[2], options.areaWidth);
+					Common::parseString(area[3], options.areaHeight);
+
+					if ((options.areaX < 0) || (options.areaY < 0) || !options.hasArea())
+						throw 0;
+
+				} catch (...) {
+					printUsage(stderr, argv[0]);
+					returnValue = 1;
+
+					return false;
+				}
+
 			} else if (argv[i].beginsWith("-") || argv[i].beginsWith("--")) {
 			  // An options, but we already checked for all known ones
 
@@ -158,11 +233,17 @@ bool parseCommandLine(const std::vector<Common::UString> &argv, int &returnValue
 }
 
 void printUsage(FILE *stream, const Common::UString &name) {
-	std::fprintf(stream, "BioWare textures to TGA converter\n");
+	std::fprintf(stream, "BioWare textures to TGA or PNG converter\n");
 	std::fprintf(stream, "Usage: %s [<options>] <input file> <output file>\n", name.c_str());
 	std::fprintf(stream, "  -h      --help              This help text\n");
 	std::fprintf(stream, "          --version           Display version information\n");
 	std::fprintf(stream, "  -f      --flip              Flip the image vertically\n");
+	std::fprintf(stream, "          --rle               Write a run-length encoded TGA\n");
+	std::fprintf(stream, "          --png               Write a PNG instead of a TGA\n");
+	std::fprintf(stream, "  -m <n>  --mipmap <n>        Write mip map n instead of the largest one\n");
+	std::fprintf(stream, "  -l <n>  --layer <n>         Only write layer n\n");
+	std::fprintf(stream, "          --area <x>,<y>,<w>,<h>\n");
+	std::fprintf(stream, "                              Only write this area of the image\n");
 	std::fprintf(stream, "          --auto              Autodetect input type (default)\n");
 	std::fprintf(stream, "          --dds               Input file is DDS\n");
 	std::fprintf(stream, "          --sbm               Input file is SBM\n");
@@ -202,16 +283,23 @@ static Aurora::FileType detectType(const Common::UString &file) {
 	return Aurora::kFileTypeNone;
 }
 
-Images::Decoder *openImage(Common::SeekableReadStream &stream, Aurora::FileType type) {
+Images::Decoder *openImage(Common::SeekableReadStream &stream, Aurora::FileType type,
+                           const Images::DecodeOptions &options) {
+
+	// SBM and TGA images only have a single mip map and layer, and can't be cropped
+	const bool needsOptions = (options.firstMipMap != 0) || (options.firstLayer != 0) || options.hasArea();
+	if (needsOptions && ((type == Aurora::kFileTypeSBM) || (type == Aurora::kFileTypeTGA)))
+		throw Common::Exception("Mip maps, layers and areas can't be selected for this image type");
+
 	switch (type) {
 		case Aurora::kFileTypeDDS:
-			return new Images::DDS(stream);
+			return new Images::DDS(stream, options);
 		case Aurora::kFileTypeSBM:
 			return new Images::SBM(stream);
 		case Aurora::kFileTypeTPC:
-			return new Images::TPC(stream);
+			return new Images::TPC(stream, options);
 		case Aurora::kFileTypeTXB:
-			return new Images::TXB(stream);
+			return new Images::TXB(stream, options);
 		case Aurora::kFileTypeTGA:
 			return new Images::TGA(stream);
 
@@ -221,7 +309,7 @@ Images::Decoder *openImage(Common::SeekableReadStream &stream, Aurora::FileType
 }
 
 void convert(const Common::UString &inFile, const Common::UString &outFile,
-             Aurora::FileType type, bool flip) {
+             Aurora::FileType type, bool flip, bool rle, bool png, const Images::DecodeOptions &options) {
 
 	Common::ReadFile in(inFile);
 
@@ -238,12 +326,15 @@ void convert(const Common::UString &inFile, const Common::UString &outFile,
 		}
 	}
 
-	Images::Decoder *image = openImage(in, type);
+	Images::Decoder *image = openImage(in, type, options);
 	if (flip)
 		image->flipVertically();
 
 	try {
-		image->dumpTGA(outFile);
+		if (png)
+			image->dumpPNG(outFile);
+		else
+			image->dumpTGA(outFile, rle);
 	} catch (...) {
 		delete image;
 		throw;